@@ -1,5 +1,6 @@
 #include "./Common/d3dApp.h"
 #include "./Common/MathHelper.h"
+#include "./Common/MeshGeometry.h"
 #include <DirectXColors.h>
 #include <DirectX-Headers/include/directx/d3dx12_barriers.h>
 #include "./Common/UploadBuffer.h"
@@ -13,8 +14,13 @@ struct ObjectConstants
 	XMFLOAT4X4 WorldViewProj = MathHelper::Identity4x4();
 };
 
-struct Vertex {
+// The box's vertices as two streams: positions in slot 0 and colors in
+// slot 1, so a depth-only pass can bind slot 0 and fetch 12 bytes a vertex.
+struct VPosData {
 	XMFLOAT3 Pos;
+};
+
+struct VColorData {
 	XMFLOAT4 Color;
 };
 
@@ -62,6 +68,8 @@ private:
 	std::vector<D3D12_INPUT_ELEMENT_DESC> mInputLayout;
 
 	std::unique_ptr<MeshGeometry> mBoxGeo = nullptr;
+	// Completes when the copy queue has filled mBoxGeo's buffers.
+	CopyQueue::Token mBoxUploads = 0;
 
 	Microsoft::WRL::ComPtr<ID3D12PipelineState> mPSO = nullptr;
 };
@@ -147,7 +155,7 @@ void BoxRenderer::BuildDescriptorHeaps()
 void BoxRenderer::BuildConstantBuffers()
 {
 	// UploadBuffer is a wrapper of ID3D12Resource that put in Upload buffer
-	mObjectCB = std::make_unique<UploadBuffer<ObjectConstants>>(md3dDevice.Get(), 1, true);
+	mObjectCB = std::make_unique<UploadBuffer<ObjectConstants>>(*mGpuAllocator, 1, true);
 
 	UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
 	// Address to start of the buffer (0th constant buffer).
@@ -216,22 +224,34 @@ void BoxRenderer::BuildShadersAndInputLayout()
 	mInputLayout =
 	{
 		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
 	};
 }
 
 void BoxRenderer::BuildBoxGeometry()
 {
-	std::array<Vertex, 8> vertices =
+	std::array<VPosData, 8> positions =
+	{
+		VPosData({ XMFLOAT3(-1.0f, -1.0f, -1.0f) }),
+		VPosData({ XMFLOAT3(-1.0f, +1.0f, -1.0f) }),
+		VPosData({ XMFLOAT3(+1.0f, +1.0f, -1.0f) }),
+		VPosData({ XMFLOAT3(+1.0f, -1.0f, -1.0f) }),
+		VPosData({ XMFLOAT3(-1.0f, -1.0f, +1.0f) }),
+		VPosData({ XMFLOAT3(-1.0f, +1.0f, +1.0f) }),
+		VPosData({ XMFLOAT3(+1.0f, +1.0f, +1.0f) }),
+		VPosData({ XMFLOAT3(+1.0f, -1.0f, +1.0f) })
+	};
+
+	std::array<VColorData, 8> colors =
 	{
-		Vertex({ XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT4(Colors::White) }),
-		Vertex({ XMFLOAT3(-1.0f, +1.0f, -1.0f), XMFLOAT4(Colors::Black) }),
-		Vertex({ XMFLOAT3(+1.0f, +1.0f, -1.0f), XMFLOAT4(Colors::Red) }),
-		Vertex({ XMFLOAT3(+1.0f, -1.0f, -1.0f), XMFLOAT4(Colors::Green) }),
-		Vertex({ XMFLOAT3(-1.0f, -1.0f, +1.0f), XMFLOAT4(Colors::Blue) }),
-		Vertex({ XMFLOAT3(-1.0f, +1.0f, +1.0f), XMFLOAT4(Colors::Yellow) }),
-		Vertex({ XMFLOAT3(+1.0f, +1.0f, +1.0f), XMFLOAT4(Colors::Cyan) }),
-		Vertex({ XMFLOAT3(+1.0f, -1.0f, +1.0f), XMFLOAT4(Colors::Magenta) })
+		VColorData({ XMFLOAT4(Colors::White) }),
+		VColorData({ XMFLOAT4(Colors::Black) }),
+		VColorData({ XMFLOAT4(Colors::Red) }),
+		VColorData({ XMFLOAT4(Colors::Green) }),
+		VColorData({ XMFLOAT4(Colors::Blue) }),
+		VColorData({ XMFLOAT4(Colors::Yellow) }),
+		VColorData({ XMFLOAT4(Colors::Cyan) }),
+		VColorData({ XMFLOAT4(Colors::Magenta) })
 	};
 
 	std::array<std::uint16_t, 36> indices =
@@ -261,21 +281,35 @@ void BoxRenderer::BuildBoxGeometry()
 		4, 3, 7
 	};
 
-	unsigned vbByteSize = vertices.size() * sizeof(Vertex);
+	unsigned vbByteSize = positions.size() * sizeof(VPosData);
+	unsigned colorByteSize = colors.size() * sizeof(VColorData);
 	unsigned ibByteSize = indices.size() * sizeof(std::uint16_t);
 
 	mBoxGeo = std::make_unique<MeshGeometry>();
 	mBoxGeo->Name = "boxGeo";
 
+	// The buffers are filled on the copy queue rather than mCommandList;
+	// uploads complete in order, so the last token covers all of them.
+	auto createBuffer = [&](const void* data, UINT64 byteSize)
+	{
+		return mCopyQueue->CreateDefaultBuffer(*mGpuAllocator, data, byteSize, mBoxUploads);
+	};
+
 	ThrowIfFailed(D3DCreateBlob(static_cast<SIZE_T>(vbByteSize), mBoxGeo->VertexBufferCPU.GetAddressOf()));
-	memcpy(mBoxGeo->VertexBufferCPU->GetBufferPointer(), vertices.data(), static_cast<size_t>(vbByteSize));
-	mBoxGeo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(), mCommandList.Get(), vertices.data(), static_cast<size_t>(vbByteSize), mBoxGeo->VertexBufferUploader);
+	memcpy(mBoxGeo->VertexBufferCPU->GetBufferPointer(), positions.data(), static_cast<size_t>(vbByteSize));
+	mBoxGeo->VertexBufferGPU = createBuffer(positions.data(), vbByteSize);
+
+	MeshGeometry::VertexStream colorStream;
+	colorStream.BufferGPU = createBuffer(colors.data(), colorByteSize);
+	colorStream.ByteStride = sizeof(VColorData);
+	colorStream.ByteSize = colorByteSize;
+	mBoxGeo->AttributeStreams.push_back(colorStream);
 
 	ThrowIfFailed(D3DCreateBlob(static_cast<SIZE_T>(ibByteSize), mBoxGeo->IndexBufferCPU.GetAddressOf()));
 	memcpy(mBoxGeo->IndexBufferCPU->GetBufferPointer(), indices.data(), static_cast<size_t>(ibByteSize));
-	mBoxGeo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(), mCommandList.Get(), indices.data(), static_cast<size_t>(ibByteSize), mBoxGeo->IndexBufferUploader);
+	mBoxGeo->IndexBufferGPU = createBuffer(indices.data(), ibByteSize);
 
-	mBoxGeo->VertexByteStride = sizeof(Vertex);
+	mBoxGeo->VertexByteStride = sizeof(VPosData);
 	mBoxGeo->VertexBufferByteSize = vbByteSize;
 	mBoxGeo->IndexFormat = DXGI_FORMAT_R16_UINT;
 	mBoxGeo->IndexBufferByteSize = ibByteSize;
@@ -336,6 +370,8 @@ bool BoxRenderer::Initialize()
 	BuildRootSignature();
 	BuildShadersAndInputLayout();
 	BuildBoxGeometry();
+	// Start the copies now; they run while the PSO compiles.
+	mCopyQueue->Submit();
 	BuildPSO();
 
 	// Done recording commands.
@@ -359,6 +395,8 @@ void BoxRenderer::OnResize()
 }
 void BoxRenderer::Update(const GameTimer& gt)
 {
+	mCopyQueue->Retire();
+
 	// Convert Spherical to Cartesian coordinates.
 	float x = mRadius * sinf(mPhi) * cosf(mTheta);
 	float z = mRadius * sinf(mPhi) * sinf(mTheta);
@@ -424,7 +462,9 @@ void BoxRenderer::Draw(const GameTimer& gt)
 	//       You can place different attributes in different slots (non-interleaved streams).
 	//       You CANNOT place vertex 0..99 in slot0 and vertex 100..199 in slot1 and expect correct indexing.
 	//       The InputLayout's InputSlot field determines which slot each vertex attribute is read from.
-	mCommandList->IASetVertexBuffers(0, 1, &mBoxGeo->VertexBufferView());
+	D3D12_VERTEX_BUFFER_VIEW vertexBufferViews[2];
+	UINT vertexBufferCount = mBoxGeo->VertexBufferViews(vertexBufferViews, _countof(vertexBufferViews));
+	mCommandList->IASetVertexBuffers(0, vertexBufferCount, vertexBufferViews);
 	mCommandList->IASetIndexBuffer(&mBoxGeo->IndexBufferView());
 
 	mCommandList->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
@@ -438,6 +478,9 @@ void BoxRenderer::Draw(const GameTimer& gt)
 	mCommandList->ResourceBarrier(1, &barrier);
 	// Done recording commands.
 	ThrowIfFailed(mCommandList->Close());
+	// The box can't be drawn before its buffers are filled.  Only the first
+	// frame waits; the copy queue skips waits it has already issued.
+	mCopyQueue->WaitOnGpu(mCommandQueue.Get(), mBoxUploads);
 	// Add the command list to the queue for execution.
 	ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
 	mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
@@ -1,19 +1,54 @@
 #include "./Common/d3dApp.h"
 #include "./Common/MathHelper.h"
+#include "./Common/MeshGeometry.h"
 #include <DirectXColors.h>
+#include <chrono>
 #include <DirectX-Headers/include/directx/d3dx12_barriers.h>
 #include "./Common/UploadBuffer.h"
 #include "FrameResource.h"
 #include "RenderItem.h"
 #include "./Common/GeometryGenerator.h"
+#include "./Common/GeometryCache.h"
+#include "./Common/GeometryPool.h"
+#include "./Common/UploadRingBuffer.h"
+#include "./Common/NameRegistry.h"
+#include "./Common/MeshOptimizer.h"
+#include "./Common/MeshSimplifier.h"
+#include "./Common/VertexCompression.h"
 
 using namespace DirectX;
 
 const int gNumFrameResources = 3;
 
+namespace
+{
+	// Names the app looks up after setup, hashed at compile time.
+	constexpr NameId kShapeGeo("shapeGeo");
+	constexpr NameId kBox("box");
+	constexpr NameId kGrid("grid");
+	constexpr NameId kSphere("sphere");
+	constexpr NameId kCylinder("cylinder");
+
+	// Directory holding the running executable, without a trailing slash.
+	// Unlike the working directory it does not depend on how the app was
+	// started.
+	std::wstring ExecutableDirectory()
+	{
+		std::wstring path(MAX_PATH, L'\0');
+		DWORD length;
+		while ((length = GetModuleFileNameW(nullptr, &path[0], static_cast<DWORD>(path.size()))) == path.size())
+			path.resize(path.size() * 2);
+		if (length == 0)
+			return L".";
+		path.resize(length);
+		return path.substr(0, path.find_last_of(L"\\/"));
+	}
+}
+
+// Position only, as unorm16 relative to the submesh bounds (see
+// VertexCompression).  The color is a per object constant.
 struct Vertex {
-	XMFLOAT3 Pos;
-	XMFLOAT4 Color;
+	std::uint16_t Pos[4];
 };
 
 using namespace DirectX;
@@ -43,7 +78,9 @@ private:
 
 	void UpdateObjectCBs(const GameTimer& gt);
 	void UpdateMainPassCB(const GameTimer& gt);
+	void UpdateLods();
 	void BuildShapeGeometry();
+	void LogGeometryMemory();
 private:
 	XMFLOAT2 mLastMousePos;
 	float mTheta = 1.5f * XM_PI;
@@ -51,6 +88,11 @@ private:
 	float mRadius = 5.0f;
 
 	XMFLOAT3 mEyePos;
+	// Largest simplification error, in pixels, a LOD may show on screen.
+	float mLodPixelThreshold = 1.0f;
+
+	// Generated meshes, persisted next to the executable between runs.
+	GeometryCache mGeometryCache{ ExecutableDirectory() + L"\\GeometryCache" };
 
 	XMFLOAT4X4 mWorld = MathHelper::Identity4x4();
 	XMFLOAT4X4 mView = MathHelper::Identity4x4();
@@ -66,11 +108,16 @@ private:
 	std::vector<RenderItem*> mOpaqueRitems;
 	std::vector<RenderItem*> mTransparentRitems;
 
+	// The pass CBV of each frame resource.  Object constants are bound as
+	// root CBVs and need no descriptors.
 	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mCbvHeap;
-	/*
-	| frameRes 0, object 0 | ... | frameRes gNumFrameResources - 1, object objectCount -1 | frameRes 0 passData | frameRes 1 pass Data | .... |
-	*/
-	UINT mPassCbvOffset;
+
+	// Per-object data as one StructuredBuffer a frame, indexed by a root
+	// constant per draw, rather than a root CBV per draw.  Set before
+	// Initialize; it picks the root signature and shader variant.
+	bool mObjectDataInBuffer = true;
+	// This frame's StructuredBuffer, bound as a root SRV.
+	D3D12_GPU_VIRTUAL_ADDRESS mObjectBufferAddress = 0;
 
 	Microsoft::WRL::ComPtr<ID3D12RootSignature> mRootSignature;
 
@@ -79,10 +126,18 @@ private:
 
 	std::vector<D3D12_INPUT_ELEMENT_DESC> mInputLayout;
 
-	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> mGeometries;
-
-	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3DBlob>> mShaders;
-	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D12PipelineState>> mPSOs;
+	NameRegistry<std::unique_ptr<MeshGeometry>> mGeometries;
+	// Shared vertex and index buffers that the geometries are sub-allocated
+	// from.
+	std::unique_ptr<GeometryPool> mGeometryPool;
+	// Upload memory every buffer upload is staged through.
+	std::unique_ptr<UploadRingBuffer> mUploadRing;
+
+	NameRegistry<Microsoft::WRL::ComPtr<ID3DBlob>> mShaders;
+	NameRegistry<Microsoft::WRL::ComPtr<ID3D12PipelineState>> mPSOs;
+	// Resolved in BuildPSO so Draw indexes mPSOs directly.
+	NameRegistry<Microsoft::WRL::ComPtr<ID3D12PipelineState>>::Handle mOpaquePso =
+		NameRegistry<Microsoft::WRL::ComPtr<ID3D12PipelineState>>::InvalidHandle;
 };
 
 
@@ -152,15 +207,10 @@ void ShapeRenderer::OnMouseMove(WPARAM btnState, int x, int y)
 // CreateDescriptorHeap for CBV
 void ShapeRenderer::BuildDescriptorHeaps()
 {
-	UINT objCount = (UINT)mOpaqueRitems.size();
-	// Need a CBV descriptor for each object for each frame resource,
-	// +1 for the perPass CBV for each frame resource.
-	UINT numDescriptors = (objCount + 1) * gNumFrameResources;
+	// Need a perPass CBV for each frame resource.
+	UINT numDescriptors = gNumFrameResources;
 	// create cbv heap, we will not use SRV and UAV in this demo;
 
-	// Save an offset to the start of the pass CBVs. These are the last 3 descriptors.
-	mPassCbvOffset = objCount * gNumFrameResources;
-
 	D3D12_DESCRIPTOR_HEAP_DESC cbvHeapDesc;
 	cbvHeapDesc.NumDescriptors = numDescriptors;
 	cbvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
@@ -171,28 +221,6 @@ void ShapeRenderer::BuildDescriptorHeaps()
 
 void ShapeRenderer::BuildConstantBufferViews()
 {
-	UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
-
-	UINT objCount = (UINT)mOpaqueRitems.size();
-	for (int frameIdx = 0; frameIdx < gNumFrameResources; frameIdx++) {
-		FrameResource* cur = mFrameResources[frameIdx].get();
-		D3D12_GPU_VIRTUAL_ADDRESS cbAddress = cur->ObjectCB->Resource()->GetGPUVirtualAddress();
-		for (int i = 0; i < objCount; i++) {
-			D3D12_GPU_VIRTUAL_ADDRESS trueAddress = cbAddress + objCBByteSize * i;
-			D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc;
-			cbvDesc.BufferLocation = trueAddress;
-			cbvDesc.SizeInBytes = objCBByteSize;
-
-			// Offset to the object CBV in the descriptor heap.
-			// Each FrameResource has it own ObjectCB, but they share one mCbvHeap
-			int heapIndex = frameIdx * objCount + i;
-			auto cbvHanle = CD3DX12_CPU_DESCRIPTOR_HANDLE(mCbvHeap->GetCPUDescriptorHandleForHeapStart());
-			cbvHanle.Offset(heapIndex, mCbvSrvUavDescriptorSize);
-
-			md3dDevice->CreateConstantBufferView(&cbvDesc, cbvHanle);
-		}
-	}
-
 	UINT passCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(PassConstants));
 	for (int frameIdx = 0; frameIdx < gNumFrameResources; frameIdx++) {
 		
@@ -203,7 +231,7 @@ void ShapeRenderer::BuildConstantBufferViews()
 		cbvDesc.BufferLocation = cbAddress;
 		cbvDesc.SizeInBytes = passCBByteSize;
 
-		int heapIdx = mPassCbvOffset + frameIdx;
+		int heapIdx = frameIdx;
 		auto cbvHanle = CD3DX12_CPU_DESCRIPTOR_HANDLE(mCbvHeap->GetCPUDescriptorHandleForHeapStart());
 		cbvHanle.Offset(heapIdx, mCbvSrvUavDescriptorSize);
 
@@ -217,33 +245,60 @@ void ShapeRenderer::BuildFrameResources()
 	for (int i = 0; i < gNumFrameResources; ++i)
 	{
 		mFrameResources.push_back(std::make_unique<FrameResource>(
-			md3dDevice.Get(), 1, (UINT)mAllRitems.size()));
+			md3dDevice.Get(), *mGpuAllocator, 1));
 	}
 }
 
 void ShapeRenderer::BuildRenderItems()
 {
+	// Collects "<name>", "<name>_lod1", ... for render items that pick their
+	// level of detail at runtime.
+	MeshGeometry* shapeGeo = mGeometries[kShapeGeo].get();
+	auto lodsOf = [shapeGeo](const std::string& name)
+	{
+		std::vector<SubmeshGeometry> lods = { shapeGeo->DrawArgs[NameId(name)] };
+		for (int i = 1;; ++i)
+		{
+			auto handle = shapeGeo->DrawArgs.Find(name + "_lod" + std::to_string(i));
+			if (handle == NameRegistry<SubmeshGeometry>::InvalidHandle)
+				break;
+			lods.push_back(shapeGeo->DrawArgs[handle]);
+		}
+		return lods;
+	};
+
+	// Look every submesh up once; the items below only copy from these.
+	const SubmeshGeometry& boxSubmesh = shapeGeo->DrawArgs[kBox];
+	const SubmeshGeometry& gridSubmesh = shapeGeo->DrawArgs[kGrid];
+	const SubmeshGeometry& sphereSubmesh = shapeGeo->DrawArgs[kSphere];
+	const SubmeshGeometry& cylinderSubmesh = shapeGeo->DrawArgs[kCylinder];
+	std::vector<SubmeshGeometry> gridLods = lodsOf("grid");
+	std::vector<SubmeshGeometry> sphereLods = lodsOf("sphere");
+	std::vector<SubmeshGeometry> cylinderLods = lodsOf("cylinder");
+
 	auto boxRitem = std::make_unique<RenderItem>();
 	XMStoreFloat4x4(&boxRitem->World, XMMatrixScaling(2.0f, 2.0f, 2.0f) * XMMatrixTranslation(0.0f, 0.5f, 0.0f));
-	boxRitem->ObjCBIndex = 0;
-	boxRitem->Geo = mGeometries["shapeGeo"].get();
+	boxRitem->Geo = shapeGeo;
 	boxRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	boxRitem->IndexCount = boxRitem->Geo->DrawArgs["box"].IndexCount;
-	boxRitem->StartIndexLocation = boxRitem->Geo->DrawArgs["box"].StartIndexLocation;
-	boxRitem->BaseVertexLocation = boxRitem->Geo->DrawArgs["box"].BaseVertexLocation;
+	boxRitem->IndexCount = boxSubmesh.IndexCount;
+	boxRitem->StartIndexLocation = boxSubmesh.StartIndexLocation;
+	boxRitem->BaseVertexLocation = boxSubmesh.BaseVertexLocation;
+	boxRitem->PositionDecode = VertexCompression::QuantizationFor(boxSubmesh.Bounds);
+	boxRitem->Color = XMFLOAT4(DirectX::Colors::DarkGreen);
 	mAllRitems.push_back(std::move(boxRitem));
 
 	auto gridRitem = std::make_unique<RenderItem>();
 	gridRitem->World = MathHelper::Identity4x4();
-	gridRitem->ObjCBIndex = 1;
-	gridRitem->Geo = mGeometries["shapeGeo"].get();
+	gridRitem->Geo = shapeGeo;
 	gridRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	gridRitem->IndexCount = gridRitem->Geo->DrawArgs["grid"].IndexCount;
-	gridRitem->StartIndexLocation = gridRitem->Geo->DrawArgs["grid"].StartIndexLocation;
-	gridRitem->BaseVertexLocation = gridRitem->Geo->DrawArgs["grid"].BaseVertexLocation;
+	gridRitem->IndexCount = gridSubmesh.IndexCount;
+	gridRitem->StartIndexLocation = gridSubmesh.StartIndexLocation;
+	gridRitem->BaseVertexLocation = gridSubmesh.BaseVertexLocation;
+	gridRitem->Lods = gridLods;
+	gridRitem->PositionDecode = VertexCompression::QuantizationFor(gridSubmesh.Bounds);
+	gridRitem->Color = XMFLOAT4(DirectX::Colors::ForestGreen);
 	mAllRitems.push_back(std::move(gridRitem));
 
-	UINT objCBIndex = 2;
 	for (int i = 0; i < 5; ++i)
 	{
 		auto leftCylRitem = std::make_unique<RenderItem>();
@@ -258,36 +313,44 @@ void ShapeRenderer::BuildRenderItems()
 		XMMATRIX rightSphereWorld = XMMatrixTranslation(+5.0f, 3.5f, -10.0f + i * 5.0f);
 
 		XMStoreFloat4x4(&leftCylRitem->World, rightCylWorld);
-		leftCylRitem->ObjCBIndex = objCBIndex++;
-		leftCylRitem->Geo = mGeometries["shapeGeo"].get();
+		leftCylRitem->Geo = shapeGeo;
 		leftCylRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-		leftCylRitem->IndexCount = leftCylRitem->Geo->DrawArgs["cylinder"].IndexCount;
-		leftCylRitem->StartIndexLocation = leftCylRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
-		leftCylRitem->BaseVertexLocation = leftCylRitem->Geo->DrawArgs["cylinder"].BaseVertexLocation;
+		leftCylRitem->IndexCount = cylinderSubmesh.IndexCount;
+		leftCylRitem->StartIndexLocation = cylinderSubmesh.StartIndexLocation;
+		leftCylRitem->BaseVertexLocation = cylinderSubmesh.BaseVertexLocation;
+		leftCylRitem->Lods = cylinderLods;
+		leftCylRitem->PositionDecode = VertexCompression::QuantizationFor(cylinderSubmesh.Bounds);
+		leftCylRitem->Color = XMFLOAT4(DirectX::Colors::SteelBlue);
 
 		XMStoreFloat4x4(&rightCylRitem->World, leftCylWorld);
-		rightCylRitem->ObjCBIndex = objCBIndex++;
-		rightCylRitem->Geo = mGeometries["shapeGeo"].get();
+		rightCylRitem->Geo = shapeGeo;
 		rightCylRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-		rightCylRitem->IndexCount = rightCylRitem->Geo->DrawArgs["cylinder"].IndexCount;
-		rightCylRitem->StartIndexLocation = rightCylRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
-		rightCylRitem->BaseVertexLocation = rightCylRitem->Geo->DrawArgs["cylinder"].BaseVertexLocation;
+		rightCylRitem->IndexCount = cylinderSubmesh.IndexCount;
+		rightCylRitem->StartIndexLocation = cylinderSubmesh.StartIndexLocation;
+		rightCylRitem->BaseVertexLocation = cylinderSubmesh.BaseVertexLocation;
+		rightCylRitem->Lods = cylinderLods;
+		rightCylRitem->PositionDecode = VertexCompression::QuantizationFor(cylinderSubmesh.Bounds);
+		rightCylRitem->Color = XMFLOAT4(DirectX::Colors::SteelBlue);
 
 		XMStoreFloat4x4(&leftSphereRitem->World, leftSphereWorld);
-		leftSphereRitem->ObjCBIndex = objCBIndex++;
-		leftSphereRitem->Geo = mGeometries["shapeGeo"].get();
+		leftSphereRitem->Geo = shapeGeo;
 		leftSphereRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-		leftSphereRitem->IndexCount = leftSphereRitem->Geo->DrawArgs["sphere"].IndexCount;
-		leftSphereRitem->StartIndexLocation = leftSphereRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
-		leftSphereRitem->BaseVertexLocation = leftSphereRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
+		leftSphereRitem->IndexCount = sphereSubmesh.IndexCount;
+		leftSphereRitem->StartIndexLocation = sphereSubmesh.StartIndexLocation;
+		leftSphereRitem->BaseVertexLocation = sphereSubmesh.BaseVertexLocation;
+		leftSphereRitem->Lods = sphereLods;
+		leftSphereRitem->PositionDecode = VertexCompression::QuantizationFor(sphereSubmesh.Bounds);
+		leftSphereRitem->Color = XMFLOAT4(DirectX::Colors::Crimson);
 
 		XMStoreFloat4x4(&rightSphereRitem->World, rightSphereWorld);
-		rightSphereRitem->ObjCBIndex = objCBIndex++;
-		rightSphereRitem->Geo = mGeometries["shapeGeo"].get();
+		rightSphereRitem->Geo = shapeGeo;
 		rightSphereRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-		rightSphereRitem->IndexCount = rightSphereRitem->Geo->DrawArgs["sphere"].IndexCount;
-		rightSphereRitem->StartIndexLocation = rightSphereRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
-		rightSphereRitem->BaseVertexLocation = rightSphereRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
+		rightSphereRitem->IndexCount = sphereSubmesh.IndexCount;
+		rightSphereRitem->StartIndexLocation = sphereSubmesh.StartIndexLocation;
+		rightSphereRitem->BaseVertexLocation = sphereSubmesh.BaseVertexLocation;
+		rightSphereRitem->Lods = sphereLods;
+		rightSphereRitem->PositionDecode = VertexCompression::QuantizationFor(sphereSubmesh.Bounds);
+		rightSphereRitem->Color = XMFLOAT4(DirectX::Colors::Crimson);
 
 		mAllRitems.push_back(std::move(leftCylRitem));
 		mAllRitems.push_back(std::move(rightCylRitem));
@@ -303,6 +366,9 @@ void ShapeRenderer::BuildRenderItems()
 
 void ShapeRenderer::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
 {
+	// Geometry from the pool shares one set of buffers, so consecutive items
+	// usually need no new bindings.
+	MeshGeometry* boundGeo = nullptr;
 	for (int i = 0; i < ritems.size(); i++) 
 	{
 		auto& ri = ritems[i];
@@ -311,37 +377,80 @@ void ShapeRenderer::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const st
 		//       You can place different attributes in different slots (non-interleaved streams).
 		//       You CANNOT place vertex 0..99 in slot0 and vertex 100..199 in slot1 and expect correct indexing.
 		//       The InputLayout's InputSlot field determines which slot each vertex attribute is read from.
-		cmdList->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
-		cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
-
-		cmdList->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		if (ri->Geo != boundGeo)
+		{
+			D3D12_VERTEX_BUFFER_VIEW vertexBufferViews[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+			UINT vertexBufferCount = ri->Geo->VertexBufferViews(vertexBufferViews, _countof(vertexBufferViews));
+			cmdList->IASetVertexBuffers(0, vertexBufferCount, vertexBufferViews);
+			cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
+			cmdList->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+			boundGeo = ri->Geo;
+		}
 		
-		UINT objCount = (UINT)mOpaqueRitems.size();
-		CD3DX12_GPU_DESCRIPTOR_HANDLE objectCbVhandle(mCbvHeap->GetGPUDescriptorHandleForHeapStart());
-		objectCbVhandle.Offset(ri->ObjCBIndex + objCount * mCurrFrameResourceIndex, mCbvSrvUavDescriptorSize);
-		cmdList->SetGraphicsRootDescriptorTable(0, objectCbVhandle);
+		// With the object buffer, a draw only has to say which object it is.
+		if (mObjectDataInBuffer)
+			cmdList->SetGraphicsRoot32BitConstant(2, ri->ObjectIndex, 0);
+		else
+			cmdList->SetGraphicsRootConstantBufferView(0, ri->ObjectCBAddress);
 
 		cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
 	}
 }
 
-void ShapeRenderer::UpdateObjectCBs(const GameTimer& gt)
+void ShapeRenderer::UpdateLods()
 {
-	auto currentObjectCB = mCurrFrameResource->ObjectCB.get();
+	// Pixels per object space unit at distance 1.
+	float projectionScale = 0.5f * mClientHeight * mProj(1, 1);
+	XMVECTOR eyePos = XMLoadFloat3(&mEyePos);
+
 	for (auto& e : mAllRitems)
 	{
-		// Only update the cbuffer data if the constants have changed.
-		// This needs to be tracked per frame resource.
-		if (e->NumFramesDirty > 0)
+		if (e->Lods.empty())
+			continue;
+
+		// Measure from the object's origin; the world matrices here carry no scale.
+		XMVECTOR origin = XMVectorSet(e->World(3, 0), e->World(3, 1), e->World(3, 2), 1.0f);
+		float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(origin, eyePos)));
+
+		UINT lod = d3dUtil::SelectLod(e->Lods.data(), static_cast<UINT>(e->Lods.size()),
+			distance, projectionScale, mLodPixelThreshold);
+		e->IndexCount = e->Lods[lod].IndexCount;
+		e->StartIndexLocation = e->Lods[lod].StartIndexLocation;
+		e->BaseVertexLocation = e->Lods[lod].BaseVertexLocation;
+	}
+}
+
+void ShapeRenderer::UpdateObjectCBs(const GameTimer& gt)
+{
+	// The constants are transient: every item drawn this frame gets a fresh
+	// copy, so items can come and go without resizing anything.
+	LinearUploadAllocator* constants = mCurrFrameResource->Constants.get();
+	// With the object buffer, all of them go in one allocation, back to back.
+	LinearUploadAllocator::Allocation objects;
+	if (mObjectDataInBuffer)
+	{
+		objects = constants->Allocate(mAllRitems.size() * sizeof(ObjectConstants));
+		mObjectBufferAddress = objects.GPU;
+	}
+
+	for (UINT i = 0; i < mAllRitems.size(); ++i)
+	{
+		RenderItem* e = mAllRitems[i].get();
+		XMMATRIX world = XMLoadFloat4x4(&e->World);
+		ObjectConstants objConstants;
+		XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
+		objConstants.Color = e->Color;
+		objConstants.PosOffset = e->PositionDecode.Offset;
+		objConstants.PosScale = e->PositionDecode.Scale;
+		if (mObjectDataInBuffer)
 		{
-			XMMATRIX world = XMLoadFloat4x4(&e->World);
-			ObjectConstants objConstants;
-			XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
-			currentObjectCB->CopyData(e->ObjCBIndex, objConstants);
-			// Next FrameResource need to be updated too.
-			e->NumFramesDirty--;
+			StreamingWrites::Write(objects.CPU + i * sizeof(ObjectConstants), &objConstants, sizeof(ObjectConstants));
+			e->ObjectIndex = i;
 		}
+		else
+			e->ObjectCBAddress = constants->Push(objConstants);
 	}
+	StreamingWrites::Fence();
 }
 
 void ShapeRenderer::UpdateMainPassCB(const GameTimer& gt)
@@ -375,99 +484,260 @@ void ShapeRenderer::UpdateMainPassCB(const GameTimer& gt)
 
 void ShapeRenderer::BuildShapeGeometry()
 {
-	GeometryGenerator geoGen;
-	GeometryGenerator::MeshData box = geoGen.CreateBox(1.5f, 0.5f, 1.5f, 3);
-	GeometryGenerator::MeshData grid = geoGen.CreateGrid(20.0f, 30.0f, 60, 40);
-	GeometryGenerator::MeshData sphere = geoGen.CreateSphere(0.5f, 20, 20);
-	GeometryGenerator::MeshData cylinder = geoGen.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20);
+	// The cache loads the meshes from disk when an earlier run already
+	// generated them.
+	auto cacheStart = std::chrono::steady_clock::now();
+	GeometryCache::MeshPtr boxMesh = mGeometryCache.Box(1.5f, 0.5f, 1.5f, 3);
+	GeometryCache::MeshPtr gridMesh = mGeometryCache.Grid(20.0f, 30.0f, 60, 40);
+	GeometryCache::MeshPtr sphereMesh = mGeometryCache.Sphere(0.5f, 20, 20);
+	GeometryCache::MeshPtr cylinderMesh = mGeometryCache.Cylinder(0.5f, 0.3f, 3.0f, 20, 20);
+	double cacheMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cacheStart).count();
+
+	const GeometryCache::Stats& cacheStats = mGeometryCache.GetStats();
+	std::wstring cacheText = L"***GeometryCache: " + std::to_wstring(cacheStats.DiskHits) + L" loaded, " +
+		std::to_wstring(cacheStats.Generated) + L" generated in " + std::to_wstring(cacheMilliseconds) + L" ms\n";
+	OutputDebugString(cacheText.c_str());
+
+	auto sizeOf = [](const GeometryGenerator::MeshData& mesh)
+	{
+		GeometryGenerator::MeshSize size;
+		size.VertexCount = static_cast<std::uint32_t>(mesh.Vertices.size());
+		size.IndexCount = static_cast<std::uint32_t>(mesh.Indices32.size());
+		return size;
+	};
+	GeometryGenerator::MeshSize box = sizeOf(*boxMesh);
+	GeometryGenerator::MeshSize grid = sizeOf(*gridMesh);
+	GeometryGenerator::MeshSize sphere = sizeOf(*sphereMesh);
+	GeometryGenerator::MeshSize cylinder = sizeOf(*cylinderMesh);
 
 	unsigned boxVertexOffset = 0;
-	unsigned gridVertexOffset = box.Vertices.size();
-	unsigned sphereVertexOffset = grid.Vertices.size() + gridVertexOffset;
-	unsigned cylinderVertexOffset = sphere.Vertices.size() + sphereVertexOffset;
+	unsigned gridVertexOffset = box.VertexCount;
+	unsigned sphereVertexOffset = grid.VertexCount + gridVertexOffset;
+	unsigned cylinderVertexOffset = sphere.VertexCount + sphereVertexOffset;
 
 	unsigned boxIndexOffset = 0;
-	unsigned gridIndexOffset = box.Indices32.size();
-	unsigned sphereIndexOffset = gridIndexOffset + grid.Indices32.size();
-	unsigned cylinderIndexOffset = sphereIndexOffset + sphere.Indices32.size();
+	unsigned gridIndexOffset = box.IndexCount;
+	unsigned sphereIndexOffset = gridIndexOffset + grid.IndexCount;
+	unsigned cylinderIndexOffset = sphereIndexOffset + sphere.IndexCount;
 
 	SubmeshGeometry boxSubMesh;
 	boxSubMesh.BaseVertexLocation = boxVertexOffset;
 	boxSubMesh.StartIndexLocation = boxIndexOffset;
-	boxSubMesh.IndexCount = box.Indices32.size();
+	boxSubMesh.IndexCount = box.IndexCount;
 
 	SubmeshGeometry gridSubMesh;
 	gridSubMesh.BaseVertexLocation = gridVertexOffset;
 	gridSubMesh.StartIndexLocation = gridIndexOffset;
-	gridSubMesh.IndexCount = grid.Indices32.size();
+	gridSubMesh.IndexCount = grid.IndexCount;
 
 	SubmeshGeometry sphereSubMesh;
 	sphereSubMesh.BaseVertexLocation = sphereVertexOffset;
 	sphereSubMesh.StartIndexLocation = sphereIndexOffset;
-	sphereSubMesh.IndexCount = sphere.Indices32.size();
+	sphereSubMesh.IndexCount = sphere.IndexCount;
 
 	SubmeshGeometry cylinderSubMesh;
 	cylinderSubMesh.BaseVertexLocation = cylinderVertexOffset;
 	cylinderSubMesh.StartIndexLocation = cylinderIndexOffset;
-	cylinderSubMesh.IndexCount = cylinder.Indices32.size();
+	cylinderSubMesh.IndexCount = cylinder.IndexCount;
+
+	auto totalVertexCount = box.VertexCount + grid.VertexCount + sphere.VertexCount + cylinder.VertexCount;
+	auto totalIndexCount = box.IndexCount + grid.IndexCount + sphere.IndexCount + cylinder.IndexCount;
 
-	auto totalVertexCount = box.Vertices.size() + grid.Vertices.size() + sphere.Vertices.size() + cylinder.Vertices.size();
-	std::vector<Vertex> vertices(totalVertexCount);
-	UINT k = 0;
-	for (size_t i = 0; i < box.Vertices.size(); ++i, ++k)
+	std::unique_ptr<MeshGeometry> geo = std::make_unique<MeshGeometry>();
+	geo->Name = "shapeGeo";
+
+	// The meshes are not generated straight into the pool: the vertex buffer
+	// holds quantized positions, which need each submesh's bounds, and the
+	// optimizer, simplifier and meshlet builder all work on float positions
+	// and reorder the vertices in place first.  So the cached meshes are
+	// written once, through a position-only span, into float staging and
+	// quantized into the vertex blob at the end.  The index count is only
+	// final once the LOD levels are appended, so the indices are staged too
+	// and copied into the blob at the end; the pool then takes both blobs.
+	std::vector<XMFLOAT3> positions(totalVertexCount);
+	std::vector<std::uint16_t> indexData(totalIndexCount);
+	std::uint16_t* indices = indexData.data();
+
+	GeometryGenerator::MeshSpan span;
+	span.Layout.Stride = sizeof(XMFLOAT3);
+	span.Layout.PositionOffset = 0;
+	span.Layout.NormalOffset = -1;
+	span.Layout.TangentUOffset = -1;
+	span.Layout.TexCOffset = -1;
+	span.IndexByteSize = sizeof(std::uint16_t);
+	auto spanAt = [&](const SubmeshGeometry& submesh)
 	{
-		vertices[k].Pos = box.Vertices[i].Position;
-		vertices[k].Color = XMFLOAT4(DirectX::Colors::DarkGreen);
-	}
-	for (size_t i = 0; i < grid.Vertices.size(); ++i, ++k)
+		span.Vertices = positions.data() + submesh.BaseVertexLocation;
+		span.Indices = indices + submesh.StartIndexLocation;
+		return span;
+	};
+
+	GeometryGenerator::WriteMesh(*boxMesh, spanAt(boxSubMesh));
+	GeometryGenerator::WriteMesh(*gridMesh, spanAt(gridSubMesh));
+	GeometryGenerator::WriteMesh(*sphereMesh, spanAt(sphereSubMesh));
+	GeometryGenerator::WriteMesh(*cylinderMesh, spanAt(cylinderSubMesh));
+
+	// The bounds set the quantization range of each submesh's positions.  LOD
+	// levels copy them, so this comes before they are built.
+	auto computeBounds = [&](SubmeshGeometry& submesh, UINT vertexCount)
 	{
-		vertices[k].Pos = grid.Vertices[i].Position;
-		vertices[k].Color = XMFLOAT4(DirectX::Colors::ForestGreen);
-	}
-	for (size_t i = 0; i < sphere.Vertices.size(); ++i, ++k)
+		const XMFLOAT3* first = positions.data() + submesh.BaseVertexLocation;
+		submesh.Bounds = MathHelper::ComputeBoundingBox(first, vertexCount, sizeof(XMFLOAT3));
+		submesh.SphereBounds = MathHelper::ComputeBoundingSphere(first, vertexCount, sizeof(XMFLOAT3));
+	};
+	computeBounds(boxSubMesh, box.VertexCount);
+	computeBounds(gridSubMesh, grid.VertexCount);
+	computeBounds(sphereSubMesh, sphere.VertexCount);
+	computeBounds(cylinderSubMesh, cylinder.VertexCount);
+
+	// Reorder each submesh for the post-transform cache and vertex fetch
+	// before it is uploaded.  Indices are relative to BaseVertexLocation, so
+	// every submesh is optimized on its own.
+	MeshOptimizer::Options optimizerOptions;
+	optimizerOptions.OptimizeOverdraw = true;
+	auto optimize = [&](const char* name, const SubmeshGeometry& submesh, UINT vertexCount)
 	{
-		vertices[k].Pos = sphere.Vertices[i].Position;
-		vertices[k].Color = XMFLOAT4(DirectX::Colors::Crimson);
-	}
-	for (size_t i = 0; i < cylinder.Vertices.size(); ++i, ++k)
+		MeshOptimizer::Report report = MeshOptimizer::Optimize(
+			positions.data() + submesh.BaseVertexLocation, vertexCount, sizeof(XMFLOAT3), 0,
+			indices + submesh.StartIndexLocation, submesh.IndexCount, optimizerOptions);
+
+		std::wstring text = L"***MeshOptimizer: " + AnsiToWString(name) +
+			L" ACMR " + std::to_wstring(report.Before.Acmr) + L" -> " + std::to_wstring(report.After.Acmr) +
+			L", ATVR " + std::to_wstring(report.Before.Atvr) + L" -> " + std::to_wstring(report.After.Atvr) + L"\n";
+		OutputDebugString(text.c_str());
+	};
+	optimize("box", boxSubMesh, box.VertexCount);
+	optimize("grid", gridSubMesh, grid.VertexCount);
+	optimize("sphere", sphereSubMesh, sphere.VertexCount);
+	optimize("cylinder", cylinderSubMesh, cylinder.VertexCount);
+
+	// Simplified levels index the same vertices as the full detail submesh and
+	// are appended after all the full detail indices as "<name>_lod<n>".
+	// Appending reallocates indexData, so indices is not used past this point.
+	MeshSimplifier::Options lodOptions;
+	std::vector<std::pair<std::string, SubmeshGeometry>> lodSubMeshes;
+	auto buildLods = [&](const std::string& name, const SubmeshGeometry& submesh, UINT vertexCount)
 	{
-		vertices[k].Pos = cylinder.Vertices[i].Position;
-		vertices[k].Color = XMFLOAT4(DirectX::Colors::SteelBlue);
-	}
-
-	std::vector<std::uint16_t> indices;
-	indices.insert(indices.end(), std::begin(box.GetIndices16()), std::end(box.GetIndices16()));
-	indices.insert(indices.end(), std::begin(grid.GetIndices16()), std::end(grid.GetIndices16()));
-	indices.insert(indices.end(), std::begin(sphere.GetIndices16()), std::end(sphere.GetIndices16()));
-	indices.insert(indices.end(), std::begin(cylinder.GetIndices16()), std::end(cylinder.GetIndices16()));
-
+		std::vector<std::uint16_t> lodIndices;
+		std::vector<MeshSimplifier::Level> levels = MeshSimplifier::BuildLodChain(
+			indexData.data() + submesh.StartIndexLocation, submesh.IndexCount,
+			positions.data() + submesh.BaseVertexLocation, vertexCount, sizeof(XMFLOAT3), 0,
+			lodOptions, lodIndices);
+
+		const UINT lodStart = static_cast<UINT>(indexData.size());
+		for (size_t i = 0; i < levels.size(); ++i)
+		{
+			MeshOptimizer::OptimizeVertexCache(lodIndices.data() + levels[i].StartIndex, levels[i].IndexCount, vertexCount);
 
-	std::unique_ptr<MeshGeometry> geo = std::make_unique<MeshGeometry>();
-	geo->Name = "shapeGeo";
+			SubmeshGeometry lodSubMesh = submesh;
+			lodSubMesh.IndexCount = levels[i].IndexCount;
+			lodSubMesh.StartIndexLocation = lodStart + levels[i].StartIndex;
+			lodSubMesh.LodError = levels[i].Error;
+			lodSubMeshes.emplace_back(name + "_lod" + std::to_string(i + 1), lodSubMesh);
+		}
+		indexData.insert(indexData.end(), lodIndices.begin(), lodIndices.end());
+	};
+	buildLods("grid", gridSubMesh, grid.VertexCount);
+	buildLods("sphere", sphereSubMesh, sphere.VertexCount);
+	buildLods("cylinder", cylinderSubMesh, cylinder.VertexCount);
 
-	unsigned vbByteSize = vertices.size() * sizeof(Vertex);
-	unsigned ibByteSize = indices.size() * sizeof(std::uint16_t);
+	// Cluster the full detail submeshes for culling.
+	MeshletBuilder::Options meshletOptions;
+	auto buildMeshlets = [&](SubmeshGeometry& submesh, UINT vertexCount)
+	{
+		submesh.MeshletStart = static_cast<UINT>(geo->Meshlets.Meshlets.size());
+		submesh.MeshletCount = MeshletBuilder::Build(indexData.data() + submesh.StartIndexLocation, submesh.IndexCount,
+			positions.data() + submesh.BaseVertexLocation, vertexCount, sizeof(XMFLOAT3), 0,
+			meshletOptions, geo->Meshlets);
+	};
+	buildMeshlets(boxSubMesh, box.VertexCount);
+	buildMeshlets(gridSubMesh, grid.VertexCount);
+	buildMeshlets(sphereSubMesh, sphere.VertexCount);
+	buildMeshlets(cylinderSubMesh, cylinder.VertexCount);
 
+	unsigned vbByteSize = totalVertexCount * sizeof(Vertex);
 	ThrowIfFailed(D3DCreateBlob(static_cast<SIZE_T>(vbByteSize), geo->VertexBufferCPU.GetAddressOf()));
-	memcpy(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), static_cast<size_t>(vbByteSize));
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(), mCommandList.Get(), vertices.data(), static_cast<size_t>(vbByteSize), geo->VertexBufferUploader);
-
+	Vertex* vertices = reinterpret_cast<Vertex*>(geo->VertexBufferCPU->GetBufferPointer());
+	auto quantize = [&](const SubmeshGeometry& submesh, UINT vertexCount)
+	{
+		PositionQuantization quantization = VertexCompression::QuantizationFor(submesh.Bounds);
+		for (UINT i = 0; i < vertexCount; ++i)
+		{
+			UINT v = submesh.BaseVertexLocation + i;
+			VertexCompression::QuantizePosition(positions[v], quantization, vertices[v].Pos);
+		}
+	};
+	quantize(boxSubMesh, box.VertexCount);
+	quantize(gridSubMesh, grid.VertexCount);
+	quantize(sphereSubMesh, sphere.VertexCount);
+	quantize(cylinderSubMesh, cylinder.VertexCount);
+
+	// Float position plus color was 28 bytes a vertex.
+	std::wstring footprint = L"***VertexCompression: " + std::to_wstring(totalVertexCount) + L" vertices, " +
+		std::to_wstring(totalVertexCount * (sizeof(XMFLOAT3) + sizeof(XMFLOAT4))) + L" -> " +
+		std::to_wstring(vbByteSize) + L" bytes\n";
+	OutputDebugString(footprint.c_str());
+
+	unsigned ibByteSize = static_cast<unsigned>(indexData.size() * sizeof(std::uint16_t));
 	ThrowIfFailed(D3DCreateBlob(static_cast<SIZE_T>(ibByteSize), geo->IndexBufferCPU.GetAddressOf()));
-	memcpy(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), static_cast<size_t>(ibByteSize));
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(), mCommandList.Get(), indices.data(), static_cast<size_t>(ibByteSize), geo->IndexBufferUploader);
-
-	geo->VertexByteStride = sizeof(Vertex);
-	geo->VertexBufferByteSize = vbByteSize;
-	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
-	geo->IndexBufferByteSize = ibByteSize;
-
-	geo->DrawArgs["box"] = boxSubMesh;
-	geo->DrawArgs["grid"] = gridSubMesh;
-	geo->DrawArgs["sphere"] = sphereSubMesh;
-	geo->DrawArgs["cylinder"] = cylinderSubMesh;
+	memcpy(geo->IndexBufferCPU->GetBufferPointer(), indexData.data(), static_cast<size_t>(ibByteSize));
+
+	// The shapes go into the pool as one block, sized to fit it exactly.  The
+	// submeshes above are relative to the block, so shift them to wherever
+	// the pool put it.
+	UINT indexCount = static_cast<UINT>(indexData.size());
+	mGeometryPool = std::make_unique<GeometryPool>(md3dDevice.Get(), sizeof(Vertex), DXGI_FORMAT_R16_UINT,
+		totalVertexCount, indexCount);
+	GeometryPool::Handle shapes = mGeometryPool->Add(vertices, totalVertexCount, indexData.data(), indexCount);
+	mGeometryPool->FlushUploads(mCommandList.Get(), *mUploadRing);
+	mGeometryPool->Describe(*geo);
+
+	SubmeshGeometry block = mGeometryPool->Submesh(shapes);
+	auto addDrawArgs = [&](const std::string& name, SubmeshGeometry submesh)
+	{
+		submesh.BaseVertexLocation += block.BaseVertexLocation;
+		submesh.StartIndexLocation += block.StartIndexLocation;
+		geo->DrawArgs[name] = submesh;
+	};
+	addDrawArgs("box", boxSubMesh);
+	addDrawArgs("grid", gridSubMesh);
+	addDrawArgs("sphere", sphereSubMesh);
+	addDrawArgs("cylinder", cylinderSubMesh);
+	for (auto& lod : lodSubMeshes)
+		addDrawArgs(lod.first, lod.second);
+
+	// The pool has its own copy for the upload.  Picking and collision read
+	// the CPU copies only now and then, so keep them compressed.
+	geo->Retention = CpuRetention::KeepCompressed;
+	geo->ApplyRetention();
 	mGeometries[geo->Name] = std::move(geo);
 }
 
+void ShapeRenderer::LogGeometryMemory()
+{
+	std::vector<const MeshGeometry*> geometries;
+	std::wstring text;
+	for (const auto& geo : mGeometries)
+	{
+		GeometryMemoryStats stats = geo->GetMemoryStats();
+		text += L"***GeometryMemory: " + AnsiToWString(geo->Name) + L" cpu " + std::to_wstring(stats.CpuBytes) +
+			L", gpu " + std::to_wstring(stats.GpuBytes) + L", upload " + std::to_wstring(stats.UploadBytes) + L" bytes\n";
+		geometries.push_back(geo.get());
+	}
+
+	// The geometries share the pool's buffers, which d3dUtil counts once; the
+	// buffers the pool replaced and the ring space its uploads hold are not
+	// referenced by any geometry.
+	GeometryMemoryStats total = d3dUtil::GetMemoryStats(geometries);
+	GeometryPool::Stats poolStats = mGeometryPool->GetStats();
+	total.CpuBytes += poolStats.StagedBytes;
+	total.GpuBytes += poolStats.RetiredBytes;
+	total.UploadBytes += mUploadRing->GetStats().UsedBytes;
+	text += L"***GeometryMemory: total cpu " + std::to_wstring(total.CpuBytes) + L", gpu " +
+		std::to_wstring(total.GpuBytes) + L", upload " + std::to_wstring(total.UploadBytes) + L" bytes\n";
+	OutputDebugString(text.c_str());
+}
+
 
 
 
@@ -480,16 +750,18 @@ void ShapeRenderer::BuildRootSignature()
 	// thought of as defining the function signature.  
 	// 
 	// Root parameter can be a table, root descriptor or root constants.
-	CD3DX12_ROOT_PARAMETER slotRootParameter[2];
-	// Create a single descriptor table of CBVs.
-	CD3DX12_DESCRIPTOR_RANGE cbvTable;
-	// You only declare that there is a CBV at register b0?(or that a descriptor table contains a CBV); you do not describe how many float4s or what fields the CBV contains.
-	cbvTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV,
-		1, // Number of descriptors in table
-		0);// base shader register arguments are bound to for this root parameter
-	slotRootParameter[0].InitAsDescriptorTable(
-		1, // Number of ranges
-		&cbvTable); // Pointer to array of ranges
+	CD3DX12_ROOT_PARAMETER slotRootParameter[3];
+	// The object constants (b0) as a root CBV: a GPU address set per draw,
+	// wherever the frame's LinearUploadAllocator put them.  Or the frame's
+	// StructuredBuffer of them (t0) as a root SRV, set once, and the index of
+	// the draw's object (b2) as a root constant.
+	if (mObjectDataInBuffer)
+	{
+		slotRootParameter[0].InitAsShaderResourceView(0);
+		slotRootParameter[2].InitAsConstants(1, 2);
+	}
+	else
+		slotRootParameter[0].InitAsConstantBufferView(0);
 
 	CD3DX12_DESCRIPTOR_RANGE cbvTable1;
 	// this cbv binds to register 1(b1)
@@ -497,8 +769,9 @@ void ShapeRenderer::BuildRootSignature()
 	slotRootParameter[1].InitAsDescriptorTable(1, &cbvTable1);
 
 	// A root signature is an array of root parameters.
-	// Now you have 2 slotRootParameter
-	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(2, slotRootParameter, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+	// Now you have 2 slotRootParameter, or 3 with the object buffer
+	UINT rootParameterCount = mObjectDataInBuffer ? 3 : 2;
+	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(rootParameterCount, slotRootParameter, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
 	// create a root signature with a single slot which points to a
 	// descriptor range consisting of a single constant buffer.
@@ -519,14 +792,16 @@ void ShapeRenderer::BuildShadersAndInputLayout()
 	// Compile Shader and prepare input layout
 	HRESULT hr = S_OK;
 
-	mvsByteCode = d3dUtil::CompileShader(L"Shaders\\color.hlsl", nullptr, "VS", "vs_5_0");
-	mpsByteCode = d3dUtil::CompileShader(L"Shaders\\color.hlsl", nullptr, "PS", "ps_5_0");
-
-	mInputLayout =
+	const D3D_SHADER_MACRO objectBufferDefines[] =
 	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+		{ "OBJECT_DATA_BUFFER", "1" },
+		{ nullptr, nullptr }
 	};
+	const D3D_SHADER_MACRO* defines = mObjectDataInBuffer ? objectBufferDefines : nullptr;
+	mvsByteCode = d3dUtil::CompileShader(L"Shaders\\color.hlsl", defines, "VS", "vs_5_0");
+	mpsByteCode = d3dUtil::CompileShader(L"Shaders\\color.hlsl", defines, "PS", "ps_5_0");
+
+	mInputLayout = VertexCompression::PackedPositionLayout();
 }
 
 void ShapeRenderer::BuildPSO()
@@ -557,7 +832,7 @@ void ShapeRenderer::BuildPSO()
 
 	Microsoft::WRL::ComPtr<ID3D12PipelineState> pso;
 	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pso)));
-	mPSOs["opaque"] = pso;
+	mOpaquePso = mPSOs.Add("opaque", pso);
 }
 
 ShapeRenderer::ShapeRenderer(HINSTANCE hInstance)
@@ -573,6 +848,7 @@ bool ShapeRenderer::Initialize()
 		return false;
 
 	ThrowIfFailed(mCommandList->Reset(mDirectCmdListAlloc.Get(), nullptr));
+	mUploadRing = std::make_unique<UploadRingBuffer>(md3dDevice.Get(), mFence.Get(), 4 * 1024 * 1024);
 	// BuildRenderItems -> BuildFrameResources
 	// BuildShapeGeometry -> BuildRenderItems
 	BuildShapeGeometry();
@@ -590,10 +866,15 @@ bool ShapeRenderer::Initialize()
 	ThrowIfFailed(mCommandList->Close());
 	ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
 	mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
-	// Wait until frame commands are complete. This waiting is
-	// inefficient and is done for simplicity. Later we will show how to
-	// organize our rendering code so we do not have to wait per frame.
-	FlushCommandQueue();
+	// Rather than wait for the uploads, mark them with a fence; Update
+	// releases the upload buffers once the GPU has passed it.
+	ThrowIfFailed(mCommandQueue->Signal(mFence.Get(), ++mCurrentFence));
+	mGeometryPool->FenceUploads(mCurrentFence);
+	mUploadRing->Submit(mCurrentFence);
+	for (auto& geo : mGeometries)
+		geo->DeferUploaders(mDeferredReleases, mCurrentFence);
+
+	LogGeometryMemory();
 
 	return true;
 }
@@ -621,6 +902,14 @@ void ShapeRenderer::Update(const GameTimer& gt)
 		CloseHandle(eventHandle);
 	}
 
+	// The GPU is done with this frame resource's constants.
+	mCurrFrameResource->Constants->Reset();
+
+	// Release the upload buffers of copies the GPU has finished.
+	UINT64 completedFence = mFence->GetCompletedValue();
+	mGeometryPool->ReleaseUploaders(completedFence);
+	mUploadRing->Retire();
+
 	// Convert Spherical to Cartesian coordinates.
 	float x = mRadius * sinf(mPhi) * cosf(mTheta);
 	float z = mRadius * sinf(mPhi) * sinf(mTheta);
@@ -639,17 +928,9 @@ void ShapeRenderer::Update(const GameTimer& gt)
 	// XMFLOAT4X4 in class as member
 	DirectX::XMStoreFloat4x4(&mView, view);
 
-	XMMATRIX world = XMLoadFloat4x4(&mWorld);
-	XMMATRIX proj = XMLoadFloat4x4(&mProj);
-	XMMATRIX worldViewProj = world * view * proj;
-
-	// Update the constant buffer with the latest worldViewProj matrix.
-	ObjectConstants objConstants;
-	DirectX::XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
-	mCurrFrameResource->ObjectCB->CopyData(0, objConstants);
-
 	UpdateMainPassCB(gt);
 	UpdateObjectCBs(gt);
+	UpdateLods();
 }
 
 void ShapeRenderer::Draw(const GameTimer& gt)
@@ -664,7 +945,7 @@ void ShapeRenderer::Draw(const GameTimer& gt)
 	ThrowIfFailed(cmdListAlloc->Reset());
 	// A command list can be reset after it has been added to the
 	// command queue via ExecuteCommandList. Reusing the command list reuses memory.
-	ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mPSOs["opaque"].Get()));
+	ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mPSOs[mOpaquePso].Get()));
 
 
 	// Indicate a state transition on the resource usage.
@@ -689,8 +970,10 @@ void ShapeRenderer::Draw(const GameTimer& gt)
 	mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
 
 	CD3DX12_GPU_DESCRIPTOR_HANDLE passCBVhanlde (mCbvHeap->GetGPUDescriptorHandleForHeapStart());
-	passCBVhanlde.Offset(mPassCbvOffset + mCurrFrameResourceIndex, mCbvSrvUavDescriptorSize);
+	passCBVhanlde.Offset(mCurrFrameResourceIndex, mCbvSrvUavDescriptorSize);
 	mCommandList->SetGraphicsRootDescriptorTable(1, passCBVhanlde);
+	if (mObjectDataInBuffer)
+		mCommandList->SetGraphicsRootShaderResourceView(0, mObjectBufferAddress);
 
 	DrawRenderItems(mCommandList.Get(), mOpaqueRitems);
 
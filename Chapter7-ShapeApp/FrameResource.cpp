@@ -1,9 +1,9 @@
 #include "FrameResource.h"
 
-FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount)
+FrameResource::FrameResource(ID3D12Device* device, GpuMemoryAllocator& allocator, UINT passCount)
 {
 	ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(CmdListAlloc.GetAddressOf())));
-	PassCB = std::make_unique<UploadBuffer<PassConstants>>(device, passCount, true);
-	ObjectCB = std::make_unique<UploadBuffer<ObjectConstants>>(device, objectCount, true);
+	PassCB = std::make_unique<UploadBuffer<PassConstants>>(allocator, passCount, true);
+	Constants = std::make_unique<LinearUploadAllocator>(allocator);
 }
 FrameResource::~FrameResource() {}
\ No newline at end of file
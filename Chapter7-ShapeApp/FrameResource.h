@@ -5,6 +5,7 @@
 #include <DirectXColors.h>
 #include <DirectX-Headers/include/directx/d3dx12_barriers.h>
 #include "./Common/UploadBuffer.h"
+#include "./Common/LinearUploadAllocator.h"
 
 using namespace DirectX;
 
@@ -12,6 +13,12 @@ using namespace DirectX;
 struct ObjectConstants
 {
 	XMFLOAT4X4 World = MathHelper::Identity4x4();
+	XMFLOAT4 Color = { 1.0f, 1.0f, 1.0f, 1.0f };
+	// Decodes the unorm16 positions: posL = PosOffset + q * PosScale.
+	XMFLOAT3 PosOffset = { 0.0f, 0.0f, 0.0f };
+	float cbPerObjectPad0 = 0.0f;
+	XMFLOAT3 PosScale = { 1.0f, 1.0f, 1.0f };
+	float cbPerObjectPad1 = 0.0f;
 };
 
 struct PassConstants 
@@ -39,7 +46,7 @@ struct PassConstants
 struct FrameResource
 {
 public:
-	FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount);
+	FrameResource(ID3D12Device* device, GpuMemoryAllocator& allocator, UINT passCount);
 
 	FrameResource(const FrameResource& rhs) = delete;
 	FrameResource& operator=(const FrameResource& rhs) = delete;
@@ -50,8 +57,9 @@ public:
 	// We cannot update a cbuffer until the GPU is done processing the
 	// commands that reference it. So each frame needs their own cbuffers.
 	std::unique_ptr<UploadBuffer<PassConstants>> PassCB = nullptr;
-	// all object concat in one objectCB
-	std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectCB = nullptr;
+	// Object constants, written anew every frame for however many objects
+	// it draws.  Reset once Fence has completed.
+	std::unique_ptr<LinearUploadAllocator> Constants = nullptr;
 	// Fence value to mark commands up to this fence point. This lets us
 	// check if these frame resources are still in use by the GPU.
 	UINT64 Fence = 0;
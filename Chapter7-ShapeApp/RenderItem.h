@@ -1,14 +1,14 @@
 #pragma once
 #include "./Common/d3dApp.h"
 #include "./Common/MathHelper.h"
+#include "./Common/MeshGeometry.h"
 #include <DirectXColors.h>
 #include <DirectX-Headers/include/directx/d3dx12_barriers.h>
 #include "./Common/UploadBuffer.h"
+#include "./Common/VertexCompression.h"
 
 using namespace DirectX;
 
-extern const int gNumFrameResources;
-
 // Lightweight structure stores parameters to draw a shape. This will
 // vary from app-to-app.
 struct RenderItem
@@ -20,18 +20,16 @@ struct RenderItem
 	// orientation, and scale of the object in the world.
 	XMFLOAT4X4 World = MathHelper::Identity4x4();
 
-	// Dirty flag indicating the object data has changed and we need
-	// to update the constant buffer. Because we have an object
-	// cbuffer for each FrameResource, we have to apply the
-	// update to each FrameResource. Thus, when we modify obect data we
-	// should set
-	// NumFramesDirty = gNumFrameResources so that each frame resource
-	// gets the update.
-	int NumFramesDirty = gNumFrameResources;
+	// Where this frame's object constants were written, bound as a root
+	// CBV.  Set every frame by UpdateObjectCBs.
+	D3D12_GPU_VIRTUAL_ADDRESS ObjectCBAddress = 0;
+	// Or, with the object buffer, its index there.
+	UINT ObjectIndex = 0;
 
-	// Index into GPU constant buffer corresponding to the ObjectCB
-	// for this render item.
-	UINT ObjCBIndex = -1;
+	// Flat color of the shape, and how to decode its quantized positions
+	// (from the bounds of its submesh).
+	XMFLOAT4 Color = { 1.0f, 1.0f, 1.0f, 1.0f };
+	PositionQuantization PositionDecode;
 
 	// Geometry associated with this render-item. Note that multiple
 	// render-items can share the same geometry.
@@ -43,4 +41,8 @@ struct RenderItem
 	UINT IndexCount = 0;
 	UINT StartIndexLocation = 0;
 	int BaseVertexLocation = 0;
+
+	// Levels of detail from full detail to coarsest.  When set, the draw
+	// parameters above are picked from these every frame by projected error.
+	std::vector<SubmeshGeometry> Lods;
 };
\ No newline at end of file
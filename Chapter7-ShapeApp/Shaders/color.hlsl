@@ -1,8 +1,45 @@
+#include "../../Common/VertexCompression.hlsli"
+
+#ifdef OBJECT_DATA_BUFFER
+
+// Every object's data for the frame, tightly packed; the draw says which is
+// its own with a root constant.
+struct ObjectData
+{
+	float4x4 World;
+	float4 Color;
+	float3 PosOffset;
+	float Pad0;
+	float3 PosScale;
+	float Pad1;
+};
+
+StructuredBuffer<ObjectData> gObjects : register(t0);
+
+cbuffer cbDraw : register(b2)
+{
+	uint gObjectIndex;
+};
+
+#define gWorld gObjects[gObjectIndex].World
+#define gColor gObjects[gObjectIndex].Color
+#define gPosOffset gObjects[gObjectIndex].PosOffset
+#define gPosScale gObjects[gObjectIndex].PosScale
+
+#else
+
 cbuffer cbPerObject : register(b0)
 {
 	float4x4 gWorld; 
+	float4 gColor;
+	float3 gPosOffset;
+	float cbPerObjectPad0;
+	float3 gPosScale;
+	float cbPerObjectPad1;
 };
 
+#endif
+
 cbuffer cbPass : register(b1)
 {
     float4x4 gView;
@@ -23,8 +60,8 @@ cbuffer cbPass : register(b1)
 
 struct VertexIn
 {
-	float3 PosL  : POSITION;
-    float4 Color : COLOR;
+	// Quantized position, already in [0, 1].
+	float3 PosQ  : POSITION;
 };
 
 struct VertexOut
@@ -38,11 +75,12 @@ VertexOut VS(VertexIn vin)
 	VertexOut vout;
 	
 	// Transform to homogeneous clip space.
-    float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
+    float3 posL = DequantizePosition(vin.PosQ, gPosOffset, gPosScale);
+    float4 posW = mul(float4(posL, 1.0f), gWorld);
     vout.PosH = mul(posW, gViewProj);
 	
-	// Just pass vertex color into the pixel shader.
-    vout.Color = vin.Color;
+	// Just pass the object color into the pixel shader.
+    vout.Color = gColor;
     
     return vout;
 }
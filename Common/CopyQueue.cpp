@@ -0,0 +1,154 @@
+#include "CopyQueue.h"
+#include <algorithm>
+
+using Microsoft::WRL::ComPtr;
+
+CopyQueue::CopyQueue(ID3D12Device* device, UINT64 ringByteSize, UINT64 batchByteSize) :
+	mDevice(device),
+	mScheduler(batchByteSize)
+{
+	D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+	queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+	queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+	ThrowIfFailed(mDevice->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(mQueue.GetAddressOf())));
+	ThrowIfFailed(mDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(mFence.GetAddressOf())));
+
+	// The list is created open; close it so every batch starts with Reset.
+	ComPtr<ID3D12CommandAllocator> allocator;
+	ThrowIfFailed(mDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(allocator.GetAddressOf())));
+	ThrowIfFailed(mDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, allocator.Get(), nullptr,
+		IID_PPV_ARGS(mCommandList.GetAddressOf())));
+	ThrowIfFailed(mCommandList->Close());
+	mSubmittedAllocators.push_back({ allocator, 0 });
+	mStats.AllocatorCount = 1;
+
+	mUploads = std::make_unique<UploadRingBuffer>(mDevice, mFence.Get(), ringByteSize);
+}
+
+CopyQueue::~CopyQueue()
+{
+	if (mScheduler.HasPending())
+		Submit();
+	WaitOnCpu(mScheduler.SubmittedFence());
+}
+
+void CopyQueue::BeginBatch()
+{
+	if (mAllocator != nullptr)
+		return;
+
+	// Reuse the oldest allocator if its batch is done.
+	UINT64 completedFence = mFence->GetCompletedValue();
+	if (!mSubmittedAllocators.empty() && mSubmittedAllocators.front().Fence <= completedFence)
+	{
+		mAllocator = mSubmittedAllocators.front().Allocator;
+		mSubmittedAllocators.pop_front();
+		ThrowIfFailed(mAllocator->Reset());
+	}
+	else
+	{
+		ThrowIfFailed(mDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY,
+			IID_PPV_ARGS(mAllocator.GetAddressOf())));
+		++mStats.AllocatorCount;
+	}
+	ThrowIfFailed(mCommandList->Reset(mAllocator.Get(), nullptr));
+}
+
+CopyQueue::Token CopyQueue::Upload(ID3D12Resource* dest, UINT64 destOffset, const void* data, UINT64 size)
+{
+	if (size == 0)
+		return 0;
+
+	BeginBatch();
+	mUploads->Upload(dest, destOffset, data, size, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COMMON);
+	Token token = mScheduler.Record(size);
+	++mStats.Uploads;
+	mStats.UploadedBytes += size;
+
+	if (mScheduler.BatchFull())
+		Submit();
+	return token;
+}
+
+ComPtr<ID3D12Resource> CopyQueue::CreateDefaultBuffer(GpuMemoryAllocator& allocator, const void* initData,
+	UINT64 byteSize, Token& token)
+{
+	ComPtr<ID3D12Resource> buffer = allocator.CreateResource(D3D12_HEAP_TYPE_DEFAULT,
+		CD3DX12_RESOURCE_DESC::Buffer(byteSize), D3D12_RESOURCE_STATE_COMMON);
+	token = Upload(buffer.Get(), 0, initData, byteSize);
+	return buffer;
+}
+
+CopyQueue::Token CopyQueue::Submit()
+{
+	if (!mScheduler.HasPending())
+		return mScheduler.SubmittedFence();
+
+	mUploads->Flush(mCommandList.Get());
+	ThrowIfFailed(mCommandList->Close());
+	ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
+	mQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+
+	UINT64 fence = mScheduler.Submit();
+	ThrowIfFailed(mQueue->Signal(mFence.Get(), fence));
+	mUploads->Submit(fence);
+	mSubmittedAllocators.push_back({ mAllocator, fence });
+	mAllocator = nullptr;
+	++mStats.Submissions;
+	return fence;
+}
+
+void CopyQueue::WaitOnGpu(ID3D12CommandQueue* queue, Token token)
+{
+	if (!mScheduler.IsSubmitted(token))
+		Submit();
+	mScheduler.Complete(mFence->GetCompletedValue());
+
+	auto consumer = std::find_if(mConsumers.begin(), mConsumers.end(),
+		[queue](const std::pair<ID3D12CommandQueue*, CopyScheduler::Consumer>& entry) { return entry.first == queue; });
+	if (consumer == mConsumers.end())
+	{
+		mConsumers.push_back({ queue, CopyScheduler::Consumer() });
+		consumer = mConsumers.end() - 1;
+	}
+
+	UINT64 waitValue = mScheduler.WaitValue(consumer->second, token);
+	if (waitValue == 0)
+	{
+		++mStats.SkippedWaits;
+		return;
+	}
+	ThrowIfFailed(queue->Wait(mFence.Get(), waitValue));
+	++mStats.GpuWaits;
+}
+
+void CopyQueue::WaitOnCpu(Token token)
+{
+	if (!mScheduler.IsSubmitted(token))
+		Submit();
+
+	if (mFence->GetCompletedValue() < token)
+	{
+		HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
+		ThrowIfFailed(mFence->SetEventOnCompletion(token, eventHandle));
+		WaitForSingleObject(eventHandle, INFINITE);
+		CloseHandle(eventHandle);
+	}
+	mScheduler.Complete(mFence->GetCompletedValue());
+}
+
+bool CopyQueue::IsComplete(Token token) const
+{
+	return mScheduler.IsSubmitted(token) && mFence->GetCompletedValue() >= token;
+}
+
+void CopyQueue::Retire()
+{
+	mScheduler.Complete(mFence->GetCompletedValue());
+	mUploads->Retire();
+}
+
+CopyQueue::Stats CopyQueue::GetStats() const
+{
+	return mStats;
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <deque>
+#include <memory>
+#include <vector>
+#include "d3dUtil.h"
+#include "CopyScheduler.h"
+#include "GpuMemoryAllocator.h"
+#include "UploadRingBuffer.h"
+
+// A D3D12_COMMAND_LIST_TYPE_COPY queue for uploads that run alongside
+// rendering.  Upload() stages data in the queue's own UploadRingBuffer and
+// returns a token; copies go out in batches, each with its own command
+// allocator and a value of the queue's fence.  A frame that needs an upload
+// calls WaitOnGpu() with its token before executing, which makes its queue
+// wait on the GPU for that batch only, and only once.
+//
+// The destinations have to be buffers in COMMON, as buffers are between
+// command lists.  The copy queue leaves them in COMMON, from which the
+// direct queue promotes them to any read state without a barrier.
+//
+// Not thread safe; call it from the thread that records the frames.
+class CopyQueue
+{
+public:
+	// The copy fence value after which an upload is complete.
+	using Token = UINT64;
+
+	struct Stats
+	{
+		UINT64 Submissions = 0;
+		UINT64 Uploads = 0;
+		UINT64 UploadedBytes = 0;
+		// Waits issued by WaitOnGpu(), and calls that needed none.
+		UINT64 GpuWaits = 0;
+		UINT64 SkippedWaits = 0;
+		UINT AllocatorCount = 0;
+	};
+
+	// Batches are submitted once they hold batchByteSize bytes, well before
+	// they could fill the ring.
+	CopyQueue(ID3D12Device* device, UINT64 ringByteSize = 16 * 1024 * 1024, UINT64 batchByteSize = 4 * 1024 * 1024);
+	CopyQueue(const CopyQueue& rhs) = delete;
+	CopyQueue& operator=(const CopyQueue& rhs) = delete;
+	// Waits for the submitted copies.
+	~CopyQueue();
+
+	// Copies size bytes of data into dest at destOffset.  Keep dest alive
+	// until the token completes.
+	Token Upload(ID3D12Resource* dest, UINT64 destOffset, const void* data, UINT64 size);
+	// A default heap buffer placed by allocator and filled with initData.
+	Microsoft::WRL::ComPtr<ID3D12Resource> CreateDefaultBuffer(GpuMemoryAllocator& allocator, const void* initData,
+		UINT64 byteSize, Token& token);
+
+	// Submits the batch being recorded, if any, and returns the token of
+	// everything uploaded so far.
+	Token Submit();
+
+	// Makes queue wait on the GPU until token completes, submitting its
+	// batch first if need be.  Nothing is queued if the upload is already
+	// complete or queue has already waited for it.
+	void WaitOnGpu(ID3D12CommandQueue* queue, Token token);
+	// Blocks the CPU until token completes.
+	void WaitOnCpu(Token token);
+	bool IsComplete(Token token) const;
+
+	// Frees the ring space and allocators of completed batches.  Call it once
+	// a frame.
+	void Retire();
+
+	ID3D12CommandQueue* Queue() const { return mQueue.Get(); }
+	ID3D12Fence* Fence() const { return mFence.Get(); }
+	Stats GetStats() const;
+
+private:
+	struct BatchAllocator
+	{
+		Microsoft::WRL::ComPtr<ID3D12CommandAllocator> Allocator;
+		// Fence of the batch recorded with it.
+		UINT64 Fence;
+	};
+
+	void BeginBatch();
+
+	ID3D12Device* mDevice = nullptr;
+	CopyScheduler mScheduler;
+
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue> mQueue;
+	Microsoft::WRL::ComPtr<ID3D12Fence> mFence;
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> mCommandList;
+	// The allocator of the batch being recorded, null between batches.
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> mAllocator;
+	// Allocators of submitted batches, oldest first.
+	std::deque<BatchAllocator> mSubmittedAllocators;
+
+	std::unique_ptr<UploadRingBuffer> mUploads;
+
+	std::vector<std::pair<ID3D12CommandQueue*, CopyScheduler::Consumer>> mConsumers;
+	Stats mStats;
+};
@@ -0,0 +1,41 @@
+#include "CopyScheduler.h"
+#include <cassert>
+
+CopyScheduler::CopyScheduler(uint64 batchByteSize) :
+	mBatchByteSize(batchByteSize)
+{
+}
+
+CopyScheduler::uint64 CopyScheduler::Record(uint64 size)
+{
+	mPendingBytes += size;
+	++mPendingCount;
+	return mSubmittedFence + 1;
+}
+
+CopyScheduler::uint64 CopyScheduler::Submit()
+{
+	assert(HasPending());
+	mPendingBytes = 0;
+	mPendingCount = 0;
+	return ++mSubmittedFence;
+}
+
+void CopyScheduler::Complete(uint64 completedFence)
+{
+	// A removed device reports every fence value as completed.
+	if (completedFence > mSubmittedFence)
+		completedFence = mSubmittedFence;
+	if (completedFence > mCompletedFence)
+		mCompletedFence = completedFence;
+}
+
+CopyScheduler::uint64 CopyScheduler::WaitValue(Consumer& consumer, uint64 token) const
+{
+	assert(IsSubmitted(token));
+	if (IsComplete(token) || token <= consumer.WaitedFence)
+		return 0;
+
+	consumer.WaitedFence = token;
+	return token;
+}
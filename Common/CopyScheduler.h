@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+
+// Bookkeeping for a queue that records work in batches and signals one fence
+// value per batch.  A token is the fence value of the batch an upload went
+// into, so it is known as soon as the upload is recorded; 0 is a token that
+// is always complete.  Other queues wait for tokens through Consumers, which
+// remember how far they have already waited so that repeated waits for the
+// same or older uploads cost nothing.
+//
+// Pure bookkeeping with no GPU dependency; CopyQueue builds on it.
+class CopyScheduler
+{
+public:
+	using uint64 = std::uint64_t;
+
+	// A queue that waits for tokens.
+	struct Consumer
+	{
+		uint64 WaitedFence = 0;
+	};
+
+	// A batch is full once it holds batchByteSize bytes.
+	explicit CopyScheduler(uint64 batchByteSize);
+
+	// Adds size bytes to the batch being recorded and returns its token.
+	uint64 Record(uint64 size);
+	bool HasPending() const { return mPendingCount != 0; }
+	// Whether the pending batch should be submitted now, so its copies start
+	// before more are added.
+	bool BatchFull() const { return mPendingBytes >= mBatchByteSize; }
+
+	// Closes the pending batch and returns the fence value to signal after
+	// it.
+	uint64 Submit();
+	// Records the fence's completed value.
+	void Complete(uint64 completedFence);
+
+	bool IsSubmitted(uint64 token) const { return token <= mSubmittedFence; }
+	bool IsComplete(uint64 token) const { return token <= mCompletedFence; }
+
+	// The fence value consumer has to wait for before it may use the upload
+	// of token, or 0 if it is complete or consumer already waited for it or
+	// a later token.  token has to be submitted.
+	uint64 WaitValue(Consumer& consumer, uint64 token) const;
+
+	uint64 SubmittedFence() const { return mSubmittedFence; }
+	uint64 CompletedFence() const { return mCompletedFence; }
+	uint64 PendingBytes() const { return mPendingBytes; }
+
+private:
+	uint64 mBatchByteSize = 0;
+	uint64 mSubmittedFence = 0;
+	uint64 mCompletedFence = 0;
+	uint64 mPendingBytes = 0;
+	uint64 mPendingCount = 0;
+};
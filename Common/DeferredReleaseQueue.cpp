@@ -0,0 +1,37 @@
+#include "DeferredReleaseQueue.h"
+#include <algorithm>
+
+DeferredReleaseQueue::~DeferredReleaseQueue()
+{
+	Collect(UINT64_MAX);
+}
+
+void DeferredReleaseQueue::Defer(Microsoft::WRL::ComPtr<IUnknown> object, std::uint64_t fence)
+{
+	if (object == nullptr)
+		return;
+
+	Node* node = new Node{ std::move(object), fence, mIncoming.load(std::memory_order_relaxed) };
+	mPendingCount.fetch_add(1, std::memory_order_relaxed);
+	// On failure node->Next is reloaded with the current head.
+	while (!mIncoming.compare_exchange_weak(node->Next, node,
+		std::memory_order_release, std::memory_order_relaxed))
+	{
+	}
+}
+
+std::size_t DeferredReleaseQueue::Collect(std::uint64_t completedFence)
+{
+	for (Node* node = mIncoming.exchange(nullptr, std::memory_order_acquire); node != nullptr; node = node->Next)
+		mWaiting.push_back(node);
+
+	auto waiting = std::partition(mWaiting.begin(), mWaiting.end(),
+		[completedFence](const Node* node) { return node->Fence > completedFence; });
+	std::size_t released = mWaiting.end() - waiting;
+	for (auto it = waiting; it != mWaiting.end(); ++it)
+		delete *it;
+	mWaiting.erase(waiting, mWaiting.end());
+
+	mPendingCount.fetch_sub(released, std::memory_order_relaxed);
+	return released;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "d3dBase.h"
+
+// Holds the last reference to GPU objects until the GPU is done with them,
+// so they can be dropped without flushing the queue.  Defer() takes the
+// object and the fence value signalled after the last command list that
+// used it; Collect() releases every object whose value the fence has
+// completed.
+//
+// Defer() is lock-free and may be called from any thread: it pushes onto an
+// atomic list.  Collect() takes the whole list in one exchange and must only
+// be called from one thread at a time, typically once a frame.
+class DeferredReleaseQueue
+{
+public:
+	DeferredReleaseQueue() = default;
+	DeferredReleaseQueue(const DeferredReleaseQueue& rhs) = delete;
+	DeferredReleaseQueue& operator=(const DeferredReleaseQueue& rhs) = delete;
+	// Releases everything still held; make sure the GPU is idle first.
+	~DeferredReleaseQueue();
+
+	// Takes object, which may be null, until fence completes.
+	void Defer(Microsoft::WRL::ComPtr<IUnknown> object, std::uint64_t fence);
+
+	// Releases the objects whose fence is at most completedFence and returns
+	// how many.
+	std::size_t Collect(std::uint64_t completedFence);
+
+	// Objects held, counting those deferred since the last Collect().
+	std::size_t PendingCount() const { return mPendingCount.load(std::memory_order_relaxed); }
+
+private:
+	struct Node
+	{
+		Microsoft::WRL::ComPtr<IUnknown> Object;
+		std::uint64_t Fence;
+		Node* Next;
+	};
+
+	// Deferred since the last Collect(), newest first.
+	std::atomic<Node*> mIncoming{ nullptr };
+	// Taken by Collect() but not complete yet.  Only Collect() touches it.
+	std::vector<Node*> mWaiting;
+	std::atomic<std::size_t> mPendingCount{ 0 };
+};
@@ -0,0 +1,134 @@
+#include "GeometryCache.h"
+#include <Windows.h>
+#include <chrono>
+#include <fstream>
+
+using MeshData = GeometryGenerator::MeshData;
+
+namespace
+{
+	double MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+GeometryCache::GeometryCache(const std::wstring& directory) :
+	mDirectory(directory)
+{
+}
+
+GeometryCache::MeshPtr GeometryCache::Box(float width, float height, float depth, uint32 numSubdivisions)
+{
+	Key key("Box");
+	key.Add(width).Add(height).Add(depth).Add(numSubdivisions);
+	return GetOrCreate(key, [&]() { return mGenerator.CreateBox(width, height, depth, numSubdivisions); });
+}
+
+GeometryCache::MeshPtr GeometryCache::Grid(float width, float depth, uint32 m, uint32 n)
+{
+	Key key("Grid");
+	key.Add(width).Add(depth).Add(m).Add(n);
+	return GetOrCreate(key, [&]() { return mGenerator.CreateGrid(width, depth, m, n); });
+}
+
+GeometryCache::MeshPtr GeometryCache::Sphere(float radius, uint32 sliceCount, uint32 stackCount)
+{
+	Key key("Sphere");
+	key.Add(radius).Add(sliceCount).Add(stackCount);
+	return GetOrCreate(key, [&]() { return mGenerator.CreateSphere(radius, sliceCount, stackCount); });
+}
+
+GeometryCache::MeshPtr GeometryCache::Cylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount)
+{
+	Key key("Cylinder");
+	key.Add(bottomRadius).Add(topRadius).Add(height).Add(sliceCount).Add(stackCount);
+	return GetOrCreate(key, [&]() { return mGenerator.CreateCylinder(bottomRadius, topRadius, height, sliceCount, stackCount); });
+}
+
+GeometryCache::MeshPtr GeometryCache::Geosphere(float radius, uint32 numSubdivisions)
+{
+	Key key("Geosphere");
+	key.Add(radius).Add(numSubdivisions);
+	return GetOrCreate(key, [&]() { return mGenerator.CreateGeosphere(radius, numSubdivisions); });
+}
+
+GeometryCache::MeshPtr GeometryCache::GetOrCreate(const Key& key, const std::function<MeshData()>& generate)
+{
+	auto it = mMeshes.find(key.Value());
+	if (it != mMeshes.end())
+	{
+		++mStats.MemoryHits;
+		return it->second;
+	}
+
+	auto mesh = std::make_shared<MeshData>();
+	auto start = std::chrono::steady_clock::now();
+	if (Load(key.Value(), *mesh))
+	{
+		++mStats.DiskHits;
+		mStats.LoadMilliseconds += MillisecondsSince(start);
+	}
+	else
+	{
+		*mesh = generate();
+		++mStats.Generated;
+		mStats.GenerateMilliseconds += MillisecondsSince(start);
+		Save(key.Value(), *mesh);
+	}
+
+	MeshPtr result = mesh;
+	mMeshes[key.Value()] = result;
+	return result;
+}
+
+void GeometryCache::Clear()
+{
+	mMeshes.clear();
+}
+
+std::wstring GeometryCache::PathFor(std::uint64_t key) const
+{
+	wchar_t name[32];
+	swprintf_s(name, L"%016llx.mesh", static_cast<unsigned long long>(key));
+	return mDirectory + L"\\" + name;
+}
+
+bool GeometryCache::Load(std::uint64_t key, MeshData& meshData) const
+{
+	if (mDirectory.empty())
+		return false;
+
+	std::ifstream fin(PathFor(key), std::ios::binary);
+	if (!fin)
+		return false;
+
+	return GeometryCacheFormat::Read(fin, key, meshData);
+}
+
+void GeometryCache::Save(std::uint64_t key, const MeshData& meshData) const
+{
+	if (mDirectory.empty())
+		return;
+
+	// Failing to write the cache is not an error, the mesh is just generated
+	// again next time.
+	CreateDirectoryW(mDirectory.c_str(), nullptr);
+
+	// Write to a temporary name and rename over the real one, so a run that
+	// dies mid-write never leaves a truncated file under a valid name.
+	std::wstring path = PathFor(key);
+	std::wstring tempPath = path + L".tmp";
+	{
+		std::ofstream fout(tempPath, std::ios::binary | std::ios::trunc);
+		GeometryCacheFormat::Write(fout, key, meshData);
+		if (!fout)
+		{
+			fout.close();
+			DeleteFileW(tempPath.c_str());
+			return;
+		}
+	}
+	if (!MoveFileExW(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+		DeleteFileW(tempPath.c_str());
+}
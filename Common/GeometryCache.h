@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "GeometryCacheFormat.h"
+#include "GeometryGenerator.h"
+
+// Memoizes GeometryGenerator output.  Every mesh is keyed by a hash of the
+// generator name and its parameters; identical requests share one MeshData,
+// and with a cache directory each mesh is also written to disk so later runs
+// load it instead of generating it again.
+//
+// The keys and the file layout are in GeometryCacheFormat; this class adds
+// the memory cache and the files.  A stale or foreign file is regenerated
+// and overwritten rather than used.  Not thread safe.
+class GeometryCache
+{
+public:
+	using uint32 = std::uint32_t;
+	using MeshPtr = std::shared_ptr<const GeometryGenerator::MeshData>;
+	using Key = GeometryCacheFormat::Key;
+
+	struct Stats
+	{
+		uint32 MemoryHits = 0;
+		uint32 DiskHits = 0;
+		uint32 Generated = 0;
+		// Wall time spent loading files and running generators.
+		double LoadMilliseconds = 0.0;
+		double GenerateMilliseconds = 0.0;
+	};
+
+	// An empty directory keeps the cache in memory only.  The directory is
+	// created on the first write.
+	explicit GeometryCache(const std::wstring& directory = L"");
+
+	MeshPtr Box(float width, float height, float depth, uint32 numSubdivisions);
+	MeshPtr Grid(float width, float depth, uint32 m, uint32 n);
+	MeshPtr Sphere(float radius, uint32 sliceCount, uint32 stackCount);
+	MeshPtr Cylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount);
+	MeshPtr Geosphere(float radius, uint32 numSubdivisions);
+
+	// Returns the mesh stored under key, running generate only when neither
+	// memory nor disk has it.
+	MeshPtr GetOrCreate(const Key& key, const std::function<GeometryGenerator::MeshData()>& generate);
+
+	// Drops the in-memory copies.  Meshes still referenced elsewhere stay
+	// alive, and the disk files are kept.
+	void Clear();
+
+	const Stats& GetStats() const { return mStats; }
+
+private:
+	std::wstring PathFor(std::uint64_t key) const;
+	bool Load(std::uint64_t key, GeometryGenerator::MeshData& meshData) const;
+	void Save(std::uint64_t key, const GeometryGenerator::MeshData& meshData) const;
+
+	std::wstring mDirectory;
+	std::unordered_map<std::uint64_t, MeshPtr> mMeshes;
+	GeometryGenerator mGenerator;
+	Stats mStats;
+};
@@ -0,0 +1,108 @@
+#include "GeometryCacheFormat.h"
+#include <cstring>
+
+using MeshData = GeometryGenerator::MeshData;
+
+namespace
+{
+	// Bump whenever the file layout or the output of any cached generator
+	// changes (vertex order, attributes, index order), including changes to
+	// GeometryGenerator that look like pure optimizations.  The version is
+	// part of every Key, so old files simply stop matching; forgetting to
+	// bump it serves the previous meshes from disk.
+	const std::uint32_t kFormatVersion = 1;
+	const std::uint32_t kMagic = 0x43454f47; // "GEOC"
+
+	const std::uint64_t kFnvOffsetBasis = 14695981039346656037ull;
+	const std::uint64_t kFnvPrime = 1099511628211ull;
+
+	struct FileHeader
+	{
+		std::uint32_t Magic;
+		std::uint32_t Version;
+		std::uint64_t Key;
+		std::uint32_t VertexByteSize;
+		std::uint32_t VertexCount;
+		std::uint32_t IndexCount;
+		std::uint32_t Pad;
+	};
+}
+
+GeometryCacheFormat::Key::Key(const char* generator) :
+	mHash(kFnvOffsetBasis)
+{
+	AddBytes(&kFormatVersion, sizeof(kFormatVersion));
+	AddBytes(generator, std::strlen(generator));
+}
+
+GeometryCacheFormat::Key& GeometryCacheFormat::Key::Add(float value)
+{
+	// -0 and +0 generate the same mesh.
+	value += 0.0f;
+	AddBytes(&value, sizeof(value));
+	return *this;
+}
+
+GeometryCacheFormat::Key& GeometryCacheFormat::Key::Add(uint32 value)
+{
+	AddBytes(&value, sizeof(value));
+	return *this;
+}
+
+void GeometryCacheFormat::Key::AddBytes(const void* data, size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; ++i)
+	{
+		mHash ^= bytes[i];
+		mHash *= kFnvPrime;
+	}
+}
+
+void GeometryCacheFormat::Write(std::ostream& out, std::uint64_t key, const MeshData& meshData)
+{
+	FileHeader header = {};
+	header.Magic = kMagic;
+	header.Version = kFormatVersion;
+	header.Key = key;
+	header.VertexByteSize = sizeof(GeometryGenerator::Vertex);
+	header.VertexCount = static_cast<std::uint32_t>(meshData.Vertices.size());
+	header.IndexCount = static_cast<std::uint32_t>(meshData.Indices32.size());
+
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char*>(meshData.Vertices.data()), meshData.Vertices.size() * sizeof(GeometryGenerator::Vertex));
+	out.write(reinterpret_cast<const char*>(meshData.Indices32.data()), meshData.Indices32.size() * sizeof(std::uint32_t));
+}
+
+bool GeometryCacheFormat::Read(std::istream& in, std::uint64_t key, MeshData& meshData)
+{
+	meshData = MeshData();
+
+	FileHeader header;
+	if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+		header.Magic != kMagic || header.Version != kFormatVersion || header.Key != key ||
+		header.VertexByteSize != sizeof(GeometryGenerator::Vertex))
+		return false;
+
+	// Check the counts against the file size before allocating anything, so
+	// a corrupt header falls back to generating the mesh rather than
+	// throwing bad_alloc.
+	std::uint64_t expectedSize = sizeof(FileHeader) +
+		std::uint64_t(header.VertexCount) * sizeof(GeometryGenerator::Vertex) +
+		std::uint64_t(header.IndexCount) * sizeof(std::uint32_t);
+	if (!in.seekg(0, std::ios::end) || static_cast<std::uint64_t>(in.tellg()) != expectedSize ||
+		!in.seekg(sizeof(FileHeader)))
+		return false;
+
+	meshData.Vertices.resize(header.VertexCount);
+	meshData.Indices32.resize(header.IndexCount);
+	in.read(reinterpret_cast<char*>(meshData.Vertices.data()), header.VertexCount * sizeof(GeometryGenerator::Vertex));
+	in.read(reinterpret_cast<char*>(meshData.Indices32.data()), header.IndexCount * sizeof(std::uint32_t));
+	if (!in)
+	{
+		// Truncated file; leave nothing half read behind.
+		meshData = MeshData();
+		return false;
+	}
+	return true;
+}
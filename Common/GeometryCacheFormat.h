@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include "GeometryGenerator.h"
+
+// The keys and the file layout of GeometryCache, apart from the Win32 file
+// handling so that both can be tested headless.
+//
+// A file is raw GeometryGenerator::Vertex and uint32 index arrays behind a
+// small header.  Read() checks the key, the format version and the sizes,
+// so a stale, foreign or truncated file reads as a miss rather than as a
+// mesh.
+class GeometryCacheFormat
+{
+public:
+	using uint32 = std::uint32_t;
+
+	// FNV-1a over the format version, the generator name and its parameters
+	// in call order.
+	class Key
+	{
+	public:
+		explicit Key(const char* generator);
+
+		Key& Add(float value);
+		Key& Add(uint32 value);
+
+		std::uint64_t Value() const { return mHash; }
+
+	private:
+		void AddBytes(const void* data, size_t size);
+
+		std::uint64_t mHash;
+	};
+
+	static void Write(std::ostream& out, std::uint64_t key, const GeometryGenerator::MeshData& meshData);
+	// Leaves meshData empty and returns false unless in holds a whole file
+	// for key, and nothing after it.
+	static bool Read(std::istream& in, std::uint64_t key, GeometryGenerator::MeshData& meshData);
+};
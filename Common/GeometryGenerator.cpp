@@ -1,10 +1,265 @@
 #include "GeometryGenerator.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
 
 using namespace DirectX;
 
+namespace
+{
+	// Marks an unused slot in EdgeMidpointTable; no real edge packs to it.
+	const std::uint64_t kEmptyEdgeKey = ~0ull;
+
+	// Maps an undirected edge (a, b) to the vertex created at its midpoint, so
+	// the two triangles sharing an edge also share its midpoint.  Open addressing
+	// over flat arrays; the capacity is fixed by Reset() and Clear() does not
+	// release memory.
+	class EdgeMidpointTable
+	{
+	public:
+		EdgeMidpointTable(std::vector<std::uint64_t>& keys, std::vector<std::uint32_t>& values) :
+			mKeys(keys),
+			mValues(values)
+		{
+		}
+
+		void Reset(size_t maxEdges)
+		{
+			size_t capacity = 16;
+			while (capacity < maxEdges * 2)
+				capacity <<= 1;
+			mKeys.assign(capacity, kEmptyEdgeKey);
+			mValues.resize(capacity);
+			mSize = 0;
+		}
+
+		void Clear()
+		{
+			std::fill(mKeys.begin(), mKeys.end(), kEmptyEdgeKey);
+			mSize = 0;
+		}
+
+		size_t Size()const
+		{
+			return mSize;
+		}
+
+		// Returns the midpoint already stored for the edge, or stores and
+		// returns newIndex if the edge has not been seen yet.
+		std::uint32_t FindOrInsert(std::uint32_t a, std::uint32_t b, std::uint32_t newIndex)
+		{
+			std::uint64_t key = a < b ?
+				((std::uint64_t)a << 32) | b :
+				((std::uint64_t)b << 32) | a;
+
+			size_t mask = mKeys.size() - 1;
+			size_t slot = (size_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+			while (mKeys[slot] != kEmptyEdgeKey)
+			{
+				if (mKeys[slot] == key)
+					return mValues[slot];
+				slot = (slot + 1) & mask;
+			}
+
+			assert(mSize < mKeys.size() / 2);
+			mKeys[slot] = key;
+			mValues[slot] = newIndex;
+			++mSize;
+			return newIndex;
+		}
+
+	private:
+		std::vector<std::uint64_t>& mKeys;
+		std::vector<std::uint32_t>& mValues;
+		size_t mSize = 0;
+	};
+
+	// Scratch storage for the subdivided shapes, kept so repeated calls do not
+	// reallocate.  It is per thread rather than per generator so that a shared
+	// generator stays safe to call concurrently; each thread keeps the buffers
+	// of the largest mesh it has built until it exits.
+	struct Scratch
+	{
+		GeometryGenerator::MeshData Mesh;
+		std::vector<std::uint32_t> Indices;
+		std::vector<std::uint64_t> EdgeKeys;
+		std::vector<std::uint32_t> EdgeValues;
+	};
+
+	Scratch& ThreadScratch()
+	{
+		thread_local Scratch scratch;
+		return scratch;
+	}
+
+	// Span over a MeshData that has already been resized to its final counts.
+	GeometryGenerator::MeshSpan SpanOf(GeometryGenerator::MeshData& meshData)
+	{
+		GeometryGenerator::MeshSpan span;
+		span.Vertices = meshData.Vertices.data();
+		span.Indices = meshData.Indices32.data();
+		return span;
+	}
+
+	GeometryGenerator::MeshData Allocate(const GeometryGenerator::MeshSize& size)
+	{
+		GeometryGenerator::MeshData meshData;
+		meshData.Vertices.resize(size.VertexCount);
+		meshData.Indices32.resize(size.IndexCount);
+		return meshData;
+	}
+}
+
+// Writes vertices and indices into a MeshSpan, scattering the Vertex
+// attributes to the span's layout and narrowing indices to its index width.
+class GeometryGenerator::MeshWriter
+{
+public:
+	explicit MeshWriter(const MeshSpan& span) :
+		mVertices(static_cast<std::uint8_t*>(span.Vertices)),
+		mIndices(span.Indices),
+		mLayout(span.Layout),
+		mIndexByteSize(span.IndexByteSize)
+	{
+		assert(mIndexByteSize == sizeof(uint16) || mIndexByteSize == sizeof(uint32));
+
+		VertexLayout vertexLayout;
+		mIsVertexLayout =
+			mLayout.Stride == vertexLayout.Stride &&
+			mLayout.PositionOffset == vertexLayout.PositionOffset &&
+			mLayout.NormalOffset == vertexLayout.NormalOffset &&
+			mLayout.TangentUOffset == vertexLayout.TangentUOffset &&
+			mLayout.TexCOffset == vertexLayout.TexCOffset;
+	}
+
+	void WriteVertex(uint32 i, const Vertex& v)
+	{
+		std::uint8_t* dst = mVertices + (size_t)i * mLayout.Stride;
+		if (mIsVertexLayout)
+		{
+			memcpy(dst, &v, sizeof(Vertex));
+			return;
+		}
+
+		if (mLayout.PositionOffset >= 0)
+			memcpy(dst + mLayout.PositionOffset, &v.Position, sizeof(v.Position));
+		if (mLayout.NormalOffset >= 0)
+			memcpy(dst + mLayout.NormalOffset, &v.Normal, sizeof(v.Normal));
+		if (mLayout.TangentUOffset >= 0)
+			memcpy(dst + mLayout.TangentUOffset, &v.TangentU, sizeof(v.TangentU));
+		if (mLayout.TexCOffset >= 0)
+			memcpy(dst + mLayout.TexCOffset, &v.TexC, sizeof(v.TexC));
+	}
+
+	void WriteIndex(uint32 i, uint32 index)
+	{
+		if (mIndexByteSize == sizeof(uint16))
+		{
+			assert(index <= 0xffff && "Mesh does not fit in 16-bit indices.");
+			static_cast<uint16*>(mIndices)[i] = static_cast<uint16>(index);
+		}
+		else
+		{
+			static_cast<uint32*>(mIndices)[i] = index;
+		}
+	}
+
+	// Writes the triangle (a, b, c) at index slots i, i + 1 and i + 2.
+	void WriteTriangle(uint32 i, uint32 a, uint32 b, uint32 c)
+	{
+		WriteIndex(i + 0, a);
+		WriteIndex(i + 1, b);
+		WriteIndex(i + 2, c);
+	}
+
+private:
+	std::uint8_t* mVertices;
+	void* mIndices;
+	VertexLayout mLayout;
+	uint32 mIndexByteSize;
+	bool mIsVertexLayout = false;
+};
+
+GeometryGenerator::MeshSize GeometryGenerator::CylinderSize(uint32 sliceCount, uint32 stackCount)
+{
+	// Side rings plus, per cap, a rim ring and a center vertex.
+	MeshSize size;
+	size.VertexCount = (stackCount + 1) * (sliceCount + 1) + 2 * (sliceCount + 2);
+	size.IndexCount = stackCount * sliceCount * 6 + 2 * sliceCount * 3;
+	return size;
+}
+
+GeometryGenerator::MeshSize GeometryGenerator::SphereSize(uint32 sliceCount, uint32 stackCount)
+{
+	// Two poles plus stackCount - 1 rings.
+	MeshSize size;
+	size.VertexCount = (stackCount - 1) * (sliceCount + 1) + 2;
+	size.IndexCount = (stackCount - 1) * sliceCount * 6;
+	return size;
+}
+
+GeometryGenerator::MeshSize GeometryGenerator::GeosphereSize(uint32 numSubdivisions)
+{
+	// Icosahedron (12 vertices, 30 edges, 20 faces), subdivided with shared
+	// midpoints: V = 10 * 4^n + 2, F = 20 * 4^n.
+	numSubdivisions = std::min<uint32>(numSubdivisions, 8u);
+	uint32 pow4 = 1u << (2 * numSubdivisions);
+
+	MeshSize size;
+	size.VertexCount = 10 * pow4 + 2;
+	size.IndexCount = 60 * pow4;
+	return size;
+}
+
+GeometryGenerator::MeshSize GeometryGenerator::BoxSize(uint32 numSubdivisions)
+{
+	// Six independent faces, each an s x s grid of quads with s = 2^n.
+	numSubdivisions = std::min<uint32>(numSubdivisions, 6u);
+	uint32 s = 1u << numSubdivisions;
+
+	MeshSize size;
+	size.VertexCount = 6 * (s + 1) * (s + 1);
+	size.IndexCount = 6 * s * s * 6;
+	return size;
+}
+
+GeometryGenerator::MeshSize GeometryGenerator::QuadSize()
+{
+	MeshSize size;
+	size.VertexCount = 4;
+	size.IndexCount = 6;
+	return size;
+}
+
+GeometryGenerator::MeshSize GeometryGenerator::GridSize(uint32 m, uint32 n)
+{
+	MeshSize size;
+	size.VertexCount = m * n;
+	size.IndexCount = (m - 1) * (n - 1) * 6;
+	return size;
+}
+
+void GeometryGenerator::WriteMesh(const MeshData& meshData, const MeshSpan& out)
+{
+	MeshWriter writer(out);
+	for (uint32 i = 0; i < (uint32)meshData.Vertices.size(); ++i)
+		writer.WriteVertex(i, meshData.Vertices[i]);
+	for (uint32 i = 0; i < (uint32)meshData.Indices32.size(); ++i)
+		writer.WriteIndex(i, meshData.Indices32[i]);
+}
+
 GeometryGenerator::MeshData GeometryGenerator::CreateCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount)
 {
-	MeshData meshData;
+	MeshData meshData = Allocate(CylinderSize(sliceCount, stackCount));
+	CreateCylinder(bottomRadius, topRadius, height, sliceCount, stackCount, SpanOf(meshData));
+	return meshData;
+}
+
+void GeometryGenerator::CreateCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, const MeshSpan& out)
+{
+	MeshWriter writer(out);
+	uint32 vertexIndex = 0;
+	uint32 indexIndex = 0;
 	//
 	// Build Stacks.
 	//
@@ -57,34 +312,30 @@ GeometryGenerator::MeshData GeometryGenerator::CreateCylinder(float bottomRadius
 			XMVECTOR N = XMVector3Normalize(XMVector3Cross(T, B));
 
 			XMStoreFloat3(&vertex.Normal, N);
-			meshData.Vertices.push_back(vertex);
+			writer.WriteVertex(vertexIndex++, vertex);
 		}
 	}
 
 	int n = sliceCount + 1;
 	for (int i = 0; i < ringCount - 1; i++) {
 		for (int j = 0; j < n - 1; j++) {
-			meshData.Indices32.push_back(i * n + j);
-			meshData.Indices32.push_back((i + 1) * n + j);
-			meshData.Indices32.push_back((i + 1) * n + j + 1);
-
-			meshData.Indices32.push_back(i * n + j);
-			meshData.Indices32.push_back((i + 1) * n + j + 1);
-			meshData.Indices32.push_back(i * n + j + 1);
+			writer.WriteTriangle(indexIndex, i * n + j, (i + 1) * n + j, (i + 1) * n + j + 1);
+			writer.WriteTriangle(indexIndex + 3, i * n + j, (i + 1) * n + j + 1, i * n + j + 1);
+			indexIndex += 6;
 		}
 	}
 
+	// Each cap is a rim ring plus a center vertex.
 	BuildCylinderTopCap(bottomRadius, topRadius, height,
-		sliceCount, stackCount, meshData);
+		sliceCount, stackCount, writer, vertexIndex, indexIndex);
+	vertexIndex += sliceCount + 2;
+	indexIndex += sliceCount * 3;
 	BuildCylinderBottomCap(bottomRadius, topRadius, height,
-		sliceCount, stackCount, meshData);
-
-	return meshData;
+		sliceCount, stackCount, writer, vertexIndex, indexIndex);
 }
 
-void GeometryGenerator::BuildCylinderTopCap(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, MeshData& meshData)
+void GeometryGenerator::BuildCylinderTopCap(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, MeshWriter& writer, uint32 baseVertex, uint32 baseIndex)
 {
-	uint32 baseIndex = meshData.Vertices.size();
 
 	float thetaStep = 2.0f * XM_PI / sliceCount;
 	for (int i = 0; i <= sliceCount; i++) {
@@ -106,25 +357,19 @@ void GeometryGenerator::BuildCylinderTopCap(float bottomRadius, float topRadius,
 		vertex.TangentU = XMFLOAT3(1.0f, 0.0f, 0.0f);
 		vertex.TexC = XMFLOAT2(u, v);
 		
-		meshData.Vertices.push_back(vertex);
+		writer.WriteVertex(baseVertex + i, vertex);
 	}
 
 	// Cap center vertex.
-	meshData.Vertices.push_back(Vertex(0.0f, 0.5f * height, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f));
+	uint32 centerIndex = baseVertex + sliceCount + 1;
+	writer.WriteVertex(centerIndex, Vertex(0.0f, 0.5f * height, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f));
 
-	// Index of center vertex.
-	uint32 centerIndex = (uint32)meshData.Vertices.size() - 1;
 	for (uint32 i = 0; i < sliceCount; ++i)
-	{
-		meshData.Indices32.push_back(centerIndex);
-		meshData.Indices32.push_back(baseIndex + i + 1);
-		meshData.Indices32.push_back(baseIndex + i);
-	}
+		writer.WriteTriangle(baseIndex + i * 3, centerIndex, baseVertex + i + 1, baseVertex + i);
 }
 
-void GeometryGenerator::BuildCylinderBottomCap(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, MeshData& meshData)
+void GeometryGenerator::BuildCylinderBottomCap(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, MeshWriter& writer, uint32 baseVertex, uint32 baseIndex)
 {
-	uint32 baseIndex = meshData.Vertices.size();
 
 	float thetaStep = 2.0f * XM_PI / sliceCount;
 	for (int i = 0; i <= sliceCount; i++) {
@@ -146,25 +391,29 @@ void GeometryGenerator::BuildCylinderBottomCap(float bottomRadius, float topRadi
 		vertex.TangentU = XMFLOAT3(1.0f, 0.0f, 0.0f);
 		vertex.TexC = XMFLOAT2(u, v);
 
-		meshData.Vertices.push_back(vertex);
+		writer.WriteVertex(baseVertex + i, vertex);
 	}
 
 	// Cap center vertex.
-	meshData.Vertices.push_back(Vertex(0.0f, -0.5f * height, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f));
+	uint32 centerIndex = baseVertex + sliceCount + 1;
+	writer.WriteVertex(centerIndex, Vertex(0.0f, -0.5f * height, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f));
 
-	// Index of center vertex.
-	uint32 centerIndex = (uint32)meshData.Vertices.size() - 1;
 	for (uint32 i = 0; i < sliceCount; ++i)
-	{
-		meshData.Indices32.push_back(centerIndex);
-		meshData.Indices32.push_back(baseIndex + i);
-		meshData.Indices32.push_back(baseIndex + i + 1);
-	}
+		writer.WriteTriangle(baseIndex + i * 3, centerIndex, baseVertex + i, baseVertex + i + 1);
 }
 
 GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32 sliceCount, uint32 stackCount)
 {
-	MeshData meshData;
+	MeshData meshData = Allocate(SphereSize(sliceCount, stackCount));
+	CreateSphere(radius, sliceCount, stackCount, SpanOf(meshData));
+	return meshData;
+}
+
+void GeometryGenerator::CreateSphere(float radius, uint32 sliceCount, uint32 stackCount, const MeshSpan& out)
+{
+	MeshWriter writer(out);
+	uint32 vertexIndex = 0;
+	uint32 indexIndex = 0;
 
 	//
 	// Compute the vertices stating at the top pole and moving down the stacks.
@@ -176,7 +425,7 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
 	Vertex topVertex(0.0f, +radius, 0.0f, 0.0f, +1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
 	Vertex bottomVertex(0.0f, -radius, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
 
-	meshData.Vertices.push_back(topVertex);
+	writer.WriteVertex(vertexIndex++, topVertex);
 
 	float phiStep = XM_PI / stackCount;
 	float thetaStep = 2.0f * XM_PI / sliceCount;
@@ -212,11 +461,11 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
 			v.TexC.x = theta / XM_2PI;
 			v.TexC.y = phi / XM_PI;
 
-			meshData.Vertices.push_back(v);
+			writer.WriteVertex(vertexIndex++, v);
 		}
 	}
 
-	meshData.Vertices.push_back(bottomVertex);
+	writer.WriteVertex(vertexIndex++, bottomVertex);
 
 	//
 	// Compute indices for top stack.  The top stack was written first to the vertex buffer
@@ -225,9 +474,8 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
 
 	for (uint32 i = 1; i <= sliceCount; ++i)
 	{
-		meshData.Indices32.push_back(0);
-		meshData.Indices32.push_back(i + 1);
-		meshData.Indices32.push_back(i);
+		writer.WriteTriangle(indexIndex, 0, i + 1, i);
+		indexIndex += 3;
 	}
 
 	//
@@ -242,13 +490,16 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
 	{
 		for (uint32 j = 0; j < sliceCount; ++j)
 		{
-			meshData.Indices32.push_back(baseIndex + i * ringVertexCount + j);
-			meshData.Indices32.push_back(baseIndex + i * ringVertexCount + j + 1);
-			meshData.Indices32.push_back(baseIndex + (i + 1) * ringVertexCount + j);
-
-			meshData.Indices32.push_back(baseIndex + (i + 1) * ringVertexCount + j);
-			meshData.Indices32.push_back(baseIndex + i * ringVertexCount + j + 1);
-			meshData.Indices32.push_back(baseIndex + (i + 1) * ringVertexCount + j + 1);
+			writer.WriteTriangle(indexIndex,
+				baseIndex + i * ringVertexCount + j,
+				baseIndex + i * ringVertexCount + j + 1,
+				baseIndex + (i + 1) * ringVertexCount + j);
+
+			writer.WriteTriangle(indexIndex + 3,
+				baseIndex + (i + 1) * ringVertexCount + j,
+				baseIndex + i * ringVertexCount + j + 1,
+				baseIndex + (i + 1) * ringVertexCount + j + 1);
+			indexIndex += 6;
 		}
 	}
 
@@ -258,19 +509,16 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
 	//
 
 	// South pole vertex was added last.
-	uint32 southPoleIndex = (uint32)meshData.Vertices.size() - 1;
+	uint32 southPoleIndex = vertexIndex - 1;
 
 	// Offset the indices to the index of the first vertex in the last ring.
 	baseIndex = southPoleIndex - ringVertexCount;
 
 	for (uint32 i = 0; i < sliceCount; ++i)
 	{
-		meshData.Indices32.push_back(southPoleIndex);
-		meshData.Indices32.push_back(baseIndex + i);
-		meshData.Indices32.push_back(baseIndex + i + 1);
+		writer.WriteTriangle(indexIndex, southPoleIndex, baseIndex + i, baseIndex + i + 1);
+		indexIndex += 3;
 	}
-
-	return meshData;
 }
 
 GeometryGenerator::Vertex GeometryGenerator::MidPoint(const Vertex& v0, const Vertex& v1)
@@ -303,14 +551,47 @@ GeometryGenerator::Vertex GeometryGenerator::MidPoint(const Vertex& v0, const Ve
 	return v;
 }
 
-void GeometryGenerator::Subdivide(MeshData& meshData)
+void GeometryGenerator::Subdivide(MeshData& meshData, uint32 numSubdivisions)
 {
-	// Save a copy of the input geometry.
-	MeshData inputCopy = meshData;
+	if (numSubdivisions == 0)
+		return;
+
+	// Count the unique edges of the input so the size of every level is known
+	// up front.  Each level splits every edge in two and adds three interior
+	// edges per triangle:
+	//   V' = V + E,  F' = 4F,  E' = 2E + 3F
+	uint32 numTris = (uint32)meshData.Indices32.size() / 3;
+	Scratch& threadScratch = ThreadScratch();
+	EdgeMidpointTable edges(threadScratch.EdgeKeys, threadScratch.EdgeValues);
+	edges.Reset(numTris * 3);
+	for (uint32 i = 0; i < numTris; ++i)
+	{
+		const uint32* tri = &meshData.Indices32[i * 3];
+		edges.FindOrInsert(tri[0], tri[1], 0);
+		edges.FindOrInsert(tri[1], tri[2], 0);
+		edges.FindOrInsert(tri[0], tri[2], 0);
+	}
 
+	size_t vertexCount = meshData.Vertices.size();
+	size_t edgeCount = edges.Size();
+	size_t triCount = numTris;
+	size_t maxEdgeCount = edgeCount;
+	for (uint32 level = 0; level < numSubdivisions; ++level)
+	{
+		maxEdgeCount = edgeCount;
+		vertexCount += edgeCount;
+		edgeCount = 2 * edgeCount + 3 * triCount;
+		triCount *= 4;
+	}
 
-	meshData.Vertices.resize(0);
-	meshData.Indices32.resize(0);
+	// Midpoints are appended to the vertex buffer in place.  The index buffer
+	// ping-pongs between Indices32 and a scratch buffer; both are allocated
+	// once at the final size.
+	meshData.Vertices.reserve(vertexCount);
+	meshData.Indices32.reserve(triCount * 3);
+	std::vector<uint32>& scratch = threadScratch.Indices;
+	scratch.reserve(triCount * 3);
+	edges.Reset(maxEdgeCount);
 
 	//       v1
 	//       *
@@ -322,56 +603,78 @@ void GeometryGenerator::Subdivide(MeshData& meshData)
 	// *-----*-----*
 	// v0    m2     v2
 
-	uint32 numTris = (uint32)inputCopy.Indices32.size() / 3;
-	for (uint32 i = 0; i < numTris; ++i)
+	for (uint32 level = 0; level < numSubdivisions; ++level)
 	{
-		Vertex v0 = inputCopy.Vertices[inputCopy.Indices32[i * 3 + 0]];
-		Vertex v1 = inputCopy.Vertices[inputCopy.Indices32[i * 3 + 1]];
-		Vertex v2 = inputCopy.Vertices[inputCopy.Indices32[i * 3 + 2]];
-
-		//
-		// Generate the midpoints.
-		//
-
-		Vertex m0 = MidPoint(v0, v1);
-		Vertex m1 = MidPoint(v1, v2);
-		Vertex m2 = MidPoint(v0, v2);
-
-		//
-		// Add new geometry.
-		//
-
-		meshData.Vertices.push_back(v0); // 0
-		meshData.Vertices.push_back(v1); // 1
-		meshData.Vertices.push_back(v2); // 2
-		meshData.Vertices.push_back(m0); // 3
-		meshData.Vertices.push_back(m1); // 4
-		meshData.Vertices.push_back(m2); // 5
-
-		meshData.Indices32.push_back(i * 6 + 0);
-		meshData.Indices32.push_back(i * 6 + 3);
-		meshData.Indices32.push_back(i * 6 + 5);
-
-		meshData.Indices32.push_back(i * 6 + 3);
-		meshData.Indices32.push_back(i * 6 + 4);
-		meshData.Indices32.push_back(i * 6 + 5);
-
-		meshData.Indices32.push_back(i * 6 + 5);
-		meshData.Indices32.push_back(i * 6 + 4);
-		meshData.Indices32.push_back(i * 6 + 2);
-
-		meshData.Indices32.push_back(i * 6 + 3);
-		meshData.Indices32.push_back(i * 6 + 1);
-		meshData.Indices32.push_back(i * 6 + 4);
+		edges.Clear();
+		numTris = (uint32)meshData.Indices32.size() / 3;
+		scratch.resize((size_t)numTris * 12);
+
+		auto midPointIndex = [&](uint32 a, uint32 b)
+		{
+			uint32 next = (uint32)meshData.Vertices.size();
+			uint32 m = edges.FindOrInsert(a, b, next);
+			if (m == next)
+			{
+				Vertex v = MidPoint(meshData.Vertices[a], meshData.Vertices[b]);
+				meshData.Vertices.push_back(v);
+			}
+			return m;
+		};
+
+		const uint32* src = meshData.Indices32.data();
+		uint32* dst = scratch.data();
+		for (uint32 i = 0; i < numTris; ++i)
+		{
+			uint32 v0 = src[i * 3 + 0];
+			uint32 v1 = src[i * 3 + 1];
+			uint32 v2 = src[i * 3 + 2];
+
+			//
+			// Generate (or reuse) the midpoints.
+			//
+
+			uint32 m0 = midPointIndex(v0, v1);
+			uint32 m1 = midPointIndex(v1, v2);
+			uint32 m2 = midPointIndex(v0, v2);
+
+			//
+			// Add new geometry.
+			//
+
+			uint32* out = &dst[i * 12];
+			out[0] = v0; out[1] = m0; out[2] = m2;
+			out[3] = m0; out[4] = m1; out[5] = m2;
+			out[6] = m2; out[7] = m1; out[8] = v2;
+			out[9] = m0; out[10] = v1; out[11] = m1;
+		}
+
+		meshData.Indices32.swap(scratch);
 	}
+
+	assert(meshData.Vertices.size() == vertexCount);
 }
 
 GeometryGenerator::MeshData GeometryGenerator::CreateGeosphere(float radius, uint32 numSubdivisions)
 {
 	MeshData meshData;
+	BuildGeosphere(radius, numSubdivisions, meshData);
+	return meshData;
+}
 
-	// Put a cap on the number of subdivisions.
-	numSubdivisions = std::min<uint32>(numSubdivisions, 6u);
+void GeometryGenerator::CreateGeosphere(float radius, uint32 numSubdivisions, const MeshSpan& out)
+{
+	MeshData& meshData = ThreadScratch().Mesh;
+	BuildGeosphere(radius, numSubdivisions, meshData);
+	WriteMesh(meshData, out);
+}
+
+void GeometryGenerator::BuildGeosphere(float radius, uint32 numSubdivisions, MeshData& meshData)
+{
+
+	// Put a cap on the number of subdivisions.  Level 8 is 655362 vertices;
+	// anything past level 6 (40962 vertices) needs 32-bit indices, so callers
+	// going that high must not use GetIndices16().
+	numSubdivisions = std::min<uint32>(numSubdivisions, 8u);
 
 	// Approximate a sphere by tessellating an icosahedron.
 
@@ -402,8 +705,7 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGeosphere(float radius, uin
 	for (uint32 i = 0; i < 12; ++i)
 		meshData.Vertices[i].Position = pos[i];
 
-	for (uint32 i = 0; i < numSubdivisions; ++i)
-		Subdivide(meshData);
+	Subdivide(meshData, numSubdivisions);
 
 	// Project vertices onto sphere and scale.
 	for (uint32 i = 0; i < meshData.Vertices.size(); ++i)
@@ -437,13 +739,24 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGeosphere(float radius, uin
 		XMVECTOR T = XMLoadFloat3(&meshData.Vertices[i].TangentU);
 		XMStoreFloat3(&meshData.Vertices[i].TangentU, XMVector3Normalize(T));
 	}
-
-	return meshData;
 }
 
 GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float height, float depth, uint32 numSubdivisions)
 {
 	MeshData meshData;
+	BuildBox(width, height, depth, numSubdivisions, meshData);
+	return meshData;
+}
+
+void GeometryGenerator::CreateBox(float width, float height, float depth, uint32 numSubdivisions, const MeshSpan& out)
+{
+	MeshData& meshData = ThreadScratch().Mesh;
+	BuildBox(width, height, depth, numSubdivisions, meshData);
+	WriteMesh(meshData, out);
+}
+
+void GeometryGenerator::BuildBox(float width, float height, float depth, uint32 numSubdivisions, MeshData& meshData)
+{
 
 	//
 	// Create the vertices.
@@ -528,61 +841,59 @@ GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float heig
 	// Put a cap on the number of subdivisions.
 	numSubdivisions = std::min<uint32>(numSubdivisions, 6u);
 
-	for (uint32 i = 0; i < numSubdivisions; ++i)
-		Subdivide(meshData);
-
-	return meshData;
+	Subdivide(meshData, numSubdivisions);
 }
 
 GeometryGenerator::MeshData GeometryGenerator::CreateQuad(float x, float y, float w, float h, float depth)
 {
-	MeshData meshData;
+	MeshData meshData = Allocate(QuadSize());
+	CreateQuad(x, y, w, h, depth, SpanOf(meshData));
+	return meshData;
+}
 
-	meshData.Vertices.resize(4);
-	meshData.Indices32.resize(6);
+void GeometryGenerator::CreateQuad(float x, float y, float w, float h, float depth, const MeshSpan& out)
+{
+	MeshWriter writer(out);
 
 	// Position coordinates specified in NDC space.
-	meshData.Vertices[0] = Vertex(
+	writer.WriteVertex(0, Vertex(
 		x, y - h, depth,
 		0.0f, 0.0f, -1.0f,
 		1.0f, 0.0f, 0.0f,
-		0.0f, 1.0f);
+		0.0f, 1.0f));
 
-	meshData.Vertices[1] = Vertex(
+	writer.WriteVertex(1, Vertex(
 		x, y, depth,
 		0.0f, 0.0f, -1.0f,
 		1.0f, 0.0f, 0.0f,
-		0.0f, 0.0f);
+		0.0f, 0.0f));
 
-	meshData.Vertices[2] = Vertex(
+	writer.WriteVertex(2, Vertex(
 		x + w, y, depth,
 		0.0f, 0.0f, -1.0f,
 		1.0f, 0.0f, 0.0f,
-		1.0f, 0.0f);
+		1.0f, 0.0f));
 
-	meshData.Vertices[3] = Vertex(
+	writer.WriteVertex(3, Vertex(
 		x + w, y - h, depth,
 		0.0f, 0.0f, -1.0f,
 		1.0f, 0.0f, 0.0f,
-		1.0f, 1.0f);
-
-	meshData.Indices32[0] = 0;
-	meshData.Indices32[1] = 1;
-	meshData.Indices32[2] = 2;
-
-	meshData.Indices32[3] = 0;
-	meshData.Indices32[4] = 2;
-	meshData.Indices32[5] = 3;
+		1.0f, 1.0f));
 
-	return meshData;
+	writer.WriteTriangle(0, 0, 1, 2);
+	writer.WriteTriangle(3, 0, 2, 3);
 }
 
 GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float depth, uint32 m, uint32 n)
 {
-	MeshData meshData;
+	MeshData meshData = Allocate(GridSize(m, n));
+	CreateGrid(width, depth, m, n, SpanOf(meshData));
+	return meshData;
+}
 
-	uint32 vertexCount = m * n;
-	uint32 faceCount = (m - 1) * (n - 1) * 2;
+void GeometryGenerator::CreateGrid(float width, float depth, uint32 m, uint32 n, const MeshSpan& out)
+{
+	MeshWriter writer(out);
 
 	//
 	// Create the vertices.
@@ -597,7 +908,6 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float dep
 	float du = 1.0f / (n - 1);
 	float dv = 1.0f / (m - 1);
 
-	meshData.Vertices.resize(vertexCount);
 	for (uint32 i = 0; i < m; ++i)
 	{
 		float z = halfDepth - i * dz;
@@ -605,13 +915,12 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float dep
 		{
 			float x = -halfWidth + j * dx;
 
-			meshData.Vertices[i * n + j].Position = XMFLOAT3(x, 0.0f, z);
-			meshData.Vertices[i * n + j].Normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
-			meshData.Vertices[i * n + j].TangentU = XMFLOAT3(1.0f, 0.0f, 0.0f);
-
 			// Stretch texture over grid.
-			meshData.Vertices[i * n + j].TexC.x = j * du;
-			meshData.Vertices[i * n + j].TexC.y = i * dv;
+			writer.WriteVertex(i * n + j, Vertex(
+				x, 0.0f, z,
+				0.0f, 1.0f, 0.0f,
+				1.0f, 0.0f, 0.0f,
+				j * du, i * dv));
 		}
 	}
 
@@ -619,25 +928,16 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float dep
 	// Create the indices.
 	//
 
-	meshData.Indices32.resize(faceCount * 3); // 3 indices per face
-
 	// Iterate over each quad and compute indices.
 	uint32 k = 0;
 	for (uint32 i = 0; i < m - 1; ++i)
 	{
 		for (uint32 j = 0; j < n - 1; ++j)
 		{
-			meshData.Indices32[k] = i * n + j;
-			meshData.Indices32[k + 1] = i * n + j + 1;
-			meshData.Indices32[k + 2] = (i + 1) * n + j;
-
-			meshData.Indices32[k + 3] = (i + 1) * n + j;
-			meshData.Indices32[k + 4] = i * n + j + 1;
-			meshData.Indices32[k + 5] = (i + 1) * n + j + 1;
+			writer.WriteTriangle(k, i * n + j, i * n + j + 1, (i + 1) * n + j);
+			writer.WriteTriangle(k + 3, (i + 1) * n + j, i * n + j + 1, (i + 1) * n + j + 1);
 
 			k += 6; // next quad
 		}
 	}
-
-	return meshData;
-}
\ No newline at end of file
+}
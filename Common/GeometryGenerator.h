@@ -1,4 +1,6 @@
 #pragma once
+#include <cassert>
+#include <cstddef>
 #include <cstdint>
 #include <DirectXMath.h>
 #include <vector>
@@ -42,6 +44,8 @@ public:
 		std::vector<uint32> Indices32;
 		std::vector<uint16>& GetIndices16()
 		{
+			// 16-bit indices can only address the first 65536 vertices.
+			assert(Vertices.size() <= 0x10000);
 			if (mIndices16.empty())
 			{
 				mIndices16.resize(Indices32.size());
@@ -54,6 +58,59 @@ public:
 		std::vector<uint16> mIndices16;
 	};
 
+	// Structure-of-arrays counterpart of MeshData.  Each attribute lives in its
+	// own tightly packed stream so the generation kernels can fill several
+	// vertices per iteration.  Use Interleave() to get the Vertex layout.
+	struct MeshDataSoA
+	{
+		std::vector<DirectX::XMFLOAT3> Positions;
+		std::vector<DirectX::XMFLOAT3> Normals;
+		std::vector<DirectX::XMFLOAT3> TangentUs;
+		std::vector<DirectX::XMFLOAT2> TexCs;
+		std::vector<uint32> Indices32;
+
+		void Resize(size_t vertexCount, size_t indexCount)
+		{
+			Positions.resize(vertexCount);
+			Normals.resize(vertexCount);
+			TangentUs.resize(vertexCount);
+			TexCs.resize(vertexCount);
+			Indices32.resize(indexCount);
+		}
+	};
+
+	// Exact vertex and index counts of a primitive.  Every Create* function
+	// produces exactly the counts reported by the matching *Size function, so
+	// callers can lay out their buffers before generating anything.
+	struct MeshSize
+	{
+		uint32 VertexCount = 0;
+		uint32 IndexCount = 0;
+	};
+
+	// Byte offsets of the Vertex attributes inside a caller vertex format.
+	// Attributes with a negative offset are not written.  The defaults
+	// describe Vertex itself.
+	struct VertexLayout
+	{
+		uint32 Stride = sizeof(Vertex);
+		int PositionOffset = offsetof(Vertex, Position);
+		int NormalOffset = offsetof(Vertex, Normal);
+		int TangentUOffset = offsetof(Vertex, TangentU);
+		int TexCOffset = offsetof(Vertex, TexC);
+	};
+
+	// Caller-owned destination for generated geometry, e.g. a CPU blob or a
+	// mapped upload buffer.  Vertices must hold VertexCount * Layout.Stride
+	// bytes and Indices must hold IndexCount * IndexByteSize bytes.
+	struct MeshSpan
+	{
+		void* Vertices = nullptr;
+		VertexLayout Layout;
+		void* Indices = nullptr;
+		uint32 IndexByteSize = sizeof(uint32); // 2 or 4
+	};
+
 	MeshData CreateCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount);
 	MeshData CreateSphere(float radius, uint32 sliceCount, uint32 stackCount);
 	MeshData CreateGeosphere(float radius, uint32 numSubdivisions);
@@ -61,12 +118,50 @@ public:
 	MeshData CreateQuad(float x, float y, float w, float h, float depth);
 	MeshData CreateGrid(float width, float depth, uint32 m, uint32 n);
 
+	static MeshSize CylinderSize(uint32 sliceCount, uint32 stackCount);
+	static MeshSize SphereSize(uint32 sliceCount, uint32 stackCount);
+	static MeshSize GeosphereSize(uint32 numSubdivisions);
+	static MeshSize BoxSize(uint32 numSubdivisions);
+	static MeshSize QuadSize();
+	static MeshSize GridSize(uint32 m, uint32 n);
+
+	// Same primitives, written straight into a caller-provided span with no
+	// intermediate MeshData.  The geosphere and box are subdivided in scratch
+	// buffers kept per thread and reused across calls, so one generator may be
+	// used from several threads at once.
+	void CreateCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, const MeshSpan& out);
+	void CreateSphere(float radius, uint32 sliceCount, uint32 stackCount, const MeshSpan& out);
+	void CreateGeosphere(float radius, uint32 numSubdivisions, const MeshSpan& out);
+	void CreateBox(float width, float height, float depth, uint32 numSubdivisions, const MeshSpan& out);
+	void CreateQuad(float x, float y, float w, float h, float depth, const MeshSpan& out);
+	void CreateGrid(float width, float depth, uint32 m, uint32 n, const MeshSpan& out);
+
+	// Writes an existing mesh through a span's vertex layout and index width.
+	static void WriteMesh(const MeshData& meshData, const MeshSpan& out);
+
+	// Vectorized versions of CreateCylinder, CreateSphere and CreateGrid.  They
+	// produce the same vertices and indices (within float rounding) as the
+	// scalar functions, four slices or columns at a time.
+	MeshDataSoA CreateCylinderSoA(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount);
+	MeshDataSoA CreateSphereSoA(float radius, uint32 sliceCount, uint32 stackCount);
+	MeshDataSoA CreateGridSoA(float width, float depth, uint32 m, uint32 n);
+
+	// Converts a MeshDataSoA to the interleaved Vertex layout.
+	static MeshData Interleave(const MeshDataSoA& soa);
+
 
 private:
+	class MeshWriter;
+
 	void BuildCylinderTopCap(float bottomRadius, float topRadius, float height,
-		uint32 sliceCount, uint32 stackCount, MeshData& meshData);
+		uint32 sliceCount, uint32 stackCount, MeshWriter& writer, uint32 baseVertex, uint32 baseIndex);
 	void BuildCylinderBottomCap(float bottomRadius, float topRadius, float height,
-		uint32 sliceCount, uint32 stackCount, MeshData& meshData);
+		uint32 sliceCount, uint32 stackCount, MeshWriter& writer, uint32 baseVertex, uint32 baseIndex);
+	void BuildGeosphere(float radius, uint32 numSubdivisions, MeshData& meshData);
+	void BuildBox(float width, float height, float depth, uint32 numSubdivisions, MeshData& meshData);
 	Vertex MidPoint(const Vertex& v0, const Vertex& v1);
-	void Subdivide(MeshData& meshData);
+	// Applies numSubdivisions levels of 1-to-4 triangle subdivision in one pass.
+	// Midpoints are shared between the triangles of an edge, and the vertex and
+	// index buffers are sized once for the final level.
+	void Subdivide(MeshData& meshData, uint32 numSubdivisions);
 };
@@ -0,0 +1,361 @@
+#include "GeometryGenerator.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	// Transposes four (x, y, z) lanes into 12 consecutive floats and writes the
+	// first count XMFLOAT3s to dst.
+	//   x = [x0 x1 x2 x3], y = [y0 ...], z = [z0 ...]
+	//   -> [x0 y0 z0 x1] [y1 z1 x2 y2] [z2 x3 y3 z3]
+	void StoreFloat3x4(XMFLOAT3* dst, FXMVECTOR x, FXMVECTOR y, FXMVECTOR z, uint32_t count)
+	{
+		XMVECTOR xy01 = XMVectorMergeXY(x, y);
+		XMVECTOR xy23 = XMVectorMergeZW(x, y);
+
+		XMVECTOR r0 = XMVectorPermute<0, 1, 4, 2>(xy01, z);
+		XMVECTOR r1 = XMVectorPermute<0, 1, 4, 5>(XMVectorPermute<3, 5, 0, 0>(xy01, z), xy23);
+		XMVECTOR r2 = XMVectorPermute<6, 2, 3, 7>(xy23, z);
+
+		if (count == 4)
+		{
+			float* f = reinterpret_cast<float*>(dst);
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(f + 0), r0);
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(f + 4), r1);
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(f + 8), r2);
+			return;
+		}
+
+		// Tail of a ring: go through a temporary so we never write past the stream.
+		XMFLOAT4 tmp[3];
+		XMStoreFloat4(&tmp[0], r0);
+		XMStoreFloat4(&tmp[1], r1);
+		XMStoreFloat4(&tmp[2], r2);
+		memcpy(dst, tmp, sizeof(XMFLOAT3) * count);
+	}
+
+	// Same as above for (u, v) pairs: [u0 v0 u1 v1] [u2 v2 u3 v3].
+	void StoreFloat2x4(XMFLOAT2* dst, FXMVECTOR u, FXMVECTOR v, uint32_t count)
+	{
+		XMVECTOR r0 = XMVectorMergeXY(u, v);
+		XMVECTOR r1 = XMVectorMergeZW(u, v);
+
+		if (count == 4)
+		{
+			float* f = reinterpret_cast<float*>(dst);
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(f + 0), r0);
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(f + 4), r1);
+			return;
+		}
+
+		XMFLOAT4 tmp[2];
+		XMStoreFloat4(&tmp[0], r0);
+		XMStoreFloat4(&tmp[1], r1);
+		memcpy(dst, tmp, sizeof(XMFLOAT2) * count);
+	}
+
+	const XMVECTORF32 gLaneOffsets = { { { 0.0f, 1.0f, 2.0f, 3.0f } } };
+
+	// Writes one ring of sliceCount + 1 vertices around the y-axis.  The normal
+	// of every vertex in the ring is (normalXZ * cos(t), normalY, normalXZ * sin(t)),
+	// the tangent is dP/dt normalized and u runs from 0 to 1 around the ring.
+	void WriteSideRing(GeometryGenerator::MeshDataSoA& mesh, uint32_t first,
+		float radius, float y, float normalXZ, float normalY, float v, uint32_t sliceCount)
+	{
+		const float thetaStep = XM_2PI / sliceCount;
+		const float du = 1.0f / sliceCount;
+		const uint32_t count = sliceCount + 1;
+
+		const XMVECTOR r = XMVectorReplicate(radius);
+		const XMVECTOR py = XMVectorReplicate(y);
+		const XMVECTOR nxz = XMVectorReplicate(normalXZ);
+		const XMVECTOR ny = XMVectorReplicate(normalY);
+		const XMVECTOR zero = XMVectorZero();
+		const XMVECTOR tv = XMVectorReplicate(v);
+
+		for (uint32_t j = 0; j < count; j += 4)
+		{
+			XMVECTOR slice = XMVectorAdd(XMVectorReplicate((float)j), gLaneOffsets);
+
+			XMVECTOR s, c;
+			XMVectorSinCos(&s, &c, XMVectorScale(slice, thetaStep));
+
+			uint32_t n = std::min(4u, count - j);
+			StoreFloat3x4(&mesh.Positions[first + j], XMVectorMultiply(r, c), py, XMVectorMultiply(r, s), n);
+			StoreFloat3x4(&mesh.Normals[first + j], XMVectorMultiply(nxz, c), ny, XMVectorMultiply(nxz, s), n);
+			StoreFloat3x4(&mesh.TangentUs[first + j], XMVectorNegate(s), zero, c, n);
+			StoreFloat2x4(&mesh.TexCs[first + j], XMVectorScale(slice, du), tv, n);
+		}
+	}
+
+	// Writes the sliceCount + 1 rim vertices of a flat cylinder cap.
+	void WriteCapRing(GeometryGenerator::MeshDataSoA& mesh, uint32_t first,
+		float radius, float y, float normalY, float height, uint32_t sliceCount)
+	{
+		const float thetaStep = XM_2PI / sliceCount;
+		const uint32_t count = sliceCount + 1;
+
+		const XMVECTOR r = XMVectorReplicate(radius);
+		const XMVECTOR py = XMVectorReplicate(y);
+		const XMVECTOR ny = XMVectorReplicate(normalY);
+		const XMVECTOR zero = XMVectorZero();
+		const XMVECTOR one = XMVectorSplatOne();
+		const XMVECTOR half = XMVectorReplicate(0.5f);
+		const XMVECTOR invHeight = XMVectorReplicate(1.0f / height);
+
+		for (uint32_t j = 0; j < count; j += 4)
+		{
+			XMVECTOR slice = XMVectorAdd(XMVectorReplicate((float)j), gLaneOffsets);
+
+			XMVECTOR s, c;
+			XMVectorSinCos(&s, &c, XMVectorScale(slice, thetaStep));
+
+			XMVECTOR x = XMVectorMultiply(r, c);
+			XMVECTOR z = XMVectorMultiply(r, s);
+
+			// Scale down by the height to try and make top cap texture coord
+			// area proportional to base.
+			XMVECTOR u = XMVectorMultiplyAdd(x, invHeight, half);
+			XMVECTOR v = XMVectorMultiplyAdd(z, invHeight, half);
+
+			uint32_t n = std::min(4u, count - j);
+			StoreFloat3x4(&mesh.Positions[first + j], x, py, z, n);
+			StoreFloat3x4(&mesh.Normals[first + j], zero, ny, zero, n);
+			StoreFloat3x4(&mesh.TangentUs[first + j], one, zero, zero, n);
+			StoreFloat2x4(&mesh.TexCs[first + j], u, v, n);
+		}
+	}
+
+	void WriteVertex(GeometryGenerator::MeshDataSoA& mesh, uint32_t i, const GeometryGenerator::Vertex& v)
+	{
+		mesh.Positions[i] = v.Position;
+		mesh.Normals[i] = v.Normal;
+		mesh.TangentUs[i] = v.TangentU;
+		mesh.TexCs[i] = v.TexC;
+	}
+}
+
+GeometryGenerator::MeshDataSoA GeometryGenerator::CreateCylinderSoA(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount)
+{
+	MeshDataSoA meshData;
+
+	uint32 ringCount = stackCount + 1;
+	uint32 ringVertexCount = sliceCount + 1;
+	uint32 sideVertexCount = ringCount * ringVertexCount;
+	MeshSize size = CylinderSize(sliceCount, stackCount);
+	meshData.Resize(size.VertexCount, size.IndexCount);
+
+	//
+	// Build Stacks.
+	//
+
+	float heightStep = height / stackCount;
+	float radiusStep = (topRadius - bottomRadius) / stackCount;
+
+	// The side normal only depends on the slice angle: with dr = r0 - r1,
+	// T x B = (h*cos(t), dr, h*sin(t)).  See CreateCylinder.
+	float dr = bottomRadius - topRadius;
+	float invLength = 1.0f / sqrtf(height * height + dr * dr);
+	float normalXZ = height * invLength;
+	float normalY = dr * invLength;
+
+	for (uint32 i = 0; i < ringCount; ++i)
+	{
+		float y = i * heightStep - 0.5f * height;
+		float r = bottomRadius + i * radiusStep;
+		WriteSideRing(meshData, i * ringVertexCount, r, y, normalXZ, normalY,
+			1.0f - (float)i / stackCount, sliceCount);
+	}
+
+	uint32* indices = meshData.Indices32.data();
+	for (uint32 i = 0; i < stackCount; ++i)
+	{
+		for (uint32 j = 0; j < sliceCount; ++j)
+		{
+			*indices++ = i * ringVertexCount + j;
+			*indices++ = (i + 1) * ringVertexCount + j;
+			*indices++ = (i + 1) * ringVertexCount + j + 1;
+
+			*indices++ = i * ringVertexCount + j;
+			*indices++ = (i + 1) * ringVertexCount + j + 1;
+			*indices++ = i * ringVertexCount + j + 1;
+		}
+	}
+
+	//
+	// Build the caps.  Both use topRadius, like BuildCylinderTopCap and
+	// BuildCylinderBottomCap.
+	//
+
+	uint32 topBase = sideVertexCount;
+	uint32 topCenter = topBase + ringVertexCount;
+	WriteCapRing(meshData, topBase, topRadius, 0.5f * height, 1.0f, height, sliceCount);
+	WriteVertex(meshData, topCenter, Vertex(0.0f, 0.5f * height, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f));
+
+	for (uint32 i = 0; i < sliceCount; ++i)
+	{
+		*indices++ = topCenter;
+		*indices++ = topBase + i + 1;
+		*indices++ = topBase + i;
+	}
+
+	uint32 bottomBase = topCenter + 1;
+	uint32 bottomCenter = bottomBase + ringVertexCount;
+	WriteCapRing(meshData, bottomBase, topRadius, -0.5f * height, -1.0f, height, sliceCount);
+	WriteVertex(meshData, bottomCenter, Vertex(0.0f, -0.5f * height, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f));
+
+	for (uint32 i = 0; i < sliceCount; ++i)
+	{
+		*indices++ = bottomCenter;
+		*indices++ = bottomBase + i;
+		*indices++ = bottomBase + i + 1;
+	}
+
+	return meshData;
+}
+
+GeometryGenerator::MeshDataSoA GeometryGenerator::CreateSphereSoA(float radius, uint32 sliceCount, uint32 stackCount)
+{
+	MeshDataSoA meshData;
+
+	uint32 ringVertexCount = sliceCount + 1;
+	MeshSize size = SphereSize(sliceCount, stackCount);
+	uint32 vertexCount = size.VertexCount;
+	meshData.Resize(size.VertexCount, size.IndexCount);
+
+	// Poles: note that there will be texture coordinate distortion as there is
+	// not a unique point on the texture map to assign to the pole when mapping
+	// a rectangular texture onto a sphere.
+	WriteVertex(meshData, 0, Vertex(0.0f, +radius, 0.0f, 0.0f, +1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f));
+	WriteVertex(meshData, vertexCount - 1, Vertex(0.0f, -radius, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f));
+
+	float phiStep = XM_PI / stackCount;
+
+	// Compute vertices for each stack ring (do not count the poles as rings).
+	for (uint32 i = 1; i <= stackCount - 1; ++i)
+	{
+		float phi = i * phiStep;
+		float sinPhi = sinf(phi);
+		float cosPhi = cosf(phi);
+
+		WriteSideRing(meshData, 1 + (i - 1) * ringVertexCount, radius * sinPhi, radius * cosPhi,
+			sinPhi, cosPhi, phi / XM_PI, sliceCount);
+	}
+
+	uint32* indices = meshData.Indices32.data();
+
+	// Top stack.
+	for (uint32 i = 1; i <= sliceCount; ++i)
+	{
+		*indices++ = 0;
+		*indices++ = i + 1;
+		*indices++ = i;
+	}
+
+	// Inner stacks.
+	uint32 baseIndex = 1;
+	for (uint32 i = 0; i < stackCount - 2; ++i)
+	{
+		for (uint32 j = 0; j < sliceCount; ++j)
+		{
+			*indices++ = baseIndex + i * ringVertexCount + j;
+			*indices++ = baseIndex + i * ringVertexCount + j + 1;
+			*indices++ = baseIndex + (i + 1) * ringVertexCount + j;
+
+			*indices++ = baseIndex + (i + 1) * ringVertexCount + j;
+			*indices++ = baseIndex + i * ringVertexCount + j + 1;
+			*indices++ = baseIndex + (i + 1) * ringVertexCount + j + 1;
+		}
+	}
+
+	// Bottom stack.
+	uint32 southPoleIndex = vertexCount - 1;
+	baseIndex = southPoleIndex - ringVertexCount;
+	for (uint32 i = 0; i < sliceCount; ++i)
+	{
+		*indices++ = southPoleIndex;
+		*indices++ = baseIndex + i;
+		*indices++ = baseIndex + i + 1;
+	}
+
+	return meshData;
+}
+
+GeometryGenerator::MeshDataSoA GeometryGenerator::CreateGridSoA(float width, float depth, uint32 m, uint32 n)
+{
+	MeshDataSoA meshData;
+	MeshSize size = GridSize(m, n);
+	meshData.Resize(size.VertexCount, size.IndexCount);
+
+	float halfWidth = 0.5f * width;
+	float halfDepth = 0.5f * depth;
+
+	float dx = width / (n - 1);
+	float dz = depth / (m - 1);
+
+	float du = 1.0f / (n - 1);
+	float dv = 1.0f / (m - 1);
+
+	const XMVECTOR x0 = XMVectorReplicate(-halfWidth);
+	const XMVECTOR zero = XMVectorZero();
+	const XMVECTOR one = XMVectorSplatOne();
+
+	for (uint32 i = 0; i < m; ++i)
+	{
+		const XMVECTOR z = XMVectorReplicate(halfDepth - i * dz);
+		const XMVECTOR v = XMVectorReplicate(i * dv);
+
+		for (uint32 j = 0; j < n; j += 4)
+		{
+			XMVECTOR column = XMVectorAdd(XMVectorReplicate((float)j), gLaneOffsets);
+			XMVECTOR x = XMVectorMultiplyAdd(column, XMVectorReplicate(dx), x0);
+
+			uint32 k = i * n + j;
+			uint32 count = std::min(4u, n - j);
+			StoreFloat3x4(&meshData.Positions[k], x, zero, z, count);
+			StoreFloat3x4(&meshData.Normals[k], zero, one, zero, count);
+			StoreFloat3x4(&meshData.TangentUs[k], one, zero, zero, count);
+
+			// Stretch texture over grid.
+			StoreFloat2x4(&meshData.TexCs[k], XMVectorScale(column, du), v, count);
+		}
+	}
+
+	uint32* indices = meshData.Indices32.data();
+	for (uint32 i = 0; i < m - 1; ++i)
+	{
+		for (uint32 j = 0; j < n - 1; ++j)
+		{
+			*indices++ = i * n + j;
+			*indices++ = i * n + j + 1;
+			*indices++ = (i + 1) * n + j;
+
+			*indices++ = (i + 1) * n + j;
+			*indices++ = i * n + j + 1;
+			*indices++ = (i + 1) * n + j + 1;
+		}
+	}
+
+	return meshData;
+}
+
+GeometryGenerator::MeshData GeometryGenerator::Interleave(const MeshDataSoA& soa)
+{
+	MeshData meshData;
+
+	size_t vertexCount = soa.Positions.size();
+	meshData.Vertices.resize(vertexCount);
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		Vertex& v = meshData.Vertices[i];
+		v.Position = soa.Positions[i];
+		v.Normal = soa.Normals[i];
+		v.TangentU = soa.TangentUs[i];
+		v.TexC = soa.TexCs[i];
+	}
+	meshData.Indices32 = soa.Indices32;
+
+	return meshData;
+}
@@ -0,0 +1,360 @@
+#include "GeometryPool.h"
+#include "MeshGeometry.h"
+#include <algorithm>
+#include <cstring>
+
+using Microsoft::WRL::ComPtr;
+
+const GeometryPool::Handle GeometryPool::InvalidHandle;
+
+namespace
+{
+	struct CopyRegion
+	{
+		UINT64 DstOffset;
+		UINT64 SrcOffset;
+		UINT64 ByteSize;
+	};
+
+	// Records the copies sorted by destination, merging neighbours that are
+	// contiguous in both buffers into one CopyBufferRegion.
+	void RecordCopies(ID3D12GraphicsCommandList* cmdList, ID3D12Resource* dst, ID3D12Resource* src,
+		std::vector<CopyRegion>& regions)
+	{
+		std::sort(regions.begin(), regions.end(),
+			[](const CopyRegion& a, const CopyRegion& b) { return a.DstOffset < b.DstOffset; });
+
+		for (size_t i = 0; i < regions.size();)
+		{
+			CopyRegion run = regions[i++];
+			while (i < regions.size() &&
+				regions[i].DstOffset == run.DstOffset + run.ByteSize &&
+				regions[i].SrcOffset == run.SrcOffset + run.ByteSize)
+			{
+				run.ByteSize += regions[i++].ByteSize;
+			}
+			cmdList->CopyBufferRegion(dst, run.DstOffset, src, run.SrcOffset, run.ByteSize);
+		}
+	}
+}
+
+GeometryPool::GeometryPool(ID3D12Device* device, UINT vertexByteStride, DXGI_FORMAT indexFormat,
+	UINT vertexCapacity, UINT indexCapacity) :
+	mDevice(device),
+	mVertexByteStride(vertexByteStride),
+	mIndexFormat(indexFormat),
+	mIndexByteSize(indexFormat == DXGI_FORMAT_R32_UINT ? 4 : 2),
+	mVertexRanges((std::max)(vertexCapacity, 1u)),
+	mIndexRanges((std::max)(indexCapacity, 1u))
+{
+}
+
+GeometryPool::Handle GeometryPool::Add(const void* vertices, UINT vertexCount, const void* indices, UINT indexCount)
+{
+	assert(vertexCount > 0 && indexCount > 0);
+
+	UINT vertexOffset = mVertexRanges.Allocate(vertexCount);
+	UINT indexOffset = mIndexRanges.Allocate(indexCount);
+	if (vertexOffset == RangeAllocator::InvalidOffset || indexOffset == RangeAllocator::InvalidOffset)
+	{
+		if (vertexOffset != RangeAllocator::InvalidOffset)
+			mVertexRanges.Free(vertexOffset, vertexCount);
+		if (indexOffset != RangeAllocator::InvalidOffset)
+			mIndexRanges.Free(indexOffset, indexCount);
+
+		// Out of room, or too fragmented.  Double whatever ran short so a
+		// run of Adds does not rebuild the buffers every time.
+		UINT vertexCapacity = mVertexRanges.Capacity();
+		if (mVertexRanges.FreeSize() < vertexCount)
+			vertexCapacity = (std::max)(2 * vertexCapacity, mVertexRanges.UsedSize() + vertexCount);
+		UINT indexCapacity = mIndexRanges.Capacity();
+		if (mIndexRanges.FreeSize() < indexCount)
+			indexCapacity = (std::max)(2 * indexCapacity, mIndexRanges.UsedSize() + indexCount);
+		Relayout(vertexCapacity, indexCapacity);
+
+		vertexOffset = mVertexRanges.Allocate(vertexCount);
+		indexOffset = mIndexRanges.Allocate(indexCount);
+	}
+
+	Handle handle;
+	if (!mFreeHandles.empty())
+	{
+		handle = mFreeHandles.back();
+		mFreeHandles.pop_back();
+	}
+	else
+	{
+		handle = static_cast<Handle>(mEntries.size());
+		mEntries.emplace_back();
+	}
+
+	Entry& entry = mEntries[handle];
+	entry = Entry();
+	entry.Live = true;
+	entry.VertexOffset = vertexOffset;
+	entry.VertexCount = vertexCount;
+	entry.IndexOffset = indexOffset;
+	entry.IndexCount = indexCount;
+
+	const std::uint8_t* vertexBytes = static_cast<const std::uint8_t*>(vertices);
+	const std::uint8_t* indexBytes = static_cast<const std::uint8_t*>(indices);
+	entry.StagedVertices.assign(vertexBytes, vertexBytes + UINT64(vertexCount) * mVertexByteStride);
+	entry.StagedIndices.assign(indexBytes, indexBytes + UINT64(indexCount) * mIndexByteSize);
+	mHasStagedData = true;
+
+	return handle;
+}
+
+void GeometryPool::Remove(Handle handle)
+{
+	Entry& entry = mEntries[handle];
+	assert(entry.Live);
+
+	mVertexRanges.Free(entry.VertexOffset, entry.VertexCount);
+	mIndexRanges.Free(entry.IndexOffset, entry.IndexCount);
+	entry = Entry();
+	mFreeHandles.push_back(handle);
+}
+
+SubmeshGeometry GeometryPool::Submesh(Handle handle) const
+{
+	const Entry& entry = mEntries[handle];
+	assert(entry.Live);
+
+	SubmeshGeometry submesh;
+	submesh.IndexCount = entry.IndexCount;
+	submesh.StartIndexLocation = entry.IndexOffset;
+	submesh.BaseVertexLocation = static_cast<INT>(entry.VertexOffset);
+	return submesh;
+}
+
+void GeometryPool::Defragment()
+{
+	Relayout(mVertexRanges.Capacity(), mIndexRanges.Capacity());
+}
+
+void GeometryPool::Relayout(UINT vertexCapacity, UINT indexCapacity)
+{
+	// Keep the meshes in their current order so neighbours stay neighbours.
+	std::vector<Handle> order;
+	for (Handle h = 0; h < mEntries.size(); ++h)
+	{
+		if (mEntries[h].Live)
+			order.push_back(h);
+	}
+	std::sort(order.begin(), order.end(),
+		[&](Handle a, Handle b) { return mEntries[a].VertexOffset < mEntries[b].VertexOffset; });
+
+	mVertexRanges.Reset(vertexCapacity);
+	mIndexRanges.Reset(indexCapacity);
+	for (Handle h : order)
+	{
+		Entry& entry = mEntries[h];
+		entry.VertexOffset = mVertexRanges.Allocate(entry.VertexCount);
+		entry.IndexOffset = mIndexRanges.Allocate(entry.IndexCount);
+	}
+	mRebuildPending = true;
+}
+
+// Committed rather than placed by a GpuMemoryAllocator: the pool is itself
+// the sub-allocator for its meshes, and holds just two buffers, replaced
+// whole when they grow.
+ComPtr<ID3D12Resource> GeometryPool::CreateBuffer(UINT64 byteSize) const
+{
+	CD3DX12_HEAP_PROPERTIES heapProps(D3D12_HEAP_TYPE_DEFAULT);
+	CD3DX12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
+
+	ComPtr<ID3D12Resource> buffer;
+	ThrowIfFailed(mDevice->CreateCommittedResource(
+		&heapProps,
+		D3D12_HEAP_FLAG_NONE,
+		&desc,
+		D3D12_RESOURCE_STATE_COMMON,
+		nullptr,
+		IID_PPV_ARGS(buffer.GetAddressOf())));
+	return buffer;
+}
+
+void GeometryPool::FlushUploads(ID3D12GraphicsCommandList* cmdList, UploadRingBuffer& uploads)
+{
+	if (!mRebuildPending && !mHasStagedData)
+		return;
+
+	ComPtr<ID3D12Resource> oldVertexBuffer = mVertexBuffer;
+	ComPtr<ID3D12Resource> oldIndexBuffer = mIndexBuffer;
+	std::vector<D3D12_RESOURCE_BARRIER> barriers;
+
+	if (mRebuildPending)
+	{
+		mVertexBuffer = CreateBuffer(UINT64(mVertexRanges.Capacity()) * mVertexByteStride);
+		mIndexBuffer = CreateBuffer(UINT64(mIndexRanges.Capacity()) * mIndexByteSize);
+		barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(mVertexBuffer.Get(),
+			D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST));
+		barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(mIndexBuffer.Get(),
+			D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST));
+		if (oldVertexBuffer)
+		{
+			barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(oldVertexBuffer.Get(),
+				D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, D3D12_RESOURCE_STATE_COPY_SOURCE));
+			barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(oldIndexBuffer.Get(),
+				D3D12_RESOURCE_STATE_INDEX_BUFFER, D3D12_RESOURCE_STATE_COPY_SOURCE));
+		}
+	}
+	else
+	{
+		barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(mVertexBuffer.Get(),
+			D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, D3D12_RESOURCE_STATE_COPY_DEST));
+		barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(mIndexBuffer.Get(),
+			D3D12_RESOURCE_STATE_INDEX_BUFFER, D3D12_RESOURCE_STATE_COPY_DEST));
+	}
+	cmdList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+
+	// Move the meshes already on the GPU into the new buffers.
+	if (mRebuildPending && oldVertexBuffer)
+	{
+		std::vector<CopyRegion> vertexMoves;
+		std::vector<CopyRegion> indexMoves;
+		for (const Entry& entry : mEntries)
+		{
+			if (!entry.Live || !entry.Resident)
+				continue;
+			vertexMoves.push_back({ UINT64(entry.VertexOffset) * mVertexByteStride,
+				UINT64(entry.ResidentVertexOffset) * mVertexByteStride, UINT64(entry.VertexCount) * mVertexByteStride });
+			indexMoves.push_back({ UINT64(entry.IndexOffset) * mIndexByteSize,
+				UINT64(entry.ResidentIndexOffset) * mIndexByteSize, UINT64(entry.IndexCount) * mIndexByteSize });
+		}
+		RecordCopies(cmdList, mVertexBuffer.Get(), oldVertexBuffer.Get(), vertexMoves);
+		RecordCopies(cmdList, mIndexBuffer.Get(), oldIndexBuffer.Get(), indexMoves);
+
+		mRetired.push_back({ oldVertexBuffer, 0 });
+		mRetired.push_back({ oldIndexBuffer, 0 });
+	}
+
+	// Stage every new mesh in one ring allocation: all the vertices, then all
+	// the indices.
+	UINT64 vertexBytes = 0;
+	UINT64 indexBytes = 0;
+	for (const Entry& entry : mEntries)
+	{
+		vertexBytes += entry.StagedVertices.size();
+		indexBytes += entry.StagedIndices.size();
+	}
+
+	if (vertexBytes > 0)
+	{
+		UploadRingBuffer::Allocation staging = uploads.Allocate(vertexBytes + indexBytes);
+		std::uint8_t* mapped = static_cast<std::uint8_t*>(staging.CPU);
+
+		std::vector<CopyRegion> vertexCopies;
+		std::vector<CopyRegion> indexCopies;
+		UINT64 vertexCursor = 0;
+		UINT64 indexCursor = vertexBytes;
+		for (Entry& entry : mEntries)
+		{
+			if (entry.StagedVertices.empty())
+				continue;
+
+			std::memcpy(mapped + vertexCursor, entry.StagedVertices.data(), entry.StagedVertices.size());
+			std::memcpy(mapped + indexCursor, entry.StagedIndices.data(), entry.StagedIndices.size());
+			vertexCopies.push_back({ UINT64(entry.VertexOffset) * mVertexByteStride, staging.Offset + vertexCursor, entry.StagedVertices.size() });
+			indexCopies.push_back({ UINT64(entry.IndexOffset) * mIndexByteSize, staging.Offset + indexCursor, entry.StagedIndices.size() });
+			vertexCursor += entry.StagedVertices.size();
+			indexCursor += entry.StagedIndices.size();
+
+			std::vector<std::uint8_t>().swap(entry.StagedVertices);
+			std::vector<std::uint8_t>().swap(entry.StagedIndices);
+			entry.Resident = true;
+		}
+
+		RecordCopies(cmdList, mVertexBuffer.Get(), staging.Resource, vertexCopies);
+		RecordCopies(cmdList, mIndexBuffer.Get(), staging.Resource, indexCopies);
+	}
+
+	for (Entry& entry : mEntries)
+	{
+		entry.ResidentVertexOffset = entry.VertexOffset;
+		entry.ResidentIndexOffset = entry.IndexOffset;
+	}
+	mHasStagedData = false;
+	mRebuildPending = false;
+
+	D3D12_RESOURCE_BARRIER toRead[] =
+	{
+		CD3DX12_RESOURCE_BARRIER::Transition(mVertexBuffer.Get(),
+			D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER),
+		CD3DX12_RESOURCE_BARRIER::Transition(mIndexBuffer.Get(),
+			D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_INDEX_BUFFER)
+	};
+	cmdList->ResourceBarrier(_countof(toRead), toRead);
+}
+
+void GeometryPool::Describe(MeshGeometry& geo) const
+{
+	geo.VertexBufferGPU = mVertexBuffer;
+	geo.IndexBufferGPU = mIndexBuffer;
+	geo.VertexByteStride = mVertexByteStride;
+	geo.VertexBufferByteSize = mVertexRanges.Capacity() * mVertexByteStride;
+	geo.IndexFormat = mIndexFormat;
+	geo.IndexBufferByteSize = mIndexRanges.Capacity() * mIndexByteSize;
+}
+
+D3D12_VERTEX_BUFFER_VIEW GeometryPool::VertexBufferView() const
+{
+	D3D12_VERTEX_BUFFER_VIEW vbv;
+	vbv.BufferLocation = mVertexBuffer->GetGPUVirtualAddress();
+	vbv.StrideInBytes = mVertexByteStride;
+	vbv.SizeInBytes = mVertexRanges.Capacity() * mVertexByteStride;
+	return vbv;
+}
+
+D3D12_INDEX_BUFFER_VIEW GeometryPool::IndexBufferView() const
+{
+	D3D12_INDEX_BUFFER_VIEW ibv;
+	ibv.BufferLocation = mIndexBuffer->GetGPUVirtualAddress();
+	ibv.Format = mIndexFormat;
+	ibv.SizeInBytes = mIndexRanges.Capacity() * mIndexByteSize;
+	return ibv;
+}
+
+void GeometryPool::FenceUploads(UINT64 fence)
+{
+	for (RetiredBuffer& retired : mRetired)
+	{
+		if (retired.Fence == 0)
+			retired.Fence = fence;
+	}
+}
+
+void GeometryPool::ReleaseUploaders(UINT64 completedFence)
+{
+	mRetired.erase(std::remove_if(mRetired.begin(), mRetired.end(),
+		[completedFence](const RetiredBuffer& retired)
+		{
+			return retired.Fence != 0 && retired.Fence <= completedFence;
+		}), mRetired.end());
+}
+
+void GeometryPool::DisposeUploaders()
+{
+	mRetired.clear();
+}
+
+GeometryPool::Stats GeometryPool::GetStats() const
+{
+	Stats stats;
+	stats.MeshCount = static_cast<UINT>(mEntries.size() - mFreeHandles.size());
+	stats.VertexCapacity = mVertexRanges.Capacity();
+	stats.UsedVertices = mVertexRanges.UsedSize();
+	stats.LargestFreeVertexRange = mVertexRanges.LargestFreeRange();
+	stats.IndexCapacity = mIndexRanges.Capacity();
+	stats.UsedIndices = mIndexRanges.UsedSize();
+	stats.LargestFreeIndexRange = mIndexRanges.LargestFreeRange();
+
+	for (const Entry& entry : mEntries)
+		stats.StagedBytes += entry.StagedVertices.size() + entry.StagedIndices.size();
+	if (mVertexBuffer)
+		stats.GpuBytes = mVertexBuffer->GetDesc().Width + mIndexBuffer->GetDesc().Width;
+	for (const RetiredBuffer& retired : mRetired)
+		stats.RetiredBytes += retired.Resource->GetDesc().Width;
+	return stats;
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "d3dUtil.h"
+#include "RangeAllocator.h"
+#include "UploadRingBuffer.h"
+
+// One default heap vertex buffer and one index buffer shared by many meshes.
+// Meshes get ranges from a RangeAllocator and can be added and removed at
+// any time, so every mesh in the pool draws with the same vertex and index
+// buffer bindings.
+//
+// Add() and Remove() only update the CPU side bookkeeping.  FlushUploads()
+// records everything staged since the last flush into a command list with
+// one UploadRingBuffer allocation and one batch of barriers.  When the pool
+// runs out of room, or after Defragment(), the next flush moves every live
+// mesh into a new pair of buffers with the gaps squeezed out; the old
+// buffers are released once the GPU is done with them, see FenceUploads().
+//
+// Indices are relative to each mesh's BaseVertexLocation, so meshes are
+// added with the same indices they would use in a buffer of their own.
+class GeometryPool
+{
+public:
+	using Handle = std::uint32_t;
+
+	static const Handle InvalidHandle = 0xffffffff;
+
+	struct Stats
+	{
+		UINT MeshCount = 0;
+		UINT VertexCapacity = 0;
+		UINT UsedVertices = 0;
+		UINT LargestFreeVertexRange = 0;
+		UINT IndexCapacity = 0;
+		UINT UsedIndices = 0;
+		UINT LargestFreeIndexRange = 0;
+
+		// Memory, in bytes.  Staged data waits in system memory for the next
+		// flush; retired buffers wait for the GPU.
+		UINT64 StagedBytes = 0;
+		UINT64 GpuBytes = 0;
+		UINT64 RetiredBytes = 0;
+	};
+
+	// indexFormat is DXGI_FORMAT_R16_UINT or DXGI_FORMAT_R32_UINT.  The
+	// capacities are the initial sizes in vertices and indices.
+	GeometryPool(ID3D12Device* device, UINT vertexByteStride, DXGI_FORMAT indexFormat,
+		UINT vertexCapacity, UINT indexCapacity);
+	GeometryPool(const GeometryPool& rhs) = delete;
+	GeometryPool& operator=(const GeometryPool& rhs) = delete;
+
+	// Reserves room for a mesh and copies its data aside for the next flush.
+	Handle Add(const void* vertices, UINT vertexCount, const void* indices, UINT indexCount);
+	void Remove(Handle handle);
+
+	// Where a mesh lives, as a submesh of the pool's buffers.  Growing and
+	// Defragment() move meshes, so read this again after each flush; the
+	// ranges are only valid for drawing once FlushUploads() has been
+	// recorded.
+	SubmeshGeometry Submesh(Handle handle) const;
+
+	// Packs the live meshes to the front of new buffers at the next flush.
+	void Defragment();
+
+	// Records the staged uploads and moves, staging the data in uploads.
+	// Leaves the buffers in the vertex and index buffer states.
+	void FlushUploads(ID3D12GraphicsCommandList* cmdList, UploadRingBuffer& uploads);
+
+	// Points geo's GPU buffers and sizes at the pool, so its views bind the
+	// whole pool.  Call again after a flush that moved the buffers.
+	void Describe(MeshGeometry& geo) const;
+
+	D3D12_VERTEX_BUFFER_VIEW VertexBufferView() const;
+	D3D12_INDEX_BUFFER_VIEW IndexBufferView() const;
+
+	// Tags the buffers replaced by the flushes since the last call with
+	// fence, the value signalled after their command list.
+	void FenceUploads(UINT64 fence);
+	// Releases the tagged buffers whose fence completedFence has reached.
+	// Call it each frame with the fence's completed value.
+	void ReleaseUploaders(UINT64 completedFence);
+
+	// Releases the buffers replaced by earlier flushes, tagged or not.  Only
+	// call this once the GPU has executed them.
+	void DisposeUploaders();
+
+	Stats GetStats() const;
+
+private:
+	struct Entry
+	{
+		bool Live = false;
+		UINT VertexOffset = 0;
+		UINT VertexCount = 0;
+		UINT IndexOffset = 0;
+		UINT IndexCount = 0;
+
+		// Where the data currently is in the GPU buffers, if it got there.
+		bool Resident = false;
+		UINT ResidentVertexOffset = 0;
+		UINT ResidentIndexOffset = 0;
+
+		// Waiting for the next flush.
+		std::vector<std::uint8_t> StagedVertices;
+		std::vector<std::uint8_t> StagedIndices;
+	};
+
+	// Lays every live mesh out again from offset 0 in buffers of the given
+	// capacities, and marks the buffers for replacement.
+	void Relayout(UINT vertexCapacity, UINT indexCapacity);
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> CreateBuffer(UINT64 byteSize) const;
+
+	ID3D12Device* mDevice = nullptr;
+	UINT mVertexByteStride = 0;
+	DXGI_FORMAT mIndexFormat = DXGI_FORMAT_R16_UINT;
+	UINT mIndexByteSize = 0;
+
+	RangeAllocator mVertexRanges;
+	RangeAllocator mIndexRanges;
+
+	std::vector<Entry> mEntries;
+	std::vector<Handle> mFreeHandles;
+	bool mHasStagedData = false;
+	bool mRebuildPending = true;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> mVertexBuffer;
+	Microsoft::WRL::ComPtr<ID3D12Resource> mIndexBuffer;
+	// Replaced buffers still referenced by recorded command lists, with the
+	// fence that frees them, 0 until FenceUploads().
+	struct RetiredBuffer
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+		UINT64 Fence = 0;
+	};
+	std::vector<RetiredBuffer> mRetired;
+};
@@ -0,0 +1,517 @@
+#include "GpuMemoryAllocator.h"
+#include <algorithm>
+#include <atomic>
+
+using Microsoft::WRL::ComPtr;
+
+const UINT64 GpuMemoryAllocator::UnitSize;
+const UINT64 GpuMemoryAllocator::BufferPageSize;
+const UINT64 GpuMemoryAllocator::MaxSmallBufferSize;
+const UINT64 GpuMemoryAllocator::SmallBufferAlignment;
+
+namespace
+{
+	// Tags the private data of resources from PlaceResource().
+	// {6E5A4D2B-3C1F-4B8E-9A61-2F0D7C45B318}
+	const GUID kAllocationGuid = { 0x6e5a4d2b, 0x3c1f, 0x4b8e, { 0x9a, 0x61, 0x2f, 0x0d, 0x7c, 0x45, 0xb3, 0x18 } };
+
+	UINT64 AlignUp(UINT64 value, UINT64 alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	D3D12_HEAP_FLAGS HeapFlags(HeapCategory category)
+	{
+		switch (category)
+		{
+		case HeapCategory::Buffers:
+			return D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+		case HeapCategory::RenderTargets:
+			return D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+		case HeapCategory::Textures:
+			return D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+		}
+		return D3D12_HEAP_FLAG_NONE;
+	}
+}
+
+// Held by a placed resource as private data; the runtime releases it with
+// the resource, which frees the resource's space.
+class GpuMemoryAllocator::ReleaseHook : public IUnknown
+{
+public:
+	ReleaseHook(GpuMemoryAllocator* allocator, const Allocation& allocation) :
+		mAllocator(allocator),
+		mAllocation(allocation)
+	{
+	}
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override
+	{
+		if (object == nullptr)
+			return E_POINTER;
+		if (riid == __uuidof(IUnknown))
+		{
+			*object = static_cast<IUnknown*>(this);
+			AddRef();
+			return S_OK;
+		}
+		*object = nullptr;
+		return E_NOINTERFACE;
+	}
+
+	ULONG STDMETHODCALLTYPE AddRef() override
+	{
+		return ++mRefCount;
+	}
+
+	ULONG STDMETHODCALLTYPE Release() override
+	{
+		ULONG refCount = --mRefCount;
+		if (refCount == 0)
+		{
+			if (mArmed)
+			{
+				std::lock_guard<std::mutex> lock(mAllocator->mMutex);
+				mAllocator->FreeLocked(mAllocation);
+			}
+			delete this;
+		}
+		return refCount;
+	}
+
+	// Set once a resource holds the hook; until then releasing it frees
+	// nothing.
+	void Arm()
+	{
+		mArmed = true;
+	}
+
+private:
+	GpuMemoryAllocator* mAllocator;
+	Allocation mAllocation;
+	std::atomic<ULONG> mRefCount{ 1 };
+	bool mArmed = false;
+};
+
+GpuMemoryAllocator::GpuMemoryAllocator(ID3D12Device* device, UINT64 preferredBlockSize) :
+	mDevice(device),
+	mPreferredBlockSize(preferredBlockSize)
+{
+	// The first block of a list is an eighth of the preferred size.
+	assert(preferredBlockSize % (8 * UnitSize) == 0);
+}
+
+GpuMemoryAllocator::~GpuMemoryAllocator()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	while (!mPages.empty())
+		ReleasePage(mPages.size() - 1);
+
+	for (const auto& block : mBlocks)
+		assert(block->Live.empty() && "placed resources outlived their allocator");
+}
+
+HeapCategory GpuMemoryAllocator::CategoryOf(const D3D12_RESOURCE_DESC& desc)
+{
+	if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+		return HeapCategory::Buffers;
+	if (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
+		return HeapCategory::RenderTargets;
+	return HeapCategory::Textures;
+}
+
+GpuMemoryAllocator::Allocation GpuMemoryAllocator::Allocate(D3D12_HEAP_TYPE type, HeapCategory category,
+	UINT64 size, UINT64 alignment)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return AllocateLocked(type, category, size, alignment);
+}
+
+void GpuMemoryAllocator::Free(const Allocation& allocation)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	FreeLocked(allocation);
+}
+
+GpuMemoryAllocator::Allocation GpuMemoryAllocator::AllocateLocked(D3D12_HEAP_TYPE type, HeapCategory category,
+	UINT64 size, UINT64 alignment)
+{
+	assert(size > 0);
+	UINT64 alignedSize = AlignUp(size, UnitSize);
+
+	if (alignment > UnitSize || alignedSize > mPreferredBlockSize / 2)
+	{
+		Block* block = CreateBlock(type, category, alignedSize, (std::max)(alignment, UnitSize), true);
+		return TryAllocate(block, alignedSize);
+	}
+
+	UINT blockCount = 0;
+	for (const auto& block : mBlocks)
+	{
+		if (block->Type != type || block->Category != category || block->Dedicated)
+			continue;
+		Allocation allocation = TryAllocate(block.get(), alignedSize);
+		if (allocation.IsValid())
+			return allocation;
+		++blockCount;
+	}
+
+	// Each new block of a list doubles until the preferred size.
+	UINT64 blockSize = mPreferredBlockSize >> (3 - (std::min)(blockCount, 3u));
+	Block* block = CreateBlock(type, category, (std::max)(blockSize, alignedSize), UnitSize, false);
+	return TryAllocate(block, alignedSize);
+}
+
+void GpuMemoryAllocator::FreeLocked(const Allocation& allocation)
+{
+	Block* block = allocation.Owner;
+	ReleaseRange(allocation);
+	if (!block->Live.empty())
+		return;
+
+	// Keep one empty block per list, so a resource freed and created again
+	// every resize does not create a heap each time.
+	bool keep = !block->Dedicated;
+	for (const auto& other : mBlocks)
+	{
+		if (other.get() != block && other->Type == block->Type && other->Category == block->Category &&
+			!other->Dedicated && other->Live.empty())
+		{
+			keep = false;
+			break;
+		}
+	}
+	if (keep)
+		return;
+
+	mBlocks.erase(std::find_if(mBlocks.begin(), mBlocks.end(),
+		[block](const std::unique_ptr<Block>& candidate) { return candidate.get() == block; }));
+}
+
+GpuMemoryAllocator::Block* GpuMemoryAllocator::CreateBlock(D3D12_HEAP_TYPE type, HeapCategory category,
+	UINT64 size, UINT64 alignment, bool dedicated)
+{
+	D3D12_HEAP_DESC heapDesc = {};
+	heapDesc.SizeInBytes = size;
+	heapDesc.Properties = CD3DX12_HEAP_PROPERTIES(type);
+	heapDesc.Alignment = alignment;
+	heapDesc.Flags = HeapFlags(category);
+
+	auto block = std::make_unique<Block>();
+	ThrowIfFailed(mDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(block->Heap.GetAddressOf())));
+	block->Type = type;
+	block->Category = category;
+	block->Size = size;
+	block->Dedicated = dedicated;
+	block->Ranges.Reset(static_cast<RangeAllocator::uint32>(size / UnitSize));
+
+	mBlocks.push_back(std::move(block));
+	return mBlocks.back().get();
+}
+
+GpuMemoryAllocator::Allocation GpuMemoryAllocator::TryAllocate(Block* block, UINT64 size)
+{
+	RangeAllocator::uint32 unit = block->Ranges.Allocate(static_cast<RangeAllocator::uint32>(size / UnitSize));
+	if (unit == RangeAllocator::InvalidOffset)
+		return Allocation();
+
+	Allocation allocation;
+	allocation.Heap = block->Heap.Get();
+	allocation.Offset = UINT64(unit) * UnitSize;
+	allocation.Size = size;
+	allocation.Owner = block;
+	block->Live[allocation.Offset] = { size, nullptr };
+	return allocation;
+}
+
+void GpuMemoryAllocator::ReleaseRange(const Allocation& allocation)
+{
+	assert(allocation.IsValid());
+	Block* block = allocation.Owner;
+	auto live = block->Live.find(allocation.Offset);
+	assert(live != block->Live.end() && "allocation freed twice");
+
+	block->Ranges.Free(static_cast<RangeAllocator::uint32>(allocation.Offset / UnitSize),
+		static_cast<RangeAllocator::uint32>(live->second.Size / UnitSize));
+	block->Live.erase(live);
+}
+
+ComPtr<ID3D12Resource> GpuMemoryAllocator::CreatePlaced(const Allocation& allocation, const D3D12_RESOURCE_DESC& desc,
+	D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue) const
+{
+	ComPtr<ID3D12Resource> resource;
+	ThrowIfFailed(mDevice->CreatePlacedResource(
+		allocation.Heap,
+		allocation.Offset,
+		&desc,
+		initialState,
+		clearValue,
+		IID_PPV_ARGS(resource.GetAddressOf())));
+	return resource;
+}
+
+ComPtr<ID3D12Resource> GpuMemoryAllocator::CreateResource(D3D12_HEAP_TYPE type, const D3D12_RESOURCE_DESC& desc,
+	D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue)
+{
+	UINT64 size = desc.Width;
+	UINT64 alignment = UnitSize;
+	if (desc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER)
+	{
+		D3D12_RESOURCE_ALLOCATION_INFO info = mDevice->GetResourceAllocationInfo(0, 1, &desc);
+		size = info.SizeInBytes;
+		alignment = info.Alignment;
+	}
+
+	Allocation allocation = Allocate(type, CategoryOf(desc), size, alignment);
+	try
+	{
+		return PlaceResource(allocation, desc, initialState, clearValue);
+	}
+	catch (...)
+	{
+		Free(allocation);
+		throw;
+	}
+}
+
+// The space stays the caller's if this throws.
+ComPtr<ID3D12Resource> GpuMemoryAllocator::PlaceResource(const Allocation& allocation, const D3D12_RESOURCE_DESC& desc,
+	D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue)
+{
+	ComPtr<ID3D12Resource> resource = CreatePlaced(allocation, desc, initialState, clearValue);
+
+	// The resource takes its own reference to the hook.
+	ComPtr<ReleaseHook> hook;
+	hook.Attach(new ReleaseHook(this, allocation));
+	ThrowIfFailed(resource->SetPrivateDataInterface(kAllocationGuid, hook.Get()));
+	hook->Arm();
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	allocation.Owner->Live[allocation.Offset].Resource = resource.Get();
+	return resource;
+}
+
+GpuMemoryAllocator::BufferAllocation GpuMemoryAllocator::AllocateBuffer(D3D12_HEAP_TYPE type, UINT64 size)
+{
+	assert(size > 0 && size <= MaxSmallBufferSize);
+	auto units = static_cast<RangeAllocator::uint32>(AlignUp(size, SmallBufferAlignment) / SmallBufferAlignment);
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	BufferPage* page = nullptr;
+	RangeAllocator::uint32 unit = RangeAllocator::InvalidOffset;
+	for (const auto& candidate : mPages)
+	{
+		if (candidate->Type != type)
+			continue;
+		unit = candidate->Ranges.Allocate(units);
+		if (unit != RangeAllocator::InvalidOffset)
+		{
+			page = candidate.get();
+			break;
+		}
+	}
+
+	if (page == nullptr)
+	{
+		auto newPage = std::make_unique<BufferPage>();
+		newPage->Memory = AllocateLocked(type, HeapCategory::Buffers, BufferPageSize, UnitSize);
+		newPage->Type = type;
+		newPage->Mapped = nullptr;
+		newPage->Ranges.Reset(static_cast<RangeAllocator::uint32>(BufferPageSize / SmallBufferAlignment));
+
+		D3D12_RESOURCE_STATES state = D3D12_RESOURCE_STATE_COMMON;
+		if (type == D3D12_HEAP_TYPE_UPLOAD)
+			state = D3D12_RESOURCE_STATE_GENERIC_READ;
+		else if (type == D3D12_HEAP_TYPE_READBACK)
+			state = D3D12_RESOURCE_STATE_COPY_DEST;
+		try
+		{
+			newPage->Resource = CreatePlaced(newPage->Memory, CD3DX12_RESOURCE_DESC::Buffer(BufferPageSize), state, nullptr);
+			if (type != D3D12_HEAP_TYPE_DEFAULT)
+			{
+				// Upload pages are never read back; readback pages are, so map
+				// the whole range.
+				CD3DX12_RANGE readRange(0, 0);
+				ThrowIfFailed(newPage->Resource->Map(0, type == D3D12_HEAP_TYPE_UPLOAD ? &readRange : nullptr,
+					reinterpret_cast<void**>(&newPage->Mapped)));
+			}
+		}
+		catch (...)
+		{
+			newPage->Resource.Reset();
+			FreeLocked(newPage->Memory);
+			throw;
+		}
+
+		unit = newPage->Ranges.Allocate(units);
+		page = newPage.get();
+		mPages.push_back(std::move(newPage));
+	}
+
+	BufferAllocation allocation;
+	allocation.Resource = page->Resource.Get();
+	allocation.Offset = UINT64(unit) * SmallBufferAlignment;
+	allocation.Size = size;
+	allocation.GPUAddress = page->Resource->GetGPUVirtualAddress() + allocation.Offset;
+	allocation.CPU = page->Mapped != nullptr ? page->Mapped + allocation.Offset : nullptr;
+	allocation.Owner = page;
+
+	mSmallBufferBytes += size;
+	++mSmallBufferCount;
+	return allocation;
+}
+
+void GpuMemoryAllocator::FreeBuffer(const BufferAllocation& allocation)
+{
+	assert(allocation.IsValid());
+	auto units = static_cast<RangeAllocator::uint32>(AlignUp(allocation.Size, SmallBufferAlignment) / SmallBufferAlignment);
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	BufferPage* page = allocation.Owner;
+	page->Ranges.Free(static_cast<RangeAllocator::uint32>(allocation.Offset / SmallBufferAlignment), units);
+	mSmallBufferBytes -= allocation.Size;
+	--mSmallBufferCount;
+
+	if (page->Ranges.UsedSize() != 0)
+		return;
+
+	// Like blocks, keep one empty page per heap type.
+	for (size_t i = 0; i < mPages.size(); ++i)
+	{
+		const BufferPage* other = mPages[i].get();
+		if (other != page && other->Type == page->Type && other->Ranges.UsedSize() == 0)
+		{
+			auto self = std::find_if(mPages.begin(), mPages.end(),
+				[page](const std::unique_ptr<BufferPage>& candidate) { return candidate.get() == page; });
+			ReleasePage(size_t(self - mPages.begin()));
+			return;
+		}
+	}
+}
+
+void GpuMemoryAllocator::ReleasePage(size_t index)
+{
+	BufferPage* page = mPages[index].get();
+	if (page->Mapped != nullptr)
+		page->Resource->Unmap(0, nullptr);
+	page->Resource.Reset();
+	FreeLocked(page->Memory);
+	mPages.erase(mPages.begin() + index);
+}
+
+std::vector<GpuMemoryAllocator::Move> GpuMemoryAllocator::PlanDefragmentation(UINT64 maxBytes)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	std::vector<Move> moves;
+
+	std::vector<Block*> visited;
+	for (const auto& first : mBlocks)
+	{
+		if (first->Dedicated || std::find(visited.begin(), visited.end(), first.get()) != visited.end())
+			continue;
+
+		// The blocks of first's list, least used first.
+		std::vector<Block*> list;
+		for (const auto& block : mBlocks)
+		{
+			if (block->Type == first->Type && block->Category == first->Category && !block->Dedicated)
+				list.push_back(block.get());
+		}
+		visited.insert(visited.end(), list.begin(), list.end());
+		std::stable_sort(list.begin(), list.end(),
+			[](const Block* a, const Block* b) { return a->Ranges.UsedSize() < b->Ranges.UsedSize(); });
+
+		// Empty whole blocks into fuller ones; moving part of a block frees
+		// nothing.  Destinations are not movable, so a block that has taken
+		// moves is never a source.
+		for (size_t source = 0; source + 1 < list.size(); ++source)
+		{
+			Block* from = list[source];
+			UINT64 usedBytes = UINT64(from->Ranges.UsedSize()) * UnitSize;
+			if (usedBytes == 0)
+				continue;
+			if (usedBytes > maxBytes)
+				break;
+			bool movable = std::all_of(from->Live.begin(), from->Live.end(),
+				[](const std::pair<const UINT64, LiveRange>& live) { return live.second.Resource != nullptr; });
+			if (!movable)
+				continue;
+
+			std::vector<Move> blockMoves;
+			for (const auto& live : from->Live)
+			{
+				Move move;
+				move.Resource = live.second.Resource;
+				move.Source.Heap = from->Heap.Get();
+				move.Source.Offset = live.first;
+				move.Source.Size = live.second.Size;
+				move.Source.Owner = from;
+				// Fullest blocks first.
+				for (size_t target = list.size() - 1; target > source && !move.Destination.IsValid(); --target)
+				{
+					if (!list[target]->Live.empty())
+						move.Destination = TryAllocate(list[target], live.second.Size);
+				}
+				if (!move.Destination.IsValid())
+					break;
+				blockMoves.push_back(move);
+			}
+
+			if (blockMoves.size() != from->Live.size())
+			{
+				for (const Move& move : blockMoves)
+					ReleaseRange(move.Destination);
+				continue;
+			}
+			maxBytes -= usedBytes;
+			moves.insert(moves.end(), blockMoves.begin(), blockMoves.end());
+		}
+	}
+	return moves;
+}
+
+void GpuMemoryAllocator::CancelMoves(const std::vector<Move>& moves)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	for (const Move& move : moves)
+		FreeLocked(move.Destination);
+}
+
+std::vector<GpuMemoryAllocator::BlockStats> GpuMemoryAllocator::GetBlockStats() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	std::vector<BlockStats> stats;
+	for (const auto& block : mBlocks)
+	{
+		BlockStats blockStats;
+		blockStats.Type = block->Type;
+		blockStats.Category = block->Category;
+		blockStats.Dedicated = block->Dedicated;
+		blockStats.Size = block->Size;
+		blockStats.UsedBytes = UINT64(block->Ranges.UsedSize()) * UnitSize;
+		blockStats.AllocationCount = static_cast<UINT>(block->Live.size());
+		blockStats.LargestFreeRange = UINT64(block->Ranges.LargestFreeRange()) * UnitSize;
+		blockStats.FreeRangeCount = block->Ranges.FreeRangeCount();
+		stats.push_back(blockStats);
+	}
+	return stats;
+}
+
+GpuMemoryAllocator::Stats GpuMemoryAllocator::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	Stats stats;
+	for (const auto& block : mBlocks)
+	{
+		++stats.BlockCount;
+		stats.ReservedBytes += block->Size;
+		stats.UsedBytes += UINT64(block->Ranges.UsedSize()) * UnitSize;
+		stats.AllocationCount += static_cast<UINT>(block->Live.size());
+	}
+	stats.BufferPageCount = static_cast<UINT>(mPages.size());
+	stats.SmallBufferBytes = mSmallBufferBytes;
+	stats.SmallBufferCount = mSmallBufferCount;
+	return stats;
+}
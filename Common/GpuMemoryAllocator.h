@@ -0,0 +1,206 @@
+#pragma once
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "d3dBase.h"
+#include "RangeAllocator.h"
+
+// Which resources a heap holds.  Heaps are kept to one category so the
+// allocator works on resource heap tier 1 hardware.
+enum class HeapCategory
+{
+	Buffers,
+	// Textures with ALLOW_RENDER_TARGET or ALLOW_DEPTH_STENCIL.
+	RenderTargets,
+	Textures,
+};
+
+// Placed resources in large ID3D12Heap blocks, in place of the implicit heap
+// CreateCommittedResource makes for every resource.  Each heap type and
+// category gets its own list of blocks; a block's space is handed out in
+// 64 KB units by a RangeAllocator.  The first blocks of a list are smaller
+// than the preferred block size, so that a small app does not reserve 64 MB
+// for one depth buffer.  Resources larger than half a block, or that need
+// more than 64 KB alignment such as MSAA textures, get a heap of their own.
+//
+// CreateResource() returns an ordinary ComPtr: the placed resource carries a
+// private data interface that returns its space to the allocator when the
+// last reference goes, so callers keep the same rules as for committed
+// resources.  Every such resource has to be gone before the allocator is.
+//
+// Buffers smaller than 64 KB would waste most of their unit, so
+// AllocateBuffer() packs them into shared placed buffers instead; those
+// allocations are a resource plus an offset and are freed explicitly.
+//
+// Allocate(), Free() and the statistics only touch the bookkeeping and the
+// heaps, so they can run against a mock device.  All calls are thread safe.
+class GpuMemoryAllocator
+{
+private:
+	struct Block;
+	struct BufferPage;
+
+public:
+	// Space in a block.  Heap is null only with a mock device.
+	struct Allocation
+	{
+		ID3D12Heap* Heap = nullptr;
+		UINT64 Offset = 0;
+		UINT64 Size = 0;
+
+		Block* Owner = nullptr;
+
+		bool IsValid() const { return Owner != nullptr; }
+	};
+
+	// A range of a shared placed buffer.
+	struct BufferAllocation
+	{
+		ID3D12Resource* Resource = nullptr;
+		UINT64 Offset = 0;
+		UINT64 Size = 0;
+		D3D12_GPU_VIRTUAL_ADDRESS GPUAddress = 0;
+		// Persistently mapped for upload heap buffers, null otherwise.
+		BYTE* CPU = nullptr;
+
+		BufferPage* Owner = nullptr;
+
+		bool IsValid() const { return Owner != nullptr; }
+	};
+
+	// A resource the defragmenter would move.  Destination is already
+	// allocated; the caller places a copy of Resource there with
+	// PlaceResource(), copies the contents and releases Resource once the
+	// copy has executed, which frees Source.
+	struct Move
+	{
+		ID3D12Resource* Resource = nullptr;
+		Allocation Source;
+		Allocation Destination;
+	};
+
+	struct BlockStats
+	{
+		D3D12_HEAP_TYPE Type = D3D12_HEAP_TYPE_DEFAULT;
+		HeapCategory Category = HeapCategory::Buffers;
+		bool Dedicated = false;
+		UINT64 Size = 0;
+		UINT64 UsedBytes = 0;
+		UINT AllocationCount = 0;
+		UINT64 LargestFreeRange = 0;
+		size_t FreeRangeCount = 0;
+	};
+
+	struct Stats
+	{
+		UINT BlockCount = 0;
+		UINT64 ReservedBytes = 0;
+		UINT64 UsedBytes = 0;
+		UINT AllocationCount = 0;
+		UINT BufferPageCount = 0;
+		// Bytes handed out by AllocateBuffer(), within the pages' UsedBytes.
+		UINT64 SmallBufferBytes = 0;
+		UINT SmallBufferCount = 0;
+	};
+
+	// Placement granularity of the blocks.
+	static const UINT64 UnitSize = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+	// Size of the shared buffers AllocateBuffer() packs into, and the largest
+	// buffer it takes.
+	static const UINT64 BufferPageSize = 2 * 1024 * 1024;
+	static const UINT64 MaxSmallBufferSize = 64 * 1024;
+	static const UINT64 SmallBufferAlignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+
+	explicit GpuMemoryAllocator(ID3D12Device* device, UINT64 preferredBlockSize = 64 * 1024 * 1024);
+	GpuMemoryAllocator(const GpuMemoryAllocator& rhs) = delete;
+	GpuMemoryAllocator& operator=(const GpuMemoryAllocator& rhs) = delete;
+	~GpuMemoryAllocator();
+
+	// Space for a resource of the given size and alignment, as reported by
+	// GetResourceAllocationInfo.
+	Allocation Allocate(D3D12_HEAP_TYPE type, HeapCategory category, UINT64 size, UINT64 alignment);
+	// Frees space from Allocate() that no resource was placed in.
+	void Free(const Allocation& allocation);
+
+	// A placed resource that frees its space when released.
+	Microsoft::WRL::ComPtr<ID3D12Resource> CreateResource(D3D12_HEAP_TYPE type, const D3D12_RESOURCE_DESC& desc,
+		D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue = nullptr);
+	// The same in space from Allocate(), which the resource then owns.
+	Microsoft::WRL::ComPtr<ID3D12Resource> PlaceResource(const Allocation& allocation, const D3D12_RESOURCE_DESC& desc,
+		D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue = nullptr);
+
+	// size bytes of a shared buffer in a heap of the given type, at a
+	// multiple of SmallBufferAlignment.  Default heap pages start out in
+	// COMMON and readback pages in COPY_DEST; the state is shared by every
+	// range of a page.
+	BufferAllocation AllocateBuffer(D3D12_HEAP_TYPE type, UINT64 size);
+	// Keep the range alive until the GPU is done with it.
+	void FreeBuffer(const BufferAllocation& allocation);
+
+	// Moves that would empty the least used blocks of each list into the
+	// free space of the others, up to maxBytes in total.  Blocks holding
+	// small buffer pages or space from Allocate() stay where they are.
+	std::vector<Move> PlanDefragmentation(UINT64 maxBytes);
+	// Frees the destinations of moves that will not be carried out.
+	void CancelMoves(const std::vector<Move>& moves);
+
+	std::vector<BlockStats> GetBlockStats() const;
+	Stats GetStats() const;
+
+	static HeapCategory CategoryOf(const D3D12_RESOURCE_DESC& desc);
+
+private:
+	struct LiveRange
+	{
+		UINT64 Size;
+		// The resource placed there by PlaceResource(), which makes the range
+		// movable; null for pages and space from Allocate().
+		ID3D12Resource* Resource;
+	};
+
+	struct Block
+	{
+		Microsoft::WRL::ComPtr<ID3D12Heap> Heap;
+		D3D12_HEAP_TYPE Type;
+		HeapCategory Category;
+		UINT64 Size;
+		bool Dedicated;
+		RangeAllocator Ranges;
+		// Offset -> allocation.
+		std::map<UINT64, LiveRange> Live;
+	};
+
+	struct BufferPage
+	{
+		Allocation Memory;
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+		D3D12_HEAP_TYPE Type;
+		BYTE* Mapped;
+		// In SmallBufferAlignment units.
+		RangeAllocator Ranges;
+	};
+
+	class ReleaseHook;
+
+	// The callers hold mMutex.
+	Allocation AllocateLocked(D3D12_HEAP_TYPE type, HeapCategory category, UINT64 size, UINT64 alignment);
+	void FreeLocked(const Allocation& allocation);
+	Block* CreateBlock(D3D12_HEAP_TYPE type, HeapCategory category, UINT64 size, UINT64 alignment,
+		bool dedicated);
+	Allocation TryAllocate(Block* block, UINT64 size);
+	void ReleaseRange(const Allocation& allocation);
+	void ReleasePage(size_t index);
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> CreatePlaced(const Allocation& allocation, const D3D12_RESOURCE_DESC& desc,
+		D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue) const;
+
+	ID3D12Device* mDevice = nullptr;
+	UINT64 mPreferredBlockSize = 0;
+
+	mutable std::mutex mMutex;
+	std::vector<std::unique_ptr<Block>> mBlocks;
+	std::vector<std::unique_ptr<BufferPage>> mPages;
+	UINT64 mSmallBufferBytes = 0;
+	UINT mSmallBufferCount = 0;
+};
@@ -0,0 +1,82 @@
+#include "LinearAllocator.h"
+#include <algorithm>
+#include <cassert>
+
+LinearAllocator::LinearAllocator(uint64 pageSize) :
+	mPageSize(pageSize)
+{
+	assert(pageSize > 0);
+}
+
+LinearAllocator::Allocation LinearAllocator::Allocate(uint64 size, uint64 alignment)
+{
+	assert(size > 0);
+	assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+	assert(mPageSize % alignment == 0);
+
+	mNewPage = false;
+	uint64 start = (mOffset + alignment - 1) & ~(alignment - 1);
+	if (mPage < mPages.size() && start + size <= mPages[mPage])
+	{
+		mPaddingBytes += start - mOffset;
+		mUsedBytes += size;
+		mOffset = start + size;
+		return { mPage, start };
+	}
+
+	mPreviousPage = mPage;
+	mPreviousOffset = mOffset;
+	mPreviousPaddingBytes = mPaddingBytes;
+
+	// Move on to the first later page that can hold size; the rest of this
+	// one, and any page too small, are skipped.
+	if (mPage < mPages.size())
+	{
+		mPaddingBytes += mPages[mPage] - mOffset;
+		++mPage;
+	}
+	for (; mPage < mPages.size() && mPages[mPage] < size; ++mPage)
+		mPaddingBytes += mPages[mPage];
+
+	if (mPage == mPages.size())
+	{
+		mPages.push_back((size + mPageSize - 1) / mPageSize * mPageSize);
+		mNewPage = true;
+	}
+	mUsedBytes += size;
+	mOffset = size;
+	return { mPage, 0 };
+}
+
+void LinearAllocator::DiscardNewPage()
+{
+	assert(mNewPage);
+	mUsedBytes -= mOffset;
+	mPages.pop_back();
+	mPage = mPreviousPage;
+	mOffset = mPreviousOffset;
+	mPaddingBytes = mPreviousPaddingBytes;
+	mNewPage = false;
+}
+
+void LinearAllocator::Reset()
+{
+	mPeakBytes = (std::max)(mPeakBytes, mUsedBytes + mPaddingBytes);
+	mUsedBytes = 0;
+	mPaddingBytes = 0;
+	mPage = 0;
+	mOffset = 0;
+	mNewPage = false;
+}
+
+LinearAllocator::Stats LinearAllocator::GetStats() const
+{
+	Stats stats;
+	stats.PageCount = PageCount();
+	for (uint64 pageSize : mPages)
+		stats.ReservedBytes += pageSize;
+	stats.UsedBytes = mUsedBytes;
+	stats.PaddingBytes = mPaddingBytes;
+	stats.PeakBytes = (std::max)(mPeakBytes, mUsedBytes + mPaddingBytes);
+	return stats;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Bump allocator over a list of pages for data that lives one frame.  Each
+// allocation is placed after the previous one in the current page, or at the
+// start of the next page if it does not fit there.  Reset() starts over at
+// the first page once the frame is done, keeping the pages, so a frame that
+// needs no more than an earlier one adds none.  Data larger than a page gets
+// a page of its own, a multiple of the page size.
+//
+// Pure bookkeeping with no GPU dependency; LinearUploadAllocator builds on
+// it.
+class LinearAllocator
+{
+public:
+	using uint64 = std::uint64_t;
+
+	struct Allocation
+	{
+		std::uint32_t Page;
+		uint64 Offset;
+	};
+
+	struct Stats
+	{
+		std::uint32_t PageCount = 0;
+		uint64 ReservedBytes = 0;
+		// Bytes asked for since Reset(), and those lost to alignment and to
+		// the unused ends of pages skipped over.
+		uint64 UsedBytes = 0;
+		uint64 PaddingBytes = 0;
+		// The most UsedBytes + PaddingBytes of any frame.
+		uint64 PeakBytes = 0;
+	};
+
+	explicit LinearAllocator(uint64 pageSize);
+
+	// size bytes at a multiple of alignment, a power of two that divides the
+	// page size.  If Page is PageCount() - 1 after a call that added a page,
+	// the caller has to back it; NewPage() tells.
+	Allocation Allocate(uint64 size, uint64 alignment);
+	// Whether the last Allocate() added a page.
+	bool NewPage() const { return mNewPage; }
+	// Takes back the last Allocate(), which added a page the caller could
+	// not back.
+	void DiscardNewPage();
+
+	// Makes all the pages free again.  Call it when nothing allocated since
+	// the last call is in use anymore.
+	void Reset();
+
+	std::uint32_t PageCount() const { return static_cast<std::uint32_t>(mPages.size()); }
+	uint64 PageSize(std::uint32_t page) const { return mPages[page]; }
+	Stats GetStats() const;
+
+private:
+	uint64 mPageSize = 0;
+	// Size of each page.
+	std::vector<uint64> mPages;
+	// The page being filled and the offset in it of its free space.
+	std::uint32_t mPage = 0;
+	uint64 mOffset = 0;
+	bool mNewPage = false;
+	// mPage, mOffset and mPaddingBytes before the last Allocate() that moved
+	// to another page.
+	std::uint32_t mPreviousPage = 0;
+	uint64 mPreviousOffset = 0;
+	uint64 mPreviousPaddingBytes = 0;
+
+	uint64 mUsedBytes = 0;
+	uint64 mPaddingBytes = 0;
+	uint64 mPeakBytes = 0;
+};
@@ -0,0 +1,49 @@
+#include "LinearUploadAllocator.h"
+
+LinearUploadAllocator::LinearUploadAllocator(GpuMemoryAllocator& allocator, UINT64 pageSize) :
+	mAllocator(allocator),
+	mPages(pageSize)
+{
+}
+
+LinearUploadAllocator::~LinearUploadAllocator()
+{
+	for (Page& page : mPageResources)
+		page.Resource->Unmap(0, nullptr);
+}
+
+LinearUploadAllocator::Allocation LinearUploadAllocator::Allocate(UINT64 size, UINT64 alignment)
+{
+	LinearAllocator::Allocation allocation = mPages.Allocate(size, alignment);
+	if (mPages.NewPage())
+	{
+		// mPages and mPageResources have to stay in step, so a page that
+		// cannot be backed is taken back.
+		try
+		{
+			Page page;
+			page.Resource = mAllocator.CreateResource(D3D12_HEAP_TYPE_UPLOAD,
+				CD3DX12_RESOURCE_DESC::Buffer(mPages.PageSize(allocation.Page)), D3D12_RESOURCE_STATE_GENERIC_READ);
+			// Mapped for the page's lifetime; the CPU only writes it.
+			CD3DX12_RANGE readRange(0, 0);
+			ThrowIfFailed(page.Resource->Map(0, &readRange, reinterpret_cast<void**>(&page.MappedData)));
+			mPageResources.push_back(page);
+		}
+		catch (...)
+		{
+			mPages.DiscardNewPage();
+			throw;
+		}
+	}
+
+	const Page& page = mPageResources[allocation.Page];
+	Allocation result;
+	result.CPU = page.MappedData + allocation.Offset;
+	result.GPU = page.Resource->GetGPUVirtualAddress() + allocation.Offset;
+	return result;
+}
+
+void LinearUploadAllocator::Reset()
+{
+	mPages.Reset();
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <vector>
+#include "d3dBase.h"
+#include "GpuMemoryAllocator.h"
+#include "LinearAllocator.h"
+#include "StreamingWrites.h"
+
+// Upload memory for data a frame writes and the GPU reads once, such as
+// per-draw constants bound as root CBVs.  Pages are mapped upload buffers
+// from a GpuMemoryAllocator, added when a frame needs more than the earlier
+// ones did.  Give each frame resource its own, and Reset() it once the
+// fence of the frame that last used it has completed.
+class LinearUploadAllocator
+{
+public:
+	struct Allocation
+	{
+		// Write-combined memory: write it sequentially and never read it.
+		BYTE* CPU = nullptr;
+		D3D12_GPU_VIRTUAL_ADDRESS GPU = 0;
+	};
+
+	LinearUploadAllocator(GpuMemoryAllocator& allocator, UINT64 pageSize = 64 * 1024);
+	LinearUploadAllocator(const LinearUploadAllocator& rhs) = delete;
+	LinearUploadAllocator& operator=(const LinearUploadAllocator& rhs) = delete;
+	~LinearUploadAllocator();
+
+	// size bytes at a multiple of alignment; root CBVs need
+	// D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT.
+	Allocation Allocate(UINT64 size, UINT64 alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+
+	// Copies data into a new allocation and returns its GPU address.  The
+	// copy is streamed; call StreamingWrites::Fence() before the command
+	// list that reads it executes.
+	template<typename T>
+	D3D12_GPU_VIRTUAL_ADDRESS Push(const T& data, UINT64 alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT)
+	{
+		Allocation allocation = Allocate(sizeof(T), alignment);
+		StreamingWrites::Write(allocation.CPU, &data, sizeof(T));
+		return allocation.GPU;
+	}
+
+	void Reset();
+
+	LinearAllocator::Stats GetStats() const { return mPages.GetStats(); }
+
+private:
+	struct Page
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+		BYTE* MappedData = nullptr;
+	};
+
+	GpuMemoryAllocator& mAllocator;
+	LinearAllocator mPages;
+	std::vector<Page> mPageResources;
+};
@@ -0,0 +1,195 @@
+#include "Lz4.h"
+#include <cstring>
+
+namespace
+{
+	// The format's end conditions: the last match starts at least 12 bytes
+	// before the end, and the last 5 bytes are always literals.
+	const size_t kMinMatch = 4;
+	const size_t kMatchFindLimit = 12;
+	const size_t kLastLiterals = 5;
+	const size_t kMaxOffset = 65535;
+
+	const int kHashBits = 16;
+	const std::uint32_t kNoPosition = 0xffffffff;
+
+	std::uint32_t Read32(const std::uint8_t* p)
+	{
+		std::uint32_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	std::uint32_t Hash(std::uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - kHashBits);
+	}
+
+	// Writes the 255-byte continuation of a length that did not fit its
+	// 4 bit token field.
+	std::uint8_t* WriteLength(std::uint8_t* op, size_t length)
+	{
+		for (; length >= 255; length -= 255)
+			*op++ = 255;
+		*op++ = static_cast<std::uint8_t>(length);
+		return op;
+	}
+
+	std::uint8_t* WriteSequence(std::uint8_t* op, const std::uint8_t* literals, size_t literalLength,
+		size_t offset, size_t matchLength)
+	{
+		std::uint8_t* token = op++;
+		*token = static_cast<std::uint8_t>((literalLength < 15 ? literalLength : 15) << 4);
+		if (literalLength >= 15)
+			op = WriteLength(op, literalLength - 15);
+		if (literalLength > 0)
+			std::memcpy(op, literals, literalLength);
+		op += literalLength;
+
+		// The final sequence is literals only.
+		if (matchLength == 0)
+			return op;
+
+		*op++ = static_cast<std::uint8_t>(offset);
+		*op++ = static_cast<std::uint8_t>(offset >> 8);
+		size_t code = matchLength - kMinMatch;
+		*token |= static_cast<std::uint8_t>(code < 15 ? code : 15);
+		if (code >= 15)
+			op = WriteLength(op, code - 15);
+		return op;
+	}
+}
+
+size_t Lz4::CompressBound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+size_t Lz4::Compress(const void* src, size_t size, void* dst)
+{
+	const std::uint8_t* base = static_cast<const std::uint8_t*>(src);
+	const std::uint8_t* end = base + size;
+	const std::uint8_t* anchor = base;
+	std::uint8_t* op = static_cast<std::uint8_t*>(dst);
+
+	if (size > kMatchFindLimit)
+	{
+		std::vector<std::uint32_t> table(size_t(1) << kHashBits, kNoPosition);
+		const std::uint8_t* matchFindEnd = end - kMatchFindLimit;
+		const std::uint8_t* matchEnd = end - kLastLiterals;
+
+		const std::uint8_t* ip = base;
+		while (ip < matchFindEnd)
+		{
+			std::uint32_t sequence = Read32(ip);
+			std::uint32_t& slot = table[Hash(sequence)];
+			std::uint32_t candidate = slot;
+			slot = static_cast<std::uint32_t>(ip - base);
+
+			const std::uint8_t* ref = base + candidate;
+			if (candidate == kNoPosition || size_t(ip - ref) > kMaxOffset || Read32(ref) != sequence)
+			{
+				++ip;
+				continue;
+			}
+
+			// Grow the match backwards into the pending literals, then forwards.
+			while (ip > anchor && ref > base && ip[-1] == ref[-1])
+			{
+				--ip;
+				--ref;
+			}
+			size_t length = kMinMatch;
+			while (ip + length < matchEnd && ip[length] == ref[length])
+				++length;
+
+			op = WriteSequence(op, anchor, size_t(ip - anchor), size_t(ip - ref), length);
+			ip += length;
+			anchor = ip;
+		}
+	}
+
+	op = WriteSequence(op, anchor, size_t(end - anchor), 0, 0);
+	return size_t(op - static_cast<std::uint8_t*>(dst));
+}
+
+bool Lz4::Decompress(const void* src, size_t size, void* dst, size_t dstSize)
+{
+	const std::uint8_t* ip = static_cast<const std::uint8_t*>(src);
+	const std::uint8_t* ipEnd = ip + size;
+	std::uint8_t* base = static_cast<std::uint8_t*>(dst);
+	std::uint8_t* op = base;
+	std::uint8_t* opEnd = base + dstSize;
+
+	auto readLength = [&](size_t& length)
+	{
+		for (;;)
+		{
+			if (ip >= ipEnd)
+				return false;
+			std::uint8_t more = *ip++;
+			length += more;
+			if (more != 255)
+				return true;
+		}
+	};
+
+	while (ip < ipEnd)
+	{
+		std::uint8_t token = *ip++;
+
+		size_t literalLength = token >> 4;
+		if (literalLength == 15 && !readLength(literalLength))
+			return false;
+		if (literalLength > size_t(ipEnd - ip) || literalLength > size_t(opEnd - op))
+			return false;
+		if (literalLength > 0)
+			std::memcpy(op, ip, literalLength);
+		ip += literalLength;
+		op += literalLength;
+
+		// The last sequence ends after its literals.
+		if (ip == ipEnd)
+			break;
+
+		if (ipEnd - ip < 2)
+			return false;
+		size_t offset = size_t(ip[0]) | size_t(ip[1]) << 8;
+		ip += 2;
+		size_t matchLength = (token & 15);
+		if (matchLength == 15 && !readLength(matchLength))
+			return false;
+		matchLength += kMinMatch;
+		if (offset == 0 || offset > size_t(op - base) || matchLength > size_t(opEnd - op))
+			return false;
+
+		// A match closer than its length repeats what it is producing, so
+		// copy that one byte by byte.
+		const std::uint8_t* match = op - offset;
+		if (offset >= matchLength)
+			std::memcpy(op, match, matchLength);
+		else
+		{
+			for (size_t i = 0; i < matchLength; ++i)
+				op[i] = match[i];
+		}
+		op += matchLength;
+	}
+
+	return op == opEnd;
+}
+
+Lz4::Block Lz4::CompressBlock(const void* src, size_t size)
+{
+	Block block;
+	block.RawSize = size;
+	block.Data.resize(CompressBound(size));
+	block.Data.resize(Compress(src, size, block.Data.data()));
+	block.Data.shrink_to_fit();
+	return block;
+}
+
+bool Lz4::DecompressBlock(const Block& block, void* dst)
+{
+	return Decompress(block.Data.data(), block.Data.size(), dst, block.RawSize);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// LZ4 block compression, compatible with the reference block format, for
+// keeping rarely read data such as CPU copies of geometry in less memory.
+// Favours speed over ratio: one greedy pass with a 64K entry hash table.
+class Lz4
+{
+public:
+	// A compressed block and the size it expands to.
+	struct Block
+	{
+		std::vector<std::uint8_t> Data;
+		size_t RawSize = 0;
+
+		bool empty() const { return RawSize == 0; }
+	};
+
+	// Largest compressed size of size bytes.
+	static size_t CompressBound(size_t size);
+
+	// Compresses size bytes of src into dst, which must hold
+	// CompressBound(size) bytes.  Returns the compressed size.
+	static size_t Compress(const void* src, size_t size, void* dst);
+	// Expands a compressed block into exactly dstSize bytes.  Returns false
+	// if the block is malformed or does not expand to dstSize.
+	static bool Decompress(const void* src, size_t size, void* dst, size_t dstSize);
+
+	static Block CompressBlock(const void* src, size_t size);
+	// dst must hold block.RawSize bytes.
+	static bool DecompressBlock(const Block& block, void* dst);
+};
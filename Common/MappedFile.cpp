@@ -0,0 +1,97 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const std::string& path, std::string& error)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		error = "cannot open " + path;
+		return false;
+	}
+	mFile = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		Close();
+		error = path + " is empty";
+		return false;
+	}
+	mSize = std::uint64_t(size.QuadPart);
+
+	mMapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mMapping != nullptr)
+		mData = static_cast<const unsigned char*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+	if (mData == nullptr)
+	{
+		Close();
+		error = "cannot map " + path;
+		return false;
+	}
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		error = "cannot open " + path;
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(file, &info) != 0 || info.st_size == 0)
+	{
+		close(file);
+		error = path + " is empty";
+		return false;
+	}
+
+	// The mapping keeps its own reference to the file.
+	void* data = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (data == MAP_FAILED)
+	{
+		error = "cannot map " + path;
+		return false;
+	}
+	mData = static_cast<const unsigned char*>(data);
+	mSize = std::uint64_t(info.st_size);
+#endif
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (mData != nullptr)
+		UnmapViewOfFile(mData);
+	if (mMapping != nullptr)
+		CloseHandle(mMapping);
+	if (mFile != nullptr)
+		CloseHandle(mFile);
+	mMapping = nullptr;
+	mFile = nullptr;
+#else
+	if (mData != nullptr)
+		munmap(const_cast<unsigned char*>(mData), size_t(mSize));
+#endif
+	mData = nullptr;
+	mSize = 0;
+}
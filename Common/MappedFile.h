@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// A whole file mapped read-only.  The pages are read in on first touch, so
+// opening costs the same for any file size and the data is never copied
+// into a buffer of our own.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile& rhs) = delete;
+	MappedFile& operator=(const MappedFile& rhs) = delete;
+	~MappedFile();
+
+	// Maps path.  On failure returns false, leaves the object closed and
+	// describes the problem in error.  Empty files cannot be mapped.
+	bool Open(const std::string& path, std::string& error);
+	void Close();
+	bool IsOpen() const { return mData != nullptr; }
+
+	const unsigned char* Data() const { return mData; }
+	std::uint64_t Size() const { return mSize; }
+
+private:
+	const unsigned char* mData = nullptr;
+	std::uint64_t mSize = 0;
+
+#ifdef _WIN32
+	void* mFile = nullptr;
+	void* mMapping = nullptr;
+#endif
+};
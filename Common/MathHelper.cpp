@@ -2,5 +2,143 @@
 #include <float.h>
 #include <cmath>
 
+using namespace DirectX;
+
 const float MathHelper::Infinity = FLT_MAX;
-const float MathHelper::Pi = 3.1415926535f;
\ No newline at end of file
+const float MathHelper::Pi = 3.1415926535f;
+
+namespace
+{
+	XMVECTOR LoadPosition(const void* positions, size_t i, size_t stride)
+	{
+		return XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(static_cast<const char*>(positions) + i * stride));
+	}
+}
+
+BoundingBox MathHelper::ComputeBoundingBox(const void* positions, size_t count, size_t stride)
+{
+	BoundingBox box;
+	box.Center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	box.Extents = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	if (count == 0)
+		return box;
+
+	// Four independent min/max chains so the loads and compares of
+	// neighbouring points overlap instead of waiting on one another.
+	XMVECTOR first = LoadPosition(positions, 0, stride);
+	XMVECTOR vMin[4] = { first, first, first, first };
+	XMVECTOR vMax[4] = { first, first, first, first };
+
+	size_t i = 1;
+	for (; i + 4 <= count; i += 4)
+	{
+		for (size_t k = 0; k < 4; ++k)
+		{
+			XMVECTOR p = LoadPosition(positions, i + k, stride);
+			vMin[k] = XMVectorMin(vMin[k], p);
+			vMax[k] = XMVectorMax(vMax[k], p);
+		}
+	}
+	for (; i < count; ++i)
+	{
+		XMVECTOR p = LoadPosition(positions, i, stride);
+		vMin[0] = XMVectorMin(vMin[0], p);
+		vMax[0] = XMVectorMax(vMax[0], p);
+	}
+
+	XMVECTOR lo = XMVectorMin(XMVectorMin(vMin[0], vMin[1]), XMVectorMin(vMin[2], vMin[3]));
+	XMVECTOR hi = XMVectorMax(XMVectorMax(vMax[0], vMax[1]), XMVectorMax(vMax[2], vMax[3]));
+	XMStoreFloat3(&box.Center, XMVectorScale(XMVectorAdd(lo, hi), 0.5f));
+	XMStoreFloat3(&box.Extents, XMVectorScale(XMVectorSubtract(hi, lo), 0.5f));
+	return box;
+}
+
+BoundingSphere MathHelper::ComputeBoundingSphere(const void* positions, size_t count, size_t stride)
+{
+	BoundingSphere sphere;
+	sphere.Center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	sphere.Radius = 0.0f;
+	if (count == 0)
+		return sphere;
+
+	auto farthestFrom = [&](FXMVECTOR from)
+	{
+		XMVECTOR best = from;
+		float bestDistSq = -1.0f;
+		for (size_t i = 0; i < count; ++i)
+		{
+			XMVECTOR p = LoadPosition(positions, i, stride);
+			float distSq = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(p, from)));
+			if (distSq > bestDistSq)
+			{
+				bestDistSq = distSq;
+				best = p;
+			}
+		}
+		return best;
+	};
+
+	XMVECTOR p1 = farthestFrom(LoadPosition(positions, 0, stride));
+	XMVECTOR p2 = farthestFrom(p1);
+
+	XMVECTOR c = XMVectorScale(XMVectorAdd(p1, p2), 0.5f);
+	float r = 0.5f * XMVectorGetX(XMVector3Length(XMVectorSubtract(p2, p1)));
+	float rSq = r * r;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		XMVECTOR toPoint = XMVectorSubtract(LoadPosition(positions, i, stride), c);
+		float distSq = XMVectorGetX(XMVector3LengthSq(toPoint));
+		if (distSq > rSq)
+		{
+			float dist = std::sqrt(distSq);
+			float newRadius = 0.5f * (r + dist);
+			c = XMVectorAdd(c, XMVectorScale(toPoint, (newRadius - r) / dist));
+			r = newRadius;
+			rSq = r * r;
+		}
+	}
+
+	XMStoreFloat3(&sphere.Center, c);
+	sphere.Radius = r;
+	return sphere;
+}
+
+void MathHelper::TransformBounds(const BoundingBox* in, const XMFLOAT4X4* worlds,
+	size_t count, BoundingBox* out)
+{
+	// Arvo's method: the center goes through the matrix and each world axis
+	// extent is the sum of the object extents scaled by the absolute matrix
+	// rows.  Cheaper than transforming all eight corners.
+	for (size_t i = 0; i < count; ++i)
+	{
+		XMMATRIX world = XMLoadFloat4x4(&worlds[i]);
+		XMVECTOR center = XMLoadFloat3(&in[i].Center);
+		XMVECTOR extents = XMLoadFloat3(&in[i].Extents);
+
+		XMVECTOR newCenter = XMVector3Transform(center, world);
+		XMVECTOR newExtents = XMVectorMultiply(XMVectorSplatX(extents), XMVectorAbs(world.r[0]));
+		newExtents = XMVectorMultiplyAdd(XMVectorSplatY(extents), XMVectorAbs(world.r[1]), newExtents);
+		newExtents = XMVectorMultiplyAdd(XMVectorSplatZ(extents), XMVectorAbs(world.r[2]), newExtents);
+
+		XMStoreFloat3(&out[i].Center, newCenter);
+		XMStoreFloat3(&out[i].Extents, newExtents);
+	}
+}
+
+void MathHelper::TransformBounds(const BoundingSphere* in, const XMFLOAT4X4* worlds,
+	size_t count, BoundingSphere* out)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		XMMATRIX world = XMLoadFloat4x4(&worlds[i]);
+		XMVECTOR center = XMLoadFloat3(&in[i].Center);
+
+		// The largest axis scale bounds the radius under non-uniform scale.
+		XMVECTOR scaleSq = XMVectorMax(XMVector3LengthSq(world.r[0]),
+			XMVectorMax(XMVector3LengthSq(world.r[1]), XMVector3LengthSq(world.r[2])));
+
+		XMStoreFloat3(&out[i].Center, XMVector3Transform(center, world));
+		out[i].Radius = in[i].Radius * std::sqrt(XMVectorGetX(scaleSq));
+	}
+}
@@ -1,7 +1,8 @@
 #pragma once
 
-#include <Windows.h>
 #include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <cstddef>
 #include <cstdint>
 
 class MathHelper
@@ -26,4 +27,19 @@ public:
 
 		return I;
 	}
-};
\ No newline at end of file
+
+	// Bounds of count XMFLOAT3 positions, stride bytes apart.  Zero points
+	// give an empty box and sphere at the origin.
+	static DirectX::BoundingBox ComputeBoundingBox(const void* positions, size_t count, size_t stride);
+	// Ritter's sphere: start from two far apart points and grow the sphere
+	// over any point still outside.  Within a few percent of minimal.
+	static DirectX::BoundingSphere ComputeBoundingSphere(const void* positions, size_t count, size_t stride);
+
+	// Object to world space bounds for count objects at once: out[i] is
+	// in[i] transformed by worlds[i].  The boxes stay axis aligned, so they
+	// grow under rotation.  in and out may be the same array.
+	static void TransformBounds(const DirectX::BoundingBox* in, const DirectX::XMFLOAT4X4* worlds,
+		size_t count, DirectX::BoundingBox* out);
+	static void TransformBounds(const DirectX::BoundingSphere* in, const DirectX::XMFLOAT4X4* worlds,
+		size_t count, DirectX::BoundingSphere* out);
+};
@@ -0,0 +1,225 @@
+#include "MeshFile.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+const MeshFile::uint32 MeshFile::Magic;
+const MeshFile::uint32 MeshFile::Version;
+const size_t MeshFile::MaxNameLength;
+const MeshFile::uint32 MeshFile::PackedPositionByteStride;
+
+namespace
+{
+	// DXGI_FORMAT values, spelled out so the format has no D3D dependency.
+	const std::uint32_t kFormatR32Uint = 42;
+	const std::uint32_t kFormatR16Uint = 57;
+
+	const std::uint64_t kPayloadAlignment = 16;
+
+	std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	// Offsets of the payloads for the given counts; the same on write and
+	// on open.
+	void LayoutPayloads(const MeshFile::Header& header, std::uint64_t& vertexOffset,
+		std::uint64_t& indexOffset, std::uint64_t& fileSize)
+	{
+		std::uint64_t tableEnd = sizeof(MeshFile::Header) + std::uint64_t(header.SubmeshCount) * sizeof(MeshFile::Submesh);
+		vertexOffset = AlignUp(tableEnd, kPayloadAlignment);
+		indexOffset = AlignUp(vertexOffset + std::uint64_t(header.VertexCount) * header.VertexByteStride, kPayloadAlignment);
+		fileSize = indexOffset + std::uint64_t(header.IndexCount) * MeshFile::IndexByteSize(header.IndexFormat);
+	}
+
+	// A split stride has to leave room for attributes after the positions.
+	bool ValidVertexFormat(MeshFile::VertexFormat format, std::uint32_t stride)
+	{
+		switch (format)
+		{
+		case MeshFile::VertexFormat::Full:
+		case MeshFile::VertexFormat::Packed:
+		case MeshFile::VertexFormat::PackedPosition:
+			return true;
+		case MeshFile::VertexFormat::PackedSplit:
+			return stride > MeshFile::PackedPositionByteStride;
+		}
+		return false;
+	}
+}
+
+MeshFile::~MeshFile()
+{
+	Close();
+}
+
+bool MeshFile::Open(const std::string& path)
+{
+	Close();
+	mError.clear();
+
+	if (!mFile.Open(path, mError))
+		return false;
+	if (mFile.Size() < sizeof(Header))
+		return Fail(path + " is too small");
+	return Validate();
+}
+
+void MeshFile::Close()
+{
+	mFile.Close();
+}
+
+bool MeshFile::Fail(const std::string& error)
+{
+	Close();
+	mError = error;
+	return false;
+}
+
+// Checks only the header and the submesh table, so opening costs the same
+// for any payload size.  The indices themselves are trusted.
+bool MeshFile::Validate()
+{
+	const Header& header = GetHeader();
+	if (header.Magic != Magic)
+		return Fail("not a mesh file");
+	if (header.Version != Version)
+		return Fail("mesh file version " + std::to_string(header.Version) +
+			", expected " + std::to_string(Version));
+	if (IndexByteSize(header.IndexFormat) == 0)
+		return Fail("unsupported index format " + std::to_string(header.IndexFormat));
+	if (header.VertexByteStride == 0 || header.VertexByteStride % 4 != 0)
+		return Fail("bad vertex stride " + std::to_string(header.VertexByteStride));
+	if (!ValidVertexFormat(header.Format, header.VertexByteStride))
+		return Fail("unsupported vertex format " + std::to_string(static_cast<uint32>(header.Format)));
+
+	uint64 vertexOffset, indexOffset, fileSize;
+	LayoutPayloads(header, vertexOffset, indexOffset, fileSize);
+	if (header.VertexDataOffset != vertexOffset || header.IndexDataOffset != indexOffset ||
+		header.FileSize != fileSize)
+		return Fail("mesh file header is inconsistent");
+	if (mFile.Size() < fileSize)
+		return Fail("mesh file is truncated");
+
+	const Submesh* submeshes = Submeshes();
+	for (uint32 i = 0; i < header.SubmeshCount; ++i)
+	{
+		const Submesh& submesh = submeshes[i];
+		if (std::memchr(submesh.Name, 0, sizeof(submesh.Name)) == nullptr)
+			return Fail("submesh " + std::to_string(i) + " has no name terminator");
+		if (uint64(submesh.StartIndexLocation) + submesh.IndexCount > header.IndexCount ||
+			submesh.BaseVertexLocation < 0 || uint32(submesh.BaseVertexLocation) > header.VertexCount)
+			return Fail(std::string("submesh ") + submesh.Name + " is out of range");
+	}
+	return true;
+}
+
+bool MeshFile::Write(const std::string& path, const Contents& contents, std::string* error)
+{
+	auto fail = [&](const std::string& message)
+	{
+		if (error != nullptr)
+			*error = message;
+		return false;
+	};
+
+	Header header = {};
+	header.Magic = Magic;
+	header.Version = Version;
+	header.Format = contents.Format;
+	header.VertexByteStride = contents.VertexByteStride;
+	header.VertexCount = contents.VertexCount;
+	header.IndexFormat = contents.IndexFormat;
+	header.IndexCount = contents.IndexCount;
+	header.SubmeshCount = static_cast<uint32>(contents.Submeshes.size());
+	LayoutPayloads(header, header.VertexDataOffset, header.IndexDataOffset, header.FileSize);
+
+	if (IndexByteSize(header.IndexFormat) == 0)
+		return fail("unsupported index format");
+	if (header.VertexByteStride == 0 || header.VertexByteStride % 4 != 0)
+		return fail("vertex stride must be a non-zero multiple of 4");
+	if (!ValidVertexFormat(header.Format, header.VertexByteStride))
+		return fail("unsupported vertex format");
+	for (const Submesh& submesh : contents.Submeshes)
+	{
+		if (uint64(submesh.StartIndexLocation) + submesh.IndexCount > header.IndexCount ||
+			submesh.BaseVertexLocation < 0 || uint32(submesh.BaseVertexLocation) > header.VertexCount)
+			return fail(std::string("submesh ") + submesh.Name + " is out of range");
+	}
+
+	std::string tempPath = path + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file)
+			return fail("cannot create " + tempPath);
+
+		const char zeros[kPayloadAlignment] = {};
+		auto padTo = [&](uint64 offset)
+		{
+			uint64 position = uint64(file.tellp());
+			file.write(zeros, std::streamsize(offset - position));
+		};
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		if (!contents.Submeshes.empty())
+		{
+			file.write(reinterpret_cast<const char*>(contents.Submeshes.data()),
+				std::streamsize(contents.Submeshes.size() * sizeof(Submesh)));
+		}
+		padTo(header.VertexDataOffset);
+		file.write(static_cast<const char*>(contents.Vertices),
+			std::streamsize(uint64(header.VertexCount) * header.VertexByteStride));
+		padTo(header.IndexDataOffset);
+		file.write(static_cast<const char*>(contents.Indices),
+			std::streamsize(uint64(header.IndexCount) * IndexByteSize(header.IndexFormat)));
+		if (!file)
+			return fail("cannot write " + tempPath);
+	}
+
+#ifdef _WIN32
+	if (!MoveFileExA(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+#else
+	if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+#endif
+	{
+		std::remove(tempPath.c_str());
+		return fail("cannot replace " + path);
+	}
+	return true;
+}
+
+void MeshFile::SetName(Submesh& submesh, const std::string& name)
+{
+	std::memset(submesh.Name, 0, sizeof(submesh.Name));
+	std::memcpy(submesh.Name, name.data(), name.size() < MaxNameLength ? name.size() : MaxNameLength);
+}
+
+MeshFile::uint32 MeshFile::IndexByteSize(uint32 indexFormat)
+{
+	if (indexFormat == kFormatR16Uint)
+		return 2;
+	if (indexFormat == kFormatR32Uint)
+		return 4;
+	return 0;
+}
+
+MeshFile::uint64 MeshFile::AttributeStreamOffset() const
+{
+	const Header& header = GetHeader();
+	if (header.Format != VertexFormat::PackedSplit)
+		return VertexDataSize();
+	return uint64(header.VertexCount) * PackedPositionByteStride;
+}
+
+MeshFile::uint32 MeshFile::AttributeStreamByteStride() const
+{
+	const Header& header = GetHeader();
+	if (header.Format != VertexFormat::PackedSplit)
+		return 0;
+	return header.VertexByteStride - PackedPositionByteStride;
+}
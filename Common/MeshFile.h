@@ -0,0 +1,140 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+// Binary mesh container whose payloads are already in the layout a
+// MeshGeometry uploads.  Opening a file maps it read-only and checks the
+// header and the submesh table; the vertex and index pointers then point
+// straight into the mapping and can go to CreateDefaultBuffer (see
+// d3dUtil::CreateMeshGeometry) without being parsed or copied.
+//
+// Layout, all little endian:
+//
+//     Header
+//     Submesh[SubmeshCount]
+//     vertex data, VertexCount * VertexByteStride bytes, 16 byte aligned
+//     index data, IndexCount * 2 or 4 bytes, 16 byte aligned
+//
+// Written by MeshCooker.  Has no D3D dependency, so the format can be cooked
+// and checked on any platform.
+class MeshFile
+{
+public:
+	using uint32 = std::uint32_t;
+	using uint64 = std::uint64_t;
+
+	static const uint32 Magic = 0x4853454d; // "MESH"
+	// Bump when Header or Submesh change.
+	static const uint32 Version = 1;
+	static const size_t MaxNameLength = 47;
+
+	// What the vertex data holds.  Picks the input layout; the stride is in
+	// the header.
+	enum class VertexFormat : uint32
+	{
+		// GeometryGenerator::Vertex, 44 bytes.
+		Full = 0,
+		// PackedVertex, 20 bytes, positions quantized to each submesh's Bounds.
+		Packed = 1,
+		// unorm16x4 positions only, quantized to each submesh's Bounds.
+		PackedPosition = 2,
+		// Two streams one after the other: PackedPosition for every vertex,
+		// then PackedAttributes for every vertex.  VertexByteStride is the
+		// sum of the two strides.
+		PackedSplit = 3,
+	};
+
+	// Position bytes per vertex of PackedPosition and PackedSplit.
+	static const uint32 PackedPositionByteStride = 8;
+
+	struct Header
+	{
+		uint32 Magic;
+		uint32 Version;
+		VertexFormat Format;
+		uint32 VertexByteStride;
+		uint32 VertexCount;
+		// DXGI_FORMAT_R16_UINT or DXGI_FORMAT_R32_UINT.
+		uint32 IndexFormat;
+		uint32 IndexCount;
+		uint32 SubmeshCount;
+		uint64 VertexDataOffset;
+		uint64 IndexDataOffset;
+		// Total size, so a truncated file is caught on open.
+		uint64 FileSize;
+	};
+
+	// The fields of a SubmeshGeometry that are worth storing.  Bounds are the
+	// box center and extents, the sphere center and radius.
+	struct Submesh
+	{
+		char Name[MaxNameLength + 1];
+		uint32 IndexCount;
+		uint32 StartIndexLocation;
+		std::int32_t BaseVertexLocation;
+		float LodError;
+		float BoxCenter[3];
+		float BoxExtents[3];
+		float SphereCenter[3];
+		float SphereRadius;
+	};
+
+	// Everything Write needs; the data is not copied.
+	struct Contents
+	{
+		VertexFormat Format = VertexFormat::Full;
+		uint32 VertexByteStride = 0;
+		const void* Vertices = nullptr;
+		uint32 VertexCount = 0;
+		uint32 IndexFormat = 0;
+		const void* Indices = nullptr;
+		uint32 IndexCount = 0;
+		std::vector<Submesh> Submeshes;
+	};
+
+	MeshFile() = default;
+	MeshFile(const MeshFile& rhs) = delete;
+	MeshFile& operator=(const MeshFile& rhs) = delete;
+	~MeshFile();
+
+	// Maps path and validates it.  On failure returns false, leaves the
+	// object closed and describes the problem in Error().
+	bool Open(const std::string& path);
+	void Close();
+	bool IsOpen() const { return mFile.IsOpen(); }
+	const std::string& Error() const { return mError; }
+
+	const Header& GetHeader() const { return *reinterpret_cast<const Header*>(mFile.Data()); }
+	const Submesh* Submeshes() const { return reinterpret_cast<const Submesh*>(mFile.Data() + sizeof(Header)); }
+	const void* VertexData() const { return mFile.Data() + GetHeader().VertexDataOffset; }
+	const void* IndexData() const { return mFile.Data() + GetHeader().IndexDataOffset; }
+	uint64 VertexDataSize() const { return uint64(GetHeader().VertexCount) * GetHeader().VertexByteStride; }
+	uint64 IndexDataSize() const { return uint64(GetHeader().IndexCount) * IndexByteSize(GetHeader().IndexFormat); }
+
+	// The vertex data as streams, for PackedSplit: the positions, then the
+	// attributes from AttributeStreamOffset() on.  Any other format is one
+	// stream, so the attribute stream is empty.
+	uint64 AttributeStreamOffset() const;
+	uint32 AttributeStreamByteStride() const;
+
+	// Writes contents to path through a temporary file, so a reader never
+	// sees half a file.  Returns false if the contents are inconsistent or
+	// the file could not be written.
+	static bool Write(const std::string& path, const Contents& contents, std::string* error = nullptr);
+
+	// Copies name into a Submesh, truncated to MaxNameLength.
+	static void SetName(Submesh& submesh, const std::string& name);
+
+	// 2 or 4, or 0 for an unsupported format.
+	static uint32 IndexByteSize(uint32 indexFormat);
+
+private:
+	bool Fail(const std::string& error);
+	bool Validate();
+
+	MappedFile mFile;
+	std::string mError;
+};
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "d3dUtil.h"
+#include "Lz4.h"
+#include "MeshletBuilder.h"
+#include "NameRegistry.h"
+
+class DeferredReleaseQueue;
+
+// Defines a subrange of geometry in a MeshGeometry.  This is for when multiple
+// geometries are stored in one vertex and index buffer.  It provides the offsets
+// and data needed to draw a subset of geometry stores in the vertex and index 
+// buffers so that we can implement the technique described by Figure 6.3.
+struct SubmeshGeometry
+{
+	UINT IndexCount = 0;
+	UINT StartIndexLocation = 0;
+	INT BaseVertexLocation = 0;
+
+	// Bounding box of the geometry defined by this submesh. 
+	// This is used in later chapters of the book.
+	DirectX::BoundingBox Bounds;
+	// Bounding sphere of the same geometry.  Cheaper to test than Bounds,
+	// but looser for long or flat shapes.
+	DirectX::BoundingSphere SphereBounds;
+
+	// Object space error of a simplified level against the full detail mesh.
+	// Zero for the full detail submesh.
+	float LodError = 0.0f;
+
+	// Range of this submesh's clusters in MeshGeometry::Meshlets.  Meshlet
+	// vertex indices are relative to BaseVertexLocation.
+	UINT MeshletStart = 0;
+	UINT MeshletCount = 0;
+};
+
+// What a MeshGeometry keeps of its system memory copies once they have been
+// uploaded.
+enum class CpuRetention
+{
+	// Release them.  For geometry that is only ever drawn.
+	Drop,
+	// Keep VertexBufferCPU and IndexBufferCPU as they are.
+	Keep,
+	// Keep them LZ4 compressed, for picking and collision that read them
+	// rarely.  CopyVertexData() and CopyIndexData() expand them.
+	KeepCompressed
+};
+
+// Bytes of memory held by one or more MeshGeometry.
+struct GeometryMemoryStats
+{
+	// System memory copies, compressed or not, and meshlets.
+	UINT64 CpuBytes = 0;
+	// Default heap vertex and index buffers.
+	UINT64 GpuBytes = 0;
+	// Upload buffers not released yet.
+	UINT64 UploadBytes = 0;
+};
+
+struct MeshGeometry
+{
+	// Give it a name so we can look it up by name.
+	std::string Name;
+
+	// System memory copies.  Use Blobs because the vertex/index format can be generic.
+	// It is up to the client to cast appropriately.  
+	Microsoft::WRL::ComPtr<ID3DBlob> VertexBufferCPU = nullptr;
+	Microsoft::WRL::ComPtr<ID3DBlob> IndexBufferCPU = nullptr;
+
+	// What ApplyRetention() does with the copies above.
+	CpuRetention Retention = CpuRetention::Keep;
+	// The copies while Retention is KeepCompressed.
+	Lz4::Block VertexBufferCompressed;
+	Lz4::Block IndexBufferCompressed;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> VertexBufferGPU = nullptr;
+	Microsoft::WRL::ComPtr<ID3D12Resource> IndexBufferGPU = nullptr;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> VertexBufferUploader = nullptr;
+	Microsoft::WRL::ComPtr<ID3D12Resource> IndexBufferUploader = nullptr;
+
+	// Data about the buffers.
+	UINT VertexByteStride = 0;
+	UINT VertexBufferByteSize = 0;
+	DXGI_FORMAT IndexFormat = DXGI_FORMAT_R16_UINT;
+	UINT IndexBufferByteSize = 0;
+
+	// A vertex buffer bound after slot 0, for vertices split over several
+	// streams.  Streams may share a buffer at different offsets.
+	struct VertexStream
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> BufferGPU = nullptr;
+		Microsoft::WRL::ComPtr<ID3D12Resource> BufferUploader = nullptr;
+		UINT64 ByteOffset = 0;
+		UINT ByteStride = 0;
+		UINT ByteSize = 0;
+	};
+
+	// Slot 0 is always VertexBufferGPU, these go in slots 1 and up.  Keep
+	// positions alone in slot 0 and the other attributes here, and a depth
+	// or shadow pass can bind slot 0 only and fetch nothing but positions.
+	std::vector<VertexStream> AttributeStreams;
+
+	// A MeshGeometry may store multiple geometries in one vertex/index buffer.
+	// Use this container to define the Submesh geometries so we can draw
+	// the Submeshes individually.  Look them up by NameId or handle outside
+	// of setup code.
+	NameRegistry<SubmeshGeometry> DrawArgs;
+
+	// Clusters for fine-grained culling, see MeshletBuilder.  Empty unless the
+	// app builds them.
+	MeshletData Meshlets;
+
+	D3D12_VERTEX_BUFFER_VIEW VertexBufferView()const
+	{
+		D3D12_VERTEX_BUFFER_VIEW vbv;
+		vbv.BufferLocation = VertexBufferGPU->GetGPUVirtualAddress();
+		vbv.StrideInBytes = VertexByteStride;
+		vbv.SizeInBytes = VertexBufferByteSize;
+
+		return vbv;
+	}
+
+	UINT VertexStreamCount()const
+	{
+		return 1 + static_cast<UINT>(AttributeStreams.size());
+	}
+
+	// Fills views with slot 0 and every attribute stream, VertexStreamCount()
+	// of them, ready for IASetVertexBuffers(0, count, views).
+	UINT VertexBufferViews(D3D12_VERTEX_BUFFER_VIEW* views, UINT maxCount)const
+	{
+		assert(maxCount >= VertexStreamCount());
+		views[0] = VertexBufferView();
+		for (size_t i = 0; i < AttributeStreams.size(); ++i)
+		{
+			const VertexStream& stream = AttributeStreams[i];
+			views[i + 1].BufferLocation = stream.BufferGPU->GetGPUVirtualAddress() + stream.ByteOffset;
+			views[i + 1].StrideInBytes = stream.ByteStride;
+			views[i + 1].SizeInBytes = stream.ByteSize;
+		}
+		return VertexStreamCount();
+	}
+
+	D3D12_INDEX_BUFFER_VIEW IndexBufferView()const
+	{
+		D3D12_INDEX_BUFFER_VIEW ibv;
+		ibv.BufferLocation = IndexBufferGPU->GetGPUVirtualAddress();
+		ibv.Format = IndexFormat;
+		ibv.SizeInBytes = IndexBufferByteSize;
+
+		return ibv;
+	}
+
+	// We can free this memory after we finish upload to the GPU.
+	void DisposeUploaders()
+	{
+		VertexBufferUploader = nullptr;
+		IndexBufferUploader = nullptr;
+		for (VertexStream& stream : AttributeStreams)
+			stream.BufferUploader = nullptr;
+	}
+
+	// Hands the uploaders to queue, which drops them once uploadFence, the
+	// value signalled after the command list that copies them, completes.
+	void DeferUploaders(DeferredReleaseQueue& queue, UINT64 uploadFence);
+
+	// Drops, keeps or compresses the system memory copies as Retention says.
+	// Call it once the copies have been handed to the upload, and again after
+	// changing Retention; going back to Keep expands compressed copies, and
+	// throws a DxException if they turn out to be corrupt.
+	void ApplyRetention();
+
+	// The vertex or index data from the system memory copies, expanded if
+	// they are compressed.  Returns false, with data empty, if they were
+	// dropped or do not expand.
+	bool CopyVertexData(std::vector<std::uint8_t>& data) const;
+	bool CopyIndexData(std::vector<std::uint8_t>& data) const;
+
+	// Counts the buffers this geometry references, including shared ones;
+	// see d3dUtil::GetMemoryStats for totals over several geometries.
+	GeometryMemoryStats GetMemoryStats() const;
+};
@@ -0,0 +1,1305 @@
+#include "MeshImporter.h"
+#include "TangentGenerator.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+using namespace DirectX;
+using MeshData = GeometryGenerator::MeshData;
+using Vertex = GeometryGenerator::Vertex;
+using Options = MeshImporter::Options;
+using Result = MeshImporter::Result;
+using uint32 = std::uint32_t;
+
+namespace
+{
+	uint32 ThreadCountFor(const Options& options)
+	{
+		return ResolveThreadCount(options.ThreadCount);
+	}
+
+	bool HasExtension(const std::string& path, const char* extension)
+	{
+		size_t length = std::strlen(extension);
+		if (path.size() < length)
+			return false;
+		for (size_t i = 0; i < length; ++i)
+		{
+			if (std::tolower(static_cast<unsigned char>(path[path.size() - length + i])) != extension[i])
+				return false;
+		}
+		return true;
+	}
+
+	bool Fail(std::string* error, const std::string& message)
+	{
+		if (error != nullptr)
+			*error = message;
+		return false;
+	}
+
+	std::uint64_t Mix(std::uint64_t h)
+	{
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+		return h;
+	}
+
+	const uint32 kEmptySlot = 0xffffffff;
+
+	// Open addressing set of vertex indices.  The keys stay in the caller's
+	// arrays and are compared through a callback; the table keeps each
+	// entry's hash so it can grow without them.
+	class WeldTable
+	{
+	public:
+		void Clear()
+		{
+			mSlots.clear();
+			mCount = 0;
+		}
+
+		// Returns the index stored under a key equal to candidate's, or
+		// stores candidate and returns it.  equal(index) compares the key of
+		// a stored index with candidate's.
+		template<typename Equal>
+		uint32 Insert(std::uint64_t hash, uint32 candidate, const Equal& equal)
+		{
+			if ((mCount + 1) * 2 > mSlots.size())
+				Grow();
+
+			uint32 h = static_cast<uint32>(hash ^ (hash >> 32));
+			size_t mask = mSlots.size() - 1;
+			for (size_t i = h & mask;; i = (i + 1) & mask)
+			{
+				Slot& slot = mSlots[i];
+				if (slot.Index == kEmptySlot)
+				{
+					slot.Hash = h;
+					slot.Index = candidate;
+					++mCount;
+					return candidate;
+				}
+				if (slot.Hash == h && equal(slot.Index))
+					return slot.Index;
+			}
+		}
+
+	private:
+		struct Slot
+		{
+			uint32 Hash;
+			uint32 Index;
+		};
+
+		void Grow()
+		{
+			std::vector<Slot> old;
+			old.swap(mSlots);
+			Slot empty = { 0, kEmptySlot };
+			mSlots.assign(old.empty() ? 1024 : old.size() * 2, empty);
+
+			size_t mask = mSlots.size() - 1;
+			for (const Slot& slot : old)
+			{
+				if (slot.Index == kEmptySlot)
+					continue;
+				size_t i = slot.Hash & mask;
+				while (mSlots[i].Index != kEmptySlot)
+					i = (i + 1) & mask;
+				mSlots[i] = slot;
+			}
+		}
+
+		std::vector<Slot> mSlots;
+		size_t mCount = 0;
+	};
+
+	// Fills in normals where requested and tangents, on a copy of one part so
+	// the other parts keep theirs.
+	void GenerateFrames(MeshData& mesh, const MeshImporter::Part& part, bool computeNormals, uint32 threadCount)
+	{
+		MeshData partMesh;
+		partMesh.Vertices.assign(mesh.Vertices.begin() + part.BaseVertex,
+			mesh.Vertices.begin() + part.BaseVertex + part.VertexCount);
+		partMesh.Indices32.assign(mesh.Indices32.begin() + part.StartIndex,
+			mesh.Indices32.begin() + part.StartIndex + part.IndexCount);
+
+		TangentGenerator::Options options;
+		options.ComputeNormals = computeNormals;
+		options.ThreadCount = threadCount;
+		TangentGenerator::Generate(partMesh, options);
+
+		std::copy(partMesh.Vertices.begin(), partMesh.Vertices.end(), mesh.Vertices.begin() + part.BaseVertex);
+	}
+
+	//
+	// Text parsing.  Everything works on [p, end) ranges of the read buffer,
+	// which are not null terminated.
+	//
+
+	bool IsSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	const char* SkipSpace(const char* p, const char* end)
+	{
+		while (p < end && IsSpace(*p))
+			++p;
+		return p;
+	}
+
+	bool IsDigit(char c)
+	{
+		return static_cast<unsigned>(c - '0') < 10;
+	}
+
+	const double kPowersOf10[] =
+	{
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	// Decimal to float without strtof's locale and terminator needs.  The
+	// first 19 significant digits are exact and the scaling is in double,
+	// so the result is within an ulp of strtof's.  Words like "nan" go to
+	// strtof.
+	bool ParseFloat(const char*& p, const char* end, float& out)
+	{
+		const char* s = p;
+		bool negative = false;
+		if (s < end && (*s == '-' || *s == '+'))
+			negative = *s++ == '-';
+
+		std::uint64_t mantissa = 0;
+		int digits = 0;
+		int exponent = 0;
+		bool any = false;
+		for (; s < end && IsDigit(*s); ++s, any = true)
+		{
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + unsigned(*s - '0');
+				digits += mantissa != 0;
+			}
+			else
+				++exponent;
+		}
+		if (s < end && *s == '.')
+		{
+			for (++s; s < end && IsDigit(*s); ++s, any = true)
+			{
+				if (digits < 19)
+				{
+					mantissa = mantissa * 10 + unsigned(*s - '0');
+					digits += mantissa != 0;
+					--exponent;
+				}
+			}
+		}
+
+		if (!any)
+		{
+			char text[32] = {};
+			size_t length = 0;
+			while (p + length < end && length + 1 < sizeof(text) && !IsSpace(p[length]) && p[length] != '\n')
+			{
+				text[length] = p[length];
+				++length;
+			}
+			char* next = nullptr;
+			out = std::strtof(text, &next);
+			if (next == text)
+				return false;
+			p += next - text;
+			return true;
+		}
+
+		if (s < end && (*s == 'e' || *s == 'E'))
+		{
+			const char* e = s + 1;
+			bool negativeExponent = false;
+			if (e < end && (*e == '-' || *e == '+'))
+				negativeExponent = *e++ == '-';
+			int value = 0;
+			bool anyExponent = false;
+			for (; e < end && IsDigit(*e); ++e, anyExponent = true)
+				value = (std::min)(value * 10 + (*e - '0'), 100000);
+			if (anyExponent)
+			{
+				exponent += negativeExponent ? -value : value;
+				s = e;
+			}
+		}
+
+		double value = static_cast<double>(mantissa);
+		if (mantissa != 0 && exponent != 0)
+		{
+			if (exponent < 0)
+				value = exponent >= -22 ? value / kPowersOf10[-exponent] : value * std::pow(10.0, exponent);
+			else
+				value = exponent <= 22 ? value * kPowersOf10[exponent] : value * std::pow(10.0, exponent);
+		}
+		out = static_cast<float>(negative ? -value : value);
+		p = s;
+		return true;
+	}
+
+	bool ParseInt(const char*& p, const char* end, long& out)
+	{
+		const char* s = p;
+		bool negative = false;
+		if (s < end && (*s == '-' || *s == '+'))
+			negative = *s++ == '-';
+		if (s == end || !IsDigit(*s))
+			return false;
+
+		long value = 0;
+		for (; s < end && IsDigit(*s); ++s)
+			value = (std::min)(value * 10 + (*s - '0'), 0x7fffffffL);
+		out = negative ? -value : value;
+		p = s;
+		return true;
+	}
+
+	// Parses count floats separated by spaces and returns how many it found.
+	int ParseFloats(const char* p, const char* end, float* out, int count)
+	{
+		int found = 0;
+		for (; found < count; ++found)
+		{
+			p = SkipSpace(p, end);
+			if (p == end || !ParseFloat(p, end, out[found]))
+				break;
+		}
+		return found;
+	}
+
+	//
+	// OBJ.  The text is cut at line breaks into one chunk per thread.  Each
+	// chunk is parsed on its own into attribute arrays and unresolved face
+	// corners, then the chunks are appended in order, which resolves the
+	// corners and welds them into vertices.
+	//
+
+	// A negative OBJ index counts back from the attributes read so far, which
+	// a chunk only knows relative to its own start.  Such indices are stored
+	// as (chunk count + index) - kRelativeBias, which is always negative,
+	// apart from the positive 1 based absolute indices, until the chunk's
+	// offset is known.  0 means the corner has no such attribute.
+	const std::int64_t kRelativeBias = std::int64_t(1) << 30;
+
+	struct ObjCorner
+	{
+		// Position, texture coordinate, normal.
+		std::int32_t Index[3];
+	};
+
+	struct ObjChunk
+	{
+		std::vector<XMFLOAT3> Positions;
+		std::vector<XMFLOAT2> TexCs;
+		std::vector<XMFLOAT3> Normals;
+		std::vector<ObjCorner> Corners;
+		// Corner count of each polygon.
+		std::vector<uint32> PolygonSizes;
+		// Names that start a new part before the given polygon.
+		std::vector<std::pair<uint32, std::string>> Names;
+
+		size_t LineCount = 0;
+		std::string Error;
+		size_t ErrorLine = 0;
+
+		// Empties the chunk but keeps its memory for the next batch.
+		void Clear()
+		{
+			Positions.clear();
+			TexCs.clear();
+			Normals.clear();
+			Corners.clear();
+			PolygonSizes.clear();
+			Names.clear();
+			LineCount = 0;
+			Error.clear();
+			ErrorLine = 0;
+		}
+	};
+
+	bool EncodeObjIndex(long index, size_t chunkCount, std::int32_t& out)
+	{
+		if (index > 0 && index < kRelativeBias)
+			out = static_cast<std::int32_t>(index);
+		else if (index < 0 && -index <= kRelativeBias)
+			out = static_cast<std::int32_t>(std::int64_t(chunkCount) + index - kRelativeBias);
+		else
+			return false;
+		return true;
+	}
+
+	void ParseObjChunk(const char* p, const char* end, ObjChunk& chunk)
+	{
+		while (p < end)
+		{
+			const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', size_t(end - p)));
+			if (lineEnd == nullptr)
+				lineEnd = end;
+			++chunk.LineCount;
+			auto fail = [&](const char* message)
+			{
+				chunk.Error = message;
+				chunk.ErrorLine = chunk.LineCount;
+			};
+
+			const char* s = SkipSpace(p, lineEnd);
+			const char* keyword = s;
+			while (s < lineEnd && !IsSpace(*s))
+				++s;
+			size_t keywordLength = size_t(s - keyword);
+			s = SkipSpace(s, lineEnd);
+
+			if (keywordLength == 1 && keyword[0] == 'v')
+			{
+				XMFLOAT3 v;
+				if (ParseFloats(s, lineEnd, &v.x, 3) != 3)
+					return fail("bad position");
+				chunk.Positions.push_back(v);
+			}
+			else if (keywordLength == 2 && keyword[0] == 'v' && keyword[1] == 't')
+			{
+				XMFLOAT2 v(0.0f, 0.0f);
+				if (ParseFloats(s, lineEnd, &v.x, 2) < 1)
+					return fail("bad texture coordinate");
+				chunk.TexCs.push_back(XMFLOAT2(v.x, 1.0f - v.y));
+			}
+			else if (keywordLength == 2 && keyword[0] == 'v' && keyword[1] == 'n')
+			{
+				XMFLOAT3 v;
+				if (ParseFloats(s, lineEnd, &v.x, 3) != 3)
+					return fail("bad normal");
+				chunk.Normals.push_back(v);
+			}
+			else if (keywordLength == 1 && keyword[0] == 'f')
+			{
+				uint32 cornerCount = 0;
+				while (s < lineEnd)
+				{
+					// v, v/vt, v//vn or v/vt/vn.
+					long index[3] = { 0, 0, 0 };
+					if (!ParseInt(s, lineEnd, index[0]))
+						return fail("bad face index");
+					if (s < lineEnd && *s == '/')
+					{
+						++s;
+						if (s < lineEnd && *s != '/' && !ParseInt(s, lineEnd, index[1]))
+							return fail("bad face index");
+						if (s < lineEnd && *s == '/')
+						{
+							++s;
+							if (!ParseInt(s, lineEnd, index[2]))
+								return fail("bad face index");
+						}
+					}
+					if (s < lineEnd && !IsSpace(*s))
+						return fail("bad face index");
+					s = SkipSpace(s, lineEnd);
+
+					ObjCorner corner = { { 0, 0, 0 } };
+					if (!EncodeObjIndex(index[0], chunk.Positions.size(), corner.Index[0]) ||
+						(index[1] != 0 && !EncodeObjIndex(index[1], chunk.TexCs.size(), corner.Index[1])) ||
+						(index[2] != 0 && !EncodeObjIndex(index[2], chunk.Normals.size(), corner.Index[2])))
+						return fail("face index out of range");
+					chunk.Corners.push_back(corner);
+					++cornerCount;
+				}
+				if (cornerCount < 3)
+					return fail("face with fewer than 3 corners");
+				chunk.PolygonSizes.push_back(cornerCount);
+			}
+			else if ((keywordLength == 1 && (keyword[0] == 'o' || keyword[0] == 'g')) ||
+				(keywordLength == 6 && std::memcmp(keyword, "usemtl", 6) == 0))
+			{
+				const char* nameEnd = lineEnd;
+				while (nameEnd > s && IsSpace(nameEnd[-1]))
+					--nameEnd;
+				if (nameEnd > s)
+					chunk.Names.emplace_back(static_cast<uint32>(chunk.PolygonSizes.size()), std::string(s, nameEnd));
+			}
+
+			p = lineEnd + 1;
+		}
+	}
+
+	// Appends parsed chunks to a Result, one part at a time.
+	class ObjAssembler
+	{
+	public:
+		ObjAssembler(Result& result, bool weld) :
+			mResult(result),
+			mWeld(weld)
+		{
+			mResult.Mesh.Vertices.clear();
+			mResult.Mesh.Indices32.clear();
+			mResult.Parts.clear();
+			BeginPart("default");
+		}
+
+		bool Append(const ObjChunk& chunk, std::string& error)
+		{
+			const std::int64_t base[3] =
+			{
+				std::int64_t(mPositions.size()), std::int64_t(mTexCs.size()), std::int64_t(mNormals.size())
+			};
+			mPositions.insert(mPositions.end(), chunk.Positions.begin(), chunk.Positions.end());
+			mTexCs.insert(mTexCs.end(), chunk.TexCs.begin(), chunk.TexCs.end());
+			mNormals.insert(mNormals.end(), chunk.Normals.begin(), chunk.Normals.end());
+			const std::int64_t count[3] =
+			{
+				std::int64_t(mPositions.size()), std::int64_t(mTexCs.size()), std::int64_t(mNormals.size())
+			};
+
+			size_t name = 0;
+			const ObjCorner* corner = chunk.Corners.data();
+			for (uint32 polygon = 0; polygon < chunk.PolygonSizes.size(); ++polygon)
+			{
+				for (; name < chunk.Names.size() && chunk.Names[name].first == polygon; ++name)
+					NamePart(chunk.Names[name].second);
+
+				mPolygon.clear();
+				for (uint32 k = 0; k < chunk.PolygonSizes[polygon]; ++k, ++corner)
+				{
+					ObjCorner resolved;
+					for (int a = 0; a < 3; ++a)
+					{
+						std::int64_t index = corner->Index[a];
+						if (index > 0)
+							index -= 1;
+						else if (index < 0)
+							index += base[a] + kRelativeBias;
+						else
+							index = -1;
+
+						if (index >= count[a] || (index < 0 && (a == 0 || corner->Index[a] != 0)))
+							return Fail(&error, "face index out of range");
+						resolved.Index[a] = static_cast<std::int32_t>(index);
+					}
+					mPolygon.push_back(AddVertex(resolved));
+				}
+
+				// Fan, which is exact for the convex polygons exporters write.
+				for (size_t i = 2; i < mPolygon.size(); ++i)
+				{
+					mResult.Mesh.Indices32.push_back(mPolygon[0]);
+					mResult.Mesh.Indices32.push_back(mPolygon[i - 1]);
+					mResult.Mesh.Indices32.push_back(mPolygon[i]);
+				}
+			}
+			for (; name < chunk.Names.size(); ++name)
+				NamePart(chunk.Names[name].second);
+			return true;
+		}
+
+		// Closes the last part and generates the missing normals and the
+		// tangents.
+		bool Finish(uint32 threadCount)
+		{
+			EndPart();
+			mPositions = std::vector<XMFLOAT3>();
+			mTexCs = std::vector<XMFLOAT2>();
+			mNormals = std::vector<XMFLOAT3>();
+			if (mResult.Parts.empty())
+				return false;
+
+			// Parts share no vertices, so with the indices made absolute the
+			// whole mesh can go through TangentGenerator at once, unless
+			// only some parts lack normals.
+			bool anyMissing = std::find(mMissingNormals.begin(), mMissingNormals.end(), true) != mMissingNormals.end();
+			bool allMissing = std::find(mMissingNormals.begin(), mMissingNormals.end(), false) == mMissingNormals.end();
+			if (anyMissing && !allMissing)
+			{
+				for (size_t i = 0; i < mResult.Parts.size(); ++i)
+					GenerateFrames(mResult.Mesh, mResult.Parts[i], mMissingNormals[i], threadCount);
+				return true;
+			}
+
+			auto offsetIndices = [&](bool absolute)
+			{
+				for (const MeshImporter::Part& part : mResult.Parts)
+				{
+					uint32* indices = mResult.Mesh.Indices32.data() + part.StartIndex;
+					for (uint32 i = 0; i < part.IndexCount; ++i)
+						indices[i] = absolute ? indices[i] + part.BaseVertex : indices[i] - part.BaseVertex;
+				}
+			};
+			offsetIndices(true);
+			TangentGenerator::Options options;
+			options.ComputeNormals = allMissing;
+			options.ThreadCount = threadCount;
+			TangentGenerator::Generate(mResult.Mesh, options);
+			offsetIndices(false);
+			return true;
+		}
+
+	private:
+		void BeginPart(const std::string& name)
+		{
+			mPart = MeshImporter::Part();
+			mPart.Name = name;
+			mPart.BaseVertex = static_cast<uint32>(mResult.Mesh.Vertices.size());
+			mPart.StartIndex = static_cast<uint32>(mResult.Mesh.Indices32.size());
+			mPartMissingNormals = false;
+			mTable.Clear();
+			mPartCorners.clear();
+		}
+
+		void EndPart()
+		{
+			mPart.VertexCount = static_cast<uint32>(mResult.Mesh.Vertices.size()) - mPart.BaseVertex;
+			mPart.IndexCount = static_cast<uint32>(mResult.Mesh.Indices32.size()) - mPart.StartIndex;
+			if (mPart.IndexCount > 0)
+			{
+				mResult.Parts.push_back(mPart);
+				mMissingNormals.push_back(mPartMissingNormals);
+			}
+		}
+
+		// Names before any face just rename the current part.
+		void NamePart(const std::string& name)
+		{
+			if (mResult.Mesh.Indices32.size() == mPart.StartIndex)
+			{
+				mPart.Name = name;
+				return;
+			}
+			EndPart();
+			BeginPart(name);
+		}
+
+		uint32 AddVertex(const ObjCorner& corner)
+		{
+			uint32 candidate = static_cast<uint32>(mPartCorners.size());
+			if (mWeld)
+			{
+				std::uint64_t hash = Mix(std::uint64_t(uint32(corner.Index[0])) * 0x9e3779b97f4a7c15ull ^
+					std::uint64_t(uint32(corner.Index[1])) * 0xc2b2ae3d27d4eb4full ^
+					std::uint64_t(uint32(corner.Index[2])));
+				uint32 index = mTable.Insert(hash, candidate, [&](uint32 stored)
+				{
+					const ObjCorner& other = mPartCorners[stored];
+					return other.Index[0] == corner.Index[0] && other.Index[1] == corner.Index[1] &&
+						other.Index[2] == corner.Index[2];
+				});
+				if (index != candidate)
+					return index;
+			}
+
+			Vertex vertex;
+			vertex.Position = mPositions[corner.Index[0]];
+			vertex.TexC = corner.Index[1] >= 0 ? mTexCs[corner.Index[1]] : XMFLOAT2(0.0f, 0.0f);
+			vertex.Normal = corner.Index[2] >= 0 ? mNormals[corner.Index[2]] : XMFLOAT3(0.0f, 0.0f, 0.0f);
+			vertex.TangentU = XMFLOAT3(0.0f, 0.0f, 0.0f);
+			mResult.Mesh.Vertices.push_back(vertex);
+			mPartCorners.push_back(corner);
+			mPartMissingNormals |= corner.Index[2] < 0;
+			return candidate;
+		}
+
+		Result& mResult;
+		bool mWeld;
+
+		// Every attribute read so far; faces can refer back to any of them.
+		std::vector<XMFLOAT3> mPositions;
+		std::vector<XMFLOAT2> mTexCs;
+		std::vector<XMFLOAT3> mNormals;
+
+		MeshImporter::Part mPart;
+		bool mPartMissingNormals = false;
+		// The resolved corner of each of the current part's vertices.
+		std::vector<ObjCorner> mPartCorners;
+		WeldTable mTable;
+		std::vector<uint32> mPolygon;
+		std::vector<bool> mMissingNormals;
+	};
+
+	//
+	// glTF.  Just enough JSON to read the document of a .glb.
+	//
+
+	struct JsonValue
+	{
+		enum class Type { Null, Bool, Number, String, Array, Object };
+
+		Type Kind = Type::Null;
+		bool Bool = false;
+		double Number = 0.0;
+		std::string String;
+		std::vector<JsonValue> Items;
+		std::vector<std::pair<std::string, JsonValue>> Members;
+
+		const JsonValue* Find(const char* key) const
+		{
+			for (const auto& member : Members)
+			{
+				if (member.first == key)
+					return &member.second;
+			}
+			return nullptr;
+		}
+
+		double NumberOr(const char* key, double fallback) const
+		{
+			const JsonValue* value = Find(key);
+			return value != nullptr && value->Kind == Type::Number ? value->Number : fallback;
+		}
+
+		// Item index of an array, or nullptr.
+		const JsonValue* At(double index) const
+		{
+			if (Kind != Type::Array || index < 0.0 || index >= double(Items.size()))
+				return nullptr;
+			return &Items[size_t(index)];
+		}
+	};
+
+	class JsonReader
+	{
+	public:
+		JsonReader(const char* begin, const char* end) :
+			mP(begin),
+			mEnd(end)
+		{
+		}
+
+		bool Parse(JsonValue& value)
+		{
+			return ParseValue(value, 0) && (SkipSpace(), mP == mEnd);
+		}
+
+	private:
+		void SkipSpace()
+		{
+			while (mP < mEnd && (*mP == ' ' || *mP == '\t' || *mP == '\r' || *mP == '\n'))
+				++mP;
+		}
+
+		bool Consume(const char* word)
+		{
+			size_t length = std::strlen(word);
+			if (size_t(mEnd - mP) < length || std::memcmp(mP, word, length) != 0)
+				return false;
+			mP += length;
+			return true;
+		}
+
+		bool ParseValue(JsonValue& value, int depth)
+		{
+			if (depth > 64)
+				return false;
+			SkipSpace();
+			if (mP == mEnd)
+				return false;
+
+			switch (*mP)
+			{
+			case '{':
+			{
+				value.Kind = JsonValue::Type::Object;
+				++mP;
+				SkipSpace();
+				if (mP < mEnd && *mP == '}')
+					{
+					++mP;
+					return true;
+				}
+				for (;;)
+				{
+					std::pair<std::string, JsonValue> member;
+					SkipSpace();
+					if (!ParseString(member.first))
+						return false;
+					SkipSpace();
+					if (!Consume(":") || !ParseValue(member.second, depth + 1))
+						return false;
+					value.Members.push_back(std::move(member));
+					SkipSpace();
+					if (Consume("}"))
+						return true;
+					if (!Consume(","))
+						return false;
+				}
+			}
+			case '[':
+			{
+				value.Kind = JsonValue::Type::Array;
+				++mP;
+				SkipSpace();
+				if (mP < mEnd && *mP == ']')
+					{
+					++mP;
+					return true;
+				}
+				for (;;)
+				{
+					value.Items.emplace_back();
+					if (!ParseValue(value.Items.back(), depth + 1))
+						return false;
+					SkipSpace();
+					if (Consume("]"))
+						return true;
+					if (!Consume(","))
+						return false;
+				}
+			}
+			case '"':
+				value.Kind = JsonValue::Type::String;
+				return ParseString(value.String);
+			case 't':
+				value.Kind = JsonValue::Type::Bool;
+				value.Bool = true;
+				return Consume("true");
+			case 'f':
+				value.Kind = JsonValue::Type::Bool;
+				return Consume("false");
+			case 'n':
+				return Consume("null");
+			default:
+			{
+				value.Kind = JsonValue::Type::Number;
+				char text[64] = {};
+				size_t length = 0;
+				while (mP + length < mEnd && length + 1 < sizeof(text) &&
+					std::strchr("+-0123456789.eE", mP[length]) != nullptr)
+				{
+					text[length] = mP[length];
+					++length;
+				}
+				char* next = nullptr;
+				value.Number = std::strtod(text, &next);
+				if (next == text)
+					return false;
+				mP += next - text;
+				return true;
+			}
+			}
+		}
+
+		bool ParseString(std::string& out)
+		{
+			if (!Consume("\""))
+				return false;
+			while (mP < mEnd && *mP != '"')
+			{
+				char c = *mP++;
+				if (c != '\\')
+				{
+					out.push_back(c);
+					continue;
+				}
+				if (mP == mEnd)
+					return false;
+				c = *mP++;
+				switch (c)
+				{
+				case 'b': out.push_back('\b'); break;
+				case 'f': out.push_back('\f'); break;
+				case 'n': out.push_back('\n'); break;
+				case 'r': out.push_back('\r'); break;
+				case 't': out.push_back('\t'); break;
+				case 'u':
+				{
+					if (mEnd - mP < 4)
+						return false;
+					char hex[5] = { mP[0], mP[1], mP[2], mP[3], 0 };
+					unsigned code = static_cast<unsigned>(std::strtoul(hex, nullptr, 16));
+					mP += 4;
+					// Names only; surrogate pairs come out as two characters.
+					if (code < 0x80)
+						out.push_back(char(code));
+					else if (code < 0x800)
+					{
+						out.push_back(char(0xc0 | (code >> 6)));
+						out.push_back(char(0x80 | (code & 0x3f)));
+					}
+					else
+					{
+						out.push_back(char(0xe0 | (code >> 12)));
+						out.push_back(char(0x80 | ((code >> 6) & 0x3f)));
+						out.push_back(char(0x80 | (code & 0x3f)));
+					}
+					break;
+				}
+				default: out.push_back(c); break;
+				}
+			}
+			return Consume("\"");
+		}
+
+		const char* mP;
+		const char* mEnd;
+	};
+
+	const uint32 kGlbMagic = 0x46546c67; // "glTF"
+	const uint32 kGlbChunkJson = 0x4e4f534a; // "JSON"
+	const uint32 kGlbChunkBin = 0x004e4942; // "BIN\0"
+
+	struct GlbDocument
+	{
+		std::string Path;
+		JsonValue Json;
+		std::uint64_t BinOffset = 0;
+		std::uint64_t BinLength = 0;
+	};
+
+	uint32 ComponentCount(const std::string& type)
+	{
+		if (type == "SCALAR") return 1;
+		if (type == "VEC2") return 2;
+		if (type == "VEC3") return 3;
+		if (type == "VEC4") return 4;
+		return 0;
+	}
+
+	uint32 ComponentByteSize(uint32 componentType)
+	{
+		switch (componentType)
+		{
+		case 5120: case 5121: return 1;
+		case 5122: case 5123: return 2;
+		case 5125: case 5126: return 4;
+		default: return 0;
+		}
+	}
+
+	// Reads accessor accessorIndex of the document from file.  Attribute
+	// accessors come out as components floats per element, normalized
+	// integers converted; index accessors as uint32s.
+	bool ReadAccessor(std::ifstream& file, const GlbDocument& document, double accessorIndex, uint32 components,
+		std::vector<float>* floats, std::vector<uint32>* ints, std::string& error)
+	{
+		const JsonValue* accessors = document.Json.Find("accessors");
+		const JsonValue* accessor = accessors != nullptr ? accessors->At(accessorIndex) : nullptr;
+		if (accessor == nullptr)
+			return Fail(&error, "missing accessor");
+		if (accessor->Find("sparse") != nullptr)
+			return Fail(&error, "sparse accessors are not supported");
+
+		const JsonValue* type = accessor->Find("type");
+		uint32 componentType = static_cast<uint32>(accessor->NumberOr("componentType", 0));
+		uint32 componentSize = ComponentByteSize(componentType);
+		if (type == nullptr || ComponentCount(type->String) != components || componentSize == 0)
+			return Fail(&error, "unexpected accessor type");
+
+		const JsonValue* views = document.Json.Find("bufferViews");
+		const JsonValue* view = views != nullptr ? views->At(accessor->NumberOr("bufferView", -1)) : nullptr;
+		if (view == nullptr || view->NumberOr("buffer", 0) != 0)
+			return Fail(&error, "accessor without an embedded buffer view");
+
+		std::uint64_t count = static_cast<std::uint64_t>(accessor->NumberOr("count", 0));
+		std::uint64_t elementSize = std::uint64_t(componentSize) * components;
+		std::uint64_t stride = static_cast<std::uint64_t>(view->NumberOr("byteStride", 0));
+		if (stride == 0)
+			stride = elementSize;
+		std::uint64_t viewOffset = static_cast<std::uint64_t>(view->NumberOr("byteOffset", 0));
+		std::uint64_t viewLength = static_cast<std::uint64_t>(view->NumberOr("byteLength", 0));
+		std::uint64_t accessorOffset = static_cast<std::uint64_t>(accessor->NumberOr("byteOffset", 0));
+		std::uint64_t span = count == 0 ? 0 : stride * (count - 1) + elementSize;
+		if (accessorOffset + span > viewLength || viewOffset + accessorOffset + span > document.BinLength)
+			return Fail(&error, "accessor outside its buffer");
+		std::uint64_t offset = viewOffset + accessorOffset;
+
+		// Only the bytes this accessor covers are read.
+		std::vector<unsigned char> bytes(static_cast<size_t>(span));
+		file.seekg(std::streamoff(document.BinOffset + offset));
+		file.read(reinterpret_cast<char*>(bytes.data()), std::streamsize(span));
+		if (!file)
+			return Fail(&error, "cannot read " + document.Path);
+
+		bool normalized = accessor->Find("normalized") != nullptr && accessor->Find("normalized")->Bool;
+		size_t valueCount = static_cast<size_t>(count * components);
+		if (floats != nullptr)
+			floats->resize(valueCount);
+		if (ints != nullptr)
+			ints->resize(valueCount);
+
+		for (std::uint64_t e = 0; e < count; ++e)
+		{
+			const unsigned char* element = bytes.data() + e * stride;
+			for (uint32 c = 0; c < components; ++c)
+			{
+				const unsigned char* data = element + c * componentSize;
+				double value = 0.0;
+				switch (componentType)
+				{
+				case 5120: value = normalized ? (std::max)(std::int8_t(*data) / 127.0, -1.0) : std::int8_t(*data); break;
+				case 5121: value = normalized ? *data / 255.0 : *data; break;
+				case 5122:
+				{
+					std::int16_t v;
+					std::memcpy(&v, data, 2);
+					value = normalized ? (std::max)(v / 32767.0, -1.0) : v;
+					break;
+				}
+				case 5123:
+				{
+					std::uint16_t v;
+					std::memcpy(&v, data, 2);
+					value = normalized ? v / 65535.0 : v;
+					break;
+				}
+				case 5125:
+				{
+					std::uint32_t v;
+					std::memcpy(&v, data, 4);
+					value = v;
+					break;
+				}
+				case 5126:
+				{
+					float v;
+					std::memcpy(&v, data, 4);
+					value = v;
+					break;
+				}
+				}
+
+				size_t i = size_t(e * components + c);
+				if (floats != nullptr)
+					(*floats)[i] = static_cast<float>(value);
+				if (ints != nullptr)
+					(*ints)[i] = static_cast<uint32>(value);
+			}
+		}
+		return true;
+	}
+
+	struct GlbPrimitive
+	{
+		std::string Name;
+		const JsonValue* Json = nullptr;
+		MeshData Mesh;
+		std::string Error;
+	};
+
+	// Reads one triangle primitive into primitive.Mesh with welded vertices
+	// and a full tangent frame.
+	bool LoadGlbPrimitive(std::ifstream& file, const GlbDocument& document, bool weld, GlbPrimitive& primitive)
+	{
+		const JsonValue* attributes = primitive.Json->Find("attributes");
+		const JsonValue* position = attributes != nullptr ? attributes->Find("POSITION") : nullptr;
+		if (position == nullptr)
+			return primitive.Error = "primitive without POSITION", false;
+
+		std::vector<float> positions, normals, tangents, texCs;
+		std::string& error = primitive.Error;
+		if (!ReadAccessor(file, document, position->Number, 3, &positions, nullptr, error))
+			return false;
+		size_t vertexCount = positions.size() / 3;
+
+		auto readOptional = [&](const char* name, uint32 components, std::vector<float>& out)
+		{
+			const JsonValue* accessor = attributes->Find(name);
+			if (accessor == nullptr)
+				return true;
+			if (!ReadAccessor(file, document, accessor->Number, components, &out, nullptr, error))
+				return false;
+			if (out.size() != vertexCount * components)
+				return Fail(&error, std::string(name) + " count does not match POSITION");
+			return true;
+		};
+		if (!readOptional("NORMAL", 3, normals) || !readOptional("TANGENT", 4, tangents) ||
+			!readOptional("TEXCOORD_0", 2, texCs))
+			return false;
+
+		std::vector<uint32> indices;
+		const JsonValue* indexAccessor = primitive.Json->Find("indices");
+		if (indexAccessor != nullptr)
+		{
+			if (!ReadAccessor(file, document, indexAccessor->Number, 1, nullptr, &indices, error))
+				return false;
+		}
+		else
+		{
+			indices.resize(vertexCount);
+			for (size_t i = 0; i < vertexCount; ++i)
+				indices[i] = static_cast<uint32>(i);
+		}
+		if (indices.size() % 3 != 0)
+			return Fail(&error, "index count is not a multiple of 3");
+		for (uint32 index : indices)
+		{
+			if (index >= vertexCount)
+				return Fail(&error, "index out of range");
+		}
+
+		std::vector<Vertex> vertices(vertexCount);
+		for (size_t v = 0; v < vertexCount; ++v)
+		{
+			Vertex& vertex = vertices[v];
+			vertex.Position = XMFLOAT3(&positions[v * 3]);
+			vertex.Normal = normals.empty() ? XMFLOAT3(0.0f, 0.0f, 0.0f) : XMFLOAT3(&normals[v * 3]);
+			vertex.TangentU = tangents.empty() ? XMFLOAT3(0.0f, 0.0f, 0.0f) : XMFLOAT3(&tangents[v * 4]);
+			vertex.TexC = texCs.empty() ? XMFLOAT2(0.0f, 0.0f) : XMFLOAT2(&texCs[v * 2]);
+		}
+		bool generateNormals = normals.empty();
+		bool generateTangents = tangents.empty();
+		positions = normals = tangents = texCs = std::vector<float>();
+
+		MeshData& mesh = primitive.Mesh;
+		if (weld)
+		{
+			// Exporters often split vertices per face; merge the ones that
+			// came out bit for bit the same.
+			std::vector<uint32> remap(vertexCount);
+			WeldTable table;
+			for (size_t v = 0; v < vertexCount; ++v)
+			{
+				uint32 words[sizeof(Vertex) / 4];
+				std::memcpy(words, &vertices[v], sizeof(Vertex));
+				std::uint64_t hash = 0;
+				for (uint32 word : words)
+					hash = Mix(hash ^ word);
+
+				uint32 candidate = static_cast<uint32>(mesh.Vertices.size());
+				uint32 index = table.Insert(hash, candidate, [&](uint32 stored)
+				{
+					return std::memcmp(&mesh.Vertices[stored], &vertices[v], sizeof(Vertex)) == 0;
+				});
+				if (index == candidate)
+					mesh.Vertices.push_back(vertices[v]);
+				remap[v] = index;
+			}
+			for (uint32& index : indices)
+				index = remap[index];
+		}
+		else
+			mesh.Vertices = std::move(vertices);
+		mesh.Indices32 = std::move(indices);
+
+		// Primitives already load in parallel, so this runs on one thread.
+		if (generateNormals || generateTangents)
+		{
+			TangentGenerator::Options options;
+			options.ComputeNormals = generateNormals;
+			options.ThreadCount = 1;
+			TangentGenerator::Generate(mesh, options);
+		}
+		return true;
+	}
+}
+
+bool MeshImporter::Load(const std::string& path, Result& result, std::string* error)
+{
+	return Load(path, Options(), result, error);
+}
+
+bool MeshImporter::Load(const std::string& path, const Options& options, Result& result, std::string* error)
+{
+	if (HasExtension(path, ".obj"))
+		return LoadObj(path, options, result, error);
+	if (HasExtension(path, ".glb"))
+		return LoadGlb(path, options, result, error);
+	return Fail(error, path + ": unknown mesh format");
+}
+
+bool MeshImporter::LoadObj(const std::string& path, Result& result, std::string* error)
+{
+	return LoadObj(path, Options(), result, error);
+}
+
+bool MeshImporter::LoadObj(const std::string& path, const Options& options, Result& result, std::string* error)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		return Fail(error, "cannot open " + path);
+
+	const uint32 threadCount = ThreadCountFor(options);
+	const size_t batchSize = size_t(threadCount) * (std::max)(options.ChunkByteSize, 4096u);
+
+	std::vector<char> buffer;
+	size_t carried = 0;
+	std::vector<ObjChunk> chunks(threadCount);
+	std::vector<size_t> bounds(threadCount + 1);
+	ObjAssembler assembler(result, options.WeldVertices);
+	size_t lineBase = 0;
+
+	for (bool endOfFile = false; !endOfFile;)
+	{
+		buffer.resize(carried + batchSize);
+		file.read(buffer.data() + carried, std::streamsize(batchSize));
+		size_t size = carried + size_t(file.gcount());
+		endOfFile = size_t(file.gcount()) < batchSize;
+
+		// Parse up to the last line break; the partial line after it waits
+		// for the next batch.
+		size_t parseEnd = size;
+		if (!endOfFile)
+		{
+			while (parseEnd > 0 && buffer[parseEnd - 1] != '\n')
+				--parseEnd;
+			if (parseEnd == 0)
+			{
+				// One line longer than the batch; read more of it.
+				carried = size;
+				continue;
+			}
+		}
+
+		// Cut the batch into one chunk per thread at line breaks.
+		const char* text = buffer.data();
+		bounds[0] = 0;
+		for (uint32 t = 1; t < threadCount; ++t)
+		{
+			size_t cut = (std::max)(bounds[t - 1], parseEnd / threadCount * t);
+			const void* lineBreak = cut < parseEnd ? std::memchr(text + cut, '\n', parseEnd - cut) : nullptr;
+			bounds[t] = lineBreak != nullptr ? size_t(static_cast<const char*>(lineBreak) - text) + 1 : parseEnd;
+		}
+		bounds[threadCount] = parseEnd;
+
+		ParallelFor(threadCount, threadCount, [&](uint32 begin, uint32 end)
+		{
+			for (uint32 t = begin; t < end; ++t)
+			{
+				chunks[t].Clear();
+				ParseObjChunk(text + bounds[t], text + bounds[t + 1], chunks[t]);
+			}
+		});
+
+		for (const ObjChunk& chunk : chunks)
+		{
+			std::string message = chunk.Error;
+			size_t line = chunk.ErrorLine;
+			if (!message.empty() || !assembler.Append(chunk, message))
+			{
+				std::string where = line != 0 ? "(" + std::to_string(lineBase + line) + ")" : "";
+				return Fail(error, path + where + ": " + message);
+			}
+			lineBase += chunk.LineCount;
+		}
+
+		carried = size - parseEnd;
+		std::memmove(buffer.data(), buffer.data() + parseEnd, carried);
+	}
+
+	if (!assembler.Finish(threadCount))
+		return Fail(error, path + " has no faces");
+	return true;
+}
+
+bool MeshImporter::LoadGlb(const std::string& path, Result& result, std::string* error)
+{
+	return LoadGlb(path, Options(), result, error);
+}
+
+bool MeshImporter::LoadGlb(const std::string& path, const Options& options, Result& result, std::string* error)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		return Fail(error, "cannot open " + path);
+
+	// 12 byte header, then chunks of (length, type, data).  The JSON chunk
+	// comes first and the binary chunk, if any, right after it.
+	uint32 header[3] = {};
+	uint32 jsonChunk[2] = {};
+	file.read(reinterpret_cast<char*>(header), sizeof(header));
+	file.read(reinterpret_cast<char*>(jsonChunk), sizeof(jsonChunk));
+	if (!file || header[0] != kGlbMagic || header[1] != 2 || jsonChunk[1] != kGlbChunkJson)
+		return Fail(error, path + " is not a glTF 2.0 binary");
+
+	std::string json(jsonChunk[0], '\0');
+	file.read(&json[0], std::streamsize(json.size()));
+	if (!file)
+		return Fail(error, path + " is truncated");
+
+	GlbDocument document;
+	document.Path = path;
+	uint32 binChunk[2] = {};
+	std::uint64_t binChunkOffset = sizeof(header) + sizeof(jsonChunk) + ((std::uint64_t(jsonChunk[0]) + 3) & ~3ull);
+	file.seekg(std::streamoff(binChunkOffset));
+	if (file.read(reinterpret_cast<char*>(binChunk), sizeof(binChunk)) && binChunk[1] == kGlbChunkBin)
+	{
+		document.BinOffset = binChunkOffset + sizeof(binChunk);
+		document.BinLength = binChunk[0];
+	}
+	file.close();
+
+	JsonReader reader(json.data(), json.data() + json.size());
+	if (!reader.Parse(document.Json))
+		return Fail(error, path + ": bad JSON");
+	json = std::string();
+
+	// Every triangle primitive becomes a part.
+	std::vector<GlbPrimitive> primitives;
+	const JsonValue* meshes = document.Json.Find("meshes");
+	for (size_t m = 0; meshes != nullptr && m < meshes->Items.size(); ++m)
+	{
+		const JsonValue& mesh = meshes->Items[m];
+		const JsonValue* name = mesh.Find("name");
+		std::string meshName = name != nullptr && !name->String.empty() ? name->String : "mesh" + std::to_string(m);
+
+		const JsonValue* meshPrimitives = mesh.Find("primitives");
+		size_t count = meshPrimitives != nullptr ? meshPrimitives->Items.size() : 0;
+		for (size_t p = 0; p < count; ++p)
+		{
+			if (meshPrimitives->Items[p].NumberOr("mode", 4) != 4)
+				continue;
+			primitives.emplace_back();
+			primitives.back().Name = count > 1 ? meshName + "_" + std::to_string(p) : meshName;
+			primitives.back().Json = &meshPrimitives->Items[p];
+		}
+	}
+	if (primitives.empty())
+		return Fail(error, path + " has no triangle primitives");
+
+	// Each thread reads its own primitives through its own stream.
+	uint32 primitiveCount = static_cast<uint32>(primitives.size());
+	uint32 threadCount = (std::min)(ThreadCountFor(options), primitiveCount);
+	ParallelFor(primitiveCount, threadCount, [&](uint32 begin, uint32 end)
+	{
+		std::ifstream stream(path, std::ios::binary);
+		for (uint32 p = begin; p < end; ++p)
+		{
+			if (!stream)
+				primitives[p].Error = "cannot open " + path;
+			else
+				LoadGlbPrimitive(stream, document, options.WeldVertices, primitives[p]);
+		}
+	});
+
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	for (const GlbPrimitive& primitive : primitives)
+	{
+		if (!primitive.Error.empty())
+			return Fail(error, path + ": " + primitive.Name + ": " + primitive.Error);
+		vertexCount += primitive.Mesh.Vertices.size();
+		indexCount += primitive.Mesh.Indices32.size();
+	}
+
+	result.Mesh.Vertices.clear();
+	result.Mesh.Indices32.clear();
+	result.Mesh.Vertices.reserve(vertexCount);
+	result.Mesh.Indices32.reserve(indexCount);
+	result.Parts.clear();
+	for (GlbPrimitive& primitive : primitives)
+	{
+
+		Part part;
+		part.Name = primitive.Name;
+		part.BaseVertex = static_cast<uint32>(result.Mesh.Vertices.size());
+		part.VertexCount = static_cast<uint32>(primitive.Mesh.Vertices.size());
+		part.StartIndex = static_cast<uint32>(result.Mesh.Indices32.size());
+		part.IndexCount = static_cast<uint32>(primitive.Mesh.Indices32.size());
+		result.Parts.push_back(part);
+
+		result.Mesh.Vertices.insert(result.Mesh.Vertices.end(), primitive.Mesh.Vertices.begin(), primitive.Mesh.Vertices.end());
+		result.Mesh.Indices32.insert(result.Mesh.Indices32.end(), primitive.Mesh.Indices32.begin(), primitive.Mesh.Indices32.end());
+		primitive.Mesh = MeshData();
+	}
+	return true;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "GeometryGenerator.h"
+
+// Reads mesh files from other tools into GeometryGenerator::MeshData.
+//
+// Every OBJ object, group or material, and every glTF mesh primitive,
+// becomes a Part with its own range of vertices, so each part can get its
+// own bounds and quantization and be drawn as a submesh.  Part indices are
+// relative to the part's BaseVertex.  Vertices that repeat within a part
+// are welded through a hash table.  Normals that are missing are computed,
+// and tangents that are missing are too, with TangentGenerator.
+//
+// Files are streamed: OBJ text is read a batch of chunks at a time and the
+// chunks are parsed on separate threads, and .glb loaders read only the
+// byte ranges each primitive uses.  Memory holds the parsed data, never the
+// whole file.  No D3D dependency; MeshCooker turns the result into a
+// MeshFile for d3dUtil::CreateMeshGeometry.
+class MeshImporter
+{
+public:
+	using uint32 = std::uint32_t;
+
+	struct Part
+	{
+		std::string Name;
+		uint32 BaseVertex = 0;
+		uint32 VertexCount = 0;
+		uint32 StartIndex = 0;
+		uint32 IndexCount = 0;
+	};
+
+	struct Result
+	{
+		GeometryGenerator::MeshData Mesh;
+		std::vector<Part> Parts;
+	};
+
+	struct Options
+	{
+		// 0 uses every hardware thread.
+		uint32 ThreadCount = 0;
+		// OBJ text is parsed this many bytes per thread at a time.
+		uint32 ChunkByteSize = 4u << 20;
+		// Merge vertices that are identical within a part.  An OBJ vertex
+		// is identical when its position, texture coordinate and normal
+		// indices are.
+		bool WeldVertices = true;
+	};
+
+	// Picks the loader from the extension, .obj or .glb.
+	static bool Load(const std::string& path, Result& result, std::string* error = nullptr);
+	static bool Load(const std::string& path, const Options& options, Result& result, std::string* error = nullptr);
+
+	// Wavefront OBJ: v, vt, vn and f, with polygons fanned into triangles
+	// and negative indices relative to the end.  Texture coordinates are
+	// flipped to put v = 0 at the top.  Everything else is ignored.
+	static bool LoadObj(const std::string& path, Result& result, std::string* error = nullptr);
+	static bool LoadObj(const std::string& path, const Options& options, Result& result, std::string* error = nullptr);
+
+	// Binary glTF 2.0: the triangle primitives of every mesh, with POSITION,
+	// NORMAL, TANGENT and TEXCOORD_0 from the embedded buffer.  Node
+	// transforms are not applied; every primitive stays in its mesh's space.
+	// Sparse accessors and external buffers are not supported.
+	static bool LoadGlb(const std::string& path, Result& result, std::string* error = nullptr);
+	static bool LoadGlb(const std::string& path, const Options& options, Result& result, std::string* error = nullptr);
+};
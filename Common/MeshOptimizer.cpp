@@ -0,0 +1,469 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	using uint32 = std::uint32_t;
+
+	// Forsyth's scoring assumes an LRU cache of this size; it is independent of
+	// the FIFO size used for the statistics.
+	const uint32 kForsythCacheSize = 32;
+	const float kLastTriScore = 0.75f;
+	const float kCacheDecayPower = 1.5f;
+	const float kValenceBoostScale = 2.0f;
+	const float kValenceBoostPower = 0.5f;
+
+	float VertexScore(int cachePosition, uint32 remainingTris)
+	{
+		// No triangles left means the vertex is of no further use.
+		if (remainingTris == 0)
+			return -1.0f;
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			// The vertices of the last triangle get a fixed score so the next
+			// triangle does not simply reuse the same edge.
+			if (cachePosition < 3)
+				score = kLastTriScore;
+			else
+			{
+				const float scaler = 1.0f / (kForsythCacheSize - 3);
+				score = std::pow(1.0f - (cachePosition - 3) * scaler, kCacheDecayPower);
+			}
+		}
+
+		// Favour vertices with few triangles left so they get finished off
+		// instead of leaving lone triangles behind.
+		score += kValenceBoostScale * std::pow(static_cast<float>(remainingTris), -kValenceBoostPower);
+		return score;
+	}
+
+	// Simulates a FIFO cache with timestamps: a vertex is resident if it was
+	// pushed less than cacheSize misses ago.
+	class FifoCache
+	{
+	public:
+		FifoCache(size_t vertexCount, uint32 cacheSize) :
+			mTimestamps(vertexCount, 0),
+			mCacheSize(cacheSize)
+		{
+		}
+
+		// Returns true on a miss.  mTime is one past the newest entry, so the
+		// cacheSize most recent misses are those at most cacheSize behind it.
+		bool Access(uint32 v)
+		{
+			if (mTime - mTimestamps[v] <= mCacheSize)
+				return false;
+			mTimestamps[v] = mTime++;
+			return true;
+		}
+
+		void Flush()
+		{
+			mTime += mCacheSize + 1;
+		}
+
+	private:
+		std::vector<uint32> mTimestamps;
+		uint32 mCacheSize;
+		// Starts past the cache size so that every vertex misses on first use.
+		uint32 mTime = 1u << 30;
+	};
+
+	const XMFLOAT3& PositionAt(const void* vertices, size_t stride, size_t offset, uint32 v)
+	{
+		return *reinterpret_cast<const XMFLOAT3*>(
+			static_cast<const std::uint8_t*>(vertices) + v * stride + offset);
+	}
+}
+
+template<typename IndexType>
+MeshOptimizer::CacheStats MeshOptimizer::AnalyzeVertexCache(const IndexType* indices, size_t indexCount, size_t vertexCount, uint32 cacheSize)
+{
+	assert(indexCount % 3 == 0);
+
+	CacheStats stats;
+	if (indexCount == 0)
+		return stats;
+
+	FifoCache cache(vertexCount, cacheSize);
+	std::vector<bool> referenced(vertexCount, false);
+
+	uint32 misses = 0;
+	uint32 unique = 0;
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		uint32 v = indices[i];
+		assert(v < vertexCount);
+
+		if (cache.Access(v))
+			++misses;
+		if (!referenced[v])
+		{
+			referenced[v] = true;
+			++unique;
+		}
+	}
+
+	stats.Acmr = static_cast<float>(misses) / (indexCount / 3);
+	stats.Atvr = static_cast<float>(misses) / unique;
+	return stats;
+}
+
+template<typename IndexType>
+void MeshOptimizer::OptimizeVertexCache(IndexType* indices, size_t indexCount, size_t vertexCount)
+{
+	assert(indexCount % 3 == 0);
+
+	const uint32 triCount = static_cast<uint32>(indexCount / 3);
+	if (triCount == 0)
+		return;
+
+	//
+	// Triangle adjacency per vertex, as offsets into one flat array.  The
+	// live part of each vertex's list shrinks as its triangles are emitted.
+	//
+
+	std::vector<uint32> remaining(vertexCount, 0);
+	for (size_t i = 0; i < indexCount; ++i)
+		remaining[indices[i]]++;
+
+	std::vector<uint32> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; ++v)
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remaining[v];
+
+	std::vector<uint32> adjacency(indexCount);
+	{
+		std::vector<uint32> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (uint32 t = 0; t < triCount; ++t)
+		{
+			for (uint32 k = 0; k < 3; ++k)
+				adjacency[fill[indices[t * 3 + k]]++] = t;
+		}
+	}
+
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v)
+		vertexScores[v] = VertexScore(-1, remaining[v]);
+
+	std::vector<float> triScores(triCount);
+	std::vector<bool> emitted(triCount, false);
+	uint32 bestTri = 0;
+	for (uint32 t = 0; t < triCount; ++t)
+	{
+		triScores[t] = vertexScores[indices[t * 3 + 0]] +
+			vertexScores[indices[t * 3 + 1]] +
+			vertexScores[indices[t * 3 + 2]];
+
+		if (triScores[t] > triScores[bestTri])
+			bestTri = t;
+	}
+
+	// The cache holds the vertices of the last triangle in front, then the
+	// previous contents; it briefly overflows by up to three entries.
+	uint32 cache[kForsythCacheSize + 3];
+	uint32 newCache[kForsythCacheSize + 3];
+	uint32 cacheCount = 0;
+
+	std::vector<IndexType> output(indexCount);
+	uint32 deadEndCursor = 0;
+
+	for (uint32 outTri = 0; outTri < triCount; ++outTri)
+	{
+		if (bestTri == UINT32_MAX)
+		{
+			// Nothing in the cache has triangles left; restart from the next
+			// unemitted triangle in input order.
+			while (emitted[deadEndCursor])
+				++deadEndCursor;
+			bestTri = deadEndCursor;
+		}
+
+		const uint32 tri[3] =
+		{
+			indices[bestTri * 3 + 0],
+			indices[bestTri * 3 + 1],
+			indices[bestTri * 3 + 2]
+		};
+
+		output[outTri * 3 + 0] = static_cast<IndexType>(tri[0]);
+		output[outTri * 3 + 1] = static_cast<IndexType>(tri[1]);
+		output[outTri * 3 + 2] = static_cast<IndexType>(tri[2]);
+		emitted[bestTri] = true;
+
+		// Remove the triangle from its vertices' adjacency.
+		for (uint32 k = 0; k < 3; ++k)
+		{
+			uint32 v = tri[k];
+			uint32* list = &adjacency[adjacencyOffsets[v]];
+			uint32 count = remaining[v];
+			for (uint32 j = 0; j < count; ++j)
+			{
+				if (list[j] == bestTri)
+				{
+					list[j] = list[count - 1];
+					break;
+				}
+			}
+			remaining[v]--;
+		}
+
+		// Move the triangle's vertices to the front of the cache.
+		uint32 newCount = 0;
+		for (uint32 k = 0; k < 3; ++k)
+		{
+			if (std::find(newCache, newCache + newCount, tri[k]) == newCache + newCount)
+				newCache[newCount++] = tri[k];
+		}
+		for (uint32 j = 0; j < cacheCount; ++j)
+		{
+			uint32 v = cache[j];
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+				newCache[newCount++] = v;
+		}
+
+		// Rescore everything that was or is in the cache and push the change
+		// through to the triangles that use it.
+		for (uint32 j = 0; j < newCount; ++j)
+		{
+			uint32 v = newCache[j];
+			int position = j < kForsythCacheSize ? static_cast<int>(j) : -1;
+
+			float score = VertexScore(position, remaining[v]);
+			float delta = score - vertexScores[v];
+			vertexScores[v] = score;
+
+			const uint32* list = &adjacency[adjacencyOffsets[v]];
+			for (uint32 a = 0; a < remaining[v]; ++a)
+				triScores[list[a]] += delta;
+		}
+
+		// Only triangles touching the cache changed, so the next one is among them.
+		bestTri = UINT32_MAX;
+		float bestScore = -1.0f;
+		for (uint32 j = 0; j < newCount; ++j)
+		{
+			uint32 v = newCache[j];
+			const uint32* list = &adjacency[adjacencyOffsets[v]];
+			for (uint32 a = 0; a < remaining[v]; ++a)
+			{
+				if (triScores[list[a]] > bestScore)
+				{
+					bestScore = triScores[list[a]];
+					bestTri = list[a];
+				}
+			}
+		}
+
+		cacheCount = std::min(newCount, kForsythCacheSize);
+		std::copy(newCache, newCache + cacheCount, cache);
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+template<typename IndexType>
+void MeshOptimizer::OptimizeOverdraw(IndexType* indices, size_t indexCount,
+	const void* vertices, size_t vertexCount, size_t vertexStride, size_t positionOffset,
+	uint32 cacheSize, float threshold)
+{
+	assert(indexCount % 3 == 0);
+
+	const uint32 triCount = static_cast<uint32>(indexCount / 3);
+	if (triCount == 0)
+		return;
+
+	//
+	// Hard boundaries: a triangle that misses on all three vertices starts
+	// over with a cold cache anyway, so the order can change there for free.
+	//
+
+	std::vector<uint32> hardClusters;
+	{
+		FifoCache cache(vertexCount, cacheSize);
+		for (uint32 t = 0; t < triCount; ++t)
+		{
+			uint32 misses = 0;
+			for (uint32 k = 0; k < 3; ++k)
+				misses += cache.Access(indices[t * 3 + k]) ? 1 : 0;
+
+			if (misses == 3)
+				hardClusters.push_back(t);
+		}
+	}
+	hardClusters.push_back(triCount);
+
+	//
+	// Soft boundaries: split a hard cluster further wherever the running ACMR
+	// of the current piece is within the threshold of the whole cluster's.
+	// Every split restarts with a cold cache, so the real cost is bounded by
+	// the threshold.
+	//
+
+	std::vector<uint32> clusters;
+	for (size_t c = 0; c + 1 < hardClusters.size(); ++c)
+	{
+		const uint32 start = hardClusters[c];
+		const uint32 end = hardClusters[c + 1];
+
+		float clusterAcmr = AnalyzeVertexCache(indices + start * 3, (end - start) * 3, vertexCount, cacheSize).Acmr;
+
+		FifoCache cache(vertexCount, cacheSize);
+		uint32 pieceStart = start;
+		uint32 misses = 0;
+		clusters.push_back(start);
+		for (uint32 t = start; t < end; ++t)
+		{
+			for (uint32 k = 0; k < 3; ++k)
+				misses += cache.Access(indices[t * 3 + k]) ? 1 : 0;
+
+			float pieceAcmr = static_cast<float>(misses) / (t + 1 - pieceStart);
+			if (t + 1 < end && pieceAcmr <= clusterAcmr * threshold)
+			{
+				pieceStart = t + 1;
+				misses = 0;
+				cache.Flush();
+				clusters.push_back(pieceStart);
+			}
+		}
+	}
+	clusters.push_back(triCount);
+
+	const size_t clusterCount = clusters.size() - 1;
+	if (clusterCount <= 1)
+		return;
+
+	//
+	// Sort the clusters so those facing away from the mesh centroid are drawn
+	// first; on a convex-ish mesh they are the ones in front.
+	//
+
+	XMVECTOR meshCentroid = XMVectorZero();
+	float meshArea = 0.0f;
+	std::vector<XMFLOAT3> clusterCentroids(clusterCount);
+	std::vector<XMFLOAT3> clusterNormals(clusterCount);
+	for (size_t c = 0; c < clusterCount; ++c)
+	{
+		XMVECTOR centroid = XMVectorZero();
+		XMVECTOR normal = XMVectorZero();
+		float area = 0.0f;
+		for (uint32 t = clusters[c]; t < clusters[c + 1]; ++t)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&PositionAt(vertices, vertexStride, positionOffset, indices[t * 3 + 0]));
+			XMVECTOR p1 = XMLoadFloat3(&PositionAt(vertices, vertexStride, positionOffset, indices[t * 3 + 1]));
+			XMVECTOR p2 = XMLoadFloat3(&PositionAt(vertices, vertexStride, positionOffset, indices[t * 3 + 2]));
+
+			// The cross product is twice the area, pointing along the normal.
+			XMVECTOR n = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+			float triArea = XMVectorGetX(XMVector3Length(n));
+
+			centroid = XMVectorAdd(centroid, XMVectorScale(XMVectorAdd(XMVectorAdd(p0, p1), p2), triArea / 3.0f));
+			normal = XMVectorAdd(normal, n);
+			area += triArea;
+		}
+
+		meshCentroid = XMVectorAdd(meshCentroid, centroid);
+		meshArea += area;
+
+		XMStoreFloat3(&clusterCentroids[c], area > 0.0f ? XMVectorScale(centroid, 1.0f / area) : centroid);
+		XMStoreFloat3(&clusterNormals[c], XMVector3Normalize(normal));
+	}
+	if (meshArea > 0.0f)
+		meshCentroid = XMVectorScale(meshCentroid, 1.0f / meshArea);
+
+	std::vector<float> sortKeys(clusterCount);
+	std::vector<uint32> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; ++c)
+	{
+		XMVECTOR toCluster = XMVectorSubtract(XMLoadFloat3(&clusterCentroids[c]), meshCentroid);
+		sortKeys[c] = XMVectorGetX(XMVector3Dot(toCluster, XMLoadFloat3(&clusterNormals[c])));
+		order[c] = static_cast<uint32>(c);
+	}
+
+	std::stable_sort(order.begin(), order.end(),
+		[&sortKeys](uint32 a, uint32 b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<IndexType> output;
+	output.reserve(indexCount);
+	for (uint32 c : order)
+		output.insert(output.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+template<typename IndexType>
+void MeshOptimizer::OptimizeVertexFetch(void* vertices, size_t vertexCount, size_t vertexStride,
+	IndexType* indices, size_t indexCount)
+{
+	const uint32 kUnused = UINT32_MAX;
+	std::vector<uint32> remap(vertexCount, kUnused);
+
+	uint32 next = 0;
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		uint32 v = indices[i];
+		if (remap[v] == kUnused)
+			remap[v] = next++;
+		indices[i] = static_cast<IndexType>(remap[v]);
+	}
+
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		if (remap[v] == kUnused)
+			remap[v] = next++;
+	}
+
+	auto* bytes = static_cast<std::uint8_t*>(vertices);
+	std::vector<std::uint8_t> copy(bytes, bytes + vertexCount * vertexStride);
+	for (size_t v = 0; v < vertexCount; ++v)
+		std::memcpy(bytes + remap[v] * vertexStride, copy.data() + v * vertexStride, vertexStride);
+}
+
+template<typename IndexType>
+MeshOptimizer::Report MeshOptimizer::Optimize(void* vertices, size_t vertexCount, size_t vertexStride, size_t positionOffset,
+	IndexType* indices, size_t indexCount, const Options& options)
+{
+	Report report;
+	report.Before = AnalyzeVertexCache(indices, indexCount, vertexCount, options.CacheSize);
+
+	OptimizeVertexCache(indices, indexCount, vertexCount);
+
+	if (options.OptimizeOverdraw)
+	{
+		OptimizeOverdraw(indices, indexCount, vertices, vertexCount, vertexStride, positionOffset,
+			options.CacheSize, options.OverdrawThreshold);
+	}
+
+	// Vertex renumbering changes nothing about cache hits, so it goes last.
+	if (options.OptimizeVertexFetch)
+		OptimizeVertexFetch(vertices, vertexCount, vertexStride, indices, indexCount);
+
+	report.After = AnalyzeVertexCache(indices, indexCount, vertexCount, options.CacheSize);
+	return report;
+}
+
+MeshOptimizer::Report MeshOptimizer::Optimize(GeometryGenerator::MeshData& meshData, const Options& options)
+{
+	return Optimize(meshData.Vertices.data(), meshData.Vertices.size(), sizeof(GeometryGenerator::Vertex),
+		offsetof(GeometryGenerator::Vertex, Position),
+		meshData.Indices32.data(), meshData.Indices32.size(), options);
+}
+
+template MeshOptimizer::CacheStats MeshOptimizer::AnalyzeVertexCache<std::uint16_t>(const std::uint16_t*, size_t, size_t, uint32);
+template MeshOptimizer::CacheStats MeshOptimizer::AnalyzeVertexCache<std::uint32_t>(const std::uint32_t*, size_t, size_t, uint32);
+template void MeshOptimizer::OptimizeVertexCache<std::uint16_t>(std::uint16_t*, size_t, size_t);
+template void MeshOptimizer::OptimizeVertexCache<std::uint32_t>(std::uint32_t*, size_t, size_t);
+template void MeshOptimizer::OptimizeOverdraw<std::uint16_t>(std::uint16_t*, size_t, const void*, size_t, size_t, size_t, uint32, float);
+template void MeshOptimizer::OptimizeOverdraw<std::uint32_t>(std::uint32_t*, size_t, const void*, size_t, size_t, size_t, uint32, float);
+template void MeshOptimizer::OptimizeVertexFetch<std::uint16_t>(void*, size_t, size_t, std::uint16_t*, size_t);
+template void MeshOptimizer::OptimizeVertexFetch<std::uint32_t>(void*, size_t, size_t, std::uint32_t*, size_t);
+template MeshOptimizer::Report MeshOptimizer::Optimize<std::uint16_t>(void*, size_t, size_t, size_t, std::uint16_t*, size_t, const Options&);
+template MeshOptimizer::Report MeshOptimizer::Optimize<std::uint32_t>(void*, size_t, size_t, size_t, std::uint32_t*, size_t, const Options&);
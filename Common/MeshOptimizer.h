@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "GeometryGenerator.h"
+
+// Reorders the indices (and optionally vertices) of a triangle list so the GPU
+// gets more reuse out of its post-transform vertex cache and its vertex fetch.
+// Run it on a mesh before upload; it does not change what is drawn, only the
+// order it is drawn in.
+//
+// The low-level functions work in place on raw index and vertex buffers with
+// 16- or 32-bit indices so they can run directly on a packed CPU copy.
+// Optimize() runs the whole pass on a MeshData.
+class MeshOptimizer
+{
+public:
+	using uint32 = std::uint32_t;
+
+	// Post-transform cache statistics for an index buffer, from a simulated
+	// FIFO cache.
+	struct CacheStats
+	{
+		// Average cache miss ratio: vertex shader invocations per triangle.
+		// 3.0 is the worst case; around 0.5-0.7 is good for regular meshes.
+		float Acmr = 0.0f;
+		// Average transformed vertex ratio: vertex shader invocations per
+		// referenced vertex.  1.0 is optimal.
+		float Atvr = 0.0f;
+	};
+
+	struct Options
+	{
+		// Size of the simulated FIFO cache for the statistics and the overdraw
+		// clustering.
+		uint32 CacheSize = 16;
+		// Cluster the cache-optimized triangles and sort the clusters front to
+		// back from the outside, trading a little cache efficiency for overdraw.
+		bool OptimizeOverdraw = false;
+		// Allowed ACMR growth of a cluster when splitting for overdraw.
+		float OverdrawThreshold = 1.05f;
+		// Renumber the vertices in the order they are first referenced.
+		bool OptimizeVertexFetch = true;
+	};
+
+	struct Report
+	{
+		CacheStats Before;
+		CacheStats After;
+	};
+
+	template<typename IndexType>
+	static CacheStats AnalyzeVertexCache(const IndexType* indices, size_t indexCount, size_t vertexCount, uint32 cacheSize);
+
+	// Forsyth's linear-speed vertex cache optimization.
+	template<typename IndexType>
+	static void OptimizeVertexCache(IndexType* indices, size_t indexCount, size_t vertexCount);
+
+	// Splits the triangle order into clusters at cache flush points and sorts
+	// the clusters so outward-facing ones are drawn first (Sander et al.,
+	// "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw").
+	// Positions are read as three floats at positionOffset in each vertex.
+	template<typename IndexType>
+	static void OptimizeOverdraw(IndexType* indices, size_t indexCount,
+		const void* vertices, size_t vertexCount, size_t vertexStride, size_t positionOffset,
+		uint32 cacheSize, float threshold);
+
+	// Renumbers vertices by first use and remaps the indices.  Vertices that
+	// are never referenced are kept, after the referenced ones.
+	template<typename IndexType>
+	static void OptimizeVertexFetch(void* vertices, size_t vertexCount, size_t vertexStride,
+		IndexType* indices, size_t indexCount);
+
+	// Runs the whole pass on one mesh in a raw buffer.
+	template<typename IndexType>
+	static Report Optimize(void* vertices, size_t vertexCount, size_t vertexStride, size_t positionOffset,
+		IndexType* indices, size_t indexCount, const Options& options);
+
+	static Report Optimize(GeometryGenerator::MeshData& meshData, const Options& options);
+};
@@ -0,0 +1,404 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	using uint32 = std::uint32_t;
+
+	// Sum of squared distances to a set of planes, weighted by triangle area:
+	//   Q(p) = p^T A p + 2 b.p + c
+	struct Quadric
+	{
+		double A00 = 0.0, A01 = 0.0, A02 = 0.0, A11 = 0.0, A12 = 0.0, A22 = 0.0;
+		double B0 = 0.0, B1 = 0.0, B2 = 0.0;
+		double C = 0.0;
+		double Weight = 0.0;
+
+		void AddPlane(double nx, double ny, double nz, double d, double w)
+		{
+			A00 += w * nx * nx; A01 += w * nx * ny; A02 += w * nx * nz;
+			A11 += w * ny * ny; A12 += w * ny * nz;
+			A22 += w * nz * nz;
+			B0 += w * nx * d; B1 += w * ny * d; B2 += w * nz * d;
+			C += w * d * d;
+			Weight += w;
+		}
+
+		void Add(const Quadric& q)
+		{
+			A00 += q.A00; A01 += q.A01; A02 += q.A02;
+			A11 += q.A11; A12 += q.A12;
+			A22 += q.A22;
+			B0 += q.B0; B1 += q.B1; B2 += q.B2;
+			C += q.C;
+			Weight += q.Weight;
+		}
+	};
+
+	// Mean squared distance from p to the planes of q1 + q2.
+	double EvaluateSum(const Quadric& q1, const Quadric& q2, const XMFLOAT3& p)
+	{
+		double x = p.x, y = p.y, z = p.z;
+		double a00 = q1.A00 + q2.A00, a01 = q1.A01 + q2.A01, a02 = q1.A02 + q2.A02;
+		double a11 = q1.A11 + q2.A11, a12 = q1.A12 + q2.A12, a22 = q1.A22 + q2.A22;
+
+		double result =
+			x * (a00 * x + 2.0 * (a01 * y + a02 * z)) +
+			y * (a11 * y + 2.0 * a12 * z) +
+			z * a22 * z +
+			2.0 * (x * (q1.B0 + q2.B0) + y * (q1.B1 + q2.B1) + z * (q1.B2 + q2.B2)) +
+			q1.C + q2.C;
+
+		double weight = q1.Weight + q2.Weight;
+		// Rounding can take a zero error slightly negative.
+		return weight > 0.0 ? std::max(result / weight, 0.0) : 0.0;
+	}
+
+	XMVECTOR TriangleNormal(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2)
+	{
+		XMVECTOR v0 = XMLoadFloat3(&p0);
+		return XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&p1), v0), XMVectorSubtract(XMLoadFloat3(&p2), v0));
+	}
+
+	struct Collapse
+	{
+		double Cost;
+		uint32 From;
+		uint32 To;
+	};
+
+	// Works on a 32-bit copy of the indices and collapses in passes: every pass
+	// sorts the candidate edges by cost and collapses the cheapest ones whose
+	// vertices have not been touched yet in the pass, then rebuilds the index
+	// buffer.  Quadrics carry over between passes and between levels, so the
+	// error is always measured against the original surface.
+	class QuadricSimplifier
+	{
+	public:
+		QuadricSimplifier(std::vector<uint32>&& indices, const void* vertices, size_t vertexCount,
+			size_t vertexStride, size_t positionOffset) :
+			mIndices(std::move(indices)),
+			mPositions(vertexCount),
+			mQuadrics(vertexCount),
+			mLocked(vertexCount, false),
+			mCollapseTarget(vertexCount),
+			mTouched(vertexCount, false)
+		{
+			const auto* bytes = static_cast<const std::uint8_t*>(vertices);
+			for (size_t i = 0; i < vertexCount; ++i)
+				mPositions[i] = *reinterpret_cast<const XMFLOAT3*>(bytes + i * vertexStride + positionOffset);
+
+			XMFLOAT3 minPos(+FLT_MAX, +FLT_MAX, +FLT_MAX);
+			XMFLOAT3 maxPos(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+			for (uint32 v : mIndices)
+			{
+				const XMFLOAT3& p = mPositions[v];
+				minPos = XMFLOAT3(std::min(minPos.x, p.x), std::min(minPos.y, p.y), std::min(minPos.z, p.z));
+				maxPos = XMFLOAT3(std::max(maxPos.x, p.x), std::max(maxPos.y, p.y), std::max(maxPos.z, p.z));
+			}
+			mExtent = mIndices.empty() ? 0.0f :
+				std::max(std::max(maxPos.x - minPos.x, maxPos.y - minPos.y), maxPos.z - minPos.z);
+
+			BuildAdjacency();
+			BuildQuadrics();
+			LockBorders();
+		}
+
+		float Extent() const { return mExtent; }
+		float Error() const { return static_cast<float>(std::sqrt(mMaxCost)); }
+		const std::vector<uint32>& Indices() const { return mIndices; }
+
+		// Collapses until at most targetIndexCount indices remain or no
+		// collapse within maxError is left.
+		void Run(size_t targetIndexCount, float maxError)
+		{
+			const double maxCost = static_cast<double>(maxError) * maxError;
+			while (mIndices.size() > targetIndexCount)
+			{
+				if (!Pass(targetIndexCount / 3, maxCost))
+					break;
+			}
+		}
+
+	private:
+		void BuildAdjacency()
+		{
+			const size_t vertexCount = mPositions.size();
+			mAdjacencyOffsets.assign(vertexCount + 1, 0);
+			for (uint32 v : mIndices)
+				mAdjacencyOffsets[v + 1]++;
+			for (size_t v = 0; v < vertexCount; ++v)
+				mAdjacencyOffsets[v + 1] += mAdjacencyOffsets[v];
+
+			mAdjacency.resize(mIndices.size());
+			mFill.assign(mAdjacencyOffsets.begin(), mAdjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < mIndices.size(); ++i)
+				mAdjacency[mFill[mIndices[i]]++] = static_cast<uint32>(i / 3);
+		}
+
+		void BuildQuadrics()
+		{
+			for (size_t t = 0; t < mIndices.size(); t += 3)
+			{
+				const XMFLOAT3& p0 = mPositions[mIndices[t + 0]];
+				XMVECTOR n = TriangleNormal(p0, mPositions[mIndices[t + 1]], mPositions[mIndices[t + 2]]);
+				float length = XMVectorGetX(XMVector3Length(n));
+				if (length <= 0.0f)
+					continue;
+
+				XMFLOAT3 unit;
+				XMStoreFloat3(&unit, XMVectorScale(n, 1.0f / length));
+				double d = -(unit.x * (double)p0.x + unit.y * (double)p0.y + unit.z * (double)p0.z);
+
+				// The cross product length is twice the triangle area.
+				Quadric q;
+				q.AddPlane(unit.x, unit.y, unit.z, d, 0.5 * length);
+				for (uint32 k = 0; k < 3; ++k)
+					mQuadrics[mIndices[t + k]].Add(q);
+			}
+		}
+
+		// An edge a->b without a matching b->a is on an open border, or on a
+		// seam where the generator split the vertices.  Collapsing either end
+		// would move the outline or tear the seam.
+		void LockBorders()
+		{
+			for (size_t t = 0; t < mIndices.size(); t += 3)
+			{
+				for (uint32 k = 0; k < 3; ++k)
+				{
+					uint32 a = mIndices[t + k];
+					uint32 b = mIndices[t + (k + 1) % 3];
+					if (!HasDirectedEdge(b, a))
+					{
+						mLocked[a] = true;
+						mLocked[b] = true;
+					}
+				}
+			}
+		}
+
+		bool HasDirectedEdge(uint32 a, uint32 b) const
+		{
+			for (uint32 i = mAdjacencyOffsets[a]; i < mAdjacencyOffsets[a + 1]; ++i)
+			{
+				const uint32* tri = &mIndices[mAdjacency[i] * 3];
+				for (uint32 k = 0; k < 3; ++k)
+				{
+					if (tri[k] == a && tri[(k + 1) % 3] == b)
+						return true;
+				}
+			}
+			return false;
+		}
+
+		// Checks that moving from onto to does not fold any of from's
+		// triangles over, and counts how many triangles the collapse removes.
+		// Returns false if the collapse is rejected.
+		bool CheckCollapse(uint32 from, uint32 to, uint32& removedTris) const
+		{
+			removedTris = 0;
+			for (uint32 i = mAdjacencyOffsets[from]; i < mAdjacencyOffsets[from + 1]; ++i)
+			{
+				const uint32* tri = &mIndices[mAdjacency[i] * 3];
+				uint32 v[3] = { mCollapseTarget[tri[0]], mCollapseTarget[tri[1]], mCollapseTarget[tri[2]] };
+
+				// Already removed by an earlier collapse in this pass.
+				if (v[0] == v[1] || v[1] == v[2] || v[2] == v[0])
+					continue;
+
+				if (v[0] == to || v[1] == to || v[2] == to)
+				{
+					removedTris++;
+					continue;
+				}
+
+				XMVECTOR before = TriangleNormal(mPositions[v[0]], mPositions[v[1]], mPositions[v[2]]);
+				for (uint32 k = 0; k < 3; ++k)
+				{
+					if (v[k] == from)
+						v[k] = to;
+				}
+				XMVECTOR after = TriangleNormal(mPositions[v[0]], mPositions[v[1]], mPositions[v[2]]);
+
+				// Reject flips and triangles that become (nearly) degenerate.
+				float dot = XMVectorGetX(XMVector3Dot(XMVector3Normalize(before), XMVector3Normalize(after)));
+				if (!(dot > 1e-2f))
+					return false;
+			}
+			return true;
+		}
+
+		bool Pass(size_t targetTriCount, double maxCost)
+		{
+			const uint32 vertexCount = static_cast<uint32>(mPositions.size());
+
+			// Each interior edge shows up once per direction; take it from the
+			// triangle where it runs from the lower to the higher index.
+			mCandidates.clear();
+			for (size_t t = 0; t < mIndices.size(); t += 3)
+			{
+				for (uint32 k = 0; k < 3; ++k)
+				{
+					uint32 a = mIndices[t + k];
+					uint32 b = mIndices[t + (k + 1) % 3];
+					if (a > b || (mLocked[a] && mLocked[b]))
+						continue;
+
+					double costAB = mLocked[a] ? DBL_MAX : EvaluateSum(mQuadrics[a], mQuadrics[b], mPositions[b]);
+					double costBA = mLocked[b] ? DBL_MAX : EvaluateSum(mQuadrics[a], mQuadrics[b], mPositions[a]);
+					if (costAB <= costBA)
+						mCandidates.push_back({ costAB, a, b });
+					else
+						mCandidates.push_back({ costBA, b, a });
+				}
+			}
+
+			std::sort(mCandidates.begin(), mCandidates.end(),
+				[](const Collapse& x, const Collapse& y) { return x.Cost < y.Cost; });
+
+			for (uint32 v = 0; v < vertexCount; ++v)
+				mCollapseTarget[v] = v;
+			std::fill(mTouched.begin(), mTouched.end(), false);
+
+			size_t triCount = mIndices.size() / 3;
+			size_t collapses = 0;
+			for (const Collapse& c : mCandidates)
+			{
+				if (triCount <= targetTriCount || c.Cost > maxCost)
+					break;
+
+				if (mTouched[c.From] || mTouched[c.To])
+					continue;
+
+				uint32 removedTris = 0;
+				if (!CheckCollapse(c.From, c.To, removedTris))
+					continue;
+
+				mCollapseTarget[c.From] = c.To;
+				mQuadrics[c.To].Add(mQuadrics[c.From]);
+				mTouched[c.From] = true;
+				mTouched[c.To] = true;
+				mMaxCost = std::max(mMaxCost, c.Cost);
+				triCount -= removedTris;
+				collapses++;
+			}
+
+			if (collapses == 0)
+				return false;
+
+			// Rebuild the index buffer without the collapsed triangles.
+			size_t write = 0;
+			for (size_t t = 0; t < mIndices.size(); t += 3)
+			{
+				uint32 a = mCollapseTarget[mIndices[t + 0]];
+				uint32 b = mCollapseTarget[mIndices[t + 1]];
+				uint32 c = mCollapseTarget[mIndices[t + 2]];
+				if (a == b || b == c || c == a)
+					continue;
+
+				mIndices[write++] = a;
+				mIndices[write++] = b;
+				mIndices[write++] = c;
+			}
+			mIndices.resize(write);
+
+			BuildAdjacency();
+			return true;
+		}
+
+		std::vector<uint32> mIndices;
+		std::vector<XMFLOAT3> mPositions;
+		std::vector<Quadric> mQuadrics;
+		std::vector<bool> mLocked;
+		float mExtent = 0.0f;
+		double mMaxCost = 0.0;
+
+		std::vector<uint32> mAdjacencyOffsets;
+		std::vector<uint32> mAdjacency;
+		std::vector<uint32> mFill;
+		std::vector<Collapse> mCandidates;
+		std::vector<uint32> mCollapseTarget;
+		std::vector<bool> mTouched;
+	};
+}
+
+template<typename IndexType>
+size_t MeshSimplifier::Simplify(IndexType* destination, const IndexType* indices, size_t indexCount,
+	const void* vertices, size_t vertexCount, size_t vertexStride, size_t positionOffset,
+	size_t targetIndexCount, float targetError, float* resultError)
+{
+	assert(indexCount % 3 == 0);
+
+	QuadricSimplifier simplifier(std::vector<uint32>(indices, indices + indexCount),
+		vertices, vertexCount, vertexStride, positionOffset);
+	simplifier.Run(targetIndexCount, targetError * simplifier.Extent());
+
+	const std::vector<uint32>& result = simplifier.Indices();
+	std::copy(result.begin(), result.end(), destination);
+
+	if (resultError)
+		*resultError = simplifier.Error();
+	return result.size();
+}
+
+template<typename IndexType>
+std::vector<MeshSimplifier::Level> MeshSimplifier::BuildLodChain(const IndexType* indices, size_t indexCount,
+	const void* vertices, size_t vertexCount, size_t vertexStride, size_t positionOffset,
+	const Options& options, std::vector<IndexType>& lodIndices)
+{
+	assert(indexCount % 3 == 0);
+
+	std::vector<Level> levels;
+	const size_t baseIndex = lodIndices.size();
+
+	QuadricSimplifier simplifier(std::vector<uint32>(indices, indices + indexCount),
+		vertices, vertexCount, vertexStride, positionOffset);
+	const float maxError = options.MaxError * simplifier.Extent();
+
+	size_t previousCount = indexCount;
+	for (uint32 level = 1; level < options.LevelCount; ++level)
+	{
+		size_t target = static_cast<size_t>(previousCount / 3 * options.TriangleRatio) * 3;
+		simplifier.Run(target, maxError);
+
+		// A level that barely shrank is not worth a draw call of its own;
+		// the error limit has been reached.
+		const std::vector<uint32>& result = simplifier.Indices();
+		if (result.empty() || result.size() * 20 > previousCount * 19)
+			break;
+
+		Level lod;
+		lod.StartIndex = static_cast<uint32>(lodIndices.size() - baseIndex);
+		lod.IndexCount = static_cast<uint32>(result.size());
+		lod.Error = simplifier.Error();
+		levels.push_back(lod);
+
+		lodIndices.insert(lodIndices.end(), result.begin(), result.end());
+		previousCount = result.size();
+	}
+
+	return levels;
+}
+
+std::vector<MeshSimplifier::Level> MeshSimplifier::BuildLodChain(const GeometryGenerator::MeshData& meshData,
+	const Options& options, std::vector<uint32>& lodIndices)
+{
+	return BuildLodChain(meshData.Indices32.data(), meshData.Indices32.size(),
+		meshData.Vertices.data(), meshData.Vertices.size(), sizeof(GeometryGenerator::Vertex),
+		offsetof(GeometryGenerator::Vertex, Position), options, lodIndices);
+}
+
+template size_t MeshSimplifier::Simplify<std::uint16_t>(std::uint16_t*, const std::uint16_t*, size_t,
+	const void*, size_t, size_t, size_t, size_t, float, float*);
+template size_t MeshSimplifier::Simplify<std::uint32_t>(std::uint32_t*, const std::uint32_t*, size_t,
+	const void*, size_t, size_t, size_t, size_t, float, float*);
+template std::vector<MeshSimplifier::Level> MeshSimplifier::BuildLodChain<std::uint16_t>(const std::uint16_t*, size_t,
+	const void*, size_t, size_t, size_t, const Options&, std::vector<std::uint16_t>&);
+template std::vector<MeshSimplifier::Level> MeshSimplifier::BuildLodChain<std::uint32_t>(const std::uint32_t*, size_t,
+	const void*, size_t, size_t, size_t, const Options&, std::vector<std::uint32_t>&);
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "GeometryGenerator.h"
+
+// Reduces the triangle count of a mesh by quadric error edge collapse
+// (Garland and Heckbert, "Surface Simplification Using Quadric Error
+// Metrics").  Vertices are only ever collapsed onto other existing vertices,
+// so a simplified level is just a new index buffer over the original vertex
+// buffer and every level of a LOD chain can share one set of vertices.
+//
+// Vertices on open borders and attribute seams (where the generator
+// duplicates a position with different normals or texture coordinates) are
+// locked, which keeps the silhouette of open meshes and stops seams from
+// tearing.
+class MeshSimplifier
+{
+public:
+	using uint32 = std::uint32_t;
+
+	struct Options
+	{
+		// Number of levels in the chain, counting the full detail mesh.
+		uint32 LevelCount = 4;
+		// Triangle count of each level relative to the previous one.
+		float TriangleRatio = 0.5f;
+		// Largest allowed error relative to the mesh extent.  The chain ends
+		// early once a level can no longer be reduced within it.
+		float MaxError = 0.05f;
+	};
+
+	struct Level
+	{
+		uint32 StartIndex = 0;
+		uint32 IndexCount = 0;
+		// Object space distance the simplified surface may be off by.
+		float Error = 0.0f;
+	};
+
+	// Simplifies until at most targetIndexCount indices are left or the next
+	// collapse would exceed targetError (relative to the mesh extent).
+	// destination must hold indexCount indices; returns the number written.
+	// resultError receives the object space error of the result.
+	template<typename IndexType>
+	static size_t Simplify(IndexType* destination, const IndexType* indices, size_t indexCount,
+		const void* vertices, size_t vertexCount, size_t vertexStride, size_t positionOffset,
+		size_t targetIndexCount, float targetError, float* resultError = nullptr);
+
+	// Builds levels 1..LevelCount-1 of a LOD chain in one progressive run and
+	// appends their indices to lodIndices.  Level::StartIndex is relative to
+	// where lodIndices ended on entry; level 0 is the input itself and is not
+	// returned.
+	template<typename IndexType>
+	static std::vector<Level> BuildLodChain(const IndexType* indices, size_t indexCount,
+		const void* vertices, size_t vertexCount, size_t vertexStride, size_t positionOffset,
+		const Options& options, std::vector<IndexType>& lodIndices);
+
+	static std::vector<Level> BuildLodChain(const GeometryGenerator::MeshData& meshData,
+		const Options& options, std::vector<uint32>& lodIndices);
+};
@@ -0,0 +1,309 @@
+#include "MeshletBuilder.h"
+#include "MathHelper.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	using uint32 = std::uint32_t;
+
+	const uint32 kNotInMeshlet = UINT32_MAX;
+
+	// Builds the bounding sphere and normal cone of one meshlet from its
+	// positions (in meshlet vertex order) and its triangles' unit normals.
+	MeshletBounds ComputeBounds(const std::vector<XMFLOAT3>& positions,
+		const std::vector<XMFLOAT3>& triCorners, const std::vector<XMFLOAT3>& triNormals)
+	{
+		MeshletBounds bounds;
+		BoundingSphere sphere = MathHelper::ComputeBoundingSphere(positions.data(), positions.size(), sizeof(XMFLOAT3));
+		bounds.Center = sphere.Center;
+		bounds.Radius = sphere.Radius;
+
+		XMVECTOR axis = XMVectorZero();
+		for (const XMFLOAT3& n : triNormals)
+			axis = XMVectorAdd(axis, XMLoadFloat3(&n));
+
+		float axisLength = XMVectorGetX(XMVector3Length(axis));
+		if (axisLength < 1e-6f)
+			return bounds;
+		axis = XMVectorScale(axis, 1.0f / axisLength);
+		XMStoreFloat3(&bounds.ConeAxis, axis);
+
+		float minDot = 1.0f;
+		for (const XMFLOAT3& n : triNormals)
+			minDot = (std::min)(minDot, XMVectorGetX(XMVector3Dot(axis, XMLoadFloat3(&n))));
+
+		// Past about 84 degrees of spread the cone rejects so little that the
+		// test is not worth doing.
+		if (minDot <= 0.1f)
+			return bounds;
+
+		// Move the apex back along the axis until it is behind every triangle
+		// plane, so the test stays conservative for eyes near the cluster.
+		XMVECTOR center = XMLoadFloat3(&bounds.Center);
+		float maxT = 0.0f;
+		for (size_t i = 0; i < triNormals.size(); ++i)
+		{
+			XMVECTOR n = XMLoadFloat3(&triNormals[i]);
+			float dc = XMVectorGetX(XMVector3Dot(XMVectorSubtract(center, XMLoadFloat3(&triCorners[i])), n));
+			float dn = XMVectorGetX(XMVector3Dot(axis, n));
+			maxT = (std::max)(maxT, dc / dn);
+		}
+
+		XMStoreFloat3(&bounds.ConeApex, XMVectorSubtract(center, XMVectorScale(axis, maxT)));
+		bounds.ConeCutoff = std::sqrt(1.0f - minDot * minDot);
+		return bounds;
+	}
+}
+
+template<typename IndexType>
+MeshletBuilder::uint32 MeshletBuilder::Build(const IndexType* indices, size_t indexCount,
+	const void* vertices, size_t vertexCount, size_t vertexStride, size_t positionOffset,
+	const Options& options, MeshletData& result)
+{
+	assert(indexCount % 3 == 0);
+	assert(options.MaxVertices >= 3 && options.MaxVertices <= 256);
+	assert(options.MaxTriangles >= 1);
+
+	const uint32 triCount = static_cast<uint32>(indexCount / 3);
+	const auto* bytes = static_cast<const std::uint8_t*>(vertices);
+	auto positionOf = [&](uint32 v) -> const XMFLOAT3&
+	{
+		return *reinterpret_cast<const XMFLOAT3*>(bytes + v * vertexStride + positionOffset);
+	};
+
+	// Vertex to triangle adjacency, as offsets into one flat array.
+	std::vector<uint32> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < indexCount; ++i)
+		adjacencyOffsets[indices[i] + 1]++;
+	for (size_t v = 0; v < vertexCount; ++v)
+		adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+
+	std::vector<uint32> adjacency(indexCount);
+	{
+		std::vector<uint32> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < indexCount; ++i)
+			adjacency[fill[indices[i]]++] = static_cast<uint32>(i / 3);
+	}
+
+	std::vector<XMFLOAT3> normals(triCount);
+	for (uint32 t = 0; t < triCount; ++t)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&positionOf(indices[t * 3 + 0]));
+		XMVECTOR p1 = XMLoadFloat3(&positionOf(indices[t * 3 + 1]));
+		XMVECTOR p2 = XMLoadFloat3(&positionOf(indices[t * 3 + 2]));
+		XMVECTOR n = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+		XMStoreFloat3(&normals[t], XMVector3Normalize(n));
+	}
+
+	std::vector<bool> emitted(triCount, false);
+	std::vector<uint32> local(vertexCount, kNotInMeshlet);
+
+	std::vector<uint32> meshletVertices;
+	std::vector<uint32> meshletTris;
+	std::vector<XMFLOAT3> meshletPositions;
+	std::vector<XMFLOAT3> meshletCorners;
+	std::vector<XMFLOAT3> meshletNormals;
+	XMVECTOR normalSum = XMVectorZero();
+	uint32 added = 0;
+
+	auto flush = [&]()
+	{
+		Meshlet meshlet;
+		meshlet.VertexOffset = static_cast<uint32>(result.VertexIndices.size());
+		meshlet.TriangleOffset = static_cast<uint32>(result.PrimitiveIndices.size());
+		meshlet.VertexCount = static_cast<uint32>(meshletVertices.size());
+		meshlet.TriangleCount = static_cast<uint32>(meshletTris.size());
+
+		meshletPositions.clear();
+		for (uint32 v : meshletVertices)
+			meshletPositions.push_back(positionOf(v));
+
+		meshletCorners.clear();
+		meshletNormals.clear();
+		for (uint32 t : meshletTris)
+		{
+			uint32 i0 = local[indices[t * 3 + 0]];
+			uint32 i1 = local[indices[t * 3 + 1]];
+			uint32 i2 = local[indices[t * 3 + 2]];
+			result.PrimitiveIndices.push_back(i0 | (i1 << 8) | (i2 << 16));
+
+			meshletCorners.push_back(positionOf(indices[t * 3]));
+			meshletNormals.push_back(normals[t]);
+		}
+
+		result.VertexIndices.insert(result.VertexIndices.end(), meshletVertices.begin(), meshletVertices.end());
+		result.Meshlets.push_back(meshlet);
+		result.Bounds.push_back(ComputeBounds(meshletPositions, meshletCorners, meshletNormals));
+		added++;
+
+		for (uint32 v : meshletVertices)
+			local[v] = kNotInMeshlet;
+		meshletVertices.clear();
+		meshletTris.clear();
+		normalSum = XMVectorZero();
+	};
+
+	auto newVertexCount = [&](uint32 t)
+	{
+		uint32 a = indices[t * 3 + 0];
+		uint32 b = indices[t * 3 + 1];
+		uint32 c = indices[t * 3 + 2];
+		return (local[a] == kNotInMeshlet ? 1u : 0u) +
+			(local[b] == kNotInMeshlet && b != a ? 1u : 0u) +
+			(local[c] == kNotInMeshlet && c != a && c != b ? 1u : 0u);
+	};
+
+	uint32 cursor = 0;
+	for (uint32 emittedCount = 0; emittedCount < triCount; )
+	{
+		// Grow from the triangles around the meshlet's vertices, preferring
+		// the fewest new vertices and then normals close to the meshlet's so
+		// the cone stays narrow.
+		uint32 best = UINT32_MAX;
+		uint32 bestNew = 4;
+		float bestDot = -2.0f;
+		XMVECTOR axis = XMVector3Normalize(normalSum);
+		for (uint32 v : meshletVertices)
+		{
+			for (uint32 a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; ++a)
+			{
+				uint32 t = adjacency[a];
+				if (emitted[t])
+					continue;
+
+				uint32 extra = newVertexCount(t);
+				if (meshletVertices.size() + extra > options.MaxVertices || extra > bestNew)
+					continue;
+
+				float dot = XMVectorGetX(XMVector3Dot(axis, XMLoadFloat3(&normals[t])));
+				if (extra < bestNew || dot > bestDot)
+				{
+					best = t;
+					bestNew = extra;
+					bestDot = dot;
+				}
+			}
+		}
+
+		if (best == UINT32_MAX)
+		{
+			if (!meshletTris.empty())
+			{
+				flush();
+				continue;
+			}
+
+			// Start a new meshlet at the next triangle in index order.
+			while (emitted[cursor])
+				++cursor;
+			best = cursor;
+		}
+
+		for (uint32 k = 0; k < 3; ++k)
+		{
+			uint32 v = indices[best * 3 + k];
+			if (local[v] == kNotInMeshlet)
+			{
+				local[v] = static_cast<uint32>(meshletVertices.size());
+				meshletVertices.push_back(v);
+			}
+		}
+		meshletTris.push_back(best);
+		emitted[best] = true;
+		emittedCount++;
+		normalSum = XMVectorAdd(normalSum, XMLoadFloat3(&normals[best]));
+
+		if (meshletTris.size() == options.MaxTriangles)
+			flush();
+	}
+
+	if (!meshletTris.empty())
+		flush();
+
+	return added;
+}
+
+MeshletBuilder::uint32 MeshletBuilder::Build(const GeometryGenerator::MeshData& meshData, const Options& options, MeshletData& result)
+{
+	return Build(meshData.Indices32.data(), meshData.Indices32.size(),
+		meshData.Vertices.data(), meshData.Vertices.size(), sizeof(GeometryGenerator::Vertex),
+		offsetof(GeometryGenerator::Vertex, Position), options, result);
+}
+
+MeshletBuilder::CullingView MeshletBuilder::MakeCullingView(FXMVECTOR eyePos, CXMMATRIX worldViewProj)
+{
+	// Gribb and Hartmann: with row vectors, the clip space tests -w <= x <= w,
+	// -w <= y <= w and 0 <= z <= w become planes made of the matrix columns.
+	XMMATRIX m = XMMatrixTranspose(worldViewProj);
+	XMVECTOR planes[6] =
+	{
+		XMVectorAdd(m.r[3], m.r[0]),      // left
+		XMVectorSubtract(m.r[3], m.r[0]), // right
+		XMVectorAdd(m.r[3], m.r[1]),      // bottom
+		XMVectorSubtract(m.r[3], m.r[1]), // top
+		m.r[2],                           // near
+		XMVectorSubtract(m.r[3], m.r[2])  // far
+	};
+
+	CullingView view;
+	for (int i = 0; i < 6; ++i)
+	{
+		XMVECTOR length = XMVector3Length(planes[i]);
+		XMStoreFloat4(&view.Planes[i], XMVectorDivide(planes[i], length));
+	}
+	XMStoreFloat3(&view.EyePos, eyePos);
+	return view;
+}
+
+MeshletBuilder::CullStats MeshletBuilder::Cull(const MeshletData& meshlets, uint32 first, uint32 count,
+	const CullingView& view, std::vector<uint32>* visible)
+{
+	CullStats stats;
+	stats.MeshletCount = count;
+
+	XMVECTOR eyePos = XMLoadFloat3(&view.EyePos);
+	for (uint32 i = first; i < first + count; ++i)
+	{
+		const MeshletBounds& bounds = meshlets.Bounds[i];
+		const uint32 triangles = meshlets.Meshlets[i].TriangleCount;
+		stats.TrianglesTotal += triangles;
+
+		XMVECTOR center = XMLoadFloat3(&bounds.Center);
+		bool outside = false;
+		for (int p = 0; p < 6 && !outside; ++p)
+		{
+			XMVECTOR plane = XMLoadFloat4(&view.Planes[p]);
+			outside = XMVectorGetX(XMPlaneDotCoord(plane, center)) < -bounds.Radius;
+		}
+		if (outside)
+		{
+			stats.FrustumCulled++;
+			continue;
+		}
+
+		if (bounds.ConeCutoff <= 1.0f)
+		{
+			XMVECTOR toApex = XMVector3Normalize(XMVectorSubtract(XMLoadFloat3(&bounds.ConeApex), eyePos));
+			if (XMVectorGetX(XMVector3Dot(toApex, XMLoadFloat3(&bounds.ConeAxis))) >= bounds.ConeCutoff)
+			{
+				stats.BackfaceCulled++;
+				continue;
+			}
+		}
+
+		stats.TrianglesVisible += triangles;
+		if (visible)
+			visible->push_back(i);
+	}
+
+	return stats;
+}
+
+template MeshletBuilder::uint32 MeshletBuilder::Build<std::uint16_t>(const std::uint16_t*, size_t,
+	const void*, size_t, size_t, size_t, const Options&, MeshletData&);
+template MeshletBuilder::uint32 MeshletBuilder::Build<std::uint32_t>(const std::uint32_t*, size_t,
+	const void*, size_t, size_t, size_t, const Options&, MeshletData&);
@@ -0,0 +1,97 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "GeometryGenerator.h"
+
+// A small cluster of triangles that can be culled as a unit.  The structs
+// below are laid out for direct upload as structured buffers: every field is
+// 4-byte aligned and the bounds fit three float4s.
+struct Meshlet
+{
+	// Offset into MeshletData::VertexIndices.
+	std::uint32_t VertexOffset = 0;
+	// Offset into MeshletData::PrimitiveIndices.
+	std::uint32_t TriangleOffset = 0;
+	std::uint32_t VertexCount = 0;
+	std::uint32_t TriangleCount = 0;
+};
+
+struct MeshletBounds
+{
+	// Bounding sphere of the cluster.
+	DirectX::XMFLOAT3 Center = { 0.0f, 0.0f, 0.0f };
+	float Radius = 0.0f;
+
+	// Normal cone for backface culling.  The whole cluster faces away from an
+	// eye at e if dot(normalize(ConeApex - e), ConeAxis) >= ConeCutoff.  A
+	// cutoff above 1 means the normals spread too far for the test.
+	DirectX::XMFLOAT3 ConeApex = { 0.0f, 0.0f, 0.0f };
+	float ConeCutoff = 2.0f;
+	DirectX::XMFLOAT3 ConeAxis = { 0.0f, 0.0f, 0.0f };
+	float Pad = 0.0f;
+};
+
+// Meshlets of any number of meshes, stored back to back.
+struct MeshletData
+{
+	std::vector<Meshlet> Meshlets;
+	std::vector<MeshletBounds> Bounds;
+	// Vertex indices of each meshlet, relative to the mesh's first vertex.
+	std::vector<std::uint32_t> VertexIndices;
+	// One triangle per entry: three 8-bit indices into the meshlet's
+	// vertices, packed as i0 | i1 << 8 | i2 << 16.
+	std::vector<std::uint32_t> PrimitiveIndices;
+};
+
+// Partitions a triangle list into meshlets and computes their culling bounds,
+// plus a CPU reference of the culling a mesh or amplification shader would do.
+class MeshletBuilder
+{
+public:
+	using uint32 = std::uint32_t;
+
+	struct Options
+	{
+		// Limits per meshlet; 64 vertices and 124 triangles suit current
+		// mesh shader hardware.  MaxVertices must not exceed 256.
+		uint32 MaxVertices = 64;
+		uint32 MaxTriangles = 124;
+	};
+
+	// Frustum planes and eye position, both in the mesh's object space.
+	// Planes point inwards.
+	struct CullingView
+	{
+		DirectX::XMFLOAT4 Planes[6];
+		DirectX::XMFLOAT3 EyePos;
+	};
+
+	struct CullStats
+	{
+		uint32 MeshletCount = 0;
+		uint32 FrustumCulled = 0;
+		uint32 BackfaceCulled = 0;
+		uint32 TrianglesVisible = 0;
+		uint32 TrianglesTotal = 0;
+	};
+
+	// Appends the meshlets of one mesh to result and returns how many were
+	// added.  Triangles are grown from neighbours in index order, so run the
+	// vertex cache optimizer first for tighter clusters.
+	template<typename IndexType>
+	static uint32 Build(const IndexType* indices, size_t indexCount,
+		const void* vertices, size_t vertexCount, size_t vertexStride, size_t positionOffset,
+		const Options& options, MeshletData& result);
+
+	static uint32 Build(const GeometryGenerator::MeshData& meshData, const Options& options, MeshletData& result);
+
+	// worldViewProj transforms object space to clip space (row vectors, as
+	// everywhere in DirectXMath); eyePos is in object space.
+	static CullingView MakeCullingView(DirectX::FXMVECTOR eyePos, DirectX::CXMMATRIX worldViewProj);
+
+	// Culls meshlets [first, first + count) against the view, appending the
+	// survivors to visible if it is not null.
+	static CullStats Cull(const MeshletData& meshlets, uint32 first, uint32 count,
+		const CullingView& view, std::vector<uint32>* visible = nullptr);
+};
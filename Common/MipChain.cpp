@@ -0,0 +1,393 @@
+#include "MipChain.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h>
+#include <memory>
+#include <new>
+
+using uint32 = std::uint32_t;
+
+namespace
+{
+	// Smaller levels are not worth a thread per few rows.
+	const uint32 kRowsPerThread = 16;
+
+	// Four halves in the low 64 bits of h to floats.  Scaling by 2^112
+	// rebiases the exponent and turns half subnormals into float normals in
+	// one multiply; only infinity and NaN need their exponent patched.
+	__m128 HalfToFloat(__m128i h)
+	{
+		h = _mm_unpacklo_epi16(h, _mm_setzero_si128());
+		__m128i magnitude = _mm_and_si128(h, _mm_set1_epi32(0x7FFF));
+		__m128i sign = _mm_slli_epi32(_mm_xor_si128(h, magnitude), 16);
+		__m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(magnitude, 13)),
+			_mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23)));
+		__m128i infNan = _mm_and_si128(_mm_cmpgt_epi32(magnitude, _mm_set1_epi32(0x7BFF)),
+			_mm_set1_epi32(0xFF << 23));
+		return _mm_or_ps(scaled, _mm_castsi128_ps(_mm_or_si128(infNan, sign)));
+	}
+
+	// Four floats to halves in the low 64 bits of the result, rounding to
+	// nearest even as the GPU does.
+	__m128i FloatToHalf(__m128 f)
+	{
+		__m128 signBit = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+		__m128 absolute = _mm_andnot_ps(signBit, f);
+		__m128i bits = _mm_castps_si128(absolute);
+		__m128i sign = _mm_srli_epi32(_mm_castps_si128(_mm_and_ps(signBit, f)), 16);
+
+		// Below 2^-14 the result is subnormal: adding 0.5 rounds to a multiple
+		// of 2^-24, which is then in the low mantissa bits.
+		__m128i subnormalMagic = _mm_set1_epi32((127 - 15 + 23 - 10 + 1) << 23);
+		__m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absolute, _mm_castsi128_ps(subnormalMagic))),
+			subnormalMagic);
+		// Otherwise rebias the exponent from 127 to 15 and round off 13
+		// mantissa bits; 65520 and up carry into infinity.
+		__m128i odd = _mm_srai_epi32(_mm_slli_epi32(bits, 31 - 13), 31);
+		__m128i normal = _mm_srli_epi32(_mm_sub_epi32(
+			_mm_add_epi32(bits, _mm_set1_epi32(0xFFF - ((127 - 15) << 23))), odd), 13);
+		__m128i isSubnormal = _mm_cmpgt_epi32(_mm_set1_epi32((127 - 14) << 23), bits);
+		__m128i finite = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+
+		// 65536 and up, infinity and NaN, which keeps a mantissa bit.
+		__m128i isRegular = _mm_cmpgt_epi32(_mm_set1_epi32((127 + 16) << 23), bits);
+		__m128i nanBit = _mm_and_si128(_mm_castps_si128(_mm_cmpunord_ps(absolute, absolute)), _mm_set1_epi32(0x200));
+		__m128i special = _mm_or_si128(nanBit, _mm_set1_epi32(0x7C00));
+		__m128i result = _mm_or_si128(_mm_or_si128(_mm_and_si128(isRegular, finite),
+			_mm_andnot_si128(isRegular, special)), sign);
+
+		// Sign-extend so the saturating pack keeps all 16 bits.
+		result = _mm_srai_epi32(_mm_slli_epi32(result, 16), 16);
+		return _mm_packs_epi32(result, result);
+	}
+
+	// Loads and stores one pixel as four float lanes; R32F uses only x.
+	struct Rgba8
+	{
+		static __m128 Load(const std::uint8_t* p)
+		{
+			int packed;
+			std::memcpy(&packed, p, sizeof(packed));
+			__m128i zero = _mm_setzero_si128();
+			__m128i v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+			return _mm_mul_ps(_mm_cvtepi32_ps(v), _mm_set1_ps(1.0f / 255.0f));
+		}
+		static void Store(std::uint8_t* p, __m128 v)
+		{
+			v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+			__m128i i = _mm_cvtps_epi32(_mm_mul_ps(v, _mm_set1_ps(255.0f)));
+			i = _mm_packus_epi16(_mm_packs_epi32(i, i), i);
+			int packed = _mm_cvtsi128_si32(i);
+			std::memcpy(p, &packed, sizeof(packed));
+		}
+		static const uint32 Size = 4;
+	};
+
+	struct Rgba16F
+	{
+		static __m128 Load(const std::uint8_t* p)
+		{
+			return HalfToFloat(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+		}
+		static void Store(std::uint8_t* p, __m128 v)
+		{
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(p), FloatToHalf(v));
+		}
+		static const uint32 Size = 8;
+	};
+
+	struct R32F
+	{
+		static __m128 Load(const std::uint8_t* p)
+		{
+			float f;
+			std::memcpy(&f, p, sizeof(f));
+			return _mm_set_ss(f);
+		}
+		static void Store(std::uint8_t* p, __m128 v)
+		{
+			float f = _mm_cvtss_f32(v);
+			std::memcpy(p, &f, sizeof(f));
+		}
+		static const uint32 Size = 4;
+	};
+
+	struct LevelView
+	{
+		std::uint8_t* Data;
+		uint32 Width;
+		uint32 Height;
+		uint32 RowPitch;
+	};
+
+	template<typename Pixel>
+	void BoxRows(const LevelView& src, const LevelView& dst, uint32 begin, uint32 end)
+	{
+		const __m128 quarter = _mm_set1_ps(0.25f);
+		for (uint32 y = begin; y < end; ++y)
+		{
+			const std::uint8_t* row0 = src.Data + size_t((std::min)(2 * y, src.Height - 1)) * src.RowPitch;
+			const std::uint8_t* row1 = src.Data + size_t((std::min)(2 * y + 1, src.Height - 1)) * src.RowPitch;
+			std::uint8_t* out = dst.Data + size_t(y) * dst.RowPitch;
+			for (uint32 x = 0; x < dst.Width; ++x)
+			{
+				uint32 x0 = (std::min)(2 * x, src.Width - 1) * Pixel::Size;
+				uint32 x1 = (std::min)(2 * x + 1, src.Width - 1) * Pixel::Size;
+				__m128 sum = _mm_add_ps(_mm_add_ps(Pixel::Load(row0 + x0), Pixel::Load(row0 + x1)),
+					_mm_add_ps(Pixel::Load(row1 + x0), Pixel::Load(row1 + x1)));
+				Pixel::Store(out + x * Pixel::Size, _mm_mul_ps(sum, quarter));
+			}
+		}
+	}
+
+	// One channel, so four output texels per vector instead of one.
+	template<>
+	void BoxRows<R32F>(const LevelView& src, const LevelView& dst, uint32 begin, uint32 end)
+	{
+		const __m128 quarter = _mm_set1_ps(0.25f);
+		for (uint32 y = begin; y < end; ++y)
+		{
+			const float* row0 = reinterpret_cast<const float*>(src.Data + size_t((std::min)(2 * y, src.Height - 1)) * src.RowPitch);
+			const float* row1 = reinterpret_cast<const float*>(src.Data + size_t((std::min)(2 * y + 1, src.Height - 1)) * src.RowPitch);
+			float* out = reinterpret_cast<float*>(dst.Data + size_t(y) * dst.RowPitch);
+
+			uint32 x = 0;
+			if (src.Width > 1)
+			{
+				for (; 2 * x + 8 <= src.Width && x + 4 <= dst.Width; x += 4)
+				{
+					__m128 a = _mm_add_ps(_mm_loadu_ps(row0 + 2 * x), _mm_loadu_ps(row1 + 2 * x));
+					__m128 b = _mm_add_ps(_mm_loadu_ps(row0 + 2 * x + 4), _mm_loadu_ps(row1 + 2 * x + 4));
+					// Add the even and odd texels of each pair.
+					__m128 sum = _mm_add_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+					_mm_storeu_ps(out + x, _mm_mul_ps(sum, quarter));
+				}
+			}
+			for (; x < dst.Width; ++x)
+			{
+				uint32 x0 = (std::min)(2 * x, src.Width - 1);
+				uint32 x1 = (std::min)(2 * x + 1, src.Width - 1);
+				out[x] = 0.25f * (row0[x0] + row0[x1] + row1[x0] + row1[x1]);
+			}
+		}
+	}
+
+	// Modified Bessel function of the first kind, order 0.
+	double BesselI0(double x)
+	{
+		double sum = 1.0;
+		double term = 1.0;
+		for (int k = 1; k < 32; ++k)
+		{
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum += term;
+		}
+		return sum;
+	}
+
+	const int kKaiserTaps = 6;
+
+	// Weights of the source texels 2x - 2 .. 2x + 3 for destination texel x:
+	// a sinc low-pass at half the source rate, Kaiser windowed (alpha 4) over
+	// three texels either side of the center, normalized.
+	void KaiserWeights(float weights[kKaiserTaps])
+	{
+		const double pi = 3.14159265358979323846;
+		const double alpha = 4.0;
+		const double radius = kKaiserTaps / 2;
+		double sum = 0.0;
+		double w[kKaiserTaps];
+		for (int k = 0; k < kKaiserTaps; ++k)
+		{
+			double d = k - 2.5;
+			double t = 0.5 * d;
+			double sinc = std::sin(pi * t) / (pi * t);
+			double r = d / radius;
+			w[k] = sinc * BesselI0(alpha * std::sqrt(1.0 - r * r)) / BesselI0(alpha);
+			sum += w[k];
+		}
+		for (int k = 0; k < kKaiserTaps; ++k)
+			weights[k] = static_cast<float>(w[k] / sum);
+	}
+
+	// 16 byte aligned memory from _mm_malloc.  It is held as floats and cast
+	// where used: __m128 as a template argument, as in std::vector<__m128>,
+	// loses the attributes that give it its alignment.
+	struct AlignedFree
+	{
+		void operator()(float* p) const { _mm_free(p); }
+	};
+	using AlignedFloats = std::unique_ptr<float[], AlignedFree>;
+
+	AlignedFloats AllocateVectors(size_t count)
+	{
+		float* p = static_cast<float*>(_mm_malloc(count * sizeof(__m128), 16));
+		if (p == nullptr)
+			throw std::bad_alloc();
+		return AlignedFloats(p);
+	}
+
+	template<typename Pixel>
+	void KaiserRows(const LevelView& src, const LevelView& dst, uint32 begin, uint32 end)
+	{
+		float w[kKaiserTaps];
+		KaiserWeights(w);
+		__m128 weights[kKaiserTaps];
+		for (int k = 0; k < kKaiserTaps; ++k)
+			weights[k] = _mm_set1_ps(w[k]);
+
+		// Horizontally filtered source rows, by source row index (before
+		// clamping) modulo 8.  Consecutive destination rows share four of
+		// their six.
+		const int kSlots = 8;
+		AlignedFloats rowMemory = AllocateVectors(size_t(kSlots) * dst.Width);
+		__m128* rows = reinterpret_cast<__m128*>(rowMemory.get());
+		long long cached[kSlots];
+		std::fill(cached, cached + kSlots, -1000);
+
+		auto filteredRow = [&](long long sy) -> const __m128*
+		{
+			int slot = static_cast<int>(sy & (kSlots - 1));
+			__m128* row = rows + size_t(slot) * dst.Width;
+			if (cached[slot] == sy)
+				return row;
+
+			long long clampedY = (std::min)((std::max)(sy, 0LL), static_cast<long long>(src.Height) - 1);
+			const std::uint8_t* in = src.Data + size_t(clampedY) * src.RowPitch;
+			const long long lastX = static_cast<long long>(src.Width) - 1;
+			for (uint32 x = 0; x < dst.Width; ++x)
+			{
+				long long sx = 2LL * x - 2;
+				__m128 sum = _mm_setzero_ps();
+				if (sx >= 0 && sx + kKaiserTaps - 1 <= lastX)
+				{
+					const std::uint8_t* p = in + size_t(sx) * Pixel::Size;
+					for (int k = 0; k < kKaiserTaps; ++k)
+						sum = _mm_add_ps(sum, _mm_mul_ps(weights[k], Pixel::Load(p + k * Pixel::Size)));
+				}
+				else
+				{
+					for (int k = 0; k < kKaiserTaps; ++k)
+					{
+						long long cx = (std::min)((std::max)(sx + k, 0LL), lastX);
+						sum = _mm_add_ps(sum, _mm_mul_ps(weights[k], Pixel::Load(in + size_t(cx) * Pixel::Size)));
+					}
+				}
+				row[x] = sum;
+			}
+			cached[slot] = sy;
+			return row;
+		};
+
+		for (uint32 y = begin; y < end; ++y)
+		{
+			const __m128* taps[kKaiserTaps];
+			for (int k = 0; k < kKaiserTaps; ++k)
+				taps[k] = filteredRow(2LL * y - 2 + k);
+
+			std::uint8_t* out = dst.Data + size_t(y) * dst.RowPitch;
+			for (uint32 x = 0; x < dst.Width; ++x)
+			{
+				__m128 sum = _mm_setzero_ps();
+				for (int k = 0; k < kKaiserTaps; ++k)
+					sum = _mm_add_ps(sum, _mm_mul_ps(weights[k], taps[k][x]));
+				Pixel::Store(out + x * Pixel::Size, sum);
+			}
+		}
+	}
+
+	template<typename Pixel>
+	void FilterLevel(MipChain::Filter filter, const LevelView& src, const LevelView& dst, uint32 threadCount)
+	{
+		threadCount = (std::min)(threadCount, (std::max)(dst.Height / kRowsPerThread, 1u));
+		ParallelFor(dst.Height, threadCount, [&](uint32 begin, uint32 end)
+		{
+			if (filter == MipChain::Filter::Box)
+				BoxRows<Pixel>(src, dst, begin, end);
+			else
+				KaiserRows<Pixel>(src, dst, begin, end);
+		});
+	}
+}
+
+MipChain::MipChain(Format format, uint32 width, uint32 height, uint32 mipLevels) :
+	mFormat(format)
+{
+	assert(width > 0 && height > 0);
+	uint32 fullCount = FullMipCount(width, height);
+	if (mipLevels == 0 || mipLevels > fullCount)
+		mipLevels = fullCount;
+
+	size_t offset = 0;
+	for (uint32 mip = 0; mip < mipLevels; ++mip)
+	{
+		LevelLayout level;
+		level.Offset = offset;
+		level.Width = (std::max)(width >> mip, 1u);
+		level.Height = (std::max)(height >> mip, 1u);
+		mLevels.push_back(level);
+		// Keep every level 16 byte aligned.
+		offset += (size_t(level.Width) * level.Height * BytesPerPixel(format) + 15) & ~size_t(15);
+	}
+	mPixels.resize(offset);
+}
+
+uint32 MipChain::FullMipCount(uint32 width, uint32 height)
+{
+	uint32 count = 1;
+	for (uint32 size = (std::max)(width, height); size > 1; size >>= 1)
+		++count;
+	return count;
+}
+
+uint32 MipChain::BytesPerPixel(Format format)
+{
+	switch (format)
+	{
+	case Format::RGBA8:
+		return 4;
+	case Format::RGBA16F:
+		return 8;
+	case Format::R32F:
+		return 4;
+	}
+	return 0;
+}
+
+MipChain::Level MipChain::GetLevel(uint32 mip)
+{
+	const LevelLayout& layout = mLevels[mip];
+	Level level;
+	level.Data = mPixels.data() + layout.Offset;
+	level.Width = layout.Width;
+	level.Height = layout.Height;
+	level.RowPitch = layout.Width * BytesPerPixel(mFormat);
+	return level;
+}
+
+void MipChain::Generate(Filter filter, uint32 threadCount)
+{
+	threadCount = ResolveThreadCount(threadCount);
+	for (uint32 mip = 1; mip < MipLevels(); ++mip)
+	{
+		Level src = GetLevel(mip - 1);
+		Level dst = GetLevel(mip);
+		LevelView srcView = { src.Data, src.Width, src.Height, src.RowPitch };
+		LevelView dstView = { dst.Data, dst.Width, dst.Height, dst.RowPitch };
+		switch (mFormat)
+		{
+		case Format::RGBA8:
+			FilterLevel<Rgba8>(filter, srcView, dstView, threadCount);
+			break;
+		case Format::RGBA16F:
+			FilterLevel<Rgba16F>(filter, srcView, dstView, threadCount);
+			break;
+		case Format::R32F:
+			FilterLevel<R32F>(filter, srcView, dstView, threadCount);
+			break;
+		}
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A 2D image and its mip levels, tightly packed one after another, and the
+// CPU filters that make levels 1.. from level 0.  Each level is half the
+// size of the one above, rounded down, to 1x1.
+//
+// The filters work in linear float.  RGBA8 is treated as linear UNORM, so an
+// sRGB image comes out slightly darker than a gamma-correct filter would
+// make it.  Rows are filtered in parallel, four channels at a time with SSE.
+//
+// Pure CPU code with no GPU dependency; TextureUpload uploads the result.
+class MipChain
+{
+public:
+	using uint32 = std::uint32_t;
+
+	enum class Format
+	{
+		RGBA8,
+		RGBA16F,
+		R32F,
+	};
+
+	enum class Filter
+	{
+		// The average of each 2x2 block.  On odd sizes the last row or
+		// column is dropped.
+		Box,
+		// A windowed sinc over 6x6 texels, sharper than Box.  Edges are
+		// clamped; RGBA8 results are clamped to [0, 1].
+		Kaiser,
+	};
+
+	struct Level
+	{
+		std::uint8_t* Data;
+		uint32 Width;
+		uint32 Height;
+		// Bytes from one row to the next; the rows are packed.
+		uint32 RowPitch;
+	};
+
+	// A chain for a width x height image with mipLevels levels, or the full
+	// chain down to 1x1 if mipLevels is 0.  The pixels start zeroed.
+	MipChain(Format format, uint32 width, uint32 height, uint32 mipLevels = 0);
+
+	static uint32 FullMipCount(uint32 width, uint32 height);
+	static uint32 BytesPerPixel(Format format);
+
+	Format PixelFormat() const { return mFormat; }
+	uint32 MipLevels() const { return static_cast<uint32>(mLevels.size()); }
+	Level GetLevel(uint32 mip);
+
+	// Fills levels 1.. from level 0.  threadCount 0 uses every hardware
+	// thread.
+	void Generate(Filter filter, uint32 threadCount = 0);
+
+private:
+	struct LevelLayout
+	{
+		std::size_t Offset;
+		uint32 Width;
+		uint32 Height;
+	};
+
+	Format mFormat;
+	std::vector<LevelLayout> mLevels;
+	std::vector<std::uint8_t> mPixels;
+};
@@ -0,0 +1,139 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// 32-bit FNV-1a hash of a name.  Constructing one from a string literal in a
+// constexpr variable hashes it at compile time:
+//
+//     constexpr NameId kOpaque("opaque");
+struct NameId
+{
+	std::uint32_t Hash = 0;
+
+	constexpr NameId() = default;
+
+	template<std::size_t N>
+	explicit constexpr NameId(const char (&name)[N]) :
+		Hash(HashOf(name, N - 1))
+	{
+	}
+
+	explicit NameId(const std::string& name) :
+		Hash(HashOf(name.data(), name.size()))
+	{
+	}
+
+	static constexpr std::uint32_t HashOf(const char* name, std::size_t length)
+	{
+		std::uint32_t hash = 2166136261u;
+		for (std::size_t i = 0; i < length; ++i)
+		{
+			hash ^= static_cast<unsigned char>(name[i]);
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+};
+
+// A flat array of values that can also be found by name.  Each name is
+// interned once into a dense Handle, the value's index in the array, so code
+// that looks a value up every frame resolves the handle during setup and
+// then just indexes.  Lookups by NameId never touch a string; lookups by
+// std::string hash it first and are meant for setup code.
+//
+// operator[](const std::string&) inserts a default value for a missing name,
+// like std::unordered_map, so existing map-style code keeps working.  Adding
+// a name whose NameId another name already has throws std::invalid_argument.
+// Entries are never removed, so handles stay valid for the registry's life.
+template<typename T>
+class NameRegistry
+{
+public:
+	using Handle = std::uint32_t;
+
+	static const Handle InvalidHandle = 0xffffffff;
+
+	// Stores value under name, replacing any value already there.
+	Handle Add(const std::string& name, T value)
+	{
+		Handle handle = Intern(name);
+		mValues[handle] = std::move(value);
+		return handle;
+	}
+
+	// InvalidHandle if the name was never added.
+	Handle Find(NameId id) const
+	{
+		auto it = mHandles.find(id.Hash);
+		return it == mHandles.end() ? InvalidHandle : it->second;
+	}
+	Handle Find(const std::string& name) const
+	{
+		Handle handle = Find(NameId(name));
+		assert(handle == InvalidHandle || mNames[handle] == name);
+		return handle;
+	}
+
+	bool Contains(const std::string& name) const { return Find(name) != InvalidHandle; }
+
+	T& operator[](Handle handle) { return mValues[handle]; }
+	const T& operator[](Handle handle) const { return mValues[handle]; }
+
+	// The name must have been added.
+	T& operator[](NameId id) { return mValues[Checked(Find(id))]; }
+	const T& operator[](NameId id) const { return mValues[Checked(Find(id))]; }
+
+	T& operator[](const std::string& name) { return mValues[Intern(name)]; }
+
+	const std::string& Name(Handle handle) const { return mNames[handle]; }
+	size_t size() const { return mValues.size(); }
+	bool empty() const { return mValues.empty(); }
+
+	typename std::vector<T>::iterator begin() { return mValues.begin(); }
+	typename std::vector<T>::iterator end() { return mValues.end(); }
+	typename std::vector<T>::const_iterator begin() const { return mValues.begin(); }
+	typename std::vector<T>::const_iterator end() const { return mValues.end(); }
+
+private:
+	Handle Intern(const std::string& name)
+	{
+		NameId id(name);
+		auto it = mHandles.find(id.Hash);
+		if (it != mHandles.end())
+		{
+			// Two names with one hash would make NameId lookups ambiguous,
+			// in release builds too; rename one of them.
+			if (mNames[it->second] != name)
+			{
+				throw std::invalid_argument("NameId hash collision between \"" + mNames[it->second] + "\" and \"" +
+					name + "\"");
+			}
+			return it->second;
+		}
+
+		Handle handle = static_cast<Handle>(mValues.size());
+		mHandles.emplace(id.Hash, handle);
+		mNames.push_back(name);
+		mValues.emplace_back();
+		return handle;
+	}
+
+	static Handle Checked(Handle handle)
+	{
+		assert(handle != InvalidHandle && "name was never added");
+		return handle;
+	}
+
+	std::vector<T> mValues;
+	std::vector<std::string> mNames;
+	std::unordered_map<std::uint32_t, Handle> mHandles;
+};
+
+template<typename T>
+const typename NameRegistry<T>::Handle NameRegistry<T>::InvalidHandle;
@@ -0,0 +1,33 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// Runs fn(begin, end) over [0, count) in threadCount contiguous chunks, the
+// last one on the calling thread, and returns once all are done.
+template<typename Fn>
+void ParallelFor(std::uint32_t count, std::uint32_t threadCount, const Fn& fn)
+{
+	threadCount = (std::max)(threadCount, 1u);
+	std::vector<std::thread> workers;
+	workers.reserve(threadCount - 1);
+	for (std::uint32_t t = 0; t + 1 < threadCount; ++t)
+	{
+		std::uint32_t begin = static_cast<std::uint32_t>(std::uint64_t(count) * t / threadCount);
+		std::uint32_t end = static_cast<std::uint32_t>(std::uint64_t(count) * (t + 1) / threadCount);
+		workers.emplace_back([=, &fn]() { fn(begin, end); });
+	}
+	fn(static_cast<std::uint32_t>(std::uint64_t(count) * (threadCount - 1) / threadCount), count);
+
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+// threadCount, or every hardware thread if it is 0.
+inline std::uint32_t ResolveThreadCount(std::uint32_t threadCount)
+{
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency();
+	return (std::max)(threadCount, 1u);
+}
@@ -0,0 +1,112 @@
+#include "RangeAllocator.h"
+#include <cassert>
+#include <iterator>
+
+const RangeAllocator::uint32 RangeAllocator::InvalidOffset;
+
+RangeAllocator::RangeAllocator(uint32 capacity)
+{
+	Reset(capacity);
+}
+
+RangeAllocator::uint32 RangeAllocator::Allocate(uint32 size)
+{
+	assert(size > 0);
+
+	auto best = mFreeBySize.lower_bound(size);
+	if (best == mFreeBySize.end())
+		return InvalidOffset;
+
+	uint32 offset = best->second;
+	uint32 rangeSize = best->first;
+	EraseFree(mFreeByOffset.find(offset));
+
+	// Keep the tail of the gap free.
+	if (rangeSize > size)
+		InsertFree(offset + size, rangeSize - size);
+
+	mFreeSize -= size;
+	return offset;
+}
+
+void RangeAllocator::Free(uint32 offset, uint32 size)
+{
+	// Not offset + size <= mCapacity, which can wrap.
+	assert(size > 0 && offset <= mCapacity && size <= mCapacity - offset);
+
+	uint32 begin = offset;
+	uint32 end = offset + size;
+
+	// Merge with the free range that ends at offset, if any.
+	auto next = mFreeByOffset.lower_bound(offset);
+	if (next != mFreeByOffset.begin())
+	{
+		auto prev = std::prev(next);
+		assert(prev->first + prev->second <= begin && "range freed twice");
+		if (prev->first + prev->second == begin)
+		{
+			begin = prev->first;
+			EraseFree(prev);
+		}
+	}
+
+	// And with the one that starts at its end.
+	if (next != mFreeByOffset.end())
+	{
+		assert(next->first >= end && "range freed twice");
+		if (next->first == end)
+		{
+			end += next->second;
+			EraseFree(next);
+		}
+	}
+
+	InsertFree(begin, end - begin);
+	mFreeSize += size;
+}
+
+void RangeAllocator::Grow(uint32 newCapacity)
+{
+	assert(newCapacity >= mCapacity);
+	if (newCapacity == mCapacity)
+		return;
+
+	uint32 oldCapacity = mCapacity;
+	mCapacity = newCapacity;
+	Free(oldCapacity, newCapacity - oldCapacity);
+}
+
+void RangeAllocator::Reset(uint32 capacity)
+{
+	mFreeByOffset.clear();
+	mFreeBySize.clear();
+	mCapacity = capacity;
+	mFreeSize = capacity;
+	if (capacity > 0)
+		InsertFree(0, capacity);
+}
+
+RangeAllocator::uint32 RangeAllocator::LargestFreeRange() const
+{
+	return mFreeBySize.empty() ? 0 : mFreeBySize.rbegin()->first;
+}
+
+void RangeAllocator::InsertFree(uint32 offset, uint32 size)
+{
+	mFreeByOffset.emplace(offset, size);
+	mFreeBySize.emplace(size, offset);
+}
+
+void RangeAllocator::EraseFree(std::map<uint32, uint32>::iterator it)
+{
+	auto range = mFreeBySize.equal_range(it->second);
+	for (auto sized = range.first; sized != range.second; ++sized)
+	{
+		if (sized->second == it->first)
+		{
+			mFreeBySize.erase(sized);
+			break;
+		}
+	}
+	mFreeByOffset.erase(it);
+}
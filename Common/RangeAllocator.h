@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+
+// Best-fit free list over the range [0, Capacity).  Units are whatever the
+// caller sub-allocates, e.g. vertices or indices of a shared buffer.  Freed
+// ranges merge with free neighbours, so the list holds one entry per gap.
+//
+// Pure bookkeeping with no GPU dependency; GeometryPool builds on it.
+class RangeAllocator
+{
+public:
+	using uint32 = std::uint32_t;
+
+	static const uint32 InvalidOffset = 0xffffffff;
+
+	explicit RangeAllocator(uint32 capacity = 0);
+
+	// Offset of a free range of size units, taken from the smallest gap that
+	// fits, or InvalidOffset if none does.  Size 0 is not allowed.
+	uint32 Allocate(uint32 size);
+	// Returns a range from Allocate.
+	void Free(uint32 offset, uint32 size);
+
+	// Appends [Capacity, newCapacity) to the free space.
+	void Grow(uint32 newCapacity);
+	// Frees everything and sets a new capacity.
+	void Reset(uint32 capacity);
+
+	uint32 Capacity() const { return mCapacity; }
+	uint32 FreeSize() const { return mFreeSize; }
+	uint32 UsedSize() const { return mCapacity - mFreeSize; }
+	uint32 LargestFreeRange() const;
+	size_t FreeRangeCount() const { return mFreeByOffset.size(); }
+
+private:
+	void InsertFree(uint32 offset, uint32 size);
+	void EraseFree(std::map<uint32, uint32>::iterator it);
+
+	uint32 mCapacity = 0;
+	uint32 mFreeSize = 0;
+	// Free ranges as offset -> size, and the same ranges as size -> offset
+	// for the best-fit search.
+	std::map<uint32, uint32> mFreeByOffset;
+	std::multimap<uint32, uint32> mFreeBySize;
+};
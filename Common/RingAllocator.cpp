@@ -0,0 +1,69 @@
+#include "RingAllocator.h"
+#include <cassert>
+
+const RingAllocator::uint64 RingAllocator::InvalidOffset;
+
+RingAllocator::RingAllocator(uint64 capacity)
+{
+	Reset(capacity);
+}
+
+RingAllocator::uint64 RingAllocator::Allocate(uint64 size, uint64 alignment)
+{
+	assert(size > 0);
+	assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+	assert(mCapacity % alignment == 0);
+
+	if (size > mCapacity)
+		return InvalidOffset;
+
+	uint64 start = (mHead + alignment - 1) & ~(alignment - 1);
+	// Skip to the start of the ring rather than wrap the allocation.
+	if (start % mCapacity + size > mCapacity)
+		start += mCapacity - start % mCapacity;
+	if (start + size - mTail > mCapacity)
+		return InvalidOffset;
+
+	mHead = start + size;
+	return start % mCapacity;
+}
+
+void RingAllocator::Submit(uint64 fence)
+{
+	if (mHead == mSubmitted)
+		return;
+
+	assert(fence > 0);
+	assert(mSubmissions.empty() || mSubmissions.back().Fence <= fence);
+	mSubmissions.push_back({ fence, mHead });
+	mSubmitted = mHead;
+}
+
+void RingAllocator::Retire(uint64 completedFence)
+{
+	while (!mSubmissions.empty() && mSubmissions.front().Fence <= completedFence)
+	{
+		mTail = mSubmissions.front().End;
+		mSubmissions.pop_front();
+	}
+
+	// With nothing in flight the next allocation may as well start at 0.
+	if (mTail == mHead)
+	{
+		mHead = mTail = mSubmitted = 0;
+	}
+}
+
+RingAllocator::uint64 RingAllocator::OldestFence() const
+{
+	return mSubmissions.empty() ? 0 : mSubmissions.front().Fence;
+}
+
+void RingAllocator::Reset(uint64 capacity)
+{
+	mCapacity = capacity;
+	mHead = 0;
+	mTail = 0;
+	mSubmitted = 0;
+	mSubmissions.clear();
+}
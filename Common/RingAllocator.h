@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+// Linear allocator over a ring of Capacity bytes whose space comes back in
+// the order it was handed out.  Allocations since the last Submit() are
+// tagged with that call's fence value; Retire() frees every submission whose
+// fence has completed.  An allocation never straddles the end of the ring;
+// the bytes skipped to wrap are freed with the allocation that follows them.
+//
+// Pure bookkeeping with no GPU dependency; UploadRingBuffer builds on it.
+class RingAllocator
+{
+public:
+	using uint64 = std::uint64_t;
+
+	static const uint64 InvalidOffset = ~uint64(0);
+
+	// alignment of any later Allocate must divide capacity.
+	explicit RingAllocator(uint64 capacity = 0);
+
+	// Offset of size contiguous bytes at a multiple of alignment, a power of
+	// two, or InvalidOffset if the ring has no room until older submissions
+	// retire.  Size 0 is not allowed.
+	uint64 Allocate(uint64 size, uint64 alignment = 1);
+
+	// Tags the allocations since the last call with fence, which is non-zero
+	// and not lower than the fence of an earlier call.
+	void Submit(uint64 fence);
+	// Frees the submissions whose fence completedFence has reached.
+	void Retire(uint64 completedFence);
+
+	// Fence of the oldest submission still holding space, or 0 if none.
+	// Waiting for it is the quickest way to room.
+	uint64 OldestFence() const;
+
+	// Frees everything and sets a new capacity.
+	void Reset(uint64 capacity);
+
+	uint64 Capacity() const { return mCapacity; }
+	uint64 UsedSize() const { return mHead - mTail; }
+	// Bytes allocated since the last Submit().
+	uint64 PendingSize() const { return mHead - mSubmitted; }
+	size_t SubmissionCount() const { return mSubmissions.size(); }
+
+private:
+	struct Submission
+	{
+		uint64 Fence;
+		// mHead when it was submitted.
+		uint64 End;
+	};
+
+	// Positions count bytes since Reset and only grow; the offset in the
+	// ring is the position modulo Capacity.
+	uint64 mCapacity = 0;
+	uint64 mHead = 0;
+	uint64 mTail = 0;
+	uint64 mSubmitted = 0;
+	std::deque<Submission> mSubmissions;
+};
@@ -0,0 +1,41 @@
+#include "StreamingWrites.h"
+#include <algorithm>
+#include <cstring>
+#include <emmintrin.h>
+
+void StreamingWrites::Write(void* dest, const void* src, std::size_t size)
+{
+	auto* d = static_cast<std::uint8_t*>(dest);
+	auto* s = static_cast<const std::uint8_t*>(src);
+
+	// Ordinary stores up to the first 16 byte boundary of dest; memcpy only
+	// reads src.
+	std::size_t head = (16 - (reinterpret_cast<std::uintptr_t>(d) & 15)) & 15;
+	head = (std::min)(head, size);
+	memcpy(d, s, head);
+	d += head;
+	s += head;
+	size -= head;
+
+	// A whole write-combining buffer per iteration.
+	for (; size >= 64; d += 64, s += 64, size -= 64)
+	{
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16));
+		__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 32));
+		__m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 48));
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d), a);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d + 16), b);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d + 32), c);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d + 48), e);
+	}
+	for (; size >= 16; d += 16, s += 16, size -= 16)
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d), _mm_loadu_si128(reinterpret_cast<const __m128i*>(s)));
+
+	memcpy(d, s, size);
+}
+
+void StreamingWrites::Fence()
+{
+	_mm_sfence();
+}
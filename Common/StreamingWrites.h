@@ -0,0 +1,16 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Writes to write-combined memory, such as a mapped upload heap.  The CPU
+// does not cache it: each read goes over the bus and stalls, and stores are
+// only fast when they fill whole 64 byte lines.  Write() never reads dest and
+// streams it with 16 byte non-temporal stores, which bypass the cache.
+namespace StreamingWrites
+{
+	// Copies size bytes from src, which may be unaligned, to dest.  The
+	// stores are weakly ordered; call Fence() before the GPU may read them.
+	void Write(void* dest, const void* src, std::size_t size);
+	// Orders the stores of earlier Write calls before any later store.
+	void Fence();
+}
@@ -0,0 +1,217 @@
+#include "TangentGenerator.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	using uint32 = std::uint32_t;
+
+	// Per triangle terms every one of its vertices needs.
+	struct FaceFrame
+	{
+		// Unit normal, and twice the area for area weighting.
+		XMFLOAT3 Normal;
+		float DoubleArea;
+		// Texture space tangent, not normalized; zero when the texture
+		// coordinates are degenerate.
+		XMFLOAT3 Tangent;
+		// Interior angle at each corner, in radians.
+		float Angles[3];
+	};
+
+	// Runs fn(begin, end) over [0, count) in threadCount contiguous chunks,
+	// the last one on the calling thread.
+	template<typename Fn>
+	void ParallelFor(uint32 count, uint32 threadCount, const Fn& fn)
+	{
+		std::vector<std::thread> workers;
+		workers.reserve(threadCount - 1);
+		for (uint32 t = 0; t + 1 < threadCount; ++t)
+		{
+			uint32 begin = static_cast<uint32>(std::uint64_t(count) * t / threadCount);
+			uint32 end = static_cast<uint32>(std::uint64_t(count) * (t + 1) / threadCount);
+			workers.emplace_back([=, &fn]() { fn(begin, end); });
+		}
+		fn(static_cast<uint32>(std::uint64_t(count) * (threadCount - 1) / threadCount), count);
+
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+
+	float AngleBetween(FXMVECTOR a, FXMVECTOR b)
+	{
+		XMVECTOR lengths = XMVectorMultiply(XMVector3LengthSq(a), XMVector3LengthSq(b));
+		float lengthSq = XMVectorGetX(lengths);
+		if (lengthSq <= 0.0f)
+			return 0.0f;
+
+		float cosAngle = XMVectorGetX(XMVector3Dot(a, b)) / std::sqrt(lengthSq);
+		return std::acos(std::max(-1.0f, std::min(cosAngle, 1.0f)));
+	}
+
+	FaceFrame BuildFaceFrame(const GeometryGenerator::Vertex& v0, const GeometryGenerator::Vertex& v1,
+		const GeometryGenerator::Vertex& v2)
+	{
+		FaceFrame face;
+
+		XMVECTOR p0 = XMLoadFloat3(&v0.Position);
+		XMVECTOR p1 = XMLoadFloat3(&v1.Position);
+		XMVECTOR p2 = XMLoadFloat3(&v2.Position);
+		XMVECTOR e1 = XMVectorSubtract(p1, p0);
+		XMVECTOR e2 = XMVectorSubtract(p2, p0);
+
+		XMVECTOR cross = XMVector3Cross(e1, e2);
+		face.DoubleArea = XMVectorGetX(XMVector3Length(cross));
+		XMStoreFloat3(&face.Normal, face.DoubleArea > 0.0f ? XMVectorScale(cross, 1.0f / face.DoubleArea) : XMVectorZero());
+
+		face.Angles[0] = AngleBetween(e1, e2);
+		face.Angles[1] = AngleBetween(XMVectorSubtract(p2, p1), XMVectorNegate(e1));
+		face.Angles[2] = std::max(0.0f, XM_PI - face.Angles[0] - face.Angles[1]);
+
+		// Solve e1 = s1 T + t1 B, e2 = s2 T + t2 B for T.  Only the direction
+		// is kept, so scale by the sign of the determinant rather than its
+		// inverse, as MikkTSpace does.
+		float s1 = v1.TexC.x - v0.TexC.x;
+		float t1 = v1.TexC.y - v0.TexC.y;
+		float s2 = v2.TexC.x - v0.TexC.x;
+		float t2 = v2.TexC.y - v0.TexC.y;
+		float det = s1 * t2 - s2 * t1;
+		XMVECTOR tangent = XMVectorZero();
+		if (std::fabs(det) > 1e-20f)
+		{
+			tangent = XMVectorSubtract(XMVectorScale(e1, t2), XMVectorScale(e2, t1));
+			if (det < 0.0f)
+				tangent = XMVectorNegate(tangent);
+		}
+		XMStoreFloat3(&face.Tangent, tangent);
+		return face;
+	}
+
+	// Any unit vector perpendicular to n, for vertices with no usable
+	// texture space.
+	XMVECTOR AnyPerpendicular(FXMVECTOR n)
+	{
+		XMVECTOR axis = std::fabs(XMVectorGetX(n)) < 0.9f ? XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+		return XMVector3Normalize(XMVector3Cross(XMVector3Cross(n, axis), n));
+	}
+}
+
+void TangentGenerator::Generate(GeometryGenerator::MeshData& meshData)
+{
+	Generate(meshData, Options());
+}
+
+void TangentGenerator::Generate(GeometryGenerator::MeshData& meshData, const Options& options)
+{
+	std::vector<GeometryGenerator::Vertex>& vertices = meshData.Vertices;
+	const std::vector<uint32>& indices = meshData.Indices32;
+	const uint32 vertexCount = static_cast<uint32>(vertices.size());
+	const uint32 triangleCount = static_cast<uint32>(indices.size() / 3);
+	if (vertexCount == 0 || triangleCount == 0)
+		return;
+
+	uint32 threadCount = options.ThreadCount != 0 ? options.ThreadCount : std::max(std::thread::hardware_concurrency(), 1u);
+	threadCount = std::max(1u, std::min(threadCount, triangleCount / std::max(options.MinTrianglesPerThread, 1u)));
+
+	// Pass 1, over triangles: face frames, and how many corners each
+	// vertex has.
+	std::vector<FaceFrame> faces(triangleCount);
+	std::unique_ptr<std::atomic<uint32>[]> cursors(new std::atomic<uint32>[vertexCount]);
+	for (uint32 v = 0; v < vertexCount; ++v)
+		cursors[v].store(0, std::memory_order_relaxed);
+
+	ParallelFor(triangleCount, threadCount, [&](uint32 begin, uint32 end)
+	{
+		for (uint32 t = begin; t < end; ++t)
+		{
+			const uint32* tri = &indices[t * 3];
+			faces[t] = BuildFaceFrame(vertices[tri[0]], vertices[tri[1]], vertices[tri[2]]);
+			for (int k = 0; k < 3; ++k)
+				cursors[tri[k]].fetch_add(1, std::memory_order_relaxed);
+		}
+	});
+
+	// Lay out each vertex's corner list back to back.
+	std::vector<uint32> cornerOffsets(vertexCount + 1);
+	uint32 offset = 0;
+	for (uint32 v = 0; v < vertexCount; ++v)
+	{
+		cornerOffsets[v] = offset;
+		offset += cursors[v].load(std::memory_order_relaxed);
+		cursors[v].store(cornerOffsets[v], std::memory_order_relaxed);
+	}
+	cornerOffsets[vertexCount] = offset;
+
+	// Pass 2, over triangles: scatter the corners (triangle * 3 + corner)
+	// to their vertices.  The slots are claimed in whatever order the
+	// threads get there, so each list is sorted before it is summed.
+	std::vector<uint32> corners(offset);
+	ParallelFor(triangleCount, threadCount, [&](uint32 begin, uint32 end)
+	{
+		for (uint32 t = begin; t < end; ++t)
+		{
+			for (uint32 k = 0; k < 3; ++k)
+				corners[cursors[indices[t * 3 + k]].fetch_add(1, std::memory_order_relaxed)] = t * 3 + k;
+		}
+	});
+	cursors.reset();
+
+	// Pass 3, over vertices: gather.  Each vertex is written by exactly one
+	// thread and sums in triangle order, so no locks are needed and the
+	// result does not depend on the thread count.
+	const bool areaWeighted = options.Weighting == NormalWeighting::Area;
+	ParallelFor(vertexCount, threadCount, [&](uint32 begin, uint32 end)
+	{
+		for (uint32 v = begin; v < end; ++v)
+		{
+			uint32* first = corners.data() + cornerOffsets[v];
+			uint32* last = corners.data() + cornerOffsets[v + 1];
+			if (first == last)
+				continue;
+			std::sort(first, last);
+
+			XMVECTOR n = XMLoadFloat3(&vertices[v].Normal);
+			if (options.ComputeNormals)
+			{
+				XMVECTOR sum = XMVectorZero();
+				for (const uint32* c = first; c != last; ++c)
+				{
+					const FaceFrame& face = faces[*c / 3];
+					float weight = areaWeighted ? face.DoubleArea : face.Angles[*c % 3];
+					sum = XMVectorMultiplyAdd(XMLoadFloat3(&face.Normal), XMVectorReplicate(weight), sum);
+				}
+				// A vertex of only degenerate faces keeps its old normal.
+				if (XMVectorGetX(XMVector3LengthSq(sum)) > 0.0f)
+				{
+					n = XMVector3Normalize(sum);
+					XMStoreFloat3(&vertices[v].Normal, n);
+				}
+			}
+
+			XMVECTOR tangent = XMVectorZero();
+			for (const uint32* c = first; c != last; ++c)
+			{
+				const FaceFrame& face = faces[*c / 3];
+				XMVECTOR t = XMLoadFloat3(&face.Tangent);
+				t = XMVectorSubtract(t, XMVectorMultiply(n, XMVector3Dot(n, t)));
+				float lengthSq = XMVectorGetX(XMVector3LengthSq(t));
+				if (lengthSq > 1e-24f)
+					tangent = XMVectorMultiplyAdd(t, XMVectorReplicate(face.Angles[*c % 3] / std::sqrt(lengthSq)), tangent);
+			}
+
+			// The angle weighted sum can still have a small component along n.
+			tangent = XMVectorSubtract(tangent, XMVectorMultiply(n, XMVector3Dot(n, tangent)));
+			if (XMVectorGetX(XMVector3LengthSq(tangent)) > 1e-24f)
+				tangent = XMVector3Normalize(tangent);
+			else
+				tangent = AnyPerpendicular(n);
+			XMStoreFloat3(&vertices[v].TangentU, tangent);
+		}
+	});
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include "GeometryGenerator.h"
+
+// Rebuilds the vertex normals and TangentU of an indexed triangle mesh from
+// its positions and texture coordinates, for meshes that do not come with
+// a usable tangent frame.
+//
+// Normals are the weighted sum of the adjacent face normals.  Tangents follow
+// MikkTSpace: each face's texture space tangent is projected into the plane
+// of the vertex normal, normalized, and summed with the corner angle as the
+// weight.  Vertices are never split, so a vertex shared across a texture
+// mirror gets an averaged tangent; the generator primitives duplicate their
+// seam vertices, which avoids this.
+//
+// The work is split over triangle and vertex chunks on several threads.
+// Every vertex sums its faces in triangle order, so the result is the same
+// bit for bit for any thread count.
+class TangentGenerator
+{
+public:
+	using uint32 = std::uint32_t;
+
+	enum class NormalWeighting
+	{
+		// Weight each face by its area.  Favours large faces.
+		Area,
+		// Weight each face by its corner angle at the vertex.  Independent of
+		// how the surface around the vertex is triangulated.
+		Angle
+	};
+
+	struct Options
+	{
+		// Keep the mesh's normals and only rebuild TangentU.
+		bool ComputeNormals = true;
+		NormalWeighting Weighting = NormalWeighting::Angle;
+		// 0 uses every hardware thread.
+		uint32 ThreadCount = 0;
+		// Meshes smaller than this run on the calling thread only.
+		uint32 MinTrianglesPerThread = 16384;
+	};
+
+	static void Generate(GeometryGenerator::MeshData& meshData);
+	static void Generate(GeometryGenerator::MeshData& meshData, const Options& options);
+};
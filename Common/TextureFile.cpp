@@ -0,0 +1,477 @@
+#include "TextureFile.h"
+#include "TextureFormat.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	using uint32 = std::uint32_t;
+	using uint64 = std::uint64_t;
+
+	// D3D12's limits, spelled out so the file has no D3D12 dependency.
+	const uint32 kMaxDimension = 16384;
+	const uint32 kMaxDimension3D = 2048;
+	const uint32 kMaxArraySize = 2048;
+
+	constexpr uint32 FourCC(char a, char b, char c, char d)
+	{
+		return uint32(std::uint8_t(a)) | uint32(std::uint8_t(b)) << 8 |
+			uint32(std::uint8_t(c)) << 16 | uint32(std::uint8_t(d)) << 24;
+	}
+
+	const uint32 kDdsMagic = FourCC('D', 'D', 'S', ' ');
+
+	struct DdsPixelFormat
+	{
+		uint32 Size;
+		uint32 Flags;
+		uint32 FourCC;
+		uint32 RGBBitCount;
+		uint32 RBitMask;
+		uint32 GBitMask;
+		uint32 BBitMask;
+		uint32 ABitMask;
+	};
+
+	struct DdsHeader
+	{
+		uint32 Size;
+		uint32 Flags;
+		uint32 Height;
+		uint32 Width;
+		uint32 PitchOrLinearSize;
+		uint32 Depth;
+		uint32 MipMapCount;
+		uint32 Reserved1[11];
+		DdsPixelFormat PixelFormat;
+		uint32 Caps;
+		uint32 Caps2;
+		uint32 Caps3;
+		uint32 Caps4;
+		uint32 Reserved2;
+	};
+
+	struct DdsHeaderDx10
+	{
+		uint32 Format;
+		uint32 ResourceDimension;
+		uint32 MiscFlag;
+		uint32 ArraySize;
+		uint32 MiscFlags2;
+	};
+
+	static_assert(sizeof(DdsHeader) == 124, "DDS header layout");
+	static_assert(sizeof(DdsHeaderDx10) == 20, "DDS DX10 header layout");
+
+	const uint32 kDdpfAlpha = 0x2;
+	const uint32 kDdpfFourCC = 0x4;
+	const uint32 kDdpfRgb = 0x40;
+	const uint32 kDdpfLuminance = 0x20000;
+	const uint32 kDdsCaps2CubeMap = 0x200;
+	const uint32 kDdsCaps2AllFaces = 0xFC00;
+	const uint32 kDdsCaps2Volume = 0x200000;
+	const uint32 kDdsResourceMiscTextureCube = 0x4;
+	const uint32 kDdsDimensionTexture1D = 2;
+	const uint32 kDdsDimensionTexture2D = 3;
+	const uint32 kDdsDimensionTexture3D = 4;
+
+	const std::uint8_t kKtx2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+	struct Ktx2Header
+	{
+		std::uint8_t Identifier[12];
+		uint32 VkFormat;
+		uint32 TypeSize;
+		uint32 PixelWidth;
+		uint32 PixelHeight;
+		uint32 PixelDepth;
+		uint32 LayerCount;
+		uint32 FaceCount;
+		uint32 LevelCount;
+		uint32 SupercompressionScheme;
+		uint32 DfdByteOffset;
+		uint32 DfdByteLength;
+		uint32 KvdByteOffset;
+		uint32 KvdByteLength;
+		uint64 SgdByteOffset;
+		uint64 SgdByteLength;
+	};
+
+	struct Ktx2Level
+	{
+		uint64 ByteOffset;
+		uint64 ByteLength;
+		uint64 UncompressedByteLength;
+	};
+
+	static_assert(sizeof(Ktx2Header) == 80, "KTX2 header layout");
+
+	// The legacy DDS formats worth reading, by FourCC or by bit masks.
+	DXGI_FORMAT LegacyDdsFormat(const DdsPixelFormat& pf)
+	{
+		if (pf.Flags & kDdpfFourCC)
+		{
+			switch (pf.FourCC)
+			{
+			case FourCC('D', 'X', 'T', '1'): return DXGI_FORMAT_BC1_UNORM;
+			case FourCC('D', 'X', 'T', '2'):
+			case FourCC('D', 'X', 'T', '3'): return DXGI_FORMAT_BC2_UNORM;
+			case FourCC('D', 'X', 'T', '4'):
+			case FourCC('D', 'X', 'T', '5'): return DXGI_FORMAT_BC3_UNORM;
+			case FourCC('A', 'T', 'I', '1'):
+			case FourCC('B', 'C', '4', 'U'): return DXGI_FORMAT_BC4_UNORM;
+			case FourCC('B', 'C', '4', 'S'): return DXGI_FORMAT_BC4_SNORM;
+			case FourCC('A', 'T', 'I', '2'):
+			case FourCC('B', 'C', '5', 'U'): return DXGI_FORMAT_BC5_UNORM;
+			case FourCC('B', 'C', '5', 'S'): return DXGI_FORMAT_BC5_SNORM;
+			// D3DFORMAT values.
+			case 36: return DXGI_FORMAT_R16G16B16A16_UNORM;
+			case 110: return DXGI_FORMAT_R16G16B16A16_SNORM;
+			case 111: return DXGI_FORMAT_R16_FLOAT;
+			case 112: return DXGI_FORMAT_R16G16_FLOAT;
+			case 113: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+			case 114: return DXGI_FORMAT_R32_FLOAT;
+			case 115: return DXGI_FORMAT_R32G32_FLOAT;
+			case 116: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+			}
+			return DXGI_FORMAT_UNKNOWN;
+		}
+
+		auto masks = [&pf](uint32 r, uint32 g, uint32 b, uint32 a)
+		{
+			return pf.RBitMask == r && pf.GBitMask == g && pf.BBitMask == b && pf.ABitMask == a;
+		};
+		if (pf.Flags & kDdpfRgb)
+		{
+			if (pf.RGBBitCount == 32)
+			{
+				if (masks(0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000)) return DXGI_FORMAT_R8G8B8A8_UNORM;
+				if (masks(0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000)) return DXGI_FORMAT_B8G8R8A8_UNORM;
+				if (masks(0x00FF0000, 0x0000FF00, 0x000000FF, 0)) return DXGI_FORMAT_B8G8R8X8_UNORM;
+				if (masks(0x000003FF, 0x000FFC00, 0x3FF00000, 0xC0000000)) return DXGI_FORMAT_R10G10B10A2_UNORM;
+				if (masks(0x0000FFFF, 0xFFFF0000, 0, 0)) return DXGI_FORMAT_R16G16_UNORM;
+				if (masks(0xFFFFFFFF, 0, 0, 0)) return DXGI_FORMAT_R32_FLOAT;
+			}
+			else if (pf.RGBBitCount == 16)
+			{
+				if (masks(0x7C00, 0x03E0, 0x001F, 0x8000)) return DXGI_FORMAT_B5G5R5A1_UNORM;
+				if (masks(0xF800, 0x07E0, 0x001F, 0)) return DXGI_FORMAT_B5G6R5_UNORM;
+				if (masks(0x0F00, 0x00F0, 0x000F, 0xF000)) return DXGI_FORMAT_B4G4R4A4_UNORM;
+			}
+		}
+		else if (pf.Flags & kDdpfLuminance)
+		{
+			if (pf.RGBBitCount == 8 && masks(0xFF, 0, 0, 0)) return DXGI_FORMAT_R8_UNORM;
+			if (pf.RGBBitCount == 16 && masks(0xFFFF, 0, 0, 0)) return DXGI_FORMAT_R16_UNORM;
+			if (pf.RGBBitCount == 16 && masks(0x00FF, 0, 0, 0xFF00)) return DXGI_FORMAT_R8G8_UNORM;
+		}
+		else if (pf.Flags & kDdpfAlpha)
+		{
+			if (pf.RGBBitCount == 8) return DXGI_FORMAT_A8_UNORM;
+		}
+		return DXGI_FORMAT_UNKNOWN;
+	}
+
+	// The VkFormats with a DXGI equivalent TextureFormat knows.
+	DXGI_FORMAT Ktx2Format(uint32 vkFormat)
+	{
+		switch (vkFormat)
+		{
+		case 9: return DXGI_FORMAT_R8_UNORM;
+		case 10: return DXGI_FORMAT_R8_SNORM;
+		case 13: return DXGI_FORMAT_R8_UINT;
+		case 14: return DXGI_FORMAT_R8_SINT;
+		case 16: return DXGI_FORMAT_R8G8_UNORM;
+		case 17: return DXGI_FORMAT_R8G8_SNORM;
+		case 20: return DXGI_FORMAT_R8G8_UINT;
+		case 21: return DXGI_FORMAT_R8G8_SINT;
+		case 37: return DXGI_FORMAT_R8G8B8A8_UNORM;
+		case 38: return DXGI_FORMAT_R8G8B8A8_SNORM;
+		case 41: return DXGI_FORMAT_R8G8B8A8_UINT;
+		case 42: return DXGI_FORMAT_R8G8B8A8_SINT;
+		case 43: return DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+		case 44: return DXGI_FORMAT_B8G8R8A8_UNORM;
+		case 50: return DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+		case 64: return DXGI_FORMAT_R10G10B10A2_UNORM;
+		case 68: return DXGI_FORMAT_R10G10B10A2_UINT;
+		case 70: return DXGI_FORMAT_R16_UNORM;
+		case 71: return DXGI_FORMAT_R16_SNORM;
+		case 74: return DXGI_FORMAT_R16_UINT;
+		case 75: return DXGI_FORMAT_R16_SINT;
+		case 76: return DXGI_FORMAT_R16_FLOAT;
+		case 77: return DXGI_FORMAT_R16G16_UNORM;
+		case 78: return DXGI_FORMAT_R16G16_SNORM;
+		case 81: return DXGI_FORMAT_R16G16_UINT;
+		case 82: return DXGI_FORMAT_R16G16_SINT;
+		case 83: return DXGI_FORMAT_R16G16_FLOAT;
+		case 91: return DXGI_FORMAT_R16G16B16A16_UNORM;
+		case 92: return DXGI_FORMAT_R16G16B16A16_SNORM;
+		case 95: return DXGI_FORMAT_R16G16B16A16_UINT;
+		case 96: return DXGI_FORMAT_R16G16B16A16_SINT;
+		case 97: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+		case 98: return DXGI_FORMAT_R32_UINT;
+		case 99: return DXGI_FORMAT_R32_SINT;
+		case 100: return DXGI_FORMAT_R32_FLOAT;
+		case 101: return DXGI_FORMAT_R32G32_UINT;
+		case 102: return DXGI_FORMAT_R32G32_SINT;
+		case 103: return DXGI_FORMAT_R32G32_FLOAT;
+		case 104: return DXGI_FORMAT_R32G32B32_UINT;
+		case 105: return DXGI_FORMAT_R32G32B32_SINT;
+		case 106: return DXGI_FORMAT_R32G32B32_FLOAT;
+		case 107: return DXGI_FORMAT_R32G32B32A32_UINT;
+		case 108: return DXGI_FORMAT_R32G32B32A32_SINT;
+		case 109: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+		case 122: return DXGI_FORMAT_R11G11B10_FLOAT;
+		case 123: return DXGI_FORMAT_R9G9B9E5_SHAREDEXP;
+		case 124: return DXGI_FORMAT_D16_UNORM;
+		case 126: return DXGI_FORMAT_D32_FLOAT;
+		// BC1 with and without alpha are the same blocks.
+		case 131:
+		case 133: return DXGI_FORMAT_BC1_UNORM;
+		case 132:
+		case 134: return DXGI_FORMAT_BC1_UNORM_SRGB;
+		case 135: return DXGI_FORMAT_BC2_UNORM;
+		case 136: return DXGI_FORMAT_BC2_UNORM_SRGB;
+		case 137: return DXGI_FORMAT_BC3_UNORM;
+		case 138: return DXGI_FORMAT_BC3_UNORM_SRGB;
+		case 139: return DXGI_FORMAT_BC4_UNORM;
+		case 140: return DXGI_FORMAT_BC4_SNORM;
+		case 141: return DXGI_FORMAT_BC5_UNORM;
+		case 142: return DXGI_FORMAT_BC5_SNORM;
+		case 143: return DXGI_FORMAT_BC6H_UF16;
+		case 144: return DXGI_FORMAT_BC6H_SF16;
+		case 145: return DXGI_FORMAT_BC7_UNORM;
+		case 146: return DXGI_FORMAT_BC7_UNORM_SRGB;
+		}
+		return DXGI_FORMAT_UNKNOWN;
+	}
+
+	uint32 FullMipCount(uint32 size)
+	{
+		uint32 levels = 1;
+		while (size > 1)
+		{
+			size >>= 1;
+			++levels;
+		}
+		return levels;
+	}
+}
+
+bool TextureFile::Open(const std::string& path)
+{
+	Close();
+	mError.clear();
+
+	if (!mFile.Open(path, mError))
+		return false;
+	if (mFile.Size() >= sizeof(uint32) + sizeof(DdsHeader) && std::memcmp(mFile.Data(), &kDdsMagic, sizeof(uint32)) == 0)
+		return OpenDds();
+	if (mFile.Size() >= sizeof(Ktx2Header) && std::memcmp(mFile.Data(), kKtx2Identifier, sizeof(kKtx2Identifier)) == 0)
+		return OpenKtx2();
+	return Fail(path + " is not a DDS or KTX2 file");
+}
+
+void TextureFile::Close()
+{
+	mFile.Close();
+	mDesc = Description();
+	mSubresources.clear();
+}
+
+bool TextureFile::Fail(const std::string& error)
+{
+	Close();
+	mError = error;
+	return false;
+}
+
+bool TextureFile::OpenDds()
+{
+	DdsHeader header;
+	std::memcpy(&header, mFile.Data() + sizeof(uint32), sizeof(header));
+	if (header.Size != sizeof(DdsHeader) || header.PixelFormat.Size != sizeof(DdsPixelFormat))
+		return Fail("bad DDS header size");
+
+	uint64 dataOffset = sizeof(uint32) + sizeof(DdsHeader);
+	mDesc.Width = header.Width;
+	mDesc.Height = header.Height;
+	mDesc.Depth = 1;
+	mDesc.ArraySize = 1;
+	mDesc.MipLevels = (std::max)(header.MipMapCount, 1u);
+
+	if ((header.PixelFormat.Flags & kDdpfFourCC) && header.PixelFormat.FourCC == FourCC('D', 'X', '1', '0'))
+	{
+		if (mFile.Size() < dataOffset + sizeof(DdsHeaderDx10))
+			return Fail("DDS file is truncated");
+		DdsHeaderDx10 dx10;
+		std::memcpy(&dx10, mFile.Data() + dataOffset, sizeof(dx10));
+		dataOffset += sizeof(DdsHeaderDx10);
+
+		mDesc.Format = static_cast<DXGI_FORMAT>(dx10.Format);
+		mDesc.ArraySize = dx10.ArraySize;
+		switch (dx10.ResourceDimension)
+		{
+		case kDdsDimensionTexture1D:
+			mDesc.Type = Dimension::Texture1D;
+			if (mDesc.Height > 1)
+				return Fail("1D DDS texture with a height");
+			mDesc.Height = 1;
+			break;
+		case kDdsDimensionTexture2D:
+			mDesc.Type = Dimension::Texture2D;
+			if (dx10.MiscFlag & kDdsResourceMiscTextureCube)
+			{
+				mDesc.IsCubeMap = true;
+				mDesc.ArraySize *= 6;
+			}
+			break;
+		case kDdsDimensionTexture3D:
+			mDesc.Type = Dimension::Texture3D;
+			mDesc.Depth = header.Depth;
+			if (mDesc.ArraySize != 1)
+				return Fail("3D DDS texture with an array size");
+			break;
+		default:
+			return Fail("bad DDS resource dimension " + std::to_string(dx10.ResourceDimension));
+		}
+	}
+	else
+	{
+		mDesc.Format = LegacyDdsFormat(header.PixelFormat);
+		if (mDesc.Format == DXGI_FORMAT_UNKNOWN)
+			return Fail("unsupported legacy DDS pixel format");
+		if (header.Caps2 & kDdsCaps2CubeMap)
+		{
+			if ((header.Caps2 & kDdsCaps2AllFaces) != kDdsCaps2AllFaces)
+				return Fail("DDS cube map without all six faces");
+			mDesc.IsCubeMap = true;
+			mDesc.ArraySize = 6;
+		}
+		else if (header.Caps2 & kDdsCaps2Volume)
+		{
+			mDesc.Type = Dimension::Texture3D;
+			mDesc.Depth = header.Depth;
+		}
+	}
+
+	if (!ValidateDescription())
+		return false;
+
+	// Every mip of the first array slice, then every mip of the next.
+	mSubresources.reserve(mDesc.ArraySize * mDesc.MipLevels);
+	uint64 offset = dataOffset;
+	for (uint32 slice = 0; slice < mDesc.ArraySize; ++slice)
+	{
+		for (uint32 mip = 0; mip < mDesc.MipLevels; ++mip)
+		{
+			uint64 rowPitch, rowCount;
+			MipPitch(mip, rowPitch, rowCount);
+			uint64 slicePitch = rowPitch * rowCount;
+			uint64 size = slicePitch * MipDepth(mip);
+			if (mFile.Size() - offset < size)
+				return Fail("DDS file is truncated");
+			mSubresources.push_back({ mFile.Data() + offset, rowPitch, slicePitch });
+			offset += size;
+		}
+	}
+	return true;
+}
+
+bool TextureFile::OpenKtx2()
+{
+	Ktx2Header header;
+	std::memcpy(&header, mFile.Data(), sizeof(header));
+	if (header.SupercompressionScheme != 0)
+		return Fail("supercompressed KTX2 files are not supported");
+	mDesc.Format = Ktx2Format(header.VkFormat);
+	if (mDesc.Format == DXGI_FORMAT_UNKNOWN)
+		return Fail("unsupported KTX2 VkFormat " + std::to_string(header.VkFormat));
+	if (header.FaceCount != 1 && header.FaceCount != 6)
+		return Fail("KTX2 face count must be 1 or 6");
+
+	// Height and depth 0 mark 1D and 2D textures; layer count 0 is no
+	// array, level count 0 asks for mips to be generated.
+	mDesc.Width = header.PixelWidth;
+	mDesc.Height = (std::max)(header.PixelHeight, 1u);
+	mDesc.Depth = (std::max)(header.PixelDepth, 1u);
+	mDesc.ArraySize = (std::max)(header.LayerCount, 1u) * header.FaceCount;
+	mDesc.MipLevels = (std::max)(header.LevelCount, 1u);
+	mDesc.IsCubeMap = header.FaceCount == 6;
+	if (header.PixelDepth != 0)
+	{
+		mDesc.Type = Dimension::Texture3D;
+		if (header.PixelHeight == 0 || mDesc.ArraySize != 1)
+			return Fail("3D KTX2 texture without a height or with layers or faces");
+	}
+	else
+	{
+		mDesc.Type = header.PixelHeight == 0 ? Dimension::Texture1D : Dimension::Texture2D;
+		if (mDesc.IsCubeMap && header.PixelHeight == 0)
+			return Fail("1D KTX2 cube map");
+	}
+
+	if (!ValidateDescription())
+		return false;
+	uint64 levelIndexEnd = sizeof(Ktx2Header) + uint64(mDesc.MipLevels) * sizeof(Ktx2Level);
+	if (mFile.Size() < levelIndexEnd)
+		return Fail("KTX2 file is truncated");
+
+	// Each level holds every layer and face, so its subresources are
+	// mip, mip + MipLevels, ...
+	mSubresources.resize(mDesc.ArraySize * mDesc.MipLevels);
+	for (uint32 mip = 0; mip < mDesc.MipLevels; ++mip)
+	{
+		Ktx2Level level;
+		std::memcpy(&level, mFile.Data() + sizeof(Ktx2Header) + mip * sizeof(Ktx2Level), sizeof(level));
+
+		uint64 rowPitch, rowCount;
+		MipPitch(mip, rowPitch, rowCount);
+		uint64 slicePitch = rowPitch * rowCount;
+		uint64 imageSize = slicePitch * MipDepth(mip);
+		if (level.ByteLength != imageSize * mDesc.ArraySize)
+			return Fail("KTX2 level " + std::to_string(mip) + " has the wrong size");
+		if (level.ByteOffset < levelIndexEnd || level.ByteOffset > mFile.Size() ||
+			mFile.Size() - level.ByteOffset < level.ByteLength)
+			return Fail("KTX2 level " + std::to_string(mip) + " is outside the file");
+
+		for (uint32 slice = 0; slice < mDesc.ArraySize; ++slice)
+		{
+			mSubresources[mip + slice * mDesc.MipLevels] =
+				{ mFile.Data() + level.ByteOffset + slice * imageSize, rowPitch, slicePitch };
+		}
+	}
+	return true;
+}
+
+bool TextureFile::ValidateDescription()
+{
+	if (TextureFormat::Find(mDesc.Format) == nullptr)
+		return Fail("unsupported format " + std::to_string(mDesc.Format));
+	if (mDesc.Width == 0 || mDesc.Height == 0 || mDesc.Depth == 0 || mDesc.ArraySize == 0)
+		return Fail("texture has a zero size");
+
+	uint32 maxDimension = mDesc.Type == Dimension::Texture3D ? kMaxDimension3D : kMaxDimension;
+	uint32 largest = (std::max)((std::max)(mDesc.Width, mDesc.Height), mDesc.Depth);
+	if (largest > maxDimension || mDesc.ArraySize > kMaxArraySize)
+		return Fail("texture is larger than D3D12 allows");
+	if (mDesc.IsCubeMap && mDesc.Width != mDesc.Height)
+		return Fail("cube map faces are not square");
+	if (mDesc.MipLevels > FullMipCount(largest))
+		return Fail(std::to_string(mDesc.MipLevels) + " mip levels is more than the size allows");
+	return true;
+}
+
+void TextureFile::MipPitch(uint32 mip, uint64& rowPitch, uint64& rowCount) const
+{
+	const TextureFormatInfo* info = TextureFormat::Find(mDesc.Format);
+	uint64 width = (std::max)(mDesc.Width >> mip, 1u);
+	uint64 height = (std::max)(mDesc.Height >> mip, 1u);
+	rowPitch = (width + info->BlockWidth - 1) / info->BlockWidth * info->BytesPerBlock;
+	rowCount = (height + info->BlockHeight - 1) / info->BlockHeight;
+}
+
+TextureFile::uint32 TextureFile::MipDepth(uint32 mip) const
+{
+	return (std::max)(mDesc.Depth >> mip, 1u);
+}
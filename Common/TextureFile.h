@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <dxgiformat.h>
+#include "MappedFile.h"
+
+// A DDS or KTX2 texture, mapped read-only.  Opening checks the header and
+// that every subresource it describes lies within the file; the
+// subresources then point straight into the mapping, so
+// TextureUpload::CreateTexture copies each byte once, from the file's pages
+// to its row-pitch-aligned place in upload memory.
+//
+// DDS files may have a DX10 header or a legacy one in the usual formats
+// (DXT1-5, ATI1/2, BC4/5 and float FourCCs, 8888, 565, 5551, 4444, L8, L16
+// and A8 masks).  KTX2 files must not be supercompressed, and their
+// VkFormat must have a DXGI equivalent.  Either way the format has to be
+// in TextureFormat's table; sizes and pitches come from it.
+//
+// Has no D3D12 dependency, so files can be checked on any platform.
+class TextureFile
+{
+public:
+	using uint32 = std::uint32_t;
+	using uint64 = std::uint64_t;
+
+	enum class Dimension
+	{
+		Texture1D,
+		Texture2D,
+		Texture3D,
+	};
+
+	struct Description
+	{
+		DXGI_FORMAT Format = DXGI_FORMAT_UNKNOWN;
+		Dimension Type = Dimension::Texture2D;
+		uint32 Width = 0;
+		uint32 Height = 0;
+		// 1 unless Type is Texture3D.
+		uint32 Depth = 0;
+		// Six per cube; 1 for Texture3D.
+		uint32 ArraySize = 0;
+		uint32 MipLevels = 0;
+		bool IsCubeMap = false;
+	};
+
+	// One subresource as it is stored in the file: packed rows of blocks,
+	// then for a 3D texture the next depth slice.
+	struct Subresource
+	{
+		const void* Data;
+		uint64 RowPitch;
+		uint64 SlicePitch;
+	};
+
+	TextureFile() = default;
+	TextureFile(const TextureFile& rhs) = delete;
+	TextureFile& operator=(const TextureFile& rhs) = delete;
+
+	// Maps path and validates it.  On failure returns false, leaves the
+	// object closed and describes the problem in Error().
+	bool Open(const std::string& path);
+	void Close();
+	bool IsOpen() const { return mFile.IsOpen(); }
+	const std::string& Error() const { return mError; }
+
+	const Description& GetDescription() const { return mDesc; }
+	// In D3D12 order: index = mip + arraySlice * MipLevels.
+	uint32 SubresourceCount() const { return static_cast<uint32>(mSubresources.size()); }
+	const Subresource& GetSubresource(uint32 index) const { return mSubresources[index]; }
+
+private:
+	bool Fail(const std::string& error);
+	bool OpenDds();
+	bool OpenKtx2();
+	// Checks mDesc against the format table and the size limits.
+	bool ValidateDescription();
+	// Packed bytes per row and rows of blocks of mip.
+	void MipPitch(uint32 mip, uint64& rowPitch, uint64& rowCount) const;
+	uint32 MipDepth(uint32 mip) const;
+
+	MappedFile mFile;
+	std::string mError;
+	Description mDesc;
+	std::vector<Subresource> mSubresources;
+};
@@ -0,0 +1,106 @@
+#include "TextureFormat.h"
+
+namespace
+{
+	const TextureFormatInfo kFormats[] =
+	{
+		{ DXGI_FORMAT_R32G32B32A32_TYPELESS, 16, 1, 1 },
+		{ DXGI_FORMAT_R32G32B32A32_FLOAT, 16, 1, 1 },
+		{ DXGI_FORMAT_R32G32B32A32_UINT, 16, 1, 1 },
+		{ DXGI_FORMAT_R32G32B32A32_SINT, 16, 1, 1 },
+		{ DXGI_FORMAT_R32G32B32_TYPELESS, 12, 1, 1 },
+		{ DXGI_FORMAT_R32G32B32_FLOAT, 12, 1, 1 },
+		{ DXGI_FORMAT_R32G32B32_UINT, 12, 1, 1 },
+		{ DXGI_FORMAT_R32G32B32_SINT, 12, 1, 1 },
+		{ DXGI_FORMAT_R16G16B16A16_TYPELESS, 8, 1, 1 },
+		{ DXGI_FORMAT_R16G16B16A16_FLOAT, 8, 1, 1 },
+		{ DXGI_FORMAT_R16G16B16A16_UNORM, 8, 1, 1 },
+		{ DXGI_FORMAT_R16G16B16A16_UINT, 8, 1, 1 },
+		{ DXGI_FORMAT_R16G16B16A16_SNORM, 8, 1, 1 },
+		{ DXGI_FORMAT_R16G16B16A16_SINT, 8, 1, 1 },
+		{ DXGI_FORMAT_R32G32_TYPELESS, 8, 1, 1 },
+		{ DXGI_FORMAT_R32G32_FLOAT, 8, 1, 1 },
+		{ DXGI_FORMAT_R32G32_UINT, 8, 1, 1 },
+		{ DXGI_FORMAT_R32G32_SINT, 8, 1, 1 },
+		{ DXGI_FORMAT_R10G10B10A2_TYPELESS, 4, 1, 1 },
+		{ DXGI_FORMAT_R10G10B10A2_UNORM, 4, 1, 1 },
+		{ DXGI_FORMAT_R10G10B10A2_UINT, 4, 1, 1 },
+		{ DXGI_FORMAT_R11G11B10_FLOAT, 4, 1, 1 },
+		{ DXGI_FORMAT_R8G8B8A8_TYPELESS, 4, 1, 1 },
+		{ DXGI_FORMAT_R8G8B8A8_UNORM, 4, 1, 1 },
+		{ DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, 4, 1, 1 },
+		{ DXGI_FORMAT_R8G8B8A8_UINT, 4, 1, 1 },
+		{ DXGI_FORMAT_R8G8B8A8_SNORM, 4, 1, 1 },
+		{ DXGI_FORMAT_R8G8B8A8_SINT, 4, 1, 1 },
+		{ DXGI_FORMAT_R16G16_TYPELESS, 4, 1, 1 },
+		{ DXGI_FORMAT_R16G16_FLOAT, 4, 1, 1 },
+		{ DXGI_FORMAT_R16G16_UNORM, 4, 1, 1 },
+		{ DXGI_FORMAT_R16G16_UINT, 4, 1, 1 },
+		{ DXGI_FORMAT_R16G16_SNORM, 4, 1, 1 },
+		{ DXGI_FORMAT_R16G16_SINT, 4, 1, 1 },
+		{ DXGI_FORMAT_R32_TYPELESS, 4, 1, 1 },
+		{ DXGI_FORMAT_D32_FLOAT, 4, 1, 1 },
+		{ DXGI_FORMAT_R32_FLOAT, 4, 1, 1 },
+		{ DXGI_FORMAT_R32_UINT, 4, 1, 1 },
+		{ DXGI_FORMAT_R32_SINT, 4, 1, 1 },
+		{ DXGI_FORMAT_R9G9B9E5_SHAREDEXP, 4, 1, 1 },
+		{ DXGI_FORMAT_B8G8R8A8_UNORM, 4, 1, 1 },
+		{ DXGI_FORMAT_B8G8R8X8_UNORM, 4, 1, 1 },
+		{ DXGI_FORMAT_B8G8R8A8_TYPELESS, 4, 1, 1 },
+		{ DXGI_FORMAT_B8G8R8A8_UNORM_SRGB, 4, 1, 1 },
+		{ DXGI_FORMAT_B8G8R8X8_TYPELESS, 4, 1, 1 },
+		{ DXGI_FORMAT_B8G8R8X8_UNORM_SRGB, 4, 1, 1 },
+		{ DXGI_FORMAT_R8G8_TYPELESS, 2, 1, 1 },
+		{ DXGI_FORMAT_R8G8_UNORM, 2, 1, 1 },
+		{ DXGI_FORMAT_R8G8_UINT, 2, 1, 1 },
+		{ DXGI_FORMAT_R8G8_SNORM, 2, 1, 1 },
+		{ DXGI_FORMAT_R8G8_SINT, 2, 1, 1 },
+		{ DXGI_FORMAT_R16_TYPELESS, 2, 1, 1 },
+		{ DXGI_FORMAT_R16_FLOAT, 2, 1, 1 },
+		{ DXGI_FORMAT_D16_UNORM, 2, 1, 1 },
+		{ DXGI_FORMAT_R16_UNORM, 2, 1, 1 },
+		{ DXGI_FORMAT_R16_UINT, 2, 1, 1 },
+		{ DXGI_FORMAT_R16_SNORM, 2, 1, 1 },
+		{ DXGI_FORMAT_R16_SINT, 2, 1, 1 },
+		{ DXGI_FORMAT_B5G6R5_UNORM, 2, 1, 1 },
+		{ DXGI_FORMAT_B5G5R5A1_UNORM, 2, 1, 1 },
+		{ DXGI_FORMAT_B4G4R4A4_UNORM, 2, 1, 1 },
+		{ DXGI_FORMAT_R8_TYPELESS, 1, 1, 1 },
+		{ DXGI_FORMAT_R8_UNORM, 1, 1, 1 },
+		{ DXGI_FORMAT_R8_UINT, 1, 1, 1 },
+		{ DXGI_FORMAT_R8_SNORM, 1, 1, 1 },
+		{ DXGI_FORMAT_R8_SINT, 1, 1, 1 },
+		{ DXGI_FORMAT_A8_UNORM, 1, 1, 1 },
+		{ DXGI_FORMAT_BC1_TYPELESS, 8, 4, 4 },
+		{ DXGI_FORMAT_BC1_UNORM, 8, 4, 4 },
+		{ DXGI_FORMAT_BC1_UNORM_SRGB, 8, 4, 4 },
+		{ DXGI_FORMAT_BC2_TYPELESS, 16, 4, 4 },
+		{ DXGI_FORMAT_BC2_UNORM, 16, 4, 4 },
+		{ DXGI_FORMAT_BC2_UNORM_SRGB, 16, 4, 4 },
+		{ DXGI_FORMAT_BC3_TYPELESS, 16, 4, 4 },
+		{ DXGI_FORMAT_BC3_UNORM, 16, 4, 4 },
+		{ DXGI_FORMAT_BC3_UNORM_SRGB, 16, 4, 4 },
+		{ DXGI_FORMAT_BC4_TYPELESS, 8, 4, 4 },
+		{ DXGI_FORMAT_BC4_UNORM, 8, 4, 4 },
+		{ DXGI_FORMAT_BC4_SNORM, 8, 4, 4 },
+		{ DXGI_FORMAT_BC5_TYPELESS, 16, 4, 4 },
+		{ DXGI_FORMAT_BC5_UNORM, 16, 4, 4 },
+		{ DXGI_FORMAT_BC5_SNORM, 16, 4, 4 },
+		{ DXGI_FORMAT_BC6H_TYPELESS, 16, 4, 4 },
+		{ DXGI_FORMAT_BC6H_UF16, 16, 4, 4 },
+		{ DXGI_FORMAT_BC6H_SF16, 16, 4, 4 },
+		{ DXGI_FORMAT_BC7_TYPELESS, 16, 4, 4 },
+		{ DXGI_FORMAT_BC7_UNORM, 16, 4, 4 },
+		{ DXGI_FORMAT_BC7_UNORM_SRGB, 16, 4, 4 },
+	};
+}
+
+const TextureFormatInfo* TextureFormat::Find(DXGI_FORMAT format)
+{
+	for (const TextureFormatInfo& info : kFormats)
+	{
+		if (info.Format == format)
+			return &info;
+	}
+	return nullptr;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <dxgiformat.h>
+
+// Sizes of the texture formats the framework can copy and load.  A format
+// is stored in blocks: one pixel for the uncompressed ones, 4x4 pixels for
+// the block-compressed BC ones.
+struct TextureFormatInfo
+{
+	DXGI_FORMAT Format;
+	unsigned BytesPerBlock;
+	unsigned BlockWidth;
+	unsigned BlockHeight;
+};
+
+namespace TextureFormat
+{
+	// The entry for format, or null if it is not in the table (planar,
+	// video and packed 4:2:2 formats are not).
+	const TextureFormatInfo* Find(DXGI_FORMAT format);
+}
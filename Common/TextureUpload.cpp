@@ -0,0 +1,217 @@
+#include "TextureUpload.h"
+#include "ParallelFor.h"
+#include "StreamingWrites.h"
+#include "TextureFormat.h"
+#include <algorithm>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	// Less than this per thread is not worth starting one for.
+	const UINT64 kBytesPerThread = 1024 * 1024;
+
+	UINT64 AlignUp(UINT64 value, UINT64 alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	// The rows of one depth slice of one subresource, and where they start
+	// in the bytes of all the rows of the copy.
+	struct RowRun
+	{
+		UINT Subresource;
+		UINT Slice;
+		UINT64 FirstByte;
+	};
+}
+
+bool TextureUpload::ComputeFootprints(const D3D12_RESOURCE_DESC& desc, UINT firstSubresource, UINT subresourceCount,
+	UINT64 baseOffset, Footprints& footprints)
+{
+	const TextureFormatInfo* info = TextureFormat::Find(desc.Format);
+	if (info == nullptr || desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER || desc.MipLevels == 0)
+		return false;
+
+	footprints.Layouts.resize(subresourceCount);
+	footprints.RowCounts.resize(subresourceCount);
+	footprints.RowSizes.resize(subresourceCount);
+	footprints.TotalBytes = 0;
+
+	UINT64 offset = baseOffset;
+	for (UINT i = 0; i < subresourceCount; ++i)
+	{
+		UINT mip = (firstSubresource + i) % desc.MipLevels;
+		UINT width = (std::max)(static_cast<UINT>(desc.Width >> mip), 1u);
+		UINT height = desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE1D ? 1 : (std::max)(desc.Height >> mip, 1u);
+		UINT depth = desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D ? (std::max)(UINT(desc.DepthOrArraySize) >> mip, 1u) : 1;
+
+		UINT blocksWide = (width + info->BlockWidth - 1) / info->BlockWidth;
+		UINT blocksHigh = (height + info->BlockHeight - 1) / info->BlockHeight;
+		UINT64 rowSize = UINT64(blocksWide) * info->BytesPerBlock;
+		UINT64 rowPitch = AlignUp(rowSize, D3D12_TEXTURE_DATA_PITCH_ALIGNMENT);
+		offset = AlignUp(offset, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT& layout = footprints.Layouts[i];
+		layout.Offset = offset;
+		layout.Footprint.Format = desc.Format;
+		layout.Footprint.Width = blocksWide * info->BlockWidth;
+		layout.Footprint.Height = blocksHigh * info->BlockHeight;
+		layout.Footprint.Depth = depth;
+		layout.Footprint.RowPitch = static_cast<UINT>(rowPitch);
+		footprints.RowCounts[i] = blocksHigh;
+		footprints.RowSizes[i] = rowSize;
+
+		// The last row needs no padding after it.
+		UINT64 rows = UINT64(blocksHigh) * depth;
+		footprints.TotalBytes = offset + rowPitch * (rows - 1) + rowSize - baseOffset;
+		offset += rowPitch * rows;
+	}
+	return true;
+}
+
+void TextureUpload::CopySubresources(BYTE* dest, const Footprints& footprints, const D3D12_SUBRESOURCE_DATA* src,
+	UINT threadCount)
+{
+	std::vector<RowRun> runs;
+	UINT64 totalBytes = 0;
+	for (UINT i = 0; i < footprints.Layouts.size(); ++i)
+	{
+		for (UINT slice = 0; slice < footprints.Layouts[i].Footprint.Depth; ++slice)
+		{
+			runs.push_back({ i, slice, totalBytes });
+			totalBytes += footprints.RowSizes[i] * footprints.RowCounts[i];
+		}
+	}
+
+	// Split by bytes rather than rows: a mip level's rows are shorter than
+	// those of the level above.
+	threadCount = (std::min)(ResolveThreadCount(threadCount), static_cast<UINT>(totalBytes / kBytesPerThread + 1));
+	ParallelFor(threadCount, threadCount, [&](UINT first, UINT last)
+	{
+		for (UINT t = first; t < last; ++t)
+		{
+			UINT64 begin = totalBytes * t / threadCount;
+			UINT64 end = totalBytes * (t + 1) / threadCount;
+			for (const RowRun& run : runs)
+			{
+				UINT64 rowSize = footprints.RowSizes[run.Subresource];
+				UINT rowCount = footprints.RowCounts[run.Subresource];
+				UINT64 runEnd = run.FirstByte + rowSize * rowCount;
+				if (runEnd <= begin || run.FirstByte >= end || rowSize == 0)
+					continue;
+
+				// The rows that start in [begin, end).
+				UINT64 firstRow = begin > run.FirstByte ? (begin - run.FirstByte + rowSize - 1) / rowSize : 0;
+				UINT64 lastRow = (std::min)((end - run.FirstByte + rowSize - 1) / rowSize, UINT64(rowCount));
+
+				const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& layout = footprints.Layouts[run.Subresource];
+				const D3D12_SUBRESOURCE_DATA& data = src[run.Subresource];
+				BYTE* destSlice = dest + layout.Offset + UINT64(layout.Footprint.RowPitch) * rowCount * run.Slice;
+				const BYTE* srcSlice = static_cast<const BYTE*>(data.pData) + data.SlicePitch * run.Slice;
+				for (UINT64 row = firstRow; row < lastRow; ++row)
+				{
+					StreamingWrites::Write(destSlice + layout.Footprint.RowPitch * row,
+						srcSlice + data.RowPitch * row, static_cast<size_t>(rowSize));
+				}
+			}
+		}
+		StreamingWrites::Fence();
+	});
+}
+
+ComPtr<ID3D12Resource> TextureUpload::CreateTexture(GpuMemoryAllocator& allocator,
+	ID3D12GraphicsCommandList* cmdList, UploadRingBuffer& uploads, const D3D12_RESOURCE_DESC& desc,
+	const D3D12_SUBRESOURCE_DATA* subresources, D3D12_RESOURCE_STATES stateAfter, UINT threadCount)
+{
+	UINT subresourceCount = desc.MipLevels *
+		(desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D ? 1u : UINT(desc.DepthOrArraySize));
+	Footprints footprints;
+	if (!ComputeFootprints(desc, 0, subresourceCount, 0, footprints))
+		ThrowIfFailed(E_INVALIDARG);
+
+	ComPtr<ID3D12Resource> texture = allocator.CreateResource(D3D12_HEAP_TYPE_DEFAULT, desc,
+		D3D12_RESOURCE_STATE_COPY_DEST);
+
+	UploadRingBuffer::Allocation staging = uploads.Allocate(footprints.TotalBytes, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+	CopySubresources(static_cast<BYTE*>(staging.CPU), footprints, subresources, threadCount);
+
+	for (UINT i = 0; i < subresourceCount; ++i)
+	{
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT layout = footprints.Layouts[i];
+		layout.Offset += staging.Offset;
+		CD3DX12_TEXTURE_COPY_LOCATION dst(texture.Get(), i);
+		CD3DX12_TEXTURE_COPY_LOCATION src(staging.Resource, layout);
+		cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+	}
+
+	auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(), D3D12_RESOURCE_STATE_COPY_DEST, stateAfter);
+	cmdList->ResourceBarrier(1, &barrier);
+	return texture;
+}
+
+ComPtr<ID3D12Resource> TextureUpload::CreateTexture(GpuMemoryAllocator& allocator,
+	ID3D12GraphicsCommandList* cmdList, UploadRingBuffer& uploads, MipChain& mips,
+	D3D12_RESOURCE_STATES stateAfter, UINT threadCount)
+{
+	MipChain::Level top = mips.GetLevel(0);
+	D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Tex2D(FormatOf(mips.PixelFormat()), top.Width, top.Height,
+		1, static_cast<UINT16>(mips.MipLevels()));
+
+	std::vector<D3D12_SUBRESOURCE_DATA> subresources(mips.MipLevels());
+	for (UINT mip = 0; mip < mips.MipLevels(); ++mip)
+	{
+		MipChain::Level level = mips.GetLevel(mip);
+		subresources[mip].pData = level.Data;
+		subresources[mip].RowPitch = level.RowPitch;
+		subresources[mip].SlicePitch = LONG_PTR(level.RowPitch) * level.Height;
+	}
+	return CreateTexture(allocator, cmdList, uploads, desc, subresources.data(), stateAfter, threadCount);
+}
+
+ComPtr<ID3D12Resource> TextureUpload::CreateTexture(GpuMemoryAllocator& allocator,
+	ID3D12GraphicsCommandList* cmdList, UploadRingBuffer& uploads, const TextureFile& file,
+	D3D12_RESOURCE_STATES stateAfter, UINT threadCount)
+{
+	std::vector<D3D12_SUBRESOURCE_DATA> subresources(file.SubresourceCount());
+	for (UINT i = 0; i < file.SubresourceCount(); ++i)
+	{
+		const TextureFile::Subresource& subresource = file.GetSubresource(i);
+		subresources[i].pData = subresource.Data;
+		subresources[i].RowPitch = LONG_PTR(subresource.RowPitch);
+		subresources[i].SlicePitch = LONG_PTR(subresource.SlicePitch);
+	}
+	return CreateTexture(allocator, cmdList, uploads, ResourceDescOf(file), subresources.data(), stateAfter,
+		threadCount);
+}
+
+D3D12_RESOURCE_DESC TextureUpload::ResourceDescOf(const TextureFile& file)
+{
+	const TextureFile::Description& desc = file.GetDescription();
+	UINT16 mipLevels = static_cast<UINT16>(desc.MipLevels);
+	switch (desc.Type)
+	{
+	case TextureFile::Dimension::Texture1D:
+		return CD3DX12_RESOURCE_DESC::Tex1D(desc.Format, desc.Width, static_cast<UINT16>(desc.ArraySize), mipLevels);
+	case TextureFile::Dimension::Texture3D:
+		return CD3DX12_RESOURCE_DESC::Tex3D(desc.Format, desc.Width, desc.Height, static_cast<UINT16>(desc.Depth),
+			mipLevels);
+	default:
+		return CD3DX12_RESOURCE_DESC::Tex2D(desc.Format, desc.Width, desc.Height, static_cast<UINT16>(desc.ArraySize),
+			mipLevels);
+	}
+}
+
+DXGI_FORMAT TextureUpload::FormatOf(MipChain::Format format)
+{
+	switch (format)
+	{
+	case MipChain::Format::RGBA8:
+		return DXGI_FORMAT_R8G8B8A8_UNORM;
+	case MipChain::Format::RGBA16F:
+		return DXGI_FORMAT_R16G16B16A16_FLOAT;
+	case MipChain::Format::R32F:
+		return DXGI_FORMAT_R32_FLOAT;
+	}
+	return DXGI_FORMAT_UNKNOWN;
+}
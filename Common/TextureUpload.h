@@ -0,0 +1,62 @@
+#pragma once
+#include <vector>
+#include "d3dBase.h"
+#include "GpuMemoryAllocator.h"
+#include "MipChain.h"
+#include "TextureFile.h"
+#include "UploadRingBuffer.h"
+
+// Texture uploads through an UploadRingBuffer.  The layout of the data in
+// upload memory is computed on the CPU, following the rules of
+// GetCopyableFootprints, and the rows are copied into it by several threads
+// at once rather than one subresource at a time as UpdateSubresources does.
+namespace TextureUpload
+{
+	struct Footprints
+	{
+		std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> Layouts;
+		std::vector<UINT> RowCounts;
+		std::vector<UINT64> RowSizes;
+		UINT64 TotalBytes = 0;
+	};
+
+	// What ID3D12Device::GetCopyableFootprints returns for subresourceCount
+	// subresources of desc from firstSubresource on, placed from baseOffset
+	// on: each subresource at a multiple of
+	// D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, each row at a multiple of
+	// D3D12_TEXTURE_DATA_PITCH_ALIGNMENT.  Returns false for buffers and for
+	// formats TextureFormat does not know.
+	bool ComputeFootprints(const D3D12_RESOURCE_DESC& desc, UINT firstSubresource, UINT subresourceCount,
+		UINT64 baseOffset, Footprints& footprints);
+
+	// Copies the rows of every subresource in src to their place in dest,
+	// mapped upload memory the footprints' offsets are relative to, over
+	// threadCount threads (0 for every hardware thread).  Small copies use
+	// fewer.
+	void CopySubresources(BYTE* dest, const Footprints& footprints, const D3D12_SUBRESOURCE_DATA* src,
+		UINT threadCount = 0);
+
+	// A texture in allocator with the data of subresources copied in by
+	// commands recorded to cmdList, after which it is in stateAfter.  The
+	// data is staged in uploads, so the caller Submit()s it with the fence
+	// of cmdList as for its other uploads.
+	Microsoft::WRL::ComPtr<ID3D12Resource> CreateTexture(GpuMemoryAllocator& allocator,
+		ID3D12GraphicsCommandList* cmdList, UploadRingBuffer& uploads, const D3D12_RESOURCE_DESC& desc,
+		const D3D12_SUBRESOURCE_DATA* subresources,
+		D3D12_RESOURCE_STATES stateAfter = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, UINT threadCount = 0);
+
+	// The same for a 2D texture with the levels of mips.
+	Microsoft::WRL::ComPtr<ID3D12Resource> CreateTexture(GpuMemoryAllocator& allocator,
+		ID3D12GraphicsCommandList* cmdList, UploadRingBuffer& uploads, MipChain& mips,
+		D3D12_RESOURCE_STATES stateAfter = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, UINT threadCount = 0);
+
+	// The same for the texture in file, copied straight from its mapping.
+	Microsoft::WRL::ComPtr<ID3D12Resource> CreateTexture(GpuMemoryAllocator& allocator,
+		ID3D12GraphicsCommandList* cmdList, UploadRingBuffer& uploads, const TextureFile& file,
+		D3D12_RESOURCE_STATES stateAfter = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, UINT threadCount = 0);
+
+	// The resource a texture from file is created as.
+	D3D12_RESOURCE_DESC ResourceDescOf(const TextureFile& file);
+
+	DXGI_FORMAT FormatOf(MipChain::Format format);
+}
@@ -1,11 +1,19 @@
 #pragma once
 
 #include "d3dUtil.h"
+#include "GpuMemoryAllocator.h"
+#include "StreamingWrites.h"
+
+// The mapped memory is write-combined: write whole elements, never read it.
+// CopyData() and CopyRange() write straight to it.
 template<typename T>
 class UploadBuffer
 {
 public:
+	// A committed buffer, for code without a GpuMemoryAllocator; see the
+	// overload below.
 	UploadBuffer(ID3D12Device* device, UINT elementCount, bool isConstantBuffer) :
+		mElementCount(elementCount),
 		mIsConstantBuffer(isConstantBuffer)
 	{
 		mElementByteSize = sizeof(T);
@@ -45,6 +53,20 @@ public:
 		// the GPU (so we must use synchronization techniques).
 	}
 
+	// The same with the buffer placed in one of allocator's upload heaps.
+	UploadBuffer(GpuMemoryAllocator& allocator, UINT elementCount, bool isConstantBuffer) :
+		mElementCount(elementCount),
+		mIsConstantBuffer(isConstantBuffer)
+	{
+		mElementByteSize = sizeof(T);
+		if (isConstantBuffer)
+			mElementByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(T));
+
+		mUploadBuffer = allocator.CreateResource(D3D12_HEAP_TYPE_UPLOAD,
+			CD3DX12_RESOURCE_DESC::Buffer(mElementByteSize * elementCount), D3D12_RESOURCE_STATE_GENERIC_READ);
+		ThrowIfFailed(mUploadBuffer->Map(0, nullptr, reinterpret_cast<void**>(&mMappedData)));
+	}
+
 	UploadBuffer(const UploadBuffer& rhs) = delete;
 
 	UploadBuffer& operator=(const UploadBuffer& rhs) = delete;
@@ -65,9 +87,50 @@ public:
 	{
 		memcpy(&mMappedData[elementIndex * mElementByteSize], &data, sizeof(T));
 	}
+
+	// Copies count elements of data to the buffer from firstElement on.
+	void CopyRange(UINT firstElement, const T* data, UINT count)
+	{
+		WriteElements(firstElement, reinterpret_cast<const BYTE*>(data), sizeof(T), count, sizeof(T));
+		StreamingWrites::Fence();
+	}
+
 private:
+	// Copies elementBytes of each of count elements, srcStride bytes apart in
+	// src.  Packed elements go out in one streamed write.  Padded ones are
+	// written in whole 64 byte lines, as a partly written line is flushed
+	// from the write-combining buffer in slow pieces; the padding comes from
+	// src if it is there, else is zero.
+	void WriteElements(UINT firstElement, const BYTE* src, size_t srcStride, UINT count, size_t elementBytes)
+	{
+		assert(firstElement + count <= mElementCount);
+		BYTE* dest = mMappedData + static_cast<size_t>(firstElement) * mElementByteSize;
+		if (srcStride == mElementByteSize && elementBytes == mElementByteSize)
+		{
+			StreamingWrites::Write(dest, src, static_cast<size_t>(count) * mElementByteSize);
+			return;
+		}
+
+		size_t lineBytes = (std::min)(static_cast<size_t>(mElementByteSize), (elementBytes + 63) & ~size_t(63));
+		if (srcStride >= lineBytes)
+		{
+			for (UINT i = 0; i < count; ++i)
+				StreamingWrites::Write(dest + static_cast<size_t>(i) * mElementByteSize, src + i * srcStride, lineBytes);
+		}
+		else
+		{
+			std::vector<DirectX::XMVECTOR> line((lineBytes + 15) / 16, DirectX::XMVectorZero());
+			for (UINT i = 0; i < count; ++i)
+			{
+				memcpy(line.data(), src + i * srcStride, elementBytes);
+				StreamingWrites::Write(dest + static_cast<size_t>(i) * mElementByteSize, line.data(), lineBytes);
+			}
+		}
+	}
+
 	Microsoft::WRL::ComPtr<ID3D12Resource> mUploadBuffer;
 	BYTE* mMappedData = nullptr;
 	UINT mElementByteSize = 0;
+	UINT mElementCount = 0;
 	bool mIsConstantBuffer = false;
 };
\ No newline at end of file
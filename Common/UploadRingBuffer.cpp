@@ -0,0 +1,236 @@
+#include "UploadRingBuffer.h"
+#include "GpuMemoryAllocator.h"
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	const UINT64 kCapacityGranularity = 64 * 1024;
+}
+
+UploadRingBuffer::UploadRingBuffer(ID3D12Device* device, ID3D12Fence* fence, UINT64 byteSize) :
+	mDevice(device),
+	mFence(fence)
+{
+	UINT64 capacity = (byteSize + kCapacityGranularity - 1) / kCapacityGranularity * kCapacityGranularity;
+	mRing.Reset(capacity);
+	mUploadBuffer = CreateUploadBuffer(capacity);
+
+	// Mapped for the buffer's lifetime; the ring keeps the CPU off the
+	// bytes the GPU may still be reading.
+	CD3DX12_RANGE readRange(0, 0);
+	ThrowIfFailed(mUploadBuffer->Map(0, &readRange, reinterpret_cast<void**>(&mMappedData)));
+	mStats.Capacity = capacity;
+}
+
+UploadRingBuffer::~UploadRingBuffer()
+{
+	if (mUploadBuffer != nullptr)
+		mUploadBuffer->Unmap(0, nullptr);
+	mMappedData = nullptr;
+}
+
+// Committed rather than placed by a GpuMemoryAllocator: the ring is one
+// long-lived buffer, and dedicated buffers are rare one-offs that retire
+// within a few frames.
+ComPtr<ID3D12Resource> UploadRingBuffer::CreateUploadBuffer(UINT64 byteSize) const
+{
+	CD3DX12_HEAP_PROPERTIES heapProps(D3D12_HEAP_TYPE_UPLOAD);
+	CD3DX12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
+	ComPtr<ID3D12Resource> buffer;
+	ThrowIfFailed(mDevice->CreateCommittedResource(
+		&heapProps,
+		D3D12_HEAP_FLAG_NONE,
+		&desc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(buffer.GetAddressOf())));
+	return buffer;
+}
+
+void UploadRingBuffer::WaitForFence(UINT64 fence)
+{
+	if (mFence->GetCompletedValue() >= fence)
+		return;
+
+#ifdef _WIN32
+	HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
+	ThrowIfFailed(mFence->SetEventOnCompletion(fence, eventHandle));
+	WaitForSingleObject(eventHandle, INFINITE);
+	CloseHandle(eventHandle);
+#else
+	// No Win32 events here; a null event makes the call itself wait.
+	ThrowIfFailed(mFence->SetEventOnCompletion(fence, nullptr));
+#endif
+}
+
+UploadRingBuffer::Allocation UploadRingBuffer::Allocate(UINT64 size, UINT64 alignment)
+{
+	assert(alignment <= D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+
+	UINT64 offset = mRing.Allocate(size, alignment);
+	// Out of room: the oldest submission is the first to free space.
+	while (offset == RingAllocator::InvalidOffset && size <= mRing.Capacity() && mRing.OldestFence() != 0)
+	{
+		++mStats.Stalls;
+		WaitForFence(mRing.OldestFence());
+		Retire();
+		offset = mRing.Allocate(size, alignment);
+	}
+
+	Allocation allocation;
+	if (offset != RingAllocator::InvalidOffset)
+	{
+		allocation.Resource = mUploadBuffer.Get();
+		allocation.Offset = offset;
+		allocation.CPU = mMappedData + offset;
+		return allocation;
+	}
+
+	// Too big for the ring, or nothing left to wait for.
+	++mStats.DedicatedBuffers;
+	DedicatedBuffer dedicated;
+	dedicated.Resource = CreateUploadBuffer(size);
+	CD3DX12_RANGE readRange(0, 0);
+	ThrowIfFailed(dedicated.Resource->Map(0, &readRange, &allocation.CPU));
+	allocation.Resource = dedicated.Resource.Get();
+	mDedicated.push_back(dedicated);
+	return allocation;
+}
+
+void UploadRingBuffer::Upload(ID3D12Resource* dest, UINT64 destOffset, const void* data, UINT64 size,
+	D3D12_RESOURCE_STATES stateBefore, D3D12_RESOURCE_STATES stateAfter)
+{
+	if (size == 0)
+		return;
+
+	Allocation allocation = Allocate(size);
+	std::memcpy(allocation.CPU, data, static_cast<size_t>(size));
+
+	// A copy that continues the previous one, as when a buffer is staged in
+	// pieces, extends it.
+	if (!mPendingCopies.empty())
+	{
+		PendingCopy& last = mPendingCopies.back();
+		if (last.Dest == dest && last.DestOffset + last.Size == destOffset &&
+			last.Source == allocation.Resource && last.SourceOffset + last.Size == allocation.Offset)
+		{
+			last.Size += size;
+			last.StateAfter = stateAfter;
+			++mStats.UploadCount;
+			mStats.UploadedBytes += size;
+			return;
+		}
+	}
+
+	mPendingCopies.push_back({ dest, destOffset, allocation.Resource, allocation.Offset, size, stateBefore, stateAfter });
+	++mStats.UploadCount;
+	mStats.UploadedBytes += size;
+}
+
+ComPtr<ID3D12Resource> UploadRingBuffer::CreateDefaultBuffer(const void* initData, UINT64 byteSize,
+	D3D12_RESOURCE_STATES stateAfter)
+{
+	CD3DX12_HEAP_PROPERTIES heapProps(D3D12_HEAP_TYPE_DEFAULT);
+	CD3DX12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
+	ComPtr<ID3D12Resource> buffer;
+	ThrowIfFailed(mDevice->CreateCommittedResource(
+		&heapProps,
+		D3D12_HEAP_FLAG_NONE,
+		&desc,
+		D3D12_RESOURCE_STATE_COMMON,
+		nullptr,
+		IID_PPV_ARGS(buffer.GetAddressOf())));
+
+	Upload(buffer.Get(), 0, initData, byteSize, D3D12_RESOURCE_STATE_COMMON, stateAfter);
+	return buffer;
+}
+
+ComPtr<ID3D12Resource> UploadRingBuffer::CreateDefaultBuffer(GpuMemoryAllocator& allocator, const void* initData,
+	UINT64 byteSize, D3D12_RESOURCE_STATES stateAfter)
+{
+	ComPtr<ID3D12Resource> buffer = allocator.CreateResource(D3D12_HEAP_TYPE_DEFAULT,
+		CD3DX12_RESOURCE_DESC::Buffer(byteSize), D3D12_RESOURCE_STATE_COMMON);
+	Upload(buffer.Get(), 0, initData, byteSize, D3D12_RESOURCE_STATE_COMMON, stateAfter);
+	return buffer;
+}
+
+void UploadRingBuffer::Flush(ID3D12GraphicsCommandList* cmdList)
+{
+	if (mPendingCopies.empty())
+		return;
+
+	// One transition per destination each way, however many copies it gets.
+	struct Destination
+	{
+		ID3D12Resource* Resource;
+		D3D12_RESOURCE_STATES StateBefore;
+		D3D12_RESOURCE_STATES StateAfter;
+	};
+	std::vector<Destination> destinations;
+	std::unordered_map<ID3D12Resource*, size_t> destinationIndex;
+	for (const PendingCopy& copy : mPendingCopies)
+	{
+		auto inserted = destinationIndex.insert({ copy.Dest, destinations.size() });
+		if (inserted.second)
+			destinations.push_back({ copy.Dest, copy.StateBefore, copy.StateAfter });
+		else
+			destinations[inserted.first->second].StateAfter = copy.StateAfter;
+	}
+
+	std::vector<D3D12_RESOURCE_BARRIER> barriers;
+	for (const Destination& destination : destinations)
+	{
+		if (destination.StateBefore != D3D12_RESOURCE_STATE_COPY_DEST)
+			barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(destination.Resource,
+				destination.StateBefore, D3D12_RESOURCE_STATE_COPY_DEST));
+	}
+	if (!barriers.empty())
+		cmdList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+
+	for (const PendingCopy& copy : mPendingCopies)
+		cmdList->CopyBufferRegion(copy.Dest, copy.DestOffset, copy.Source, copy.SourceOffset, copy.Size);
+
+	barriers.clear();
+	for (const Destination& destination : destinations)
+	{
+		if (destination.StateAfter != D3D12_RESOURCE_STATE_COPY_DEST)
+			barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(destination.Resource,
+				D3D12_RESOURCE_STATE_COPY_DEST, destination.StateAfter));
+	}
+	if (!barriers.empty())
+		cmdList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+
+	mPendingCopies.clear();
+}
+
+void UploadRingBuffer::Submit(UINT64 fence)
+{
+	mRing.Submit(fence);
+	for (DedicatedBuffer& dedicated : mDedicated)
+	{
+		if (dedicated.Fence == 0)
+			dedicated.Fence = fence;
+	}
+}
+
+void UploadRingBuffer::Retire()
+{
+	UINT64 completedFence = mFence->GetCompletedValue();
+	mRing.Retire(completedFence);
+	mDedicated.erase(std::remove_if(mDedicated.begin(), mDedicated.end(),
+		[completedFence](const DedicatedBuffer& dedicated)
+		{
+			return dedicated.Fence != 0 && dedicated.Fence <= completedFence;
+		}), mDedicated.end());
+}
+
+UploadRingBuffer::Stats UploadRingBuffer::GetStats() const
+{
+	Stats stats = mStats;
+	stats.UsedBytes = mRing.UsedSize();
+	return stats;
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "d3dBase.h"
+#include "RingAllocator.h"
+
+class GpuMemoryAllocator;
+
+// One persistently mapped upload heap that every upload is staged through,
+// in place of a committed upload buffer per CreateDefaultBuffer call.
+//
+// Upload() copies data into ring space and queues a copy; Flush() records
+// all the queued copies into a command list between one batch of barriers
+// into COPY_DEST and one batch back out.  After the command list executes,
+// Submit() tags the ring space with the fence value signalled after it, and
+// Retire() frees the space once the GPU has passed that value.
+//
+// When the ring is full, Allocate() waits for the oldest submission rather
+// than create more upload memory.  Only an upload larger than the whole
+// ring, or one that finds the ring filled by copies not yet submitted, gets
+// a dedicated upload buffer, retired with the same fence.
+class UploadRingBuffer
+{
+public:
+	struct Allocation
+	{
+		ID3D12Resource* Resource = nullptr;
+		UINT64 Offset = 0;
+		// Write-combined memory: write it sequentially and never read it.
+		void* CPU = nullptr;
+	};
+
+	struct Stats
+	{
+		UINT64 Capacity = 0;
+		UINT64 UsedBytes = 0;
+		UINT64 UploadCount = 0;
+		UINT64 UploadedBytes = 0;
+		// Times Allocate() waited for the GPU.
+		UINT64 Stalls = 0;
+		// Uploads that did not fit the ring.
+		UINT64 DedicatedBuffers = 0;
+	};
+
+	// fence is the one the caller signals on the queue the copies execute
+	// on.  byteSize is rounded up to 64 KB.
+	UploadRingBuffer(ID3D12Device* device, ID3D12Fence* fence, UINT64 byteSize);
+	UploadRingBuffer(const UploadRingBuffer& rhs) = delete;
+	UploadRingBuffer& operator=(const UploadRingBuffer& rhs) = delete;
+	~UploadRingBuffer();
+
+	// size bytes of mapped upload memory, at a multiple of alignment up to
+	// D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, for callers that record their
+	// own copies.  Valid until the Submit() after those copies retires.
+	Allocation Allocate(UINT64 size, UINT64 alignment = 16);
+
+	// Stages data for a copy into dest at destOffset at the next Flush().
+	// dest is moved from stateBefore to COPY_DEST and then to stateAfter; with
+	// several copies into one resource, the first one's stateBefore and the
+	// last one's stateAfter count.  Keep dest alive until the copy executes.
+	void Upload(ID3D12Resource* dest, UINT64 destOffset, const void* data, UINT64 size,
+		D3D12_RESOURCE_STATES stateBefore, D3D12_RESOURCE_STATES stateAfter);
+
+	// A committed default heap buffer with initData staged into it; it is in
+	// stateAfter once the next Flush() has executed.
+	Microsoft::WRL::ComPtr<ID3D12Resource> CreateDefaultBuffer(const void* initData, UINT64 byteSize,
+		D3D12_RESOURCE_STATES stateAfter = D3D12_RESOURCE_STATE_GENERIC_READ);
+	// The same with the buffer placed in one of allocator's heaps.
+	Microsoft::WRL::ComPtr<ID3D12Resource> CreateDefaultBuffer(GpuMemoryAllocator& allocator, const void* initData,
+		UINT64 byteSize, D3D12_RESOURCE_STATES stateAfter = D3D12_RESOURCE_STATE_GENERIC_READ);
+
+	// Records the staged copies.
+	void Flush(ID3D12GraphicsCommandList* cmdList);
+
+	// Tags the space used since the last call with fence, signalled after the
+	// command lists that read it.
+	void Submit(UINT64 fence);
+	// Frees the space of submissions the fence has completed.  Call it once
+	// a frame.
+	void Retire();
+
+	Stats GetStats() const;
+
+private:
+	struct PendingCopy
+	{
+		ID3D12Resource* Dest;
+		UINT64 DestOffset;
+		ID3D12Resource* Source;
+		UINT64 SourceOffset;
+		UINT64 Size;
+		D3D12_RESOURCE_STATES StateBefore;
+		D3D12_RESOURCE_STATES StateAfter;
+	};
+
+	struct DedicatedBuffer
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+		// 0 until Submit().
+		UINT64 Fence = 0;
+	};
+
+	void WaitForFence(UINT64 fence);
+	Microsoft::WRL::ComPtr<ID3D12Resource> CreateUploadBuffer(UINT64 byteSize) const;
+
+	ID3D12Device* mDevice = nullptr;
+	ID3D12Fence* mFence = nullptr;
+
+	RingAllocator mRing;
+	Microsoft::WRL::ComPtr<ID3D12Resource> mUploadBuffer;
+	BYTE* mMappedData = nullptr;
+
+	std::vector<PendingCopy> mPendingCopies;
+	std::vector<DedicatedBuffer> mDedicated;
+	Stats mStats;
+};
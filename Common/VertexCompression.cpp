@@ -0,0 +1,241 @@
+#include "VertexCompression.h"
+#include "MathHelper.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	const float kUnorm16Max = 65535.0f;
+	const float kSnorm16Max = 32767.0f;
+
+	float SignNotZero(float v)
+	{
+		return v >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	std::int16_t ToSnorm16(float v)
+	{
+		return static_cast<std::int16_t>(std::round(MathHelper::Clamp(v, -1.0f, 1.0f) * kSnorm16Max));
+	}
+
+	float FromSnorm16(std::int16_t v)
+	{
+		// -32768 and -32767 both map to -1, as on the GPU.
+		return (std::max)(v / kSnorm16Max, -1.0f);
+	}
+
+	XMFLOAT3 OctahedralToVector(float x, float y)
+	{
+		XMFLOAT3 n(x, y, 1.0f - std::fabs(x) - std::fabs(y));
+		float t = (std::max)(-n.z, 0.0f);
+		n.x += n.x >= 0.0f ? -t : t;
+		n.y += n.y >= 0.0f ? -t : t;
+
+		XMFLOAT3 result;
+		XMStoreFloat3(&result, XMVector3Normalize(XMLoadFloat3(&n)));
+		return result;
+	}
+
+	float AngleBetween(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		// A zero vector (the geosphere's tangent at the poles) has no
+		// direction to lose.
+		if (XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&a))) < 1e-12f)
+			return 0.0f;
+
+		XMVECTOR va = XMVector3Normalize(XMLoadFloat3(&a));
+		XMVECTOR vb = XMVector3Normalize(XMLoadFloat3(&b));
+		float dot = MathHelper::Clamp(XMVectorGetX(XMVector3Dot(va, vb)), -1.0f, 1.0f);
+		return XMConvertToDegrees(std::acos(dot));
+	}
+}
+
+PositionQuantization VertexCompression::QuantizationFor(const BoundingBox& bounds)
+{
+	PositionQuantization q;
+	q.Offset = XMFLOAT3(
+		bounds.Center.x - bounds.Extents.x,
+		bounds.Center.y - bounds.Extents.y,
+		bounds.Center.z - bounds.Extents.z);
+
+	// A flat axis (the grid's y) still needs a non-zero scale to divide by.
+	q.Scale = XMFLOAT3(
+		(std::max)(2.0f * bounds.Extents.x, 1e-6f),
+		(std::max)(2.0f * bounds.Extents.y, 1e-6f),
+		(std::max)(2.0f * bounds.Extents.z, 1e-6f));
+	return q;
+}
+
+void VertexCompression::QuantizePosition(const XMFLOAT3& p, const PositionQuantization& quantization, std::uint16_t out[4])
+{
+	auto quantize = [](float v, float offset, float scale)
+	{
+		float unorm = MathHelper::Clamp((v - offset) / scale, 0.0f, 1.0f);
+		return static_cast<std::uint16_t>(unorm * kUnorm16Max + 0.5f);
+	};
+
+	out[0] = quantize(p.x, quantization.Offset.x, quantization.Scale.x);
+	out[1] = quantize(p.y, quantization.Offset.y, quantization.Scale.y);
+	out[2] = quantize(p.z, quantization.Offset.z, quantization.Scale.z);
+	out[3] = 0xffff;
+}
+
+XMFLOAT3 VertexCompression::DequantizePosition(const std::uint16_t in[4], const PositionQuantization& quantization)
+{
+	return XMFLOAT3(
+		quantization.Offset.x + in[0] / kUnorm16Max * quantization.Scale.x,
+		quantization.Offset.y + in[1] / kUnorm16Max * quantization.Scale.y,
+		quantization.Offset.z + in[2] / kUnorm16Max * quantization.Scale.z);
+}
+
+void VertexCompression::EncodeOctahedral(const XMFLOAT3& n, std::int16_t out[2])
+{
+	// Project onto the octahedron |x| + |y| + |z| = 1 and fold the lower
+	// half over the diagonals.
+	float invL1 = 1.0f / (std::max)(std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z), 1e-20f);
+	float x = n.x * invL1;
+	float y = n.y * invL1;
+	if (n.z < 0.0f)
+	{
+		float foldedX = (1.0f - std::fabs(y)) * SignNotZero(x);
+		float foldedY = (1.0f - std::fabs(x)) * SignNotZero(y);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	// Plain rounding is not always the closest code after decoding; try the
+	// four neighbours (Cigolle et al., "A Survey of Efficient Representations
+	// for Independent Unit Vectors").
+	float baseX = std::floor(MathHelper::Clamp(x, -1.0f, 1.0f) * kSnorm16Max);
+	float baseY = std::floor(MathHelper::Clamp(y, -1.0f, 1.0f) * kSnorm16Max);
+	XMVECTOR target = XMVector3Normalize(XMLoadFloat3(&n));
+	float bestDot = -2.0f;
+	for (int i = 0; i < 4; ++i)
+	{
+		std::int16_t candidate[2] =
+		{
+			ToSnorm16((baseX + (i & 1)) / kSnorm16Max),
+			ToSnorm16((baseY + (i >> 1)) / kSnorm16Max)
+		};
+
+		XMFLOAT3 decoded = DecodeOctahedral(candidate);
+		float dot = XMVectorGetX(XMVector3Dot(XMLoadFloat3(&decoded), target));
+		if (dot > bestDot)
+		{
+			bestDot = dot;
+			out[0] = candidate[0];
+			out[1] = candidate[1];
+		}
+	}
+}
+
+XMFLOAT3 VertexCompression::DecodeOctahedral(const std::int16_t in[2])
+{
+	return OctahedralToVector(FromSnorm16(in[0]), FromSnorm16(in[1]));
+}
+
+void VertexCompression::Encode(const GeometryGenerator::Vertex* vertices, size_t count,
+	const PositionQuantization& quantization, PackedVertex* out)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		const GeometryGenerator::Vertex& v = vertices[i];
+		QuantizePosition(v.Position, quantization, out[i].Position);
+		EncodeOctahedral(v.Normal, out[i].Normal);
+		EncodeOctahedral(v.TangentU, out[i].TangentU);
+		out[i].TexC = XMHALF2(v.TexC.x, v.TexC.y);
+	}
+}
+
+GeometryGenerator::Vertex VertexCompression::Decode(const PackedVertex& vertex, const PositionQuantization& quantization)
+{
+	GeometryGenerator::Vertex v;
+	v.Position = DequantizePosition(vertex.Position, quantization);
+	v.Normal = DecodeOctahedral(vertex.Normal);
+	v.TangentU = DecodeOctahedral(vertex.TangentU);
+	v.TexC = XMFLOAT2(XMConvertHalfToFloat(vertex.TexC.x), XMConvertHalfToFloat(vertex.TexC.y));
+	return v;
+}
+
+void VertexCompression::EncodeStreams(const GeometryGenerator::Vertex* vertices, size_t count,
+	const PositionQuantization& quantization, std::uint16_t* positions, PackedAttributes* attributes)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		const GeometryGenerator::Vertex& v = vertices[i];
+		QuantizePosition(v.Position, quantization, positions + 4 * i);
+		EncodeOctahedral(v.Normal, attributes[i].Normal);
+		EncodeOctahedral(v.TangentU, attributes[i].TangentU);
+		attributes[i].TexC = XMHALF2(v.TexC.x, v.TexC.y);
+	}
+}
+
+void VertexCompression::EncodeStreams(const GeometryGenerator::MeshDataSoA& mesh,
+	const PositionQuantization& quantization, std::uint16_t* positions, PackedAttributes* attributes)
+{
+	for (size_t i = 0; i < mesh.Positions.size(); ++i)
+		QuantizePosition(mesh.Positions[i], quantization, positions + 4 * i);
+	for (size_t i = 0; i < mesh.Positions.size(); ++i)
+	{
+		EncodeOctahedral(mesh.Normals[i], attributes[i].Normal);
+		EncodeOctahedral(mesh.TangentUs[i], attributes[i].TangentU);
+		attributes[i].TexC = XMHALF2(mesh.TexCs[i].x, mesh.TexCs[i].y);
+	}
+}
+
+VertexCompression::ErrorStats VertexCompression::MeasureError(const GeometryGenerator::Vertex* vertices, size_t count,
+	const PositionQuantization& quantization)
+{
+	ErrorStats stats;
+	for (size_t i = 0; i < count; ++i)
+	{
+		const GeometryGenerator::Vertex& v = vertices[i];
+		PackedVertex packed;
+		Encode(&v, 1, quantization, &packed);
+		GeometryGenerator::Vertex decoded = Decode(packed, quantization);
+
+		XMVECTOR positionDelta = XMVectorSubtract(XMLoadFloat3(&v.Position), XMLoadFloat3(&decoded.Position));
+		stats.MaxPositionError = (std::max)(stats.MaxPositionError, XMVectorGetX(XMVector3Length(positionDelta)));
+		stats.MaxNormalAngle = (std::max)(stats.MaxNormalAngle, AngleBetween(v.Normal, decoded.Normal));
+		stats.MaxTangentAngle = (std::max)(stats.MaxTangentAngle, AngleBetween(v.TangentU, decoded.TangentU));
+		stats.MaxTexCError = (std::max)(stats.MaxTexCError,
+			(std::max)(std::fabs(v.TexC.x - decoded.TexC.x), std::fabs(v.TexC.y - decoded.TexC.y)));
+	}
+	return stats;
+}
+
+const std::vector<D3D12_INPUT_ELEMENT_DESC>& VertexCompression::PackedVertexLayout()
+{
+	static const std::vector<D3D12_INPUT_ELEMENT_DESC> layout =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, offsetof(PackedVertex, Position), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, offsetof(PackedVertex, Normal), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 0, offsetof(PackedVertex, TangentU), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, offsetof(PackedVertex, TexC), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+	};
+	return layout;
+}
+
+const std::vector<D3D12_INPUT_ELEMENT_DESC>& VertexCompression::PackedPositionLayout()
+{
+	static const std::vector<D3D12_INPUT_ELEMENT_DESC> layout =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+	};
+	return layout;
+}
+
+const std::vector<D3D12_INPUT_ELEMENT_DESC>& VertexCompression::SplitStreamLayout()
+{
+	static const std::vector<D3D12_INPUT_ELEMENT_DESC> layout =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 1, offsetof(PackedAttributes, Normal), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 1, offsetof(PackedAttributes, TangentU), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 1, offsetof(PackedAttributes, TexC), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+	};
+	return layout;
+}
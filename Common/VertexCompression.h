@@ -0,0 +1,95 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#ifndef _WIN32
+#include <wsl/winadapter.h>
+#endif
+#include <d3d12.h>
+#include <DirectXCollision.h>
+#include <DirectXPackedVector.h>
+#include "GeometryGenerator.h"
+
+// Maps unorm16 positions back to object space: p = Offset + q * Scale, with q
+// in [0, 1].  Derived from the submesh bounds, so the 16 bits cover only the
+// space the mesh actually occupies.
+struct PositionQuantization
+{
+	DirectX::XMFLOAT3 Offset = { 0.0f, 0.0f, 0.0f };
+	DirectX::XMFLOAT3 Scale = { 1.0f, 1.0f, 1.0f };
+};
+
+// GeometryGenerator::Vertex in 20 bytes instead of 44.
+struct PackedVertex
+{
+	// DXGI_FORMAT_R16G16B16A16_UNORM; w is always 1.
+	std::uint16_t Position[4];
+	// DXGI_FORMAT_R16G16_SNORM, octahedral.
+	std::int16_t Normal[2];
+	// DXGI_FORMAT_R16G16_SNORM, octahedral.
+	std::int16_t TangentU[2];
+	// DXGI_FORMAT_R16G16_FLOAT.
+	DirectX::PackedVector::XMHALF2 TexC;
+};
+static_assert(sizeof(PackedVertex) == 20, "PackedVertexLayout() assumes no padding");
+
+// PackedVertex without its position, 12 bytes, for an attribute stream that
+// goes next to a position-only stream of unorm16x4.
+struct PackedAttributes
+{
+	std::int16_t Normal[2];
+	std::int16_t TangentU[2];
+	DirectX::PackedVector::XMHALF2 TexC;
+};
+static_assert(sizeof(PackedAttributes) == 12, "SplitStreamLayout() assumes no padding");
+
+// Encoding and decoding for PackedVertex.  The matching shader side is in
+// VertexCompression.hlsli.
+class VertexCompression
+{
+public:
+	struct ErrorStats
+	{
+		// Largest object space distance between a position and its decode.
+		float MaxPositionError = 0.0f;
+		// Largest angle, in degrees, between a direction and its decode.
+		float MaxNormalAngle = 0.0f;
+		float MaxTangentAngle = 0.0f;
+		float MaxTexCError = 0.0f;
+	};
+
+	static PositionQuantization QuantizationFor(const DirectX::BoundingBox& bounds);
+
+	static void QuantizePosition(const DirectX::XMFLOAT3& p, const PositionQuantization& quantization, std::uint16_t out[4]);
+	static DirectX::XMFLOAT3 DequantizePosition(const std::uint16_t in[4], const PositionQuantization& quantization);
+
+	// Octahedral mapping of a unit vector to two snorm16s.  The encode picks
+	// the rounding of the four nearest that decodes closest to the input.
+	static void EncodeOctahedral(const DirectX::XMFLOAT3& n, std::int16_t out[2]);
+	static DirectX::XMFLOAT3 DecodeOctahedral(const std::int16_t in[2]);
+
+	static void Encode(const GeometryGenerator::Vertex* vertices, size_t count,
+		const PositionQuantization& quantization, PackedVertex* out);
+	static GeometryGenerator::Vertex Decode(const PackedVertex& vertex, const PositionQuantization& quantization);
+
+	// Encodes into two streams, four uint16s of position per vertex and a
+	// PackedAttributes per vertex, with the same values Encode() produces.
+	static void EncodeStreams(const GeometryGenerator::Vertex* vertices, size_t count,
+		const PositionQuantization& quantization, std::uint16_t* positions, PackedAttributes* attributes);
+	// The same straight from the generator's SoA streams.
+	static void EncodeStreams(const GeometryGenerator::MeshDataSoA& mesh,
+		const PositionQuantization& quantization, std::uint16_t* positions, PackedAttributes* attributes);
+
+	// Round trips every vertex and reports the worst error per attribute.
+	static ErrorStats MeasureError(const GeometryGenerator::Vertex* vertices, size_t count,
+		const PositionQuantization& quantization);
+
+	// Input layout of PackedVertex, semantics as in VertexCompression.hlsli.
+	static const std::vector<D3D12_INPUT_ELEMENT_DESC>& PackedVertexLayout();
+	// Input layout of a position-only stream of unorm16x4.
+	static const std::vector<D3D12_INPUT_ELEMENT_DESC>& PackedPositionLayout();
+	// Input layout of the two streams of EncodeStreams(): positions in slot 0
+	// and PackedAttributes in slot 1.  Passes that need only positions use
+	// PackedPositionLayout() and bind slot 0 alone.
+	static const std::vector<D3D12_INPUT_ELEMENT_DESC>& SplitStreamLayout();
+};
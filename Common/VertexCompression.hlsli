@@ -0,0 +1,23 @@
+// Shader side of VertexCompression.h: decodes the fields of PackedVertex once
+// the input assembler has converted them to floats.
+
+#ifndef VERTEX_COMPRESSION_HLSLI
+#define VERTEX_COMPRESSION_HLSLI
+
+// Positions arrive as R16G16B16A16_UNORM, already in [0, 1].  offset and scale
+// come from PositionQuantization.
+float3 DequantizePosition(float3 q, float3 offset, float3 scale)
+{
+    return offset + q * scale;
+}
+
+// Normals and tangents arrive as R16G16_SNORM, already in [-1, 1].
+float3 DecodeOctahedral(float2 e)
+{
+    float3 n = float3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.xy += (n.xy >= 0.0f) ? -t : t;
+    return normalize(n);
+}
+
+#endif // VERTEX_COMPRESSION_HLSLI
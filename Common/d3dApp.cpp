@@ -84,6 +84,7 @@ int D3DApp::Run()
 			if (!mAppPaused)
 			{
 				CalculateFrameStats();
+				mDeferredReleases.Collect(mFence->GetCompletedValue());
 				Update(mTimer);
 				Draw(mTimer);
 			}
@@ -191,6 +192,8 @@ bool D3DApp::InitDirect3D()
 	}
 #endif
 
+	mGpuAllocator = std::make_unique<GpuMemoryAllocator>(md3dDevice.Get());
+
 	// Create the Fence and Descriptor Sizes
 
 	ThrowIfFailed(md3dDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mFence)));
@@ -427,6 +430,9 @@ void D3DApp::CreateCommandObjects()
 	// refer to the command list we will Reset it, and it needs to be
 	// closed before calling Reset.
 	mCommandList->Close();
+
+	// A second queue, with its own allocators and fence, for uploads.
+	mCopyQueue = std::make_unique<CopyQueue>(md3dDevice.Get());
 }
 
 void D3DApp::OnResize()
@@ -435,7 +441,9 @@ void D3DApp::OnResize()
 	assert(mSwapChain);
 	assert(mDirectCmdListAlloc);
 
-	// Flush before changing any resources.
+	// Flush before changing any resources.  ResizeBuffers needs the GPU done
+	// with every back buffer, and every frame uses one, so this can't wait on
+	// anything less; other resources go through mDeferredReleases instead.
 	FlushCommandQueue();
 
 	// https://learn.microsoft.com/en-us/windows/win32/api/d3d12/nf-d3d12-id3d12graphicscommandlist-reset
@@ -489,14 +497,10 @@ void D3DApp::OnResize()
 	optClear.Format = mDepthStencilFormat;
 	optClear.DepthStencil.Depth = 1.0f;
 	optClear.DepthStencil.Stencil = 0;
-	CD3DX12_HEAP_PROPERTIES DSHeapProperties(D3D12_HEAP_TYPE_DEFAULT);
-	ThrowIfFailed(md3dDevice->CreateCommittedResource(
-		&DSHeapProperties,
-		D3D12_HEAP_FLAG_NONE,
-		&depthStencilDesc,
-		D3D12_RESOURCE_STATE_COMMON,
-		&optClear,
-		IID_PPV_ARGS(mDepthStencilBuffer.GetAddressOf())));
+	// Placed in the allocator's render target heaps; the previous depth
+	// buffer's space is reused when the size allows.
+	mDepthStencilBuffer = mGpuAllocator->CreateResource(D3D12_HEAP_TYPE_DEFAULT, depthStencilDesc,
+		D3D12_RESOURCE_STATE_COMMON, &optClear);
 
 	// Create descriptor to mip level 0 of entire resource using the format of the resource.
 	D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc;
@@ -512,6 +516,9 @@ void D3DApp::OnResize()
 		D3D12_RESOURCE_STATE_COMMON, 
 		D3D12_RESOURCE_STATE_DEPTH_WRITE);
 	mCommandList->ResourceBarrier(1, &barrier);
+	// A placed depth buffer has undefined contents, including its
+	// compression metadata, until it is cleared or discarded.
+	mCommandList->DiscardResource(mDepthStencilBuffer.Get(), nullptr);
 
 	// Execute the resize commands.
 	// Close before ExecuteCommandLists
@@ -11,6 +11,9 @@
 #include <d3d12.h>          // DirectX 12 core
 
 #include "d3dUtil.h"
+#include "DeferredReleaseQueue.h"
+#include "GpuMemoryAllocator.h"
+#include "CopyQueue.h"
 #include "GameTimer.h"
 // Link necessary d3d12 libraries.
 #pragma comment(lib,"d3dcompiler.lib")
@@ -83,6 +86,9 @@ protected:
 	Microsoft::WRL::ComPtr<IDXGISwapChain> mSwapChain;
 
 	Microsoft::WRL::ComPtr<ID3D12Device> md3dDevice;
+	// Heaps for placed resources.  Declared before every resource placed in
+	// it, so it is destroyed after them.
+	std::unique_ptr<GpuMemoryAllocator> mGpuAllocator;
 	
 	Microsoft::WRL::ComPtr<ID3D12Fence> mFence;
 	UINT64 mCurrentFence = 0;
@@ -90,6 +96,11 @@ protected:
 	Microsoft::WRL::ComPtr<ID3D12CommandQueue> mCommandQueue;
 	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> mDirectCmdListAlloc;
 	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> mCommandList;
+	// Uploads that run while frames render; see CopyQueue::WaitOnGpu.
+	std::unique_ptr<CopyQueue> mCopyQueue;
+	// Objects the GPU may still use, dropped once mFence passes their
+	// value; collected before every Update.
+	DeferredReleaseQueue mDeferredReleases;
 
 	
 	// How to use during rendering?
@@ -0,0 +1,67 @@
+#pragma once
+
+// The part of d3dUtil.h that needs only d3d12.h: the Windows and D3D12
+// headers, DxException and ThrowIfFailed.  Code that talks to the device
+// and nothing else includes this rather than d3dUtil.h, so that off Windows
+// it builds against the DirectX-Headers WSL adapters for the tests.
+
+#ifdef _WIN32
+#include <windows.h>
+#include <wrl.h>
+#else
+#include <wsl/winadapter.h>
+#include <wsl/wrladapter.h>
+#endif
+#include <d3d12.h>
+#include <string>
+#include "d3dx12.h"
+#ifndef _WIN32
+#include <dxguids/dxguids.h>
+#endif
+
+inline std::wstring AnsiToWString(const std::string& str)
+{
+#ifdef _WIN32
+    WCHAR buffer[512];
+    MultiByteToWideChar(CP_ACP, 0, str.c_str(), -1, buffer, 512);
+    return std::wstring(buffer);
+#else
+    return std::wstring(str.begin(), str.end());
+#endif
+}
+
+class DxException
+{
+public:
+    DxException() = default;
+    DxException(HRESULT hr, const std::wstring& functionName, const std::wstring& filename, int lineNumber) :
+        ErrorCode(hr),
+        FunctionName(functionName),
+        Filename(filename),
+        LineNumber(lineNumber)
+    {
+    }
+
+    std::wstring ToString()const;
+
+    HRESULT ErrorCode = S_OK;
+    std::wstring FunctionName;
+    std::wstring Filename;
+    int LineNumber = -1;
+};
+
+// L#x, which only MSVC reads as one wide string literal.
+#define DxWiden(s) L ## s
+
+#ifndef ThrowIfFailed
+#define ThrowIfFailed(x)                                                      \
+{                                                                             \
+    HRESULT hr__ = (x);                                                       \
+    std::wstring wfn = AnsiToWString(__FILE__);                               \
+    if(FAILED(hr__)) { throw DxException(hr__, DxWiden(#x), wfn, __LINE__); } \
+}
+#endif
+
+#ifndef ReleaseCom
+#define ReleaseCom(x) { if(x){ x->Release(); x = 0; } }
+#endif
@@ -1,17 +1,15 @@
 #include "d3dUtil.h"
+#include "MeshGeometry.h"
+#include "DeferredReleaseQueue.h"
+#include "GpuMemoryAllocator.h"
+#include "MeshFile.h"
+#include "UploadRingBuffer.h"
 #include <comdef.h>
 #include <fstream>
+#include <unordered_set>
 
 using Microsoft::WRL::ComPtr;
 
-DxException::DxException(HRESULT hr, const std::wstring& functionName, const std::wstring& filename, int lineNumber) :
-    ErrorCode(hr),
-    FunctionName(functionName),
-    Filename(filename),
-    LineNumber(lineNumber)
-{
-}
-
 std::wstring DxException::ToString()const
 {
     // Get the string description of the error code.
@@ -21,6 +19,34 @@ std::wstring DxException::ToString()const
     return FunctionName + L" failed in " + Filename + L"; line " + std::to_wstring(LineNumber) + L"; error: " + msg;
 }
 
+namespace
+{
+    // Records the copy of initData into defaultBuffer, in COMMON, through
+    // uploadBuffer, and leaves defaultBuffer in GENERIC_READ.
+    void RecordBufferUpload(ID3D12GraphicsCommandList* cmdList, ID3D12Resource* defaultBuffer,
+        ID3D12Resource* uploadBuffer, const void* initData, UINT64 byteSize)
+    {
+        // Describe the data we want to copy into the default buffer.
+        D3D12_SUBRESOURCE_DATA subResourceData = {};
+        subResourceData.pData = initData;
+        subResourceData.RowPitch = byteSize;
+        subResourceData.SlicePitch = subResourceData.RowPitch;
+
+        // Schedule to copy the data to the default buffer resource.
+        // At a high level, the helper function UpdateSubresources
+        // will copy the CPU memory into the intermediate upload heap.
+        // Then, using ID3D12CommandList::CopySubresourceRegion,
+        // the intermediate upload heap data will be copied to mBuffer.
+        cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer,
+                D3D12_RESOURCE_STATE_COMMON,
+                D3D12_RESOURCE_STATE_COPY_DEST));
+        UpdateSubresources<1>(cmdList, defaultBuffer, uploadBuffer, 0, 0, 1, &subResourceData);
+        cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer,
+                D3D12_RESOURCE_STATE_COPY_DEST,
+                D3D12_RESOURCE_STATE_GENERIC_READ));
+    }
+}
+
 // Pass a uploadBuffer as argument
 // Return a ID3D12Resource in default buffer
 Microsoft::WRL::ComPtr<ID3D12Resource> d3dUtil::CreateDefaultBuffer(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const void* initData, UINT64 byteSize, Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer)
@@ -46,24 +72,7 @@ Microsoft::WRL::ComPtr<ID3D12Resource> d3dUtil::CreateDefaultBuffer(ID3D12Device
         nullptr,
         IID_PPV_ARGS(uploadBuffer.GetAddressOf())));
 
-    // Describe the data we want to copy into the default buffer.
-    D3D12_SUBRESOURCE_DATA subResourceData = {};
-    subResourceData.pData = initData;
-    subResourceData.RowPitch = byteSize;
-    subResourceData.SlicePitch = subResourceData.RowPitch;
-
-    // Schedule to copy the data to the default buffer resource.
-    // At a high level, the helper function UpdateSubresources
-    // will copy the CPU memory into the intermediate upload heap.
-    // Then, using ID3D12CommandList::CopySubresourceRegion,
-    // the intermediate upload heap data will be copied to mBuffer.
-    cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(),
-            D3D12_RESOURCE_STATE_COMMON,
-            D3D12_RESOURCE_STATE_COPY_DEST));
-    UpdateSubresources<1>(cmdList, defaultBuffer.Get(), uploadBuffer.Get(), 0, 0, 1, &subResourceData);
-    cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(),
-            D3D12_RESOURCE_STATE_COPY_DEST,
-            D3D12_RESOURCE_STATE_GENERIC_READ));
+    RecordBufferUpload(cmdList, defaultBuffer.Get(), uploadBuffer.Get(), initData, byteSize);
     // Note: uploadBuffer has to be kept alive after the above function
     // calls because the command list has not been executed yet that
     // performs the actual copy.
@@ -72,6 +81,17 @@ Microsoft::WRL::ComPtr<ID3D12Resource> d3dUtil::CreateDefaultBuffer(ID3D12Device
     return defaultBuffer;
 }
 
+Microsoft::WRL::ComPtr<ID3D12Resource> d3dUtil::CreateDefaultBuffer(GpuMemoryAllocator& allocator, ID3D12GraphicsCommandList* cmdList, const void* initData, UINT64 byteSize, Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer)
+{
+    CD3DX12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
+    ComPtr<ID3D12Resource> defaultBuffer = allocator.CreateResource(D3D12_HEAP_TYPE_DEFAULT, desc,
+        D3D12_RESOURCE_STATE_COMMON);
+    uploadBuffer = allocator.CreateResource(D3D12_HEAP_TYPE_UPLOAD, desc, D3D12_RESOURCE_STATE_GENERIC_READ);
+
+    RecordBufferUpload(cmdList, defaultBuffer.Get(), uploadBuffer.Get(), initData, byteSize);
+    return defaultBuffer;
+}
+
 
 UINT d3dUtil::CalcConstantBufferByteSize(UINT byteSize)
 {
@@ -130,4 +150,227 @@ ComPtr<ID3DBlob> d3dUtil::LoadBinary(const std::wstring& filename)
     fin.close();
 
     return blob;
-}
\ No newline at end of file
+}
+UINT d3dUtil::SelectLod(const SubmeshGeometry* lods, UINT lodCount,
+    float distance, float projectionScale, float pixelThreshold)
+{
+    // The error of an object distance d away covers error * projectionScale / d
+    // pixels.  Levels get coarser monotonically, so stop at the first one that
+    // is too coarse.
+    float maxError = pixelThreshold * (std::max)(distance, 1e-4f) / projectionScale;
+
+    UINT lod = 0;
+    while (lod + 1 < lodCount && lods[lod + 1].LodError <= maxError)
+        ++lod;
+    return lod;
+}
+
+namespace
+{
+    // Everything CreateMeshGeometry sets up besides the buffers themselves.
+    std::unique_ptr<MeshGeometry> DescribeMeshGeometry(const MeshFile& file, const std::string& name)
+    {
+        const MeshFile::Header& header = file.GetHeader();
+
+        auto geo = std::make_unique<MeshGeometry>();
+        geo->Name = name;
+        geo->VertexByteStride = header.VertexByteStride;
+        geo->VertexBufferByteSize = static_cast<UINT>(file.VertexDataSize());
+        geo->IndexFormat = static_cast<DXGI_FORMAT>(header.IndexFormat);
+        geo->IndexBufferByteSize = static_cast<UINT>(file.IndexDataSize());
+
+        // A split file uploads as one buffer with the attribute stream bound
+        // at its offset; slot 0 then covers only the positions.
+        if (file.AttributeStreamByteStride() != 0)
+        {
+            MeshGeometry::VertexStream attributes;
+            attributes.ByteOffset = file.AttributeStreamOffset();
+            attributes.ByteStride = file.AttributeStreamByteStride();
+            attributes.ByteSize = static_cast<UINT>(file.VertexDataSize() - attributes.ByteOffset);
+            geo->AttributeStreams.push_back(attributes);
+
+            geo->VertexByteStride = MeshFile::PackedPositionByteStride;
+            geo->VertexBufferByteSize = static_cast<UINT>(attributes.ByteOffset);
+        }
+
+        const MeshFile::Submesh* submeshes = file.Submeshes();
+        for (UINT i = 0; i < header.SubmeshCount; ++i)
+        {
+            const MeshFile::Submesh& record = submeshes[i];
+
+            SubmeshGeometry submesh;
+            submesh.IndexCount = record.IndexCount;
+            submesh.StartIndexLocation = record.StartIndexLocation;
+            submesh.BaseVertexLocation = record.BaseVertexLocation;
+            submesh.LodError = record.LodError;
+            submesh.Bounds.Center = DirectX::XMFLOAT3(record.BoxCenter);
+            submesh.Bounds.Extents = DirectX::XMFLOAT3(record.BoxExtents);
+            submesh.SphereBounds.Center = DirectX::XMFLOAT3(record.SphereCenter);
+            submesh.SphereBounds.Radius = record.SphereRadius;
+            geo->DrawArgs[record.Name] = submesh;
+        }
+
+        return geo;
+    }
+}
+
+std::unique_ptr<MeshGeometry> d3dUtil::CreateMeshGeometry(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList,
+    const MeshFile& file, const std::string& name)
+{
+    auto geo = DescribeMeshGeometry(file, name);
+    geo->VertexBufferGPU = CreateDefaultBuffer(device, cmdList, file.VertexData(),
+        file.VertexDataSize(), geo->VertexBufferUploader);
+    geo->IndexBufferGPU = CreateDefaultBuffer(device, cmdList, file.IndexData(),
+        file.IndexDataSize(), geo->IndexBufferUploader);
+    for (MeshGeometry::VertexStream& stream : geo->AttributeStreams)
+        stream.BufferGPU = geo->VertexBufferGPU;
+    return geo;
+}
+
+std::unique_ptr<MeshGeometry> d3dUtil::CreateMeshGeometry(UploadRingBuffer& uploads,
+    const MeshFile& file, const std::string& name)
+{
+    auto geo = DescribeMeshGeometry(file, name);
+    geo->VertexBufferGPU = uploads.CreateDefaultBuffer(file.VertexData(), file.VertexDataSize());
+    geo->IndexBufferGPU = uploads.CreateDefaultBuffer(file.IndexData(), file.IndexDataSize());
+    for (MeshGeometry::VertexStream& stream : geo->AttributeStreams)
+        stream.BufferGPU = geo->VertexBufferGPU;
+    return geo;
+}
+
+namespace
+{
+    UINT64 BlobBytes(ID3DBlob* blob)
+    {
+        return blob ? blob->GetBufferSize() : 0;
+    }
+
+    UINT64 ResourceBytes(ID3D12Resource* resource)
+    {
+        return resource ? resource->GetDesc().Width : 0;
+    }
+
+    template<typename T>
+    UINT64 VectorBytes(const std::vector<T>& v)
+    {
+        return v.capacity() * sizeof(T);
+    }
+
+    Lz4::Block CompressBlob(ID3DBlob* blob)
+    {
+        return Lz4::CompressBlock(blob->GetBufferPointer(), blob->GetBufferSize());
+    }
+
+    ComPtr<ID3DBlob> ExpandBlob(const Lz4::Block& block)
+    {
+        ComPtr<ID3DBlob> blob;
+        ThrowIfFailed(D3DCreateBlob(static_cast<SIZE_T>(block.RawSize), blob.GetAddressOf()));
+        // A block that does not expand to its RawSize is corrupt.
+        if (!Lz4::DecompressBlock(block, blob->GetBufferPointer()))
+            ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+        return blob;
+    }
+
+    bool CopyData(ID3DBlob* blob, const Lz4::Block& compressed, std::vector<std::uint8_t>& data)
+    {
+        if (blob)
+        {
+            const std::uint8_t* bytes = static_cast<const std::uint8_t*>(blob->GetBufferPointer());
+            data.assign(bytes, bytes + blob->GetBufferSize());
+            return true;
+        }
+        if (!compressed.empty())
+        {
+            data.resize(compressed.RawSize);
+            if (Lz4::DecompressBlock(compressed, data.data()))
+                return true;
+        }
+        data.clear();
+        return false;
+    }
+
+    UINT64 CpuBytes(const MeshGeometry& geo)
+    {
+        return BlobBytes(geo.VertexBufferCPU.Get()) + BlobBytes(geo.IndexBufferCPU.Get()) +
+            geo.VertexBufferCompressed.Data.capacity() + geo.IndexBufferCompressed.Data.capacity() +
+            VectorBytes(geo.Meshlets.Meshlets) + VectorBytes(geo.Meshlets.Bounds) +
+            VectorBytes(geo.Meshlets.VertexIndices) + VectorBytes(geo.Meshlets.PrimitiveIndices);
+    }
+}
+
+void MeshGeometry::DeferUploaders(DeferredReleaseQueue& queue, UINT64 uploadFence)
+{
+    queue.Defer(std::move(VertexBufferUploader), uploadFence);
+    queue.Defer(std::move(IndexBufferUploader), uploadFence);
+    for (VertexStream& stream : AttributeStreams)
+        queue.Defer(std::move(stream.BufferUploader), uploadFence);
+}
+
+void MeshGeometry::ApplyRetention()
+{
+    switch (Retention)
+    {
+    case CpuRetention::Drop:
+        VertexBufferCPU = nullptr;
+        IndexBufferCPU = nullptr;
+        VertexBufferCompressed = Lz4::Block();
+        IndexBufferCompressed = Lz4::Block();
+        break;
+
+    case CpuRetention::Keep:
+        if (!VertexBufferCPU && !VertexBufferCompressed.empty())
+            VertexBufferCPU = ExpandBlob(VertexBufferCompressed);
+        if (!IndexBufferCPU && !IndexBufferCompressed.empty())
+            IndexBufferCPU = ExpandBlob(IndexBufferCompressed);
+        VertexBufferCompressed = Lz4::Block();
+        IndexBufferCompressed = Lz4::Block();
+        break;
+
+    case CpuRetention::KeepCompressed:
+        if (VertexBufferCPU)
+            VertexBufferCompressed = CompressBlob(VertexBufferCPU.Get());
+        if (IndexBufferCPU)
+            IndexBufferCompressed = CompressBlob(IndexBufferCPU.Get());
+        VertexBufferCPU = nullptr;
+        IndexBufferCPU = nullptr;
+        break;
+    }
+}
+
+bool MeshGeometry::CopyVertexData(std::vector<std::uint8_t>& data) const
+{
+    return CopyData(VertexBufferCPU.Get(), VertexBufferCompressed, data);
+}
+
+bool MeshGeometry::CopyIndexData(std::vector<std::uint8_t>& data) const
+{
+    return CopyData(IndexBufferCPU.Get(), IndexBufferCompressed, data);
+}
+
+GeometryMemoryStats MeshGeometry::GetMemoryStats() const
+{
+    return d3dUtil::GetMemoryStats({ this });
+}
+
+GeometryMemoryStats d3dUtil::GetMemoryStats(const std::vector<const MeshGeometry*>& geometries)
+{
+    GeometryMemoryStats total;
+    std::unordered_set<ID3D12Resource*> counted;
+    auto countOnce = [&](ID3D12Resource* resource)
+    {
+        return resource && counted.insert(resource).second ? ResourceBytes(resource) : 0;
+    };
+
+    for (const MeshGeometry* geo : geometries)
+    {
+        total.CpuBytes += CpuBytes(*geo);
+        total.GpuBytes += countOnce(geo->VertexBufferGPU.Get()) + countOnce(geo->IndexBufferGPU.Get());
+        total.UploadBytes += countOnce(geo->VertexBufferUploader.Get()) + countOnce(geo->IndexBufferUploader.Get());
+        for (const MeshGeometry::VertexStream& stream : geo->AttributeStreams)
+        {
+            total.GpuBytes += countOnce(stream.BufferGPU.Get());
+            total.UploadBytes += countOnce(stream.BufferUploader.Get());
+        }
+    }
+    return total;
+}
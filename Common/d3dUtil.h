@@ -1,9 +1,7 @@
 #pragma once
 
-#include <windows.h>
-#include <wrl.h>
+#include "d3dBase.h"
 #include <dxgi1_4.h>
-#include <d3d12.h>
 #include <D3Dcompiler.h>
 #include <DirectXMath.h>
 #include <DirectXPackedVector.h>
@@ -19,41 +17,13 @@
 #include <fstream>
 #include <sstream>
 #include <cassert>
-#include "d3dx12.h"
 
-inline std::wstring AnsiToWString(const std::string& str)
-{
-    WCHAR buffer[512];
-    MultiByteToWideChar(CP_ACP, 0, str.c_str(), -1, buffer, 512);
-    return std::wstring(buffer);
-}
-
-class DxException
-{
-public:
-    DxException() = default;
-    DxException(HRESULT hr, const std::wstring& functionName, const std::wstring& filename, int lineNumber);
-
-    std::wstring ToString()const;
-
-    HRESULT ErrorCode = S_OK;
-    std::wstring FunctionName;
-    std::wstring Filename;
-    int LineNumber = -1;
-};
-
-#ifndef ThrowIfFailed
-#define ThrowIfFailed(x)                                              \
-{                                                                     \
-    HRESULT hr__ = (x);                                               \
-    std::wstring wfn = AnsiToWString(__FILE__);                       \
-    if(FAILED(hr__)) { throw DxException(hr__, L#x, wfn, __LINE__); } \
-}
-#endif
-
-#ifndef ReleaseCom
-#define ReleaseCom(x) { if(x){ x->Release(); x = 0; } }
-#endif
+struct SubmeshGeometry;
+struct MeshGeometry;
+struct GeometryMemoryStats;
+class MeshFile;
+class UploadRingBuffer;
+class GpuMemoryAllocator;
 
 class d3dUtil {
 public:
@@ -63,6 +33,13 @@ public:
         const void* initData,
         UINT64 byteSize,
         Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer);
+    // The same with both buffers placed in the allocator's heaps.
+    static Microsoft::WRL::ComPtr<ID3D12Resource> CreateDefaultBuffer(
+        GpuMemoryAllocator& allocator,
+        ID3D12GraphicsCommandList* cmdList,
+        const void* initData,
+        UINT64 byteSize,
+        Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer);
 
     static UINT CalcConstantBufferByteSize(UINT byteSize);
 
@@ -73,75 +50,33 @@ public:
         const std::string& target);
 
     static Microsoft::WRL::ComPtr<ID3DBlob> LoadBinary(const std::wstring& filename);
-};
-
-
-// Defines a subrange of geometry in a MeshGeometry.  This is for when multiple
-// geometries are stored in one vertex and index buffer.  It provides the offsets
-// and data needed to draw a subset of geometry stores in the vertex and index 
-// buffers so that we can implement the technique described by Figure 6.3.
-struct SubmeshGeometry
-{
-	UINT IndexCount = 0;
-	UINT StartIndexLocation = 0;
-	INT BaseVertexLocation = 0;
 
-	// Bounding box of the geometry defined by this submesh. 
-	// This is used in later chapters of the book.
-	DirectX::BoundingBox Bounds;
-};
-
-struct MeshGeometry
-{
-	// Give it a name so we can look it up by name.
-	std::string Name;
-
-	// System memory copies.  Use Blobs because the vertex/index format can be generic.
-	// It is up to the client to cast appropriately.  
-	Microsoft::WRL::ComPtr<ID3DBlob> VertexBufferCPU = nullptr;
-	Microsoft::WRL::ComPtr<ID3DBlob> IndexBufferCPU = nullptr;
-
-	Microsoft::WRL::ComPtr<ID3D12Resource> VertexBufferGPU = nullptr;
-	Microsoft::WRL::ComPtr<ID3D12Resource> IndexBufferGPU = nullptr;
-
-	Microsoft::WRL::ComPtr<ID3D12Resource> VertexBufferUploader = nullptr;
-	Microsoft::WRL::ComPtr<ID3D12Resource> IndexBufferUploader = nullptr;
-
-	// Data about the buffers.
-	UINT VertexByteStride = 0;
-	UINT VertexBufferByteSize = 0;
-	DXGI_FORMAT IndexFormat = DXGI_FORMAT_R16_UINT;
-	UINT IndexBufferByteSize = 0;
-
-	// A MeshGeometry may store multiple geometries in one vertex/index buffer.
-	// Use this container to define the Submesh geometries so we can draw
-	// the Submeshes individually.
-	std::unordered_map<std::string, SubmeshGeometry> DrawArgs;
-
-	D3D12_VERTEX_BUFFER_VIEW VertexBufferView()const
-	{
-		D3D12_VERTEX_BUFFER_VIEW vbv;
-		vbv.BufferLocation = VertexBufferGPU->GetGPUVirtualAddress();
-		vbv.StrideInBytes = VertexByteStride;
-		vbv.SizeInBytes = VertexBufferByteSize;
-
-		return vbv;
-	}
-
-	D3D12_INDEX_BUFFER_VIEW IndexBufferView()const
-	{
-		D3D12_INDEX_BUFFER_VIEW ibv;
-		ibv.BufferLocation = IndexBufferGPU->GetGPUVirtualAddress();
-		ibv.Format = IndexFormat;
-		ibv.SizeInBytes = IndexBufferByteSize;
-
-		return ibv;
-	}
-
-	// We can free this memory after we finish upload to the GPU.
-	void DisposeUploaders()
-	{
-		VertexBufferUploader = nullptr;
-		IndexBufferUploader = nullptr;
-	}
+    // Picks the coarsest level of detail whose LodError, projected to the screen
+    // at the given view distance, stays within pixelThreshold pixels.  lods run
+    // from full detail to coarsest.  projectionScale is the viewport height in
+    // pixels times proj(1,1) / 2; fold any world scale into distance.
+    static UINT SelectLod(const SubmeshGeometry* lods, UINT lodCount,
+        float distance, float projectionScale, float pixelThreshold);
+
+    // Uploads an open MeshFile into default heap buffers and fills DrawArgs
+    // from its submesh table.  The data goes from the file mapping straight
+    // into the upload buffers, so the CPU blobs are left empty; the file can
+    // be closed as soon as this returns.  A PackedSplit file gets its
+    // attributes as AttributeStreams[0].
+    static std::unique_ptr<MeshGeometry> CreateMeshGeometry(
+        ID3D12Device* device,
+        ID3D12GraphicsCommandList* cmdList,
+        const MeshFile& file,
+        const std::string& name);
+    // The same staged through an UploadRingBuffer, so loading many meshes
+    // creates no upload buffers and batches the barriers; the buffers are
+    // filled once uploads has been flushed and executed.
+    static std::unique_ptr<MeshGeometry> CreateMeshGeometry(
+        UploadRingBuffer& uploads,
+        const MeshFile& file,
+        const std::string& name);
+
+    // Memory held by a set of geometries.  A resource shared by several of
+    // them, such as a GeometryPool buffer, is counted once.
+    static GeometryMemoryStats GetMemoryStats(const std::vector<const MeshGeometry*>& geometries);
 };
@@ -0,0 +1,347 @@
+// Cooks GeometryGenerator shapes, OBJ and glTF binary files into a MeshFile.
+//
+//     MeshCooker [options] <output.mesh> <input>...
+//
+// Each shape becomes one submesh, and each file one per OBJ object, group
+// or material or per glTF primitive.  See PrintUsage for the input syntax.
+#include "../Common/GeometryGenerator.h"
+#include "../Common/MathHelper.h"
+#include "../Common/MeshFile.h"
+#include "../Common/MeshImporter.h"
+#include "../Common/VertexCompression.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+using MeshData = GeometryGenerator::MeshData;
+
+namespace
+{
+	const std::uint32_t kFormatR32Uint = 42; // DXGI_FORMAT_R32_UINT
+	const std::uint32_t kFormatR16Uint = 57; // DXGI_FORMAT_R16_UINT
+
+	struct Options
+	{
+		MeshFile::VertexFormat Format = MeshFile::VertexFormat::Full;
+		bool Index32 = false;
+		bool Verify = false;
+	};
+
+	// A named range of Mesh; the indices are relative to BaseVertex.
+	struct Input
+	{
+		MeshData Mesh;
+		std::vector<MeshImporter::Part> Parts;
+	};
+
+	void PrintUsage()
+	{
+		std::fprintf(stderr,
+			"usage: MeshCooker [options] <output.mesh> <input>...\n"
+			"\n"
+			"inputs:\n"
+			"  file.obj or file.glb\n"
+			"  box:width,height,depth,subdivisions\n"
+			"  grid:width,depth,m,n\n"
+			"  sphere:radius,slices,stacks\n"
+			"  cylinder:bottomRadius,topRadius,height,slices,stacks\n"
+			"  geosphere:radius,subdivisions\n"
+			"  Prefix an input with name= to name its submesh.\n"
+			"\n"
+			"options:\n"
+			"  --format full|packed|position|split\n"
+			"                                 vertex layout, default full; split is\n"
+			"                                 packed as a position and an attribute stream\n"
+			"  --index32                      32 bit indices instead of 16\n"
+			"  --verify                       reopen the output and compare it with the input\n");
+	}
+
+	double MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	bool ParseArgs(const std::string& text, std::vector<float>& args)
+	{
+		const char* s = text.c_str();
+		while (*s != '\0')
+		{
+			char* next = nullptr;
+			args.push_back(std::strtof(s, &next));
+			if (next == s || (*next != ',' && *next != '\0'))
+				return false;
+			s = *next == ',' ? next + 1 : next;
+		}
+		return true;
+	}
+
+	bool LoadInput(const std::string& spec, Input& input, std::string& error)
+	{
+		std::string name;
+		std::string source = spec;
+		size_t equals = source.find('=');
+		if (equals != std::string::npos)
+		{
+			name = source.substr(0, equals);
+			source = source.substr(equals + 1);
+		}
+
+		size_t colon = source.find(':');
+		std::string shape = colon == std::string::npos ? "" : source.substr(0, colon);
+		std::vector<float> args;
+		if (colon != std::string::npos && !ParseArgs(source.substr(colon + 1), args))
+		{
+			error = "bad arguments in " + spec;
+			return false;
+		}
+		auto argCount = [&](size_t count)
+		{
+			if (args.size() != count)
+				error = shape + " takes " + std::to_string(count) + " arguments";
+			return args.size() == count;
+		};
+		auto u = [&](size_t i) { return static_cast<std::uint32_t>(args[i]); };
+
+		GeometryGenerator generator;
+		if (shape == "box")
+		{
+			if (!argCount(4))
+				return false;
+			input.Mesh = generator.CreateBox(args[0], args[1], args[2], u(3));
+		}
+		else if (shape == "grid")
+		{
+			if (!argCount(4))
+				return false;
+			input.Mesh = generator.CreateGrid(args[0], args[1], u(2), u(3));
+		}
+		else if (shape == "sphere")
+		{
+			if (!argCount(3))
+				return false;
+			input.Mesh = generator.CreateSphere(args[0], u(1), u(2));
+		}
+		else if (shape == "cylinder")
+		{
+			if (!argCount(5))
+				return false;
+			input.Mesh = generator.CreateCylinder(args[0], args[1], args[2], u(3), u(4));
+		}
+		else if (shape == "geosphere")
+		{
+			if (!argCount(2))
+				return false;
+			input.Mesh = generator.CreateGeosphere(args[0], u(1));
+		}
+		else
+		{
+			MeshImporter::Result result;
+			if (!MeshImporter::Load(source, result, &error))
+				return false;
+			input.Mesh = std::move(result.Mesh);
+			input.Parts = std::move(result.Parts);
+			// A name replaces the part names only when there is one part.
+			if (!name.empty() && input.Parts.size() == 1)
+				input.Parts[0].Name = name;
+			return true;
+		}
+
+		MeshImporter::Part part;
+		part.Name = name.empty() ? shape : name;
+		part.VertexCount = static_cast<std::uint32_t>(input.Mesh.Vertices.size());
+		part.IndexCount = static_cast<std::uint32_t>(input.Mesh.Indices32.size());
+		input.Parts.push_back(part);
+		return true;
+	}
+
+	// Reopens path and checks it against what was written.
+	bool Verify(const std::string& path, const MeshFile::Contents& contents)
+	{
+		auto start = std::chrono::steady_clock::now();
+		MeshFile file;
+		if (!file.Open(path))
+		{
+			std::fprintf(stderr, "verify: %s\n", file.Error().c_str());
+			return false;
+		}
+		double openMilliseconds = MillisecondsSince(start);
+
+		const MeshFile::Header& header = file.GetHeader();
+		bool same = header.Format == contents.Format &&
+			header.VertexByteStride == contents.VertexByteStride &&
+			header.VertexCount == contents.VertexCount &&
+			header.IndexFormat == contents.IndexFormat &&
+			header.IndexCount == contents.IndexCount &&
+			header.SubmeshCount == contents.Submeshes.size() &&
+			std::memcmp(file.Submeshes(), contents.Submeshes.data(), contents.Submeshes.size() * sizeof(MeshFile::Submesh)) == 0 &&
+			std::memcmp(file.VertexData(), contents.Vertices, size_t(file.VertexDataSize())) == 0 &&
+			std::memcmp(file.IndexData(), contents.Indices, size_t(file.IndexDataSize())) == 0;
+		if (!same)
+		{
+			std::fprintf(stderr, "verify: %s does not match what was written\n", path.c_str());
+			return false;
+		}
+
+		std::printf("verified, opened in %.3f ms\n", openMilliseconds);
+		return true;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "--format" && i + 1 < argc)
+		{
+			std::string format = argv[++i];
+			if (format == "full")
+				options.Format = MeshFile::VertexFormat::Full;
+			else if (format == "packed")
+				options.Format = MeshFile::VertexFormat::Packed;
+			else if (format == "position")
+				options.Format = MeshFile::VertexFormat::PackedPosition;
+			else if (format == "split")
+				options.Format = MeshFile::VertexFormat::PackedSplit;
+			else
+			{
+				PrintUsage();
+				return 1;
+			}
+		}
+		else if (arg == "--index32")
+			options.Index32 = true;
+		else if (arg == "--verify")
+			options.Verify = true;
+		else if (arg.compare(0, 2, "--") == 0)
+		{
+			PrintUsage();
+			return 1;
+		}
+		else
+			paths.push_back(arg);
+	}
+	if (paths.size() < 2)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	// Gather every input into one vertex and index array.
+	MeshData mesh;
+	std::vector<MeshImporter::Part> parts;
+	for (size_t i = 1; i < paths.size(); ++i)
+	{
+		Input input;
+		std::string error;
+		if (!LoadInput(paths[i], input, error))
+		{
+			std::fprintf(stderr, "%s\n", error.c_str());
+			return 1;
+		}
+
+		std::uint32_t baseVertex = static_cast<std::uint32_t>(mesh.Vertices.size());
+		std::uint32_t startIndex = static_cast<std::uint32_t>(mesh.Indices32.size());
+		for (MeshImporter::Part part : input.Parts)
+		{
+			part.BaseVertex += baseVertex;
+			part.StartIndex += startIndex;
+			parts.push_back(part);
+		}
+		mesh.Vertices.insert(mesh.Vertices.end(), input.Mesh.Vertices.begin(), input.Mesh.Vertices.end());
+		mesh.Indices32.insert(mesh.Indices32.end(), input.Mesh.Indices32.begin(), input.Mesh.Indices32.end());
+	}
+
+	const std::uint32_t vertexCount = static_cast<std::uint32_t>(mesh.Vertices.size());
+	const std::uint32_t indexCount = static_cast<std::uint32_t>(mesh.Indices32.size());
+
+	MeshFile::Contents contents;
+	contents.Format = options.Format;
+	contents.VertexCount = vertexCount;
+	contents.IndexCount = indexCount;
+	contents.IndexFormat = options.Index32 ? kFormatR32Uint : kFormatR16Uint;
+	switch (options.Format)
+	{
+	case MeshFile::VertexFormat::Full: contents.VertexByteStride = sizeof(GeometryGenerator::Vertex); break;
+	case MeshFile::VertexFormat::Packed: contents.VertexByteStride = sizeof(PackedVertex); break;
+	case MeshFile::VertexFormat::PackedPosition: contents.VertexByteStride = MeshFile::PackedPositionByteStride; break;
+	case MeshFile::VertexFormat::PackedSplit: contents.VertexByteStride = MeshFile::PackedPositionByteStride + sizeof(PackedAttributes); break;
+	}
+
+	// Bounds per submesh, and the vertices in the output layout.  Packed
+	// positions are quantized to their submesh's box, as the shaders expect.
+	std::vector<std::uint8_t> vertexData(size_t(vertexCount) * contents.VertexByteStride);
+	std::uint8_t* attributeStream = vertexData.data() + size_t(vertexCount) * MeshFile::PackedPositionByteStride;
+	for (const MeshImporter::Part& part : parts)
+	{
+		if (!options.Index32 && part.VertexCount > 0x10000)
+		{
+			std::fprintf(stderr, "%s has %u vertices, too many for 16 bit indices; use --index32\n",
+				part.Name.c_str(), part.VertexCount);
+			return 1;
+		}
+
+		const GeometryGenerator::Vertex* first = mesh.Vertices.data() + part.BaseVertex;
+		BoundingBox box = MathHelper::ComputeBoundingBox(&first->Position, part.VertexCount, sizeof(GeometryGenerator::Vertex));
+		BoundingSphere sphere = MathHelper::ComputeBoundingSphere(&first->Position, part.VertexCount, sizeof(GeometryGenerator::Vertex));
+
+		MeshFile::Submesh submesh = {};
+		MeshFile::SetName(submesh, part.Name);
+		submesh.IndexCount = part.IndexCount;
+		submesh.StartIndexLocation = part.StartIndex;
+		submesh.BaseVertexLocation = static_cast<std::int32_t>(part.BaseVertex);
+		submesh.LodError = 0.0f;
+		std::memcpy(submesh.BoxCenter, &box.Center, sizeof(submesh.BoxCenter));
+		std::memcpy(submesh.BoxExtents, &box.Extents, sizeof(submesh.BoxExtents));
+		std::memcpy(submesh.SphereCenter, &sphere.Center, sizeof(submesh.SphereCenter));
+		submesh.SphereRadius = sphere.Radius;
+		contents.Submeshes.push_back(submesh);
+
+		std::uint8_t* out = vertexData.data() + size_t(part.BaseVertex) * contents.VertexByteStride;
+		if (options.Format == MeshFile::VertexFormat::PackedSplit)
+			out = vertexData.data() + size_t(part.BaseVertex) * MeshFile::PackedPositionByteStride;
+		PositionQuantization quantization = VertexCompression::QuantizationFor(box);
+		switch (options.Format)
+		{
+		case MeshFile::VertexFormat::Full:
+			std::memcpy(out, first, size_t(part.VertexCount) * sizeof(GeometryGenerator::Vertex));
+			break;
+		case MeshFile::VertexFormat::Packed:
+			VertexCompression::Encode(first, part.VertexCount, quantization, reinterpret_cast<PackedVertex*>(out));
+			break;
+		case MeshFile::VertexFormat::PackedPosition:
+			for (std::uint32_t v = 0; v < part.VertexCount; ++v)
+				VertexCompression::QuantizePosition(first[v].Position, quantization, reinterpret_cast<std::uint16_t*>(out) + 4 * v);
+			break;
+		case MeshFile::VertexFormat::PackedSplit:
+			VertexCompression::EncodeStreams(first, part.VertexCount, quantization, reinterpret_cast<std::uint16_t*>(out),
+				reinterpret_cast<PackedAttributes*>(attributeStream) + part.BaseVertex);
+			break;
+		}
+	}
+	contents.Vertices = vertexData.data();
+
+	if (options.Index32)
+		contents.Indices = mesh.Indices32.data();
+	else
+		contents.Indices = mesh.GetIndices16().data();
+
+	std::string error;
+	if (!MeshFile::Write(paths[0], contents, &error))
+	{
+		std::fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+	std::printf("%s: %zu submeshes, %u vertices of %u bytes, %u indices\n", paths[0].c_str(),
+		contents.Submeshes.size(), vertexCount, contents.VertexByteStride, indexCount);
+
+	if (options.Verify && !Verify(paths[0], contents))
+		return 1;
+	return 0;
+}
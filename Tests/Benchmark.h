@@ -0,0 +1,41 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <gtest/gtest.h>
+
+// Timing helpers for the DISABLED_* benchmark cases.  Measure() repeats a
+// body until it has run for at least minSeconds and reports the mean time of
+// one call; pass the same label prefix to line up variants being compared.
+namespace Benchmark
+{
+	// Stops the optimizer from discarding a result the benchmark never reads.
+	template<typename T>
+	inline void DoNotOptimize(const T& value)
+	{
+		static volatile const void* sink;
+		sink = &value;
+	}
+
+	template<typename Body>
+	double Measure(const char* label, Body&& body, double minSeconds = 0.25)
+	{
+		using Clock = std::chrono::steady_clock;
+
+		// One untimed call to warm caches and allocators.
+		body();
+
+		size_t iterations = 0;
+		Clock::time_point start = Clock::now();
+		double elapsed = 0.0;
+		do
+		{
+			body();
+			++iterations;
+			elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+		} while (elapsed < minSeconds);
+
+		double msPerCall = elapsed * 1000.0 / iterations;
+		std::printf("[ BENCH    ] %-40s %10.4f ms  (%zu iterations)\n", label, msPerCall, iterations);
+		return msPerCall;
+	}
+}
@@ -0,0 +1,215 @@
+#include "D3D12Fakes.h"
+#include "LinearUploadAllocator.h"
+#include "Benchmark.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// The three ways the shape app has given each draw its object constants,
+// recorded the way ShapeRenderer::DrawRenderItems records them:
+// - DescriptorTable: a CBV per object and frame, made once up front over
+//   256 byte slots of a persistent upload buffer; a descriptor table per draw.
+// - RootCbv: the constants pushed to the frame's LinearUploadAllocator and
+//   bound as a root CBV per draw (mObjectDataInBuffer off).
+// - RootConstant: all of them packed into one StructuredBuffer bound once as
+//   a root SRV, and the object's index as a root constant per draw
+//   (mObjectDataInBuffer on, color.hlsl with OBJECT_DATA_BUFFER).
+namespace
+{
+	// Mirrors ObjectConstants in Chapter7-ShapeApp/FrameResource.h.
+	struct ObjectConstants
+	{
+		float World[16];
+		float Color[4];
+		float PosOffset[3];
+		float Pad0;
+		float PosScale[3];
+		float Pad1;
+	};
+	static_assert(sizeof(ObjectConstants) == 112, "ObjectConstants must match the shape app's");
+
+	enum class ObjectPath
+	{
+		DescriptorTable,
+		RootCbv,
+		RootConstant
+	};
+
+	const char* Name(ObjectPath path)
+	{
+		return path == ObjectPath::DescriptorTable ? "descriptor table" :
+			path == ObjectPath::RootCbv ? "root CBV" : "root constant";
+	}
+
+	const UINT kDescriptorSize = 32;
+	const D3D12_GPU_DESCRIPTOR_HANDLE kHeapStart = { 0x200000000 };
+
+	struct Item
+	{
+		UINT IndexCount;
+		UINT StartIndexLocation;
+		INT BaseVertexLocation;
+		ObjectConstants Constants;
+		D3D12_GPU_VIRTUAL_ADDRESS ObjectCBAddress;
+		UINT ObjectIndex;
+	};
+
+	std::vector<Item> MakeItems(UINT count)
+	{
+		std::vector<Item> items(count);
+		for (UINT i = 0; i < count; ++i)
+		{
+			Item& item = items[i];
+			item.IndexCount = 36 + 6 * (i % 7);
+			item.StartIndexLocation = 120 * (i % 13);
+			item.BaseVertexLocation = 24 * (i % 5);
+			item.Constants = ObjectConstants();
+			for (int d = 0; d < 4; ++d)
+				item.Constants.World[d * 5] = 1.0f;
+			item.Constants.World[12] = float(i);
+			item.Constants.Color[3] = 1.0f;
+			item.ObjectCBAddress = 0;
+			item.ObjectIndex = i;
+		}
+		return items;
+	}
+
+	// One frame's object constants and draws.  tableSlots is the persistent
+	// buffer behind the descriptor table path's CBVs.
+	void RecordFrame(ObjectPath path, std::vector<Item>& items, UINT frameIndex, BYTE* tableSlots,
+		LinearUploadAllocator& constants, FakeCommandList& cmdList)
+	{
+		const UINT count = static_cast<UINT>(items.size());
+		D3D12_GPU_VIRTUAL_ADDRESS objectBuffer = 0;
+		if (path == ObjectPath::RootConstant)
+		{
+			LinearUploadAllocator::Allocation objects = constants.Allocate(count * sizeof(ObjectConstants));
+			for (UINT i = 0; i < count; ++i)
+				StreamingWrites::Write(objects.CPU + i * sizeof(ObjectConstants), &items[i].Constants,
+					sizeof(ObjectConstants));
+			objectBuffer = objects.GPU;
+		}
+		else if (path == ObjectPath::RootCbv)
+		{
+			for (Item& item : items)
+				item.ObjectCBAddress = constants.Push(item.Constants);
+		}
+		else
+		{
+			for (UINT i = 0; i < count; ++i)
+				std::memcpy(tableSlots + i * D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, &items[i].Constants,
+					sizeof(ObjectConstants));
+		}
+		StreamingWrites::Fence();
+
+		ID3D12DescriptorHeap* heaps[] = { nullptr };
+		cmdList.SetDescriptorHeaps(1, heaps);
+		cmdList.SetGraphicsRootSignature(nullptr);
+		cmdList.SetGraphicsRootDescriptorTable(1, kHeapStart);
+		if (path == ObjectPath::RootConstant)
+			cmdList.SetGraphicsRootShaderResourceView(0, objectBuffer);
+
+		// The shapes all come from one pool block, so the buffers are bound
+		// once.
+		D3D12_VERTEX_BUFFER_VIEW vertexBuffer = { 0x300000000, 1 << 20, 20 };
+		D3D12_INDEX_BUFFER_VIEW indexBuffer = { 0x400000000, 1 << 20, DXGI_FORMAT_R16_UINT };
+		cmdList.IASetVertexBuffers(0, 1, &vertexBuffer);
+		cmdList.IASetIndexBuffer(&indexBuffer);
+		cmdList.IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+		for (UINT i = 0; i < count; ++i)
+		{
+			const Item& item = items[i];
+			if (path == ObjectPath::RootConstant)
+				cmdList.SetGraphicsRoot32BitConstant(2, item.ObjectIndex, 0);
+			else if (path == ObjectPath::RootCbv)
+				cmdList.SetGraphicsRootConstantBufferView(0, item.ObjectCBAddress);
+			else
+			{
+				D3D12_GPU_DESCRIPTOR_HANDLE handle = { kHeapStart.ptr + (1 + frameIndex * count + i) * kDescriptorSize };
+				cmdList.SetGraphicsRootDescriptorTable(0, handle);
+			}
+			cmdList.DrawIndexedInstanced(item.IndexCount, 1, item.StartIndexLocation, item.BaseVertexLocation, 0);
+		}
+	}
+
+	// Upload bytes one frame holds for its object constants.
+	UINT64 UploadBytes(ObjectPath path, UINT count, const LinearUploadAllocator& constants)
+	{
+		if (path == ObjectPath::DescriptorTable)
+			return UINT64(count) * D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+		LinearAllocator::Stats stats = constants.GetStats();
+		return stats.UsedBytes + stats.PaddingBytes;
+	}
+}
+
+TEST(CommandRecording, OneBindingAndOneDrawPerItem)
+{
+	const UINT count = 100;
+	FakeDevice device;
+	GpuMemoryAllocator gpuAllocator(&device);
+	LinearUploadAllocator tableBuffer(gpuAllocator);
+	BYTE* tableSlots = tableBuffer.Allocate(count * D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT).CPU;
+
+	for (ObjectPath path : { ObjectPath::DescriptorTable, ObjectPath::RootCbv, ObjectPath::RootConstant })
+	{
+		SCOPED_TRACE(Name(path));
+		std::vector<Item> items = MakeItems(count);
+		LinearUploadAllocator constants(gpuAllocator);
+		FakeCommandList cmdList;
+		RecordFrame(path, items, 0, tableSlots, constants, cmdList);
+
+		EXPECT_EQ(count, cmdList.Calls[FakeCommandList::Draw]);
+		EXPECT_EQ(1u, cmdList.Calls[FakeCommandList::VertexBuffers]);
+		EXPECT_EQ(1u, cmdList.Calls[FakeCommandList::IndexBuffer]);
+		EXPECT_EQ(path == ObjectPath::DescriptorTable ? count + 1 : 1,
+			cmdList.Calls[FakeCommandList::RootDescriptorTable]);
+		EXPECT_EQ(path == ObjectPath::RootCbv ? count : 0, cmdList.Calls[FakeCommandList::RootConstantBufferView]);
+		EXPECT_EQ(path == ObjectPath::RootConstant ? count : 0, cmdList.Calls[FakeCommandList::Root32BitConstant]);
+		EXPECT_EQ(path == ObjectPath::RootConstant ? 1u : 0u, cmdList.Calls[FakeCommandList::RootShaderResourceView]);
+		EXPECT_EQ(0u, cmdList.Calls[FakeCommandList::Other]);
+
+		// The object buffer packs the constants; CBVs need 256 byte slots,
+		// though the last pushed one needs no padding after it.
+		const UINT64 slot = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+		UINT64 expected = path == ObjectPath::RootConstant ? count * sizeof(ObjectConstants) :
+			path == ObjectPath::DescriptorTable ? count * slot : (count - 1) * slot + sizeof(ObjectConstants);
+		EXPECT_EQ(expected, UploadBytes(path, count, constants));
+	}
+}
+
+// Per 10k draws: the calls and modeled command bytes recorded, the upload
+// memory the object constants take, and the CPU time to write the
+// constants and record the draws.
+TEST(CommandRecordingBenchmark, DISABLED_ObjectDataPaths)
+{
+	const UINT count = 10000;
+	const UINT frameCount = 3;
+	FakeDevice device;
+	GpuMemoryAllocator gpuAllocator(&device);
+	LinearUploadAllocator tableBuffer(gpuAllocator);
+	BYTE* tableSlots = tableBuffer.Allocate(count * D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT).CPU;
+
+	for (ObjectPath path : { ObjectPath::DescriptorTable, ObjectPath::RootCbv, ObjectPath::RootConstant })
+	{
+		std::vector<Item> items = MakeItems(count);
+		LinearUploadAllocator constants(gpuAllocator);
+		FakeCommandList cmdList;
+		UINT frameIndex = 0;
+		size_t commandBytes = 0;
+		char label[64];
+		std::snprintf(label, sizeof(label), "10k draws, %s", Name(path));
+		Benchmark::Measure(label, [&]() {
+			constants.Reset();
+			cmdList.Clear();
+			RecordFrame(path, items, frameIndex, tableSlots, constants, cmdList);
+			frameIndex = (frameIndex + 1) % frameCount;
+			commandBytes += cmdList.Commands.size();
+		});
+
+		std::printf("[ RECORD   ] %-20s %6u calls, %7zu command bytes (%.1f per draw), %8llu upload bytes\n",
+			Name(path), cmdList.CallCount, cmdList.Commands.size(), double(cmdList.Commands.size()) / count,
+			static_cast<unsigned long long>(UploadBytes(path, count, constants)));
+		EXPECT_GT(commandBytes, 0u);
+	}
+}
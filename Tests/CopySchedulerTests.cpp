@@ -0,0 +1,163 @@
+#include "CopyScheduler.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace
+{
+	using uint64 = CopyScheduler::uint64;
+
+	// The GPU side of a copy queue as CopyQueue drives it: a fence that
+	// completes batches when told to, and consumer queues that remember the
+	// values they were told to wait for.
+	struct FakeQueue
+	{
+		CopyScheduler::Consumer Consumer;
+		std::vector<uint64> Waits;
+	};
+
+	struct FakeCopyQueue
+	{
+		explicit FakeCopyQueue(uint64 batchByteSize) :
+			Scheduler(batchByteSize)
+		{
+		}
+
+		uint64 Upload(uint64 size)
+		{
+			uint64 token = Scheduler.Record(size);
+			if (Scheduler.BatchFull())
+				Scheduler.Submit();
+			return token;
+		}
+
+		// CopyQueue::WaitOnGpu.
+		void WaitOnGpu(FakeQueue& queue, uint64 token)
+		{
+			if (!Scheduler.IsSubmitted(token))
+				Scheduler.Submit();
+			Scheduler.Complete(CompletedFence);
+			uint64 waitValue = Scheduler.WaitValue(queue.Consumer, token);
+			if (waitValue != 0)
+				queue.Waits.push_back(waitValue);
+		}
+
+		CopyScheduler Scheduler;
+		uint64 CompletedFence = 0;
+	};
+}
+
+TEST(CopyScheduler, TokensNameTheBatchBeingRecorded)
+{
+	CopyScheduler scheduler(1000);
+	EXPECT_TRUE(scheduler.IsSubmitted(0));
+	EXPECT_TRUE(scheduler.IsComplete(0));
+	EXPECT_FALSE(scheduler.HasPending());
+
+	EXPECT_EQ(1u, scheduler.Record(100));
+	EXPECT_EQ(1u, scheduler.Record(200));
+	EXPECT_TRUE(scheduler.HasPending());
+	EXPECT_EQ(300u, scheduler.PendingBytes());
+	EXPECT_FALSE(scheduler.IsSubmitted(1));
+
+	EXPECT_EQ(1u, scheduler.Submit());
+	EXPECT_TRUE(scheduler.IsSubmitted(1));
+	EXPECT_FALSE(scheduler.IsComplete(1));
+	EXPECT_FALSE(scheduler.HasPending());
+	EXPECT_EQ(0u, scheduler.PendingBytes());
+
+	EXPECT_EQ(2u, scheduler.Record(1));
+	EXPECT_FALSE(scheduler.IsSubmitted(2));
+	EXPECT_EQ(2u, scheduler.Submit());
+	EXPECT_EQ(2u, scheduler.SubmittedFence());
+}
+
+TEST(CopyScheduler, BatchIsFullAtTheBatchSize)
+{
+	CopyScheduler scheduler(1000);
+	scheduler.Record(999);
+	EXPECT_FALSE(scheduler.BatchFull());
+	scheduler.Record(1);
+	EXPECT_TRUE(scheduler.BatchFull());
+	scheduler.Submit();
+	EXPECT_FALSE(scheduler.BatchFull());
+}
+
+TEST(CopyScheduler, CompletedFenceNeverPassesTheSubmittedOne)
+{
+	CopyScheduler scheduler(1000);
+	scheduler.Record(1);
+	scheduler.Submit();
+	scheduler.Record(1);
+
+	// A removed device reports every value as complete.
+	scheduler.Complete(~uint64(0));
+	EXPECT_EQ(1u, scheduler.CompletedFence());
+	EXPECT_FALSE(scheduler.IsComplete(2));
+	// Nor does it go back.
+	scheduler.Complete(0);
+	EXPECT_EQ(1u, scheduler.CompletedFence());
+}
+
+TEST(CopyScheduler, EachConsumerWaitsOncePerBatch)
+{
+	CopyScheduler scheduler(1000);
+	uint64 first = scheduler.Record(10);
+	scheduler.Submit();
+	uint64 second = scheduler.Record(10);
+	scheduler.Submit();
+
+	CopyScheduler::Consumer direct;
+	CopyScheduler::Consumer compute;
+	EXPECT_EQ(first, scheduler.WaitValue(direct, first));
+	EXPECT_EQ(0u, scheduler.WaitValue(direct, first));
+	EXPECT_EQ(second, scheduler.WaitValue(direct, second));
+	// Waiting for the later batch covers the earlier one.
+	EXPECT_EQ(0u, scheduler.WaitValue(direct, first));
+	EXPECT_EQ(second, direct.WaitedFence);
+
+	// Other consumers keep their own record.
+	EXPECT_EQ(second, scheduler.WaitValue(compute, second));
+
+	// Complete uploads need no wait at all.
+	CopyScheduler::Consumer late;
+	scheduler.Complete(first);
+	EXPECT_EQ(0u, scheduler.WaitValue(late, first));
+	EXPECT_EQ(0u, late.WaitedFence);
+	EXPECT_EQ(0u, scheduler.WaitValue(late, 0));
+	EXPECT_EQ(second, scheduler.WaitValue(late, second));
+}
+
+TEST(CopyScheduler, QueuesWaitOnlyForBatchesTheyUse)
+{
+	FakeCopyQueue copies(1000);
+	FakeQueue direct;
+	FakeQueue compute;
+
+	// Two batches fill up and go out on their own; the third is still being
+	// recorded when the first frame needs it.
+	uint64 mesh = copies.Upload(600);
+	uint64 texture = copies.Upload(600);
+	EXPECT_EQ(mesh, texture);
+	uint64 constants = copies.Upload(1200);
+	uint64 late = copies.Upload(10);
+	EXPECT_EQ(2u, copies.Scheduler.SubmittedFence());
+	EXPECT_EQ(3u, late);
+
+	copies.WaitOnGpu(direct, mesh);
+	copies.WaitOnGpu(direct, texture);
+	copies.WaitOnGpu(direct, late);
+	EXPECT_TRUE(copies.Scheduler.IsSubmitted(late));
+	EXPECT_EQ(std::vector<uint64>({ 1, 3 }), direct.Waits);
+
+	// By the time the compute queue needs them the first two are done.
+	copies.CompletedFence = 2;
+	copies.WaitOnGpu(compute, constants);
+	copies.WaitOnGpu(compute, mesh);
+	copies.WaitOnGpu(compute, late);
+	EXPECT_EQ(std::vector<uint64>({ 3 }), compute.Waits);
+
+	// Nothing recorded since, so nothing to submit or wait for.
+	copies.WaitOnGpu(direct, late);
+	EXPECT_EQ(3u, copies.Scheduler.SubmittedFence());
+	EXPECT_EQ(2u, direct.Waits.size());
+}
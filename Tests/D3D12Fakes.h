@@ -0,0 +1,492 @@
+#pragma once
+#include "d3dBase.h"
+#include "MockDevice.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+// Just enough of a device, its resources, a fence and a command list for
+// the upload and memory code in Common, and the samples' draw recording, to
+// run without a GPU.  Resources are reference counted and backed by CPU
+// memory when mapped; the fence completes only what a test tells it to, or
+// what the code under test waits for.
+
+// A buffer or texture that only remembers how it was created.
+class FakeResource : public ID3D12Resource
+{
+public:
+	FakeResource(const D3D12_RESOURCE_DESC& desc, D3D12_HEAP_TYPE heapType, ID3D12Heap* heap, UINT64 heapOffset,
+		D3D12_GPU_VIRTUAL_ADDRESS address, int& liveCount) :
+		HeapType(heapType),
+		Heap(heap),
+		HeapOffset(heapOffset),
+		mDesc(desc),
+		mAddress(address),
+		mLiveCount(liveCount)
+	{
+		++mLiveCount;
+	}
+
+	virtual ~FakeResource()
+	{
+		for (IUnknown* data : mPrivateData)
+			data->Release();
+		--mLiveCount;
+	}
+
+	// The memory Map() returns, allocated by the first call.
+	std::vector<BYTE> Memory;
+
+	const D3D12_HEAP_TYPE HeapType;
+	// Null for committed resources, and for placed ones on a FakeDevice,
+	// whose heaps are null.
+	ID3D12Heap* const Heap;
+	const UINT64 HeapOffset;
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override
+	{
+		if (riid != __uuidof(IUnknown) && riid != __uuidof(ID3D12Object) &&
+			riid != __uuidof(ID3D12DeviceChild) && riid != __uuidof(ID3D12Pageable) &&
+			riid != __uuidof(ID3D12Resource))
+		{
+			*object = nullptr;
+			return E_NOINTERFACE;
+		}
+		AddRef();
+		*object = static_cast<ID3D12Resource*>(this);
+		return S_OK;
+	}
+
+	ULONG STDMETHODCALLTYPE AddRef() override
+	{
+		return ++mRefCount;
+	}
+
+	ULONG STDMETHODCALLTYPE Release() override
+	{
+		ULONG refCount = --mRefCount;
+		if (refCount == 0)
+			delete this;
+		return refCount;
+	}
+
+	HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID, UINT*, void*) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID, UINT, const void*) override { return E_NOTIMPL; }
+
+	// Kept until the resource goes, as the runtime does.
+	HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID, const IUnknown* data) override
+	{
+		IUnknown* held = const_cast<IUnknown*>(data);
+		held->AddRef();
+		mPrivateData.push_back(held);
+		return S_OK;
+	}
+
+	HRESULT STDMETHODCALLTYPE SetName(LPCWSTR) override { return S_OK; }
+	HRESULT STDMETHODCALLTYPE GetDevice(REFIID, void**) override { return E_NOTIMPL; }
+
+	HRESULT STDMETHODCALLTYPE Map(UINT, const D3D12_RANGE*, void** data) override
+	{
+		if (Memory.empty())
+			Memory.resize(static_cast<size_t>(mDesc.Width) * mDesc.Height);
+		if (data != nullptr)
+			*data = Memory.data();
+		return S_OK;
+	}
+
+	void STDMETHODCALLTYPE Unmap(UINT, const D3D12_RANGE*) override {}
+
+	D3D12_RESOURCE_DESC STDMETHODCALLTYPE GetDesc() override { return mDesc; }
+	D3D12_GPU_VIRTUAL_ADDRESS STDMETHODCALLTYPE GetGPUVirtualAddress() override { return mAddress; }
+
+	HRESULT STDMETHODCALLTYPE WriteToSubresource(UINT, const D3D12_BOX*, const void*, UINT, UINT) override
+	{
+		return E_NOTIMPL;
+	}
+
+	HRESULT STDMETHODCALLTYPE ReadFromSubresource(void*, UINT, UINT, UINT, const D3D12_BOX*) override
+	{
+		return E_NOTIMPL;
+	}
+
+	HRESULT STDMETHODCALLTYPE GetHeapProperties(D3D12_HEAP_PROPERTIES* properties, D3D12_HEAP_FLAGS* flags) override
+	{
+		if (properties != nullptr)
+			*properties = CD3DX12_HEAP_PROPERTIES(HeapType);
+		if (flags != nullptr)
+			*flags = D3D12_HEAP_FLAG_NONE;
+		return S_OK;
+	}
+
+private:
+	ULONG mRefCount = 1;
+	D3D12_RESOURCE_DESC mDesc;
+	D3D12_GPU_VIRTUAL_ADDRESS mAddress;
+	std::vector<IUnknown*> mPrivateData;
+	int& mLiveCount;
+};
+
+// A fence whose value moves only through Signal(), a test setting
+// Completed, or SetEventOnCompletion(), which stands in for the GPU
+// catching up: it records the wait, completes the value and sets the event
+// if there is one; off Windows there are no events, and callers pass null.
+// Lives on the stack, so reference counting is a no-op as in MockDevice.
+class FakeFence : public ID3D12Fence
+{
+public:
+	UINT64 Completed = 0;
+	// The values SetEventOnCompletion() was called with.
+	std::vector<UINT64> Waits;
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID, void** object) override
+	{
+		*object = this;
+		return S_OK;
+	}
+
+	ULONG STDMETHODCALLTYPE AddRef() override { return 1; }
+	ULONG STDMETHODCALLTYPE Release() override { return 1; }
+
+	HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID, UINT*, void*) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID, UINT, const void*) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID, const IUnknown*) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE SetName(LPCWSTR) override { return S_OK; }
+	HRESULT STDMETHODCALLTYPE GetDevice(REFIID, void**) override { return E_NOTIMPL; }
+
+	UINT64 STDMETHODCALLTYPE GetCompletedValue() override { return Completed; }
+
+	HRESULT STDMETHODCALLTYPE SetEventOnCompletion(UINT64 value, HANDLE event) override
+	{
+		Waits.push_back(value);
+		Completed = (std::max)(Completed, value);
+#ifdef _WIN32
+		if (event != nullptr)
+			SetEvent(event);
+#endif
+		return S_OK;
+	}
+
+	HRESULT STDMETHODCALLTYPE Signal(UINT64 value) override
+	{
+		Completed = value;
+		return S_OK;
+	}
+};
+
+// A graphics command list that stores what is recorded instead of
+// executing it.  Each call appends a 4 byte tag and its arguments to
+// Commands, arrays passed by pointer by their contents, as a stand-in for
+// what a driver would write; the calls the draw path makes are also counted
+// by kind.  Lives on the stack, so reference counting is a no-op.
+class FakeCommandList : public ID3D12GraphicsCommandList
+{
+public:
+	enum Op : UINT
+	{
+		Draw,
+		RootSignature,
+		DescriptorHeaps,
+		RootDescriptorTable,
+		Root32BitConstant,
+		RootConstantBufferView,
+		RootShaderResourceView,
+		VertexBuffers,
+		IndexBuffer,
+		PrimitiveTopology,
+		Other,
+		OpCount
+	};
+
+	std::vector<BYTE> Commands;
+	UINT CallCount = 0;
+	UINT Calls[OpCount] = {};
+
+	// Forgets what was recorded but keeps the memory, like a command
+	// allocator being reset.
+	void Clear()
+	{
+		Commands.clear();
+		CallCount = 0;
+		std::fill(std::begin(Calls), std::end(Calls), 0u);
+	}
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID, void** object) override
+	{
+		*object = this;
+		return S_OK;
+	}
+
+	ULONG STDMETHODCALLTYPE AddRef() override { return 1; }
+	ULONG STDMETHODCALLTYPE Release() override { return 1; }
+
+	HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID, UINT*, void*) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID, UINT, const void*) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID, const IUnknown*) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE SetName(LPCWSTR) override { return S_OK; }
+	HRESULT STDMETHODCALLTYPE GetDevice(REFIID, void**) override { return E_NOTIMPL; }
+
+	D3D12_COMMAND_LIST_TYPE STDMETHODCALLTYPE GetType() override { return D3D12_COMMAND_LIST_TYPE_DIRECT; }
+
+	HRESULT STDMETHODCALLTYPE Close() override { return S_OK; }
+
+	HRESULT STDMETHODCALLTYPE Reset(ID3D12CommandAllocator*, ID3D12PipelineState*) override
+	{
+		Clear();
+		return S_OK;
+	}
+
+	// The draw path.
+
+	void STDMETHODCALLTYPE DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex,
+		INT baseVertex, UINT startInstance) override
+	{
+		Begin(Draw);
+		Append(indexCount);
+		Append(instanceCount);
+		Append(startIndex);
+		Append(baseVertex);
+		Append(startInstance);
+	}
+
+	void STDMETHODCALLTYPE SetGraphicsRootSignature(ID3D12RootSignature* rootSignature) override
+	{
+		Begin(RootSignature);
+		Append(rootSignature);
+	}
+
+	void STDMETHODCALLTYPE SetDescriptorHeaps(UINT count, ID3D12DescriptorHeap* const* heaps) override
+	{
+		Begin(DescriptorHeaps);
+		Append(count);
+		Append(heaps, count * sizeof(*heaps));
+	}
+
+	void STDMETHODCALLTYPE SetGraphicsRootDescriptorTable(UINT index, D3D12_GPU_DESCRIPTOR_HANDLE base) override
+	{
+		Begin(RootDescriptorTable);
+		Append(index);
+		Append(base);
+	}
+
+	void STDMETHODCALLTYPE SetGraphicsRoot32BitConstant(UINT index, UINT data, UINT offset) override
+	{
+		Begin(Root32BitConstant);
+		Append(index);
+		Append(data);
+		Append(offset);
+	}
+
+	void STDMETHODCALLTYPE SetGraphicsRootConstantBufferView(UINT index, D3D12_GPU_VIRTUAL_ADDRESS address) override
+	{
+		Begin(RootConstantBufferView);
+		Append(index);
+		Append(address);
+	}
+
+	void STDMETHODCALLTYPE SetGraphicsRootShaderResourceView(UINT index, D3D12_GPU_VIRTUAL_ADDRESS address) override
+	{
+		Begin(RootShaderResourceView);
+		Append(index);
+		Append(address);
+	}
+
+	void STDMETHODCALLTYPE IASetVertexBuffers(UINT startSlot, UINT count, const D3D12_VERTEX_BUFFER_VIEW* views) override
+	{
+		Begin(VertexBuffers);
+		Append(startSlot);
+		Append(count);
+		Append(views, count * sizeof(*views));
+	}
+
+	void STDMETHODCALLTYPE IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view) override
+	{
+		Begin(IndexBuffer);
+		Append(*view);
+	}
+
+	void STDMETHODCALLTYPE IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology) override
+	{
+		Begin(PrimitiveTopology);
+		Append(topology);
+	}
+
+	// Everything else is only tagged.
+
+	void STDMETHODCALLTYPE ClearState(ID3D12PipelineState*) override { Begin(Other); }
+	void STDMETHODCALLTYPE DrawInstanced(UINT, UINT, UINT, UINT) override { Begin(Other); }
+	void STDMETHODCALLTYPE Dispatch(UINT, UINT, UINT) override { Begin(Other); }
+	void STDMETHODCALLTYPE CopyBufferRegion(ID3D12Resource*, UINT64, ID3D12Resource*, UINT64, UINT64) override
+	{
+		Begin(Other);
+	}
+	void STDMETHODCALLTYPE CopyTextureRegion(const D3D12_TEXTURE_COPY_LOCATION*, UINT, UINT, UINT,
+		const D3D12_TEXTURE_COPY_LOCATION*, const D3D12_BOX*) override
+	{
+		Begin(Other);
+	}
+	void STDMETHODCALLTYPE CopyResource(ID3D12Resource*, ID3D12Resource*) override { Begin(Other); }
+	void STDMETHODCALLTYPE CopyTiles(ID3D12Resource*, const D3D12_TILED_RESOURCE_COORDINATE*,
+		const D3D12_TILE_REGION_SIZE*, ID3D12Resource*, UINT64, D3D12_TILE_COPY_FLAGS) override
+	{
+		Begin(Other);
+	}
+	void STDMETHODCALLTYPE ResolveSubresource(ID3D12Resource*, UINT, ID3D12Resource*, UINT, DXGI_FORMAT) override
+	{
+		Begin(Other);
+	}
+	void STDMETHODCALLTYPE RSSetViewports(UINT, const D3D12_VIEWPORT*) override { Begin(Other); }
+	void STDMETHODCALLTYPE RSSetScissorRects(UINT, const D3D12_RECT*) override { Begin(Other); }
+	void STDMETHODCALLTYPE OMSetBlendFactor(const FLOAT[4]) override { Begin(Other); }
+	void STDMETHODCALLTYPE OMSetStencilRef(UINT) override { Begin(Other); }
+	void STDMETHODCALLTYPE SetPipelineState(ID3D12PipelineState*) override { Begin(Other); }
+	void STDMETHODCALLTYPE ResourceBarrier(UINT, const D3D12_RESOURCE_BARRIER*) override { Begin(Other); }
+	void STDMETHODCALLTYPE ExecuteBundle(ID3D12GraphicsCommandList*) override { Begin(Other); }
+	void STDMETHODCALLTYPE SetComputeRootSignature(ID3D12RootSignature*) override { Begin(Other); }
+	void STDMETHODCALLTYPE SetComputeRootDescriptorTable(UINT, D3D12_GPU_DESCRIPTOR_HANDLE) override { Begin(Other); }
+	void STDMETHODCALLTYPE SetComputeRoot32BitConstant(UINT, UINT, UINT) override { Begin(Other); }
+	void STDMETHODCALLTYPE SetComputeRoot32BitConstants(UINT, UINT, const void*, UINT) override { Begin(Other); }
+	void STDMETHODCALLTYPE SetGraphicsRoot32BitConstants(UINT, UINT, const void*, UINT) override { Begin(Other); }
+	void STDMETHODCALLTYPE SetComputeRootConstantBufferView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) override { Begin(Other); }
+	void STDMETHODCALLTYPE SetComputeRootShaderResourceView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) override { Begin(Other); }
+	void STDMETHODCALLTYPE SetComputeRootUnorderedAccessView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) override { Begin(Other); }
+	void STDMETHODCALLTYPE SetGraphicsRootUnorderedAccessView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) override { Begin(Other); }
+	void STDMETHODCALLTYPE SOSetTargets(UINT, UINT, const D3D12_STREAM_OUTPUT_BUFFER_VIEW*) override { Begin(Other); }
+	void STDMETHODCALLTYPE OMSetRenderTargets(UINT, const D3D12_CPU_DESCRIPTOR_HANDLE*, BOOL,
+		const D3D12_CPU_DESCRIPTOR_HANDLE*) override
+	{
+		Begin(Other);
+	}
+	void STDMETHODCALLTYPE ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE, D3D12_CLEAR_FLAGS, FLOAT, UINT8, UINT,
+		const D3D12_RECT*) override
+	{
+		Begin(Other);
+	}
+	void STDMETHODCALLTYPE ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE, const FLOAT[4], UINT,
+		const D3D12_RECT*) override
+	{
+		Begin(Other);
+	}
+	void STDMETHODCALLTYPE ClearUnorderedAccessViewUint(D3D12_GPU_DESCRIPTOR_HANDLE, D3D12_CPU_DESCRIPTOR_HANDLE,
+		ID3D12Resource*, const UINT[4], UINT, const D3D12_RECT*) override
+	{
+		Begin(Other);
+	}
+	void STDMETHODCALLTYPE ClearUnorderedAccessViewFloat(D3D12_GPU_DESCRIPTOR_HANDLE, D3D12_CPU_DESCRIPTOR_HANDLE,
+		ID3D12Resource*, const FLOAT[4], UINT, const D3D12_RECT*) override
+	{
+		Begin(Other);
+	}
+	void STDMETHODCALLTYPE DiscardResource(ID3D12Resource*, const D3D12_DISCARD_REGION*) override { Begin(Other); }
+	void STDMETHODCALLTYPE BeginQuery(ID3D12QueryHeap*, D3D12_QUERY_TYPE, UINT) override { Begin(Other); }
+	void STDMETHODCALLTYPE EndQuery(ID3D12QueryHeap*, D3D12_QUERY_TYPE, UINT) override { Begin(Other); }
+	void STDMETHODCALLTYPE ResolveQueryData(ID3D12QueryHeap*, D3D12_QUERY_TYPE, UINT, UINT, ID3D12Resource*,
+		UINT64) override
+	{
+		Begin(Other);
+	}
+	void STDMETHODCALLTYPE SetPredication(ID3D12Resource*, UINT64, D3D12_PREDICATION_OP) override { Begin(Other); }
+	void STDMETHODCALLTYPE SetMarker(UINT, const void*, UINT) override { Begin(Other); }
+	void STDMETHODCALLTYPE BeginEvent(UINT, const void*, UINT) override { Begin(Other); }
+	void STDMETHODCALLTYPE EndEvent() override { Begin(Other); }
+	void STDMETHODCALLTYPE ExecuteIndirect(ID3D12CommandSignature*, UINT, ID3D12Resource*, UINT64, ID3D12Resource*,
+		UINT64) override
+	{
+		Begin(Other);
+	}
+
+private:
+	void Begin(Op op)
+	{
+		++CallCount;
+		++Calls[op];
+		Append(op);
+	}
+
+	template<typename T>
+	void Append(const T& value)
+	{
+		Append(&value, sizeof(T));
+	}
+
+	void Append(const void* data, size_t size)
+	{
+		const BYTE* bytes = static_cast<const BYTE*>(data);
+		Commands.insert(Commands.end(), bytes, bytes + size);
+	}
+};
+
+// MockDevice with working resource creation.  Heaps are null, which
+// GpuMemoryAllocator accepts from a mock device.  Placed and committed
+// resources are FakeResources, counted while they live.
+class FakeDevice : public MockDevice
+{
+public:
+	UINT CommittedResourceCount = 0;
+	UINT HeapCount = 0;
+	UINT PlacedResourceCount = 0;
+	// FakeResources not yet released.
+	int LiveResourceCount = 0;
+	// Makes resource creation fail with E_OUTOFMEMORY.
+	bool OutOfMemory = false;
+
+	HRESULT STDMETHODCALLTYPE CreateCommittedResource(const D3D12_HEAP_PROPERTIES* heapProperties, D3D12_HEAP_FLAGS,
+		const D3D12_RESOURCE_DESC* desc, D3D12_RESOURCE_STATES, const D3D12_CLEAR_VALUE*, REFIID,
+		void** resource) override
+	{
+		if (OutOfMemory)
+			return E_OUTOFMEMORY;
+		++CommittedResourceCount;
+		*resource = static_cast<ID3D12Resource*>(new FakeResource(*desc, heapProperties->Type, nullptr, 0,
+			NextAddress(*desc), LiveResourceCount));
+		return S_OK;
+	}
+
+	HRESULT STDMETHODCALLTYPE CreateHeap(const D3D12_HEAP_DESC*, REFIID, void** heap) override
+	{
+		++HeapCount;
+		*heap = nullptr;
+		return S_OK;
+	}
+
+	HRESULT STDMETHODCALLTYPE CreatePlacedResource(ID3D12Heap* heap, UINT64 heapOffset, const D3D12_RESOURCE_DESC* desc,
+		D3D12_RESOURCE_STATES, const D3D12_CLEAR_VALUE*, REFIID, void** resource) override
+	{
+		if (OutOfMemory)
+			return E_OUTOFMEMORY;
+		++PlacedResourceCount;
+		*resource = static_cast<ID3D12Resource*>(new FakeResource(*desc, D3D12_HEAP_TYPE_DEFAULT, heap, heapOffset,
+			NextAddress(*desc), LiveResourceCount));
+		return S_OK;
+	}
+
+	// 64 KB units, and 4 MB alignment for MSAA, as on real hardware.
+	// Textures count 4 bytes a texel and no mips.
+	D3D12_RESOURCE_ALLOCATION_INFO STDMETHODCALLTYPE GetResourceAllocationInfo(UINT, UINT count,
+		const D3D12_RESOURCE_DESC* descs) override
+	{
+		D3D12_RESOURCE_ALLOCATION_INFO info = {};
+		for (UINT i = 0; i < count; ++i)
+		{
+			UINT64 alignment = descs[i].SampleDesc.Count > 1 ?
+				D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+			UINT64 size = descs[i].Width;
+			if (descs[i].Dimension != D3D12_RESOURCE_DIMENSION_BUFFER)
+				size *= UINT64(descs[i].Height) * descs[i].DepthOrArraySize * 4;
+			info.Alignment = (std::max)(info.Alignment, alignment);
+			info.SizeInBytes = (info.SizeInBytes + size + alignment - 1) / alignment * alignment;
+		}
+		return info;
+	}
+
+private:
+	D3D12_GPU_VIRTUAL_ADDRESS NextAddress(const D3D12_RESOURCE_DESC& desc)
+	{
+		D3D12_GPU_VIRTUAL_ADDRESS address = mNextAddress;
+		mNextAddress += (desc.Width + D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT - 1) /
+			D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT * D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+		return address;
+	}
+
+	D3D12_GPU_VIRTUAL_ADDRESS mNextAddress = 0x100000000;
+};
@@ -0,0 +1,185 @@
+#include "DeferredReleaseQueue.h"
+#include "D3D12Fakes.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <thread>
+
+namespace
+{
+	// A COM object that writes its id to a log when the last reference goes.
+	class FakeObject : public IUnknown
+	{
+	public:
+		FakeObject(int id, std::vector<int>& releaseLog) :
+			mId(id),
+			mReleaseLog(releaseLog)
+		{
+		}
+
+		HRESULT STDMETHODCALLTYPE QueryInterface(REFIID, void** object) override
+		{
+			*object = nullptr;
+			return E_NOINTERFACE;
+		}
+
+		ULONG STDMETHODCALLTYPE AddRef() override
+		{
+			return ++mRefCount;
+		}
+
+		ULONG STDMETHODCALLTYPE Release() override
+		{
+			ULONG refCount = --mRefCount;
+			if (refCount == 0)
+			{
+				mReleaseLog.push_back(mId);
+				delete this;
+			}
+			return refCount;
+		}
+
+	private:
+		ULONG mRefCount = 1;
+		int mId;
+		std::vector<int>& mReleaseLog;
+	};
+
+	// Defers a new object and drops the caller's reference, so the queue
+	// holds the last one.
+	void Defer(DeferredReleaseQueue& queue, int id, UINT64 fence, std::vector<int>& releaseLog)
+	{
+		Microsoft::WRL::ComPtr<IUnknown> object;
+		object.Attach(new FakeObject(id, releaseLog));
+		queue.Defer(std::move(object), fence);
+	}
+}
+
+TEST(DeferredReleaseQueue, ReleasesOnlyWhatTheFenceHasPassed)
+{
+	std::vector<int> released;
+	DeferredReleaseQueue queue;
+	FakeFence fence;
+
+	// Deferred out of fence order, as objects from several queues would be.
+	Defer(queue, 1, 2, released);
+	Defer(queue, 2, 1, released);
+	Defer(queue, 3, 3, released);
+	EXPECT_EQ(3u, queue.PendingCount());
+
+	EXPECT_EQ(0u, queue.Collect(fence.GetCompletedValue()));
+	EXPECT_TRUE(released.empty());
+
+	fence.Signal(1);
+	EXPECT_EQ(1u, queue.Collect(fence.GetCompletedValue()));
+	EXPECT_EQ(std::vector<int>({ 2 }), released);
+	EXPECT_EQ(2u, queue.PendingCount());
+
+	// Collecting again at the same value releases nothing more.
+	EXPECT_EQ(0u, queue.Collect(fence.GetCompletedValue()));
+
+	fence.Signal(3);
+	EXPECT_EQ(2u, queue.Collect(fence.GetCompletedValue()));
+	std::sort(released.begin() + 1, released.end());
+	EXPECT_EQ(std::vector<int>({ 2, 1, 3 }), released);
+	EXPECT_EQ(0u, queue.PendingCount());
+}
+
+TEST(DeferredReleaseQueue, ObjectsDeferredBetweenCollectsWaitForTheirOwnFence)
+{
+	std::vector<int> released;
+	DeferredReleaseQueue queue;
+	FakeFence fence;
+
+	Defer(queue, 1, 2, released);
+	fence.Signal(1);
+	EXPECT_EQ(0u, queue.Collect(fence.GetCompletedValue()));
+
+	// Deferred after a Collect() that kept an older object waiting.
+	Defer(queue, 2, 1, released);
+	Defer(queue, 3, 4, released);
+	EXPECT_EQ(3u, queue.PendingCount());
+	EXPECT_EQ(1u, queue.Collect(fence.GetCompletedValue()));
+	EXPECT_EQ(std::vector<int>({ 2 }), released);
+
+	fence.Signal(2);
+	EXPECT_EQ(1u, queue.Collect(fence.GetCompletedValue()));
+	EXPECT_EQ(std::vector<int>({ 2, 1 }), released);
+
+	fence.Signal(4);
+	EXPECT_EQ(1u, queue.Collect(fence.GetCompletedValue()));
+	EXPECT_EQ(std::vector<int>({ 2, 1, 3 }), released);
+}
+
+TEST(DeferredReleaseQueue, KeepsObjectsOthersStillReference)
+{
+	std::vector<int> released;
+	DeferredReleaseQueue queue;
+
+	Microsoft::WRL::ComPtr<IUnknown> shared;
+	shared.Attach(new FakeObject(1, released));
+	queue.Defer(shared, 1);
+	// Null objects are not held.
+	queue.Defer(nullptr, 1);
+	EXPECT_EQ(1u, queue.PendingCount());
+
+	// The queue drops its reference, not the object.
+	EXPECT_EQ(1u, queue.Collect(1));
+	EXPECT_TRUE(released.empty());
+	shared = nullptr;
+	EXPECT_EQ(std::vector<int>({ 1 }), released);
+}
+
+TEST(DeferredReleaseQueue, DestructorReleasesEverything)
+{
+	std::vector<int> released;
+	{
+		DeferredReleaseQueue queue;
+		Defer(queue, 1, 5, released);
+		queue.Collect(0);
+		Defer(queue, 2, 6, released);
+	}
+	std::sort(released.begin(), released.end());
+	EXPECT_EQ(std::vector<int>({ 1, 2 }), released);
+}
+
+TEST(DeferredReleaseQueue, ProducersOnOtherThreadsNeverReleaseEarly)
+{
+	const int kThreads = 4;
+	const int kPerThread = 2000;
+	std::vector<int> released[kThreads];
+	DeferredReleaseQueue queue;
+	FakeFence fence;
+
+	std::vector<std::thread> producers;
+	for (int t = 0; t < kThreads; ++t)
+	{
+		producers.emplace_back([&queue, &released, t]()
+		{
+			// Each object's id is the fence it waits for.
+			for (int i = 1; i <= kPerThread; ++i)
+				Defer(queue, i, i, released[t]);
+		});
+	}
+
+	// Every release must be for a fence value Collect() had seen complete
+	// at the time.
+	bool early = false;
+	for (UINT64 value = 0; value <= kPerThread; value += 100)
+	{
+		fence.Signal(value);
+		queue.Collect(fence.GetCompletedValue());
+		for (const std::vector<int>& log : released)
+		{
+			for (int id : log)
+				early |= UINT64(id) > value;
+		}
+	}
+	for (std::thread& producer : producers)
+		producer.join();
+
+	queue.Collect(kPerThread);
+	EXPECT_FALSE(early);
+	EXPECT_EQ(0u, queue.PendingCount());
+	for (const std::vector<int>& log : released)
+		EXPECT_EQ(size_t(kPerThread), log.size());
+}
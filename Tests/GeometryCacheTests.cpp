@@ -0,0 +1,209 @@
+#include "GeometryCacheFormat.h"
+#include "Benchmark.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	using MeshData = GeometryGenerator::MeshData;
+	using Key = GeometryCacheFormat::Key;
+
+	// Where the fields the rejection tests corrupt sit in the file header.
+	const size_t kVersionOffset = 4;
+	const size_t kVertexByteSizeOffset = 16;
+	const size_t kVertexCountOffset = 20;
+	const size_t kHeaderSize = 32;
+
+	struct Shape
+	{
+		const char* Name;
+		std::uint64_t Key;
+		MeshData Mesh;
+	};
+
+	// The shapes GeometryCache caches, keyed the way it keys them.
+	std::vector<Shape> Shapes()
+	{
+		GeometryGenerator generator;
+		std::vector<Shape> shapes;
+		shapes.push_back({ "box", Key("Box").Add(1.5f).Add(0.5f).Add(1.5f).Add(3u).Value(),
+			generator.CreateBox(1.5f, 0.5f, 1.5f, 3) });
+		shapes.push_back({ "grid", Key("Grid").Add(20.0f).Add(30.0f).Add(60u).Add(40u).Value(),
+			generator.CreateGrid(20.0f, 30.0f, 60, 40) });
+		shapes.push_back({ "sphere", Key("Sphere").Add(0.5f).Add(20u).Add(20u).Value(),
+			generator.CreateSphere(0.5f, 20, 20) });
+		shapes.push_back({ "cylinder", Key("Cylinder").Add(0.5f).Add(0.3f).Add(3.0f).Add(20u).Add(20u).Value(),
+			generator.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20) });
+		shapes.push_back({ "geosphere", Key("Geosphere").Add(1.0f).Add(3u).Value(),
+			generator.CreateGeosphere(1.0f, 3) });
+		return shapes;
+	}
+
+	std::string Serialize(std::uint64_t key, const MeshData& mesh)
+	{
+		std::ostringstream out(std::ios::binary);
+		GeometryCacheFormat::Write(out, key, mesh);
+		return out.str();
+	}
+
+	bool Deserialize(const std::string& bytes, std::uint64_t key, MeshData& mesh)
+	{
+		std::istringstream in(bytes, std::ios::binary);
+		return GeometryCacheFormat::Read(in, key, mesh);
+	}
+
+	void Set32(std::string& bytes, size_t offset, std::uint32_t value)
+	{
+		std::memcpy(&bytes[offset], &value, sizeof(value));
+	}
+
+	// Bytewise, so that a round trip has to preserve every bit, -0 included.
+	void ExpectSameBytes(const MeshData& expected, const MeshData& actual)
+	{
+		ASSERT_EQ(expected.Vertices.size(), actual.Vertices.size());
+		EXPECT_EQ(0, std::memcmp(expected.Vertices.data(), actual.Vertices.data(),
+			expected.Vertices.size() * sizeof(GeometryGenerator::Vertex)));
+		EXPECT_EQ(expected.Indices32, actual.Indices32);
+	}
+}
+
+TEST(GeometryCacheFormat, RoundTripsEveryShape)
+{
+	for (const Shape& shape : Shapes())
+	{
+		SCOPED_TRACE(shape.Name);
+		std::string bytes = Serialize(shape.Key, shape.Mesh);
+		EXPECT_EQ(kHeaderSize + shape.Mesh.Vertices.size() * sizeof(GeometryGenerator::Vertex) +
+			shape.Mesh.Indices32.size() * sizeof(std::uint32_t), bytes.size());
+
+		MeshData loaded;
+		ASSERT_TRUE(Deserialize(bytes, shape.Key, loaded));
+		ExpectSameBytes(shape.Mesh, loaded);
+	}
+}
+
+TEST(GeometryCacheFormat, RoundTripsEmptyMesh)
+{
+	std::uint64_t key = Key("Empty").Value();
+	MeshData loaded;
+	loaded.Indices32.push_back(7);
+	ASSERT_TRUE(Deserialize(Serialize(key, MeshData()), key, loaded));
+	EXPECT_TRUE(loaded.Vertices.empty());
+	EXPECT_TRUE(loaded.Indices32.empty());
+}
+
+TEST(GeometryCacheFormat, RejectsForeignAndDamagedFiles)
+{
+	Shape shape = Shapes()[2];
+	const std::string good = Serialize(shape.Key, shape.Mesh);
+
+	std::vector<std::pair<const char*, std::string>> bad;
+	std::string wrongMagic = good;
+	wrongMagic[0] ^= 1;
+	bad.push_back({ "magic", wrongMagic });
+	std::string wrongVersion = good;
+	Set32(wrongVersion, kVersionOffset, 0xFFFFFFFFu);
+	bad.push_back({ "version", wrongVersion });
+	std::string wrongVertexSize = good;
+	Set32(wrongVertexSize, kVertexByteSizeOffset, sizeof(GeometryGenerator::Vertex) + 4);
+	bad.push_back({ "vertex size", wrongVertexSize });
+	std::string hugeCount = good;
+	Set32(hugeCount, kVertexCountOffset, 0xFFFFFFFFu);
+	bad.push_back({ "vertex count", hugeCount });
+	bad.push_back({ "truncated header", good.substr(0, kHeaderSize - 1) });
+	bad.push_back({ "truncated data", good.substr(0, good.size() - 1) });
+	bad.push_back({ "trailing data", good + '\0' });
+	bad.push_back({ "empty", std::string() });
+
+	for (const auto& file : bad)
+	{
+		SCOPED_TRACE(file.first);
+		MeshData loaded;
+		loaded.Indices32.push_back(7);
+		EXPECT_FALSE(Deserialize(file.second, shape.Key, loaded));
+		EXPECT_TRUE(loaded.Vertices.empty());
+		EXPECT_TRUE(loaded.Indices32.empty());
+	}
+
+	MeshData loaded;
+	EXPECT_FALSE(Deserialize(good, shape.Key + 1, loaded));
+	EXPECT_TRUE(Deserialize(good, shape.Key, loaded));
+}
+
+TEST(GeometryCacheFormat, KeysSeparateParameters)
+{
+	EXPECT_EQ(Key("Sphere").Add(0.5f).Add(20u).Value(), Key("Sphere").Add(0.5f).Add(20u).Value());
+	EXPECT_EQ(Key("Grid").Add(0.0f).Value(), Key("Grid").Add(-0.0f).Value());
+
+	EXPECT_NE(Key("Sphere").Add(0.5f).Value(), Key("Geosphere").Add(0.5f).Value());
+	EXPECT_NE(Key("Box").Add(1.0f).Add(2.0f).Value(), Key("Box").Add(2.0f).Add(1.0f).Value());
+	EXPECT_NE(Key("Sphere").Add(20u).Add(10u).Value(), Key("Sphere").Add(10u).Add(20u).Value());
+	EXPECT_NE(Key("Sphere").Add(0.5f).Value(), Key("Sphere").Add(0.5001f).Value());
+	EXPECT_NE(Key("Sphere").Value(), Key("Sphere").Add(0u).Value());
+}
+
+// What a cache miss costs against a hit: running the generator, reading the
+// file back from disk, and parsing bytes already in memory.  The file is
+// written once up front, so the disk case measures a warm OS file cache; the
+// memory case includes the copy istringstream makes of its string.
+TEST(GeometryCacheBenchmark, DISABLED_ColdVsWarm)
+{
+	struct Case
+	{
+		const char* Name;
+		std::function<MeshData()> Generate;
+	};
+
+	GeometryGenerator generator;
+	const Case cases[] = {
+		{ "sphere 20x20", [&] { return generator.CreateSphere(0.5f, 20, 20); } },
+		{ "sphere 200x200", [&] { return generator.CreateSphere(0.5f, 200, 200); } },
+		{ "cylinder 200x200", [&] { return generator.CreateCylinder(0.5f, 0.3f, 3.0f, 200, 200); } },
+		{ "grid 500x500", [&] { return generator.CreateGrid(20.0f, 30.0f, 500, 500); } },
+		{ "geosphere 6", [&] { return generator.CreateGeosphere(1.0f, 6); } },
+	};
+
+	const std::string path = ::testing::TempDir() + "GeometryCacheBenchmark.bin";
+	for (const Case& c : cases)
+	{
+		std::uint64_t key = Key(c.Name).Value();
+		MeshData mesh = c.Generate();
+		{
+			std::ofstream file(path, std::ios::binary | std::ios::trunc);
+			GeometryCacheFormat::Write(file, key, mesh);
+		}
+		std::string bytes = Serialize(key, mesh);
+
+		std::printf("%s: %zu vertices, %zu indices, %zu bytes\n", c.Name, mesh.Vertices.size(),
+			mesh.Indices32.size(), bytes.size());
+
+		size_t generated = 0;
+		size_t fromDisk = 0;
+		size_t fromMemory = 0;
+		std::string label = std::string(c.Name) + " / generate";
+		Benchmark::Measure(label.c_str(), [&] { generated += c.Generate().Vertices.size(); });
+		label = std::string(c.Name) + " / read file";
+		Benchmark::Measure(label.c_str(), [&] {
+			std::ifstream file(path, std::ios::binary);
+			MeshData loaded;
+			if (GeometryCacheFormat::Read(file, key, loaded))
+				fromDisk += loaded.Vertices.size();
+		});
+		label = std::string(c.Name) + " / read memory";
+		Benchmark::Measure(label.c_str(), [&] {
+			MeshData loaded;
+			if (Deserialize(bytes, key, loaded))
+				fromMemory += loaded.Vertices.size();
+		});
+
+		EXPECT_GT(generated, 0u);
+		EXPECT_GT(fromDisk, 0u);
+		EXPECT_GT(fromMemory, 0u);
+	}
+	std::remove(path.c_str());
+}
@@ -0,0 +1,303 @@
+#include "GeometryGenerator.h"
+#include "Benchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace
+{
+	using MeshData = GeometryGenerator::MeshData;
+
+	// The SoA kernels evaluate sin/cos four lanes at a time, so they may
+	// differ from the scalar generators in the last bit or two.
+	const float kSoATolerance = 1e-5f;
+
+	float MaxDifference(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b)
+	{
+		return (std::max)({ std::fabs(a.x - b.x), std::fabs(a.y - b.y), std::fabs(a.z - b.z) });
+	}
+
+	float MaxDifference(const DirectX::XMFLOAT2& a, const DirectX::XMFLOAT2& b)
+	{
+		return (std::max)(std::fabs(a.x - b.x), std::fabs(a.y - b.y));
+	}
+
+	void ExpectSameMesh(const MeshData& expected, const MeshData& actual)
+	{
+		ASSERT_EQ(expected.Vertices.size(), actual.Vertices.size());
+		EXPECT_EQ(expected.Indices32, actual.Indices32);
+		for (size_t i = 0; i < expected.Vertices.size(); ++i)
+		{
+			const GeometryGenerator::Vertex& e = expected.Vertices[i];
+			const GeometryGenerator::Vertex& a = actual.Vertices[i];
+			EXPECT_LE(MaxDifference(e.Position, a.Position), kSoATolerance) << "vertex " << i;
+			EXPECT_LE(MaxDifference(e.Normal, a.Normal), kSoATolerance) << "vertex " << i;
+			EXPECT_LE(MaxDifference(e.TangentU, a.TangentU), kSoATolerance) << "vertex " << i;
+			EXPECT_LE(MaxDifference(e.TexC, a.TexC), kSoATolerance) << "vertex " << i;
+		}
+	}
+
+	// The geosphere as it was generated before Subdivide shared midpoints:
+	// every level copies the mesh and emits six vertices per triangle, so
+	// each midpoint is computed and stored once per triangle using it.
+	namespace Baseline
+	{
+		using namespace DirectX;
+		using Vertex = GeometryGenerator::Vertex;
+
+		Vertex MidPoint(const Vertex& v0, const Vertex& v1)
+		{
+			XMVECTOR pos = 0.5f * (XMLoadFloat3(&v0.Position) + XMLoadFloat3(&v1.Position));
+			XMVECTOR normal = XMVector3Normalize(0.5f * (XMLoadFloat3(&v0.Normal) + XMLoadFloat3(&v1.Normal)));
+			XMVECTOR tangent = XMVector3Normalize(0.5f * (XMLoadFloat3(&v0.TangentU) + XMLoadFloat3(&v1.TangentU)));
+			XMVECTOR tex = 0.5f * (XMLoadFloat2(&v0.TexC) + XMLoadFloat2(&v1.TexC));
+
+			Vertex v;
+			XMStoreFloat3(&v.Position, pos);
+			XMStoreFloat3(&v.Normal, normal);
+			XMStoreFloat3(&v.TangentU, tangent);
+			XMStoreFloat2(&v.TexC, tex);
+			return v;
+		}
+
+		void Subdivide(MeshData& meshData)
+		{
+			MeshData inputCopy = meshData;
+			meshData.Vertices.resize(0);
+			meshData.Indices32.resize(0);
+
+			std::uint32_t numTris = (std::uint32_t)inputCopy.Indices32.size() / 3;
+			for (std::uint32_t i = 0; i < numTris; ++i)
+			{
+				Vertex v0 = inputCopy.Vertices[inputCopy.Indices32[i * 3 + 0]];
+				Vertex v1 = inputCopy.Vertices[inputCopy.Indices32[i * 3 + 1]];
+				Vertex v2 = inputCopy.Vertices[inputCopy.Indices32[i * 3 + 2]];
+				Vertex m0 = MidPoint(v0, v1);
+				Vertex m1 = MidPoint(v1, v2);
+				Vertex m2 = MidPoint(v0, v2);
+
+				meshData.Vertices.push_back(v0);
+				meshData.Vertices.push_back(v1);
+				meshData.Vertices.push_back(v2);
+				meshData.Vertices.push_back(m0);
+				meshData.Vertices.push_back(m1);
+				meshData.Vertices.push_back(m2);
+
+				const std::uint32_t k[12] = { 0, 3, 5, 3, 4, 5, 5, 4, 2, 3, 1, 4 };
+				for (std::uint32_t j : k)
+					meshData.Indices32.push_back(i * 6 + j);
+			}
+		}
+
+		MeshData CreateGeosphere(float radius, std::uint32_t numSubdivisions)
+		{
+			const float X = 0.525731f;
+			const float Z = 0.850651f;
+			const XMFLOAT3 pos[12] =
+			{
+				XMFLOAT3(-X, 0.0f, Z),  XMFLOAT3(X, 0.0f, Z),
+				XMFLOAT3(-X, 0.0f, -Z), XMFLOAT3(X, 0.0f, -Z),
+				XMFLOAT3(0.0f, Z, X),   XMFLOAT3(0.0f, Z, -X),
+				XMFLOAT3(0.0f, -Z, X),  XMFLOAT3(0.0f, -Z, -X),
+				XMFLOAT3(Z, X, 0.0f),   XMFLOAT3(-Z, X, 0.0f),
+				XMFLOAT3(Z, -X, 0.0f),  XMFLOAT3(-Z, -X, 0.0f)
+			};
+			const std::uint32_t k[60] =
+			{
+				1,4,0,  4,9,0,  4,5,9,  8,5,4,  1,8,4,
+				1,10,8, 10,3,8, 8,3,5,  3,2,5,  3,7,2,
+				3,10,7, 10,6,7, 6,11,7, 6,0,11, 6,1,0,
+				10,1,6, 11,0,9, 2,11,9, 5,2,9,  11,2,7
+			};
+
+			MeshData meshData;
+			meshData.Vertices.resize(12);
+			meshData.Indices32.assign(&k[0], &k[60]);
+			for (std::uint32_t i = 0; i < 12; ++i)
+				meshData.Vertices[i].Position = pos[i];
+
+			for (std::uint32_t i = 0; i < numSubdivisions; ++i)
+				Subdivide(meshData);
+
+			for (Vertex& v : meshData.Vertices)
+			{
+				XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&v.Position));
+				XMStoreFloat3(&v.Position, radius * n);
+				XMStoreFloat3(&v.Normal, n);
+
+				float theta = atan2f(v.Position.z, v.Position.x);
+				if (theta < 0.0f)
+					theta += XM_2PI;
+				float phi = acosf(v.Position.y / radius);
+				v.TexC = XMFLOAT2(theta / XM_2PI, phi / XM_PI);
+
+				XMVECTOR T = XMVectorSet(-radius * sinf(phi) * sinf(theta), 0.0f, radius * sinf(phi) * cosf(theta), 0.0f);
+				XMStoreFloat3(&v.TangentU, XMVector3Normalize(T));
+			}
+			return meshData;
+		}
+	}
+
+	// The distinct positions of a mesh, sorted.
+	std::vector<std::tuple<float, float, float>> UniquePositions(const MeshData& meshData)
+	{
+		std::vector<std::tuple<float, float, float>> positions;
+		for (const GeometryGenerator::Vertex& v : meshData.Vertices)
+			positions.emplace_back(v.Position.x, v.Position.y, v.Position.z);
+		std::sort(positions.begin(), positions.end());
+		positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+		return positions;
+	}
+}
+
+// An icosahedron subdivided n times with shared midpoints has 10 * 4^n + 2
+// vertices and 20 * 4^n triangles, none of them duplicated.
+TEST(GeometryGenerator, GeosphereCounts)
+{
+	GeometryGenerator generator;
+	for (std::uint32_t level = 0; level <= 8; ++level)
+	{
+		SCOPED_TRACE(level);
+		std::uint32_t pow4 = 1u << (2 * level);
+		MeshData meshData = generator.CreateGeosphere(1.0f, level);
+		EXPECT_EQ(10 * pow4 + 2, meshData.Vertices.size());
+		EXPECT_EQ(60 * pow4, meshData.Indices32.size());
+		EXPECT_EQ(meshData.Vertices.size(), GeometryGenerator::GeosphereSize(level).VertexCount);
+		EXPECT_EQ(meshData.Indices32.size(), GeometryGenerator::GeosphereSize(level).IndexCount);
+		if (level <= 5)
+			EXPECT_EQ(meshData.Vertices.size(), UniquePositions(meshData).size());
+	}
+}
+
+// Sharing midpoints changes the vertex count, not the surface: the baseline
+// computes every midpoint from the same two endpoints, so the positions match
+// exactly.
+TEST(GeometryGenerator, GeosphereMatchesBaseline)
+{
+	GeometryGenerator generator;
+	for (std::uint32_t level = 0; level <= 4; ++level)
+	{
+		SCOPED_TRACE(level);
+		MeshData meshData = generator.CreateGeosphere(2.0f, level);
+		MeshData baseline = Baseline::CreateGeosphere(2.0f, level);
+		EXPECT_EQ(baseline.Indices32.size(), meshData.Indices32.size());
+		EXPECT_TRUE(UniquePositions(baseline) == UniquePositions(meshData));
+	}
+}
+
+// The span overloads subdivide in per-thread scratch, so threads sharing one
+// generator must not see each other's half-built meshes.
+TEST(GeometryGenerator, SharedGeneratorAcrossThreads)
+{
+	GeometryGenerator generator;
+	const MeshData geosphere = generator.CreateGeosphere(1.0f, 4);
+	const MeshData box = generator.CreateBox(1.0f, 2.0f, 3.0f, 3);
+
+	auto build = [&](bool isGeosphere, MeshData& out) {
+		GeometryGenerator::MeshSize size = isGeosphere ?
+			GeometryGenerator::GeosphereSize(4) : GeometryGenerator::BoxSize(3);
+		out.Vertices.resize(size.VertexCount);
+		out.Indices32.resize(size.IndexCount);
+		GeometryGenerator::MeshSpan span;
+		span.Vertices = out.Vertices.data();
+		span.Indices = out.Indices32.data();
+		for (int i = 0; i < 50; ++i)
+		{
+			if (isGeosphere)
+				generator.CreateGeosphere(1.0f, 4, span);
+			else
+				generator.CreateBox(1.0f, 2.0f, 3.0f, 3, span);
+		}
+	};
+
+	MeshData fromThread0;
+	MeshData fromThread1;
+	std::thread thread0(build, true, std::ref(fromThread0));
+	std::thread thread1(build, false, std::ref(fromThread1));
+	thread0.join();
+	thread1.join();
+
+	EXPECT_EQ(geosphere.Indices32, fromThread0.Indices32);
+	EXPECT_EQ(box.Indices32, fromThread1.Indices32);
+	ASSERT_EQ(geosphere.Vertices.size(), fromThread0.Vertices.size());
+	ASSERT_EQ(box.Vertices.size(), fromThread1.Vertices.size());
+	for (size_t i = 0; i < geosphere.Vertices.size(); ++i)
+		EXPECT_EQ(0.0f, MaxDifference(geosphere.Vertices[i].Position, fromThread0.Vertices[i].Position));
+	for (size_t i = 0; i < box.Vertices.size(); ++i)
+		EXPECT_EQ(0.0f, MaxDifference(box.Vertices[i].Position, fromThread1.Vertices[i].Position));
+}
+
+// Slice and stack counts that are not multiples of four exercise the partial
+// last iteration of the four-wide kernels.
+TEST(GeometryGeneratorSoA, SphereMatchesAoS)
+{
+	GeometryGenerator generator;
+	ExpectSameMesh(generator.CreateSphere(0.5f, 20, 20),
+		GeometryGenerator::Interleave(generator.CreateSphereSoA(0.5f, 20, 20)));
+	ExpectSameMesh(generator.CreateSphere(2.0f, 37, 13),
+		GeometryGenerator::Interleave(generator.CreateSphereSoA(2.0f, 37, 13)));
+}
+
+TEST(GeometryGeneratorSoA, CylinderMatchesAoS)
+{
+	GeometryGenerator generator;
+	ExpectSameMesh(generator.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20),
+		GeometryGenerator::Interleave(generator.CreateCylinderSoA(0.5f, 0.3f, 3.0f, 20, 20)));
+	ExpectSameMesh(generator.CreateCylinder(1.5f, 0.3f, 2.0f, 13, 7),
+		GeometryGenerator::Interleave(generator.CreateCylinderSoA(1.5f, 0.3f, 2.0f, 13, 7)));
+}
+
+TEST(GeometryGeneratorSoA, GridMatchesAoS)
+{
+	GeometryGenerator generator;
+	ExpectSameMesh(generator.CreateGrid(20.0f, 30.0f, 60, 40),
+		GeometryGenerator::Interleave(generator.CreateGridSoA(20.0f, 30.0f, 60, 40)));
+	ExpectSameMesh(generator.CreateGrid(20.0f, 30.0f, 7, 9),
+		GeometryGenerator::Interleave(generator.CreateGridSoA(20.0f, 30.0f, 7, 9)));
+}
+
+TEST(GeometryGeneratorBenchmark, DISABLED_SoAvsAoS)
+{
+	GeometryGenerator generator;
+	Benchmark::Measure("Sphere 256x256 AoS", [&]() {
+		Benchmark::DoNotOptimize(generator.CreateSphere(1.0f, 256, 256));
+	});
+	Benchmark::Measure("Sphere 256x256 SoA", [&]() {
+		Benchmark::DoNotOptimize(generator.CreateSphereSoA(1.0f, 256, 256));
+	});
+	Benchmark::Measure("Cylinder 256x256 AoS", [&]() {
+		Benchmark::DoNotOptimize(generator.CreateCylinder(1.0f, 0.5f, 3.0f, 256, 256));
+	});
+	Benchmark::Measure("Cylinder 256x256 SoA", [&]() {
+		Benchmark::DoNotOptimize(generator.CreateCylinderSoA(1.0f, 0.5f, 3.0f, 256, 256));
+	});
+	Benchmark::Measure("Grid 512x512 AoS", [&]() {
+		Benchmark::DoNotOptimize(generator.CreateGrid(10.0f, 10.0f, 512, 512));
+	});
+	Benchmark::Measure("Grid 512x512 SoA", [&]() {
+		Benchmark::DoNotOptimize(generator.CreateGridSoA(10.0f, 10.0f, 512, 512));
+	});
+}
+
+TEST(GeometryGeneratorBenchmark, DISABLED_GeosphereVsBaseline)
+{
+	GeometryGenerator generator;
+	for (std::uint32_t level = 0; level <= 8; ++level)
+	{
+		size_t vertices = 0;
+		size_t baselineVertices = 0;
+		std::string label = "Geosphere " + std::to_string(level) + " shared midpoints";
+		Benchmark::Measure(label.c_str(), [&]() {
+			vertices += generator.CreateGeosphere(1.0f, level).Vertices.size();
+		});
+		label = "Geosphere " + std::to_string(level) + " baseline";
+		Benchmark::Measure(label.c_str(), [&]() {
+			baselineVertices += Baseline::CreateGeosphere(1.0f, level).Vertices.size();
+		});
+		EXPECT_GT(vertices, 0u);
+		EXPECT_GT(baselineVertices, 0u);
+	}
+}
@@ -0,0 +1,265 @@
+#include "GpuMemoryAllocator.h"
+#include "D3D12Fakes.h"
+#include <gtest/gtest.h>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	const UINT64 KB = 1024;
+	const UINT64 MB = 1024 * 1024;
+
+	ComPtr<ID3D12Resource> CreateBuffer(GpuMemoryAllocator& allocator, UINT64 size,
+		D3D12_HEAP_TYPE type = D3D12_HEAP_TYPE_DEFAULT)
+	{
+		return allocator.CreateResource(type, CD3DX12_RESOURCE_DESC::Buffer(size), D3D12_RESOURCE_STATE_COMMON);
+	}
+
+	std::vector<UINT64> BlockSizes(const GpuMemoryAllocator& allocator)
+	{
+		std::vector<UINT64> sizes;
+		for (const GpuMemoryAllocator::BlockStats& block : allocator.GetBlockStats())
+			sizes.push_back(block.Size);
+		return sizes;
+	}
+}
+
+TEST(GpuMemoryAllocator, BlocksGrowToThePreferredSize)
+{
+	FakeDevice device;
+	GpuMemoryAllocator allocator(&device, 64 * MB);
+
+	// 4 MB allocations fill each block exactly; every new block doubles up to
+	// the preferred size.
+	std::vector<GpuMemoryAllocator::Allocation> allocations;
+	for (int i = 0; i < 2 + 4 + 8 + 16 + 1; ++i)
+		allocations.push_back(allocator.Allocate(D3D12_HEAP_TYPE_DEFAULT, HeapCategory::Buffers, 4 * MB, 0));
+	EXPECT_EQ(std::vector<UINT64>({ 8 * MB, 16 * MB, 32 * MB, 64 * MB, 64 * MB }), BlockSizes(allocator));
+	EXPECT_EQ(5u, device.HeapCount);
+
+	GpuMemoryAllocator::Stats stats = allocator.GetStats();
+	EXPECT_EQ(5u, stats.BlockCount);
+	EXPECT_EQ(184 * MB, stats.ReservedBytes);
+	EXPECT_EQ(124 * MB, stats.UsedBytes);
+	EXPECT_EQ(31u, stats.AllocationCount);
+
+	// Space is handed out in 64 KB units.
+	GpuMemoryAllocator::Allocation small = allocator.Allocate(D3D12_HEAP_TYPE_DEFAULT, HeapCategory::Buffers, 1, 0);
+	EXPECT_EQ(GpuMemoryAllocator::UnitSize, small.Size);
+	EXPECT_EQ(0u, small.Offset % GpuMemoryAllocator::UnitSize);
+	allocations.push_back(small);
+
+	for (const GpuMemoryAllocator::Allocation& allocation : allocations)
+		allocator.Free(allocation);
+	stats = allocator.GetStats();
+	EXPECT_EQ(0u, stats.UsedBytes);
+	// One empty block stays as a spare.
+	EXPECT_EQ(1u, stats.BlockCount);
+}
+
+TEST(GpuMemoryAllocator, LargeOrMsaaAlignedResourcesGetTheirOwnHeap)
+{
+	FakeDevice device;
+	GpuMemoryAllocator allocator(&device, 64 * MB);
+
+	GpuMemoryAllocator::Allocation large = allocator.Allocate(D3D12_HEAP_TYPE_DEFAULT, HeapCategory::Buffers,
+		33 * MB, 0);
+	GpuMemoryAllocator::Allocation msaa = allocator.Allocate(D3D12_HEAP_TYPE_DEFAULT, HeapCategory::RenderTargets,
+		MB, D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT);
+	std::vector<GpuMemoryAllocator::BlockStats> blocks = allocator.GetBlockStats();
+	ASSERT_EQ(2u, blocks.size());
+	EXPECT_TRUE(blocks[0].Dedicated);
+	EXPECT_EQ(33 * MB, blocks[0].Size);
+	EXPECT_TRUE(blocks[1].Dedicated);
+	EXPECT_EQ(MB, blocks[1].Size);
+
+	// Dedicated heaps are never spares.
+	allocator.Free(large);
+	allocator.Free(msaa);
+	EXPECT_EQ(0u, allocator.GetStats().BlockCount);
+}
+
+TEST(GpuMemoryAllocator, KeepsHeapTypesAndCategoriesApart)
+{
+	FakeDevice device;
+	GpuMemoryAllocator allocator(&device, 64 * MB);
+
+	CD3DX12_RESOURCE_DESC texture = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, 256, 256);
+	CD3DX12_RESOURCE_DESC depth = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_D24_UNORM_S8_UINT, 256, 256, 1, 1, 1, 0,
+		D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL);
+	EXPECT_EQ(HeapCategory::Buffers, GpuMemoryAllocator::CategoryOf(CD3DX12_RESOURCE_DESC::Buffer(16)));
+	EXPECT_EQ(HeapCategory::Textures, GpuMemoryAllocator::CategoryOf(texture));
+	EXPECT_EQ(HeapCategory::RenderTargets, GpuMemoryAllocator::CategoryOf(depth));
+
+	ComPtr<ID3D12Resource> resources[] = {
+		CreateBuffer(allocator, 100 * KB),
+		CreateBuffer(allocator, 100 * KB, D3D12_HEAP_TYPE_UPLOAD),
+		allocator.CreateResource(D3D12_HEAP_TYPE_DEFAULT, texture, D3D12_RESOURCE_STATE_COMMON),
+		allocator.CreateResource(D3D12_HEAP_TYPE_DEFAULT, depth, D3D12_RESOURCE_STATE_DEPTH_WRITE),
+		CreateBuffer(allocator, 100 * KB),
+	};
+	EXPECT_EQ(5u, device.PlacedResourceCount);
+	EXPECT_EQ(0u, device.CommittedResourceCount);
+
+	std::vector<GpuMemoryAllocator::BlockStats> blocks = allocator.GetBlockStats();
+	ASSERT_EQ(4u, blocks.size());
+	EXPECT_EQ(D3D12_HEAP_TYPE_DEFAULT, blocks[0].Type);
+	EXPECT_EQ(HeapCategory::Buffers, blocks[0].Category);
+	EXPECT_EQ(2u, blocks[0].AllocationCount);
+	EXPECT_EQ(D3D12_HEAP_TYPE_UPLOAD, blocks[1].Type);
+	EXPECT_EQ(HeapCategory::Buffers, blocks[1].Category);
+	EXPECT_EQ(HeapCategory::Textures, blocks[2].Category);
+	// 256 KB of texels.
+	EXPECT_EQ(256 * KB, blocks[2].UsedBytes);
+	EXPECT_EQ(HeapCategory::RenderTargets, blocks[3].Category);
+
+	// The two default buffers do not overlap.
+	FakeResource* first = static_cast<FakeResource*>(resources[0].Get());
+	FakeResource* second = static_cast<FakeResource*>(resources[4].Get());
+	EXPECT_GE(second->HeapOffset, first->HeapOffset + 128 * KB);
+}
+
+TEST(GpuMemoryAllocator, ReleasingAPlacedResourceFreesItsSpace)
+{
+	FakeDevice device;
+	GpuMemoryAllocator allocator(&device, 8 * MB);
+
+	// Two blocks: 1 MB, then 2 MB.
+	ComPtr<ID3D12Resource> a = CreateBuffer(allocator, MB);
+	ComPtr<ID3D12Resource> b = CreateBuffer(allocator, 2 * MB);
+	ComPtr<ID3D12Resource> extra = b;
+	EXPECT_EQ(3 * MB, allocator.GetStats().UsedBytes);
+
+	a.Reset();
+	EXPECT_EQ(2 * MB, allocator.GetStats().UsedBytes);
+	EXPECT_EQ(1, device.LiveResourceCount);
+	// The emptied block is the list's spare.
+	EXPECT_EQ(2u, allocator.GetStats().BlockCount);
+
+	// Only the last reference frees the space.
+	b.Reset();
+	EXPECT_EQ(2 * MB, allocator.GetStats().UsedBytes);
+	extra.Reset();
+	GpuMemoryAllocator::Stats stats = allocator.GetStats();
+	EXPECT_EQ(0u, stats.UsedBytes);
+	EXPECT_EQ(0u, stats.AllocationCount);
+	EXPECT_EQ(1u, stats.BlockCount);
+	EXPECT_EQ(0, device.LiveResourceCount);
+
+	// The spare takes the next resource.
+	ComPtr<ID3D12Resource> c = CreateBuffer(allocator, MB);
+	EXPECT_EQ(2u, device.HeapCount);
+}
+
+TEST(GpuMemoryAllocator, PacksSmallBuffersIntoSharedPages)
+{
+	FakeDevice device;
+	GpuMemoryAllocator allocator(&device, 64 * MB);
+
+	const UINT64 perPage = GpuMemoryAllocator::BufferPageSize / GpuMemoryAllocator::SmallBufferAlignment;
+	std::vector<GpuMemoryAllocator::BufferAllocation> buffers;
+	for (UINT64 i = 0; i < perPage; ++i)
+		buffers.push_back(allocator.AllocateBuffer(D3D12_HEAP_TYPE_UPLOAD, 200));
+
+	// One placed buffer with a persistent mapping.
+	ID3D12Resource* page = buffers[0].Resource;
+	BYTE* mapped = static_cast<FakeResource*>(page)->Memory.data();
+	for (UINT64 i = 0; i < perPage; ++i)
+	{
+		const GpuMemoryAllocator::BufferAllocation& buffer = buffers[size_t(i)];
+		ASSERT_EQ(page, buffer.Resource);
+		EXPECT_EQ(i * GpuMemoryAllocator::SmallBufferAlignment, buffer.Offset);
+		EXPECT_EQ(page->GetGPUVirtualAddress() + buffer.Offset, buffer.GPUAddress);
+		EXPECT_EQ(mapped + buffer.Offset, buffer.CPU);
+	}
+	GpuMemoryAllocator::Stats stats = allocator.GetStats();
+	EXPECT_EQ(1u, stats.BufferPageCount);
+	EXPECT_EQ(perPage, stats.SmallBufferCount);
+	EXPECT_EQ(perPage * 200, stats.SmallBufferBytes);
+	EXPECT_EQ(GpuMemoryAllocator::BufferPageSize, stats.UsedBytes);
+
+	// A full page starts another; default heap pages are not mapped.
+	GpuMemoryAllocator::BufferAllocation overflow = allocator.AllocateBuffer(D3D12_HEAP_TYPE_UPLOAD, 64 * KB);
+	EXPECT_NE(page, overflow.Resource);
+	GpuMemoryAllocator::BufferAllocation gpuOnly = allocator.AllocateBuffer(D3D12_HEAP_TYPE_DEFAULT, 16);
+	EXPECT_EQ(nullptr, gpuOnly.CPU);
+	EXPECT_EQ(3u, allocator.GetStats().BufferPageCount);
+
+	// Freed ranges are reused.
+	allocator.FreeBuffer(buffers[7]);
+	buffers[7] = allocator.AllocateBuffer(D3D12_HEAP_TYPE_UPLOAD, 256);
+	EXPECT_EQ(page, buffers[7].Resource);
+	EXPECT_EQ(7 * GpuMemoryAllocator::SmallBufferAlignment, buffers[7].Offset);
+
+	// Emptied pages go, but for one spare per heap type.
+	for (const GpuMemoryAllocator::BufferAllocation& buffer : buffers)
+		allocator.FreeBuffer(buffer);
+	allocator.FreeBuffer(overflow);
+	allocator.FreeBuffer(gpuOnly);
+	stats = allocator.GetStats();
+	EXPECT_EQ(0u, stats.SmallBufferCount);
+	EXPECT_EQ(0u, stats.SmallBufferBytes);
+	EXPECT_EQ(2u, stats.BufferPageCount);
+}
+
+TEST(GpuMemoryAllocator, DefragmentationEmptiesTheSparsestBlocks)
+{
+	FakeDevice device;
+	// Blocks of 1, 2, 4 and 8 MB, that is 2, 4, 8 and 16 of these buffers.
+	GpuMemoryAllocator allocator(&device, 8 * MB);
+	const UINT64 size = 512 * KB;
+	std::vector<ComPtr<ID3D12Resource>> buffers;
+	for (int i = 0; i < 16; ++i)
+		buffers.push_back(CreateBuffer(allocator, size));
+	EXPECT_EQ(std::vector<UINT64>({ MB, 2 * MB, 4 * MB, 8 * MB }), BlockSizes(allocator));
+
+	// Leaves the 2 MB block with one buffer; the 1 and 4 MB blocks stay full
+	// and the 8 MB one has room.
+	buffers[3].Reset();
+	buffers[4].Reset();
+	buffers[5].Reset();
+	const GpuMemoryAllocator::Stats before = allocator.GetStats();
+
+	// Within 1 MB only the 2 MB block fits.
+	std::vector<GpuMemoryAllocator::Move> moves = allocator.PlanDefragmentation(MB);
+	ASSERT_EQ(1u, moves.size());
+	EXPECT_EQ(buffers[2].Get(), moves[0].Resource);
+	EXPECT_EQ(size, moves[0].Destination.Size);
+	allocator.CancelMoves(moves);
+	EXPECT_EQ(before.UsedBytes, allocator.GetStats().UsedBytes);
+
+	// Unbounded, the 1 MB block goes too.  The full 4 MB block has no room,
+	// so everything lands in the 8 MB one.
+	moves = allocator.PlanDefragmentation(~UINT64(0));
+	ASSERT_EQ(3u, moves.size());
+	EXPECT_EQ(buffers[2].Get(), moves[0].Resource);
+	EXPECT_EQ(buffers[0].Get(), moves[1].Resource);
+	EXPECT_EQ(buffers[1].Get(), moves[2].Resource);
+	EXPECT_EQ(moves[0].Destination.Owner, moves[1].Destination.Owner);
+	EXPECT_EQ(moves[0].Destination.Owner, moves[2].Destination.Owner);
+	EXPECT_EQ(before.UsedBytes + 3 * size, allocator.GetStats().UsedBytes);
+
+	// Carry the moves out as a renderer would, once the copies executed.
+	for (const GpuMemoryAllocator::Move& move : moves)
+	{
+		for (ComPtr<ID3D12Resource>& buffer : buffers)
+		{
+			if (buffer.Get() == move.Resource)
+				buffer = allocator.PlaceResource(move.Destination, move.Resource->GetDesc(),
+					D3D12_RESOURCE_STATE_COMMON);
+		}
+	}
+
+	std::vector<GpuMemoryAllocator::BlockStats> blocks = allocator.GetBlockStats();
+	GpuMemoryAllocator::Stats after = allocator.GetStats();
+	EXPECT_EQ(before.UsedBytes, after.UsedBytes);
+	// Both sources emptied; the 2 MB one stays as the spare.
+	ASSERT_EQ(3u, blocks.size());
+	EXPECT_EQ(0u, blocks[0].AllocationCount);
+	EXPECT_EQ(2 * MB, blocks[0].Size);
+	EXPECT_EQ(8u, blocks[1].AllocationCount);
+	EXPECT_EQ(5u, blocks[2].AllocationCount);
+
+	// Nothing left worth moving.
+	EXPECT_TRUE(allocator.PlanDefragmentation(~UINT64(0)).empty());
+}
@@ -0,0 +1,114 @@
+#include "LinearAllocator.h"
+#include <gtest/gtest.h>
+
+namespace
+{
+	void ExpectAt(const LinearAllocator::Allocation& allocation, std::uint32_t page, LinearAllocator::uint64 offset)
+	{
+		EXPECT_EQ(page, allocation.Page);
+		EXPECT_EQ(offset, allocation.Offset);
+	}
+}
+
+TEST(LinearAllocator, PlacesAllocationsOneAfterAnother)
+{
+	LinearAllocator allocator(1024);
+	ExpectAt(allocator.Allocate(10, 1), 0, 0);
+	EXPECT_TRUE(allocator.NewPage());
+	ExpectAt(allocator.Allocate(100, 256), 0, 256);
+	EXPECT_FALSE(allocator.NewPage());
+	ExpectAt(allocator.Allocate(4, 4), 0, 356);
+
+	LinearAllocator::Stats stats = allocator.GetStats();
+	EXPECT_EQ(1u, stats.PageCount);
+	EXPECT_EQ(1024u, stats.ReservedBytes);
+	EXPECT_EQ(114u, stats.UsedBytes);
+	EXPECT_EQ(246u, stats.PaddingBytes);
+}
+
+TEST(LinearAllocator, StartsANewPageWhenTheCurrentOneIsFull)
+{
+	LinearAllocator allocator(1024);
+	ExpectAt(allocator.Allocate(1000, 16), 0, 0);
+	ExpectAt(allocator.Allocate(100, 16), 1, 0);
+	EXPECT_TRUE(allocator.NewPage());
+	EXPECT_EQ(1024u, allocator.PageSize(1));
+
+	// The end of the first page is lost for this frame.
+	LinearAllocator::Stats stats = allocator.GetStats();
+	EXPECT_EQ(2u, stats.PageCount);
+	EXPECT_EQ(1100u, stats.UsedBytes);
+	EXPECT_EQ(24u, stats.PaddingBytes);
+}
+
+TEST(LinearAllocator, LargeDataGetsAPageOfItsOwn)
+{
+	LinearAllocator allocator(1024);
+	ExpectAt(allocator.Allocate(16, 16), 0, 0);
+	ExpectAt(allocator.Allocate(3000, 256), 1, 0);
+	EXPECT_TRUE(allocator.NewPage());
+	// Rounded up to whole pages.
+	EXPECT_EQ(3072u, allocator.PageSize(1));
+	EXPECT_EQ(1024u + 3072u, allocator.GetStats().ReservedBytes);
+}
+
+TEST(LinearAllocator, ResetReusesThePages)
+{
+	LinearAllocator allocator(1024);
+	for (std::uint32_t page = 0; page < 3; ++page)
+		ExpectAt(allocator.Allocate(600, 8), page, 0);
+	EXPECT_EQ(2648u, allocator.GetStats().PeakBytes);
+
+	allocator.Reset();
+	LinearAllocator::Stats stats = allocator.GetStats();
+	EXPECT_EQ(0u, stats.UsedBytes);
+	EXPECT_EQ(0u, stats.PaddingBytes);
+	EXPECT_EQ(2648u, stats.PeakBytes);
+
+	// The same frame again adds nothing.
+	for (std::uint32_t page = 0; page < 3; ++page)
+	{
+		ExpectAt(allocator.Allocate(600, 8), page, 0);
+		EXPECT_FALSE(allocator.NewPage());
+	}
+	EXPECT_EQ(3u, allocator.PageCount());
+
+	// A smaller frame leaves the peak alone.
+	allocator.Reset();
+	allocator.Allocate(8, 8);
+	allocator.Reset();
+	EXPECT_EQ(2648u, allocator.GetStats().PeakBytes);
+}
+
+TEST(LinearAllocator, SkipsPagesTooSmallForTheData)
+{
+	LinearAllocator allocator(1024);
+	allocator.Allocate(8, 8);
+	allocator.Allocate(2048, 8);
+	allocator.Reset();
+
+	ExpectAt(allocator.Allocate(2000, 8), 1, 0);
+	EXPECT_FALSE(allocator.NewPage());
+	EXPECT_EQ(1024u, allocator.GetStats().PaddingBytes);
+	// Nothing goes back to a skipped page.
+	ExpectAt(allocator.Allocate(8, 8), 1, 2000);
+}
+
+TEST(LinearAllocator, DiscardNewPageTakesTheAllocationBack)
+{
+	LinearAllocator allocator(1024);
+	allocator.Allocate(1000, 8);
+	ExpectAt(allocator.Allocate(100, 8), 1, 0);
+	allocator.DiscardNewPage();
+
+	EXPECT_FALSE(allocator.NewPage());
+	LinearAllocator::Stats stats = allocator.GetStats();
+	EXPECT_EQ(1u, stats.PageCount);
+	EXPECT_EQ(1000u, stats.UsedBytes);
+	EXPECT_EQ(0u, stats.PaddingBytes);
+
+	// Allocation carries on where it was.
+	ExpectAt(allocator.Allocate(16, 8), 0, 1000);
+	ExpectAt(allocator.Allocate(100, 8), 1, 0);
+	EXPECT_TRUE(allocator.NewPage());
+}
@@ -0,0 +1,75 @@
+#include "LinearUploadAllocator.h"
+#include "D3D12Fakes.h"
+#include <gtest/gtest.h>
+
+namespace
+{
+	const UINT64 kPageSize = 64 * 1024;
+
+	struct Constants
+	{
+		float Values[4];
+	};
+}
+
+TEST(LinearUploadAllocator, HandsOutMappedRangesOfPlacedPages)
+{
+	FakeDevice device;
+	GpuMemoryAllocator gpuAllocator(&device);
+	LinearUploadAllocator allocator(gpuAllocator, kPageSize);
+
+	LinearUploadAllocator::Allocation first = allocator.Allocate(100);
+	LinearUploadAllocator::Allocation second = allocator.Allocate(100);
+	EXPECT_EQ(1u, device.PlacedResourceCount);
+	EXPECT_EQ(first.CPU + D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, second.CPU);
+	EXPECT_EQ(first.GPU + D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, second.GPU);
+
+	Constants constants = { { 1.0f, 2.0f, 3.0f, 4.0f } };
+	D3D12_GPU_VIRTUAL_ADDRESS address = allocator.Push(constants);
+	StreamingWrites::Fence();
+	EXPECT_EQ(second.GPU + D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, address);
+	EXPECT_EQ(0, std::memcmp(&constants, second.CPU + D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT,
+		sizeof(constants)));
+}
+
+TEST(LinearUploadAllocator, ResetReusesThePages)
+{
+	FakeDevice device;
+	GpuMemoryAllocator gpuAllocator(&device);
+	LinearUploadAllocator allocator(gpuAllocator, kPageSize);
+
+	std::vector<D3D12_GPU_VIRTUAL_ADDRESS> frame;
+	for (int i = 0; i < 3; ++i)
+		frame.push_back(allocator.Allocate(kPageSize / 2 + 1).GPU);
+	EXPECT_EQ(3u, device.PlacedResourceCount);
+	EXPECT_EQ(3u, allocator.GetStats().PageCount);
+
+	allocator.Reset();
+	for (int i = 0; i < 3; ++i)
+		EXPECT_EQ(frame[i], allocator.Allocate(kPageSize / 2 + 1).GPU);
+	EXPECT_EQ(3u, device.PlacedResourceCount);
+}
+
+TEST(LinearUploadAllocator, PageThatCannotBeCreatedIsTakenBack)
+{
+	FakeDevice device;
+	GpuMemoryAllocator gpuAllocator(&device);
+	LinearUploadAllocator allocator(gpuAllocator, kPageSize);
+	allocator.Allocate(kPageSize - 1024);
+
+	device.OutOfMemory = true;
+	EXPECT_ANY_THROW(allocator.Allocate(2048));
+	LinearAllocator::Stats stats = allocator.GetStats();
+	EXPECT_EQ(1u, stats.PageCount);
+	EXPECT_EQ(kPageSize - 1024, stats.UsedBytes);
+	// What still fits needs no new page.
+	EXPECT_NE(nullptr, allocator.Allocate(512).CPU);
+
+	// Once memory is back the page is added as usual.
+	device.OutOfMemory = false;
+	LinearUploadAllocator::Allocation allocation = allocator.Allocate(2048);
+	EXPECT_EQ(2u, allocator.GetStats().PageCount);
+	EXPECT_EQ(2u, device.PlacedResourceCount);
+	ASSERT_NE(nullptr, allocation.CPU);
+	allocation.CPU[2047] = 1;
+}
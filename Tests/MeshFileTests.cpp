@@ -0,0 +1,208 @@
+#include "MeshFile.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+	const std::uint32_t kFormatR16Uint = 57;
+	const std::uint32_t kFormatR32Uint = 42;
+
+	std::string TempPath(const char* name)
+	{
+		return ::testing::TempDir() + name;
+	}
+
+	std::vector<char> ReadBytes(const std::string& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	void WriteBytes(const std::string& path, const std::vector<char>& bytes)
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file.write(bytes.data(), std::streamsize(bytes.size()));
+	}
+
+	// Three submeshes over a small vertex and index buffer.  The payloads
+	// are arbitrary bytes; the format does not look inside them.
+	class MeshFileTest : public ::testing::Test
+	{
+	protected:
+		void SetUp() override
+		{
+			mVertices.resize(mVertexCount * mStride);
+			for (size_t i = 0; i < mVertices.size(); ++i)
+				mVertices[i] = static_cast<std::uint8_t>(i * 7 + 3);
+			mIndices.resize(36);
+			for (size_t i = 0; i < mIndices.size(); ++i)
+				mIndices[i] = static_cast<std::uint16_t>(i % mVertexCount);
+
+			mContents.Format = MeshFile::VertexFormat::Full;
+			mContents.VertexByteStride = mStride;
+			mContents.Vertices = mVertices.data();
+			mContents.VertexCount = mVertexCount;
+			mContents.IndexFormat = kFormatR16Uint;
+			mContents.Indices = mIndices.data();
+			mContents.IndexCount = static_cast<std::uint32_t>(mIndices.size());
+
+			const char* names[] = { "box", "grid", "a name that is far too long to fit in the submesh table" };
+			for (std::uint32_t i = 0; i < 3; ++i)
+			{
+				MeshFile::Submesh submesh = {};
+				MeshFile::SetName(submesh, names[i]);
+				submesh.IndexCount = 12;
+				submesh.StartIndexLocation = i * 12;
+				submesh.BaseVertexLocation = static_cast<std::int32_t>(i);
+				submesh.LodError = 0.25f * i;
+				submesh.BoxCenter[0] = 1.0f + i;
+				submesh.BoxExtents[1] = 2.0f + i;
+				submesh.SphereCenter[2] = 3.0f + i;
+				submesh.SphereRadius = 4.0f + i;
+				mContents.Submeshes.push_back(submesh);
+			}
+			mPath = TempPath("MeshFileTest.mesh");
+		}
+
+		void TearDown() override
+		{
+			std::remove(mPath.c_str());
+		}
+
+		const std::uint32_t mVertexCount = 10;
+		const std::uint32_t mStride = 44;
+		std::vector<std::uint8_t> mVertices;
+		std::vector<std::uint16_t> mIndices;
+		MeshFile::Contents mContents;
+		std::string mPath;
+	};
+}
+
+TEST_F(MeshFileTest, RoundTripsHeaderSubmeshesAndPayloads)
+{
+	std::string error;
+	ASSERT_TRUE(MeshFile::Write(mPath, mContents, &error)) << error;
+
+	MeshFile file;
+	ASSERT_TRUE(file.Open(mPath)) << file.Error();
+	const MeshFile::Header& header = file.GetHeader();
+	EXPECT_EQ(MeshFile::VertexFormat::Full, header.Format);
+	EXPECT_EQ(mStride, header.VertexByteStride);
+	EXPECT_EQ(mVertexCount, header.VertexCount);
+	EXPECT_EQ(kFormatR16Uint, header.IndexFormat);
+	EXPECT_EQ(mIndices.size(), header.IndexCount);
+	EXPECT_EQ(0u, header.VertexDataOffset % 16);
+	EXPECT_EQ(0u, header.IndexDataOffset % 16);
+
+	ASSERT_EQ(3u, header.SubmeshCount);
+	for (std::uint32_t i = 0; i < 3; ++i)
+	{
+		const MeshFile::Submesh& expected = mContents.Submeshes[i];
+		const MeshFile::Submesh& actual = file.Submeshes()[i];
+		EXPECT_STREQ(expected.Name, actual.Name);
+		EXPECT_EQ(0, std::memcmp(&expected, &actual, sizeof(MeshFile::Submesh)));
+	}
+	EXPECT_EQ(MeshFile::MaxNameLength, std::strlen(file.Submeshes()[2].Name));
+
+	ASSERT_EQ(mVertices.size(), file.VertexDataSize());
+	ASSERT_EQ(mIndices.size() * 2, file.IndexDataSize());
+	EXPECT_EQ(0, std::memcmp(mVertices.data(), file.VertexData(), mVertices.size()));
+	EXPECT_EQ(0, std::memcmp(mIndices.data(), file.IndexData(), mIndices.size() * 2));
+	EXPECT_EQ(file.VertexDataSize(), file.AttributeStreamOffset());
+	EXPECT_EQ(0u, file.AttributeStreamByteStride());
+}
+
+TEST_F(MeshFileTest, RoundTripsSplitStreamsAnd32BitIndices)
+{
+	std::vector<std::uint32_t> indices(mIndices.begin(), mIndices.end());
+	mContents.Format = MeshFile::VertexFormat::PackedSplit;
+	mContents.VertexByteStride = 20;
+	mContents.IndexFormat = kFormatR32Uint;
+	mContents.Indices = indices.data();
+	ASSERT_TRUE(MeshFile::Write(mPath, mContents));
+
+	MeshFile file;
+	ASSERT_TRUE(file.Open(mPath)) << file.Error();
+	EXPECT_EQ(mVertexCount * MeshFile::PackedPositionByteStride, file.AttributeStreamOffset());
+	EXPECT_EQ(20u - MeshFile::PackedPositionByteStride, file.AttributeStreamByteStride());
+	ASSERT_EQ(indices.size() * 4, file.IndexDataSize());
+	EXPECT_EQ(0, std::memcmp(indices.data(), file.IndexData(), indices.size() * 4));
+}
+
+TEST_F(MeshFileTest, WriteRejectsInconsistentContents)
+{
+	MeshFile::Contents contents = mContents;
+	contents.IndexFormat = 0;
+	EXPECT_FALSE(MeshFile::Write(mPath, contents));
+
+	contents = mContents;
+	contents.VertexByteStride = 42;
+	EXPECT_FALSE(MeshFile::Write(mPath, contents));
+
+	contents = mContents;
+	contents.Format = MeshFile::VertexFormat::PackedSplit;
+	contents.VertexByteStride = MeshFile::PackedPositionByteStride;
+	EXPECT_FALSE(MeshFile::Write(mPath, contents));
+
+	contents = mContents;
+	contents.Submeshes[1].StartIndexLocation = contents.IndexCount;
+	std::string error;
+	EXPECT_FALSE(MeshFile::Write(mPath, contents, &error));
+	EXPECT_NE(std::string::npos, error.find("grid"));
+}
+
+TEST_F(MeshFileTest, OpenRejectsDamagedFiles)
+{
+	ASSERT_TRUE(MeshFile::Write(mPath, mContents));
+	const std::vector<char> good = ReadBytes(mPath);
+	MeshFile file;
+
+	EXPECT_FALSE(file.Open(TempPath("MeshFileTest.missing")));
+	EXPECT_FALSE(file.IsOpen());
+
+	std::vector<char> bytes(good.begin(), good.end() - 1);
+	WriteBytes(mPath, bytes);
+	EXPECT_FALSE(file.Open(mPath));
+	EXPECT_EQ("mesh file is truncated", file.Error());
+
+	bytes.assign(good.begin(), good.begin() + sizeof(MeshFile::Header) - 1);
+	WriteBytes(mPath, bytes);
+	EXPECT_FALSE(file.Open(mPath));
+
+	bytes = good;
+	bytes[0] ^= 1;
+	WriteBytes(mPath, bytes);
+	EXPECT_FALSE(file.Open(mPath));
+	EXPECT_EQ("not a mesh file", file.Error());
+
+	bytes = good;
+	MeshFile::Header header;
+	std::memcpy(&header, bytes.data(), sizeof(header));
+	++header.Version;
+	std::memcpy(bytes.data(), &header, sizeof(header));
+	WriteBytes(mPath, bytes);
+	EXPECT_FALSE(file.Open(mPath));
+
+	bytes = good;
+	std::memcpy(&header, bytes.data(), sizeof(header));
+	header.VertexCount += 1;
+	std::memcpy(bytes.data(), &header, sizeof(header));
+	WriteBytes(mPath, bytes);
+	EXPECT_FALSE(file.Open(mPath));
+	EXPECT_EQ("mesh file header is inconsistent", file.Error());
+
+	bytes = good;
+	MeshFile::Submesh submesh;
+	std::memcpy(&submesh, bytes.data() + sizeof(MeshFile::Header), sizeof(submesh));
+	std::memset(submesh.Name, 'x', sizeof(submesh.Name));
+	std::memcpy(bytes.data() + sizeof(MeshFile::Header), &submesh, sizeof(submesh));
+	WriteBytes(mPath, bytes);
+	EXPECT_FALSE(file.Open(mPath));
+	EXPECT_FALSE(file.IsOpen());
+
+	WriteBytes(mPath, good);
+	EXPECT_TRUE(file.Open(mPath)) << file.Error();
+}
@@ -0,0 +1,277 @@
+#include "MeshImporter.h"
+#include "Benchmark.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	using Result = MeshImporter::Result;
+
+	std::string TempPath(const char* name)
+	{
+		return ::testing::TempDir() + name;
+	}
+
+	void WriteFile(const std::string& path, const std::string& bytes)
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file.write(bytes.data(), std::streamsize(bytes.size()));
+	}
+
+	// Writes the text to a temporary .obj and loads it.
+	bool LoadObjText(const std::string& text, Result& result, std::string* error = nullptr,
+		const MeshImporter::Options& options = MeshImporter::Options())
+	{
+		std::string path = TempPath("MeshImporterTest.obj");
+		WriteFile(path, text);
+		bool loaded = MeshImporter::Load(path, options, result, error);
+		std::remove(path.c_str());
+		return loaded;
+	}
+
+	// A displaced grid with a group every few rows, large enough to span many
+	// small parse chunks.
+	std::string GridObj(int size)
+	{
+		std::ostringstream obj;
+		for (int z = 0; z <= size; ++z)
+		{
+			for (int x = 0; x <= size; ++x)
+			{
+				obj << "v " << x << ' ' << std::sin(x * 0.3f) * std::cos(z * 0.2f) << ' ' << z << '\n';
+				obj << "vt " << float(x) / size << ' ' << float(z) / size << '\n';
+			}
+		}
+		for (int z = 0; z < size; ++z)
+		{
+			if (z % 8 == 0)
+				obj << "g rows" << z << '\n';
+			for (int x = 0; x < size; ++x)
+			{
+				int a = z * (size + 1) + x + 1;
+				int b = a + size + 1;
+				obj << "f " << a << '/' << a << ' ' << b << '/' << b << ' ' << b + 1 << '/' << b + 1 << ' '
+					<< a + 1 << '/' << a + 1 << '\n';
+			}
+		}
+		return obj.str();
+	}
+
+	void ExpectSameResult(const Result& expected, const Result& actual)
+	{
+		ASSERT_EQ(expected.Parts.size(), actual.Parts.size());
+		for (size_t i = 0; i < expected.Parts.size(); ++i)
+		{
+			EXPECT_EQ(expected.Parts[i].Name, actual.Parts[i].Name);
+			EXPECT_EQ(expected.Parts[i].BaseVertex, actual.Parts[i].BaseVertex);
+			EXPECT_EQ(expected.Parts[i].VertexCount, actual.Parts[i].VertexCount);
+			EXPECT_EQ(expected.Parts[i].StartIndex, actual.Parts[i].StartIndex);
+			EXPECT_EQ(expected.Parts[i].IndexCount, actual.Parts[i].IndexCount);
+		}
+		EXPECT_EQ(expected.Mesh.Indices32, actual.Mesh.Indices32);
+		ASSERT_EQ(expected.Mesh.Vertices.size(), actual.Mesh.Vertices.size());
+		EXPECT_EQ(0, std::memcmp(expected.Mesh.Vertices.data(), actual.Mesh.Vertices.data(),
+			expected.Mesh.Vertices.size() * sizeof(GeometryGenerator::Vertex)));
+	}
+
+	// Builds a binary glTF from a JSON document and its buffer.
+	std::string Glb(std::string json, std::string bin)
+	{
+		while (json.size() % 4 != 0)
+			json += ' ';
+		while (bin.size() % 4 != 0)
+			bin += '\0';
+
+		auto u32 = [](std::uint32_t value) { return std::string(reinterpret_cast<const char*>(&value), 4); };
+		std::string glb = u32(0x46546C67) + u32(2) + u32(std::uint32_t(12 + 8 + json.size() + 8 + bin.size()));
+		glb += u32(std::uint32_t(json.size())) + u32(0x4E4F534A) + json;
+		glb += u32(std::uint32_t(bin.size())) + u32(0x004E4942) + bin;
+		return glb;
+	}
+
+	template<typename T>
+	void Append(std::string& bin, std::initializer_list<T> values)
+	{
+		for (T value : values)
+			bin.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+}
+
+TEST(MeshImporter, ObjSplitsPartsAndFansPolygons)
+{
+	const char* obj =
+		"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+		"vt 0 0\nvt 1 0\nvt 1 1\nvt 0 0.25\n"
+		"vn 0 0 1\n"
+		"o quad\n"
+		"f 1/1/1 2/2/1 3/3/1 4/4/1\n"
+		"g tri\n"
+		"f -4/-4/-1 -3/-3/-1 -1/-1/-1";
+
+	Result result;
+	std::string error;
+	ASSERT_TRUE(LoadObjText(obj, result, &error)) << error;
+
+	ASSERT_EQ(2u, result.Parts.size());
+	EXPECT_EQ("quad", result.Parts[0].Name);
+	EXPECT_EQ(0u, result.Parts[0].BaseVertex);
+	EXPECT_EQ(4u, result.Parts[0].VertexCount);
+	EXPECT_EQ(6u, result.Parts[0].IndexCount);
+	EXPECT_EQ("tri", result.Parts[1].Name);
+	EXPECT_EQ(4u, result.Parts[1].BaseVertex);
+	EXPECT_EQ(3u, result.Parts[1].VertexCount);
+	EXPECT_EQ(6u, result.Parts[1].StartIndex);
+	EXPECT_EQ(3u, result.Parts[1].IndexCount);
+
+	// Part relative indices, the quad fanned from its first corner.
+	const std::vector<std::uint32_t> indices = { 0, 1, 2, 0, 2, 3, 0, 1, 2 };
+	EXPECT_EQ(indices, result.Mesh.Indices32);
+
+	// v is flipped, and the negative indices of the triangle reach back to
+	// vertices 1, 2 and 4.
+	const GeometryGenerator::Vertex& corner = result.Mesh.Vertices[6];
+	EXPECT_EQ(0.0f, corner.Position.x);
+	EXPECT_EQ(1.0f, corner.Position.y);
+	EXPECT_EQ(0.0f, corner.TexC.x);
+	EXPECT_EQ(0.75f, corner.TexC.y);
+	EXPECT_EQ(1.0f, corner.Normal.z);
+}
+
+TEST(MeshImporter, ObjWeldsRepeatedCornersOnlyWhenAsked)
+{
+	const char* obj =
+		"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+		"f 1 2 3\nf 1 3 4\n";
+
+	Result welded;
+	ASSERT_TRUE(LoadObjText(obj, welded));
+	EXPECT_EQ(4u, welded.Mesh.Vertices.size());
+	EXPECT_EQ("default", welded.Parts[0].Name);
+
+	// Normals were missing, so they were computed.
+	for (const GeometryGenerator::Vertex& v : welded.Mesh.Vertices)
+		EXPECT_NEAR(1.0f, std::fabs(v.Normal.z), 1e-6f);
+
+	MeshImporter::Options options;
+	options.WeldVertices = false;
+	Result unwelded;
+	ASSERT_TRUE(LoadObjText(obj, unwelded, nullptr, options));
+	EXPECT_EQ(6u, unwelded.Mesh.Vertices.size());
+	EXPECT_EQ(welded.Mesh.Indices32.size(), unwelded.Mesh.Indices32.size());
+}
+
+TEST(MeshImporter, ObjResultDoesNotDependOnChunksOrThreads)
+{
+	std::string obj = GridObj(64);
+	MeshImporter::Options options;
+	options.ThreadCount = 1;
+	Result reference;
+	ASSERT_TRUE(LoadObjText(obj, reference, nullptr, options));
+	EXPECT_EQ(8u, reference.Parts.size());
+
+	// Chunks this small split lines, groups and faces at every possible
+	// point.
+	for (std::uint32_t chunkByteSize : { 61u, 4096u })
+	{
+		for (std::uint32_t threads : { 1u, 3u, 8u })
+		{
+			SCOPED_TRACE(testing::Message() << chunkByteSize << " byte chunks, " << threads << " threads");
+			options.ChunkByteSize = chunkByteSize;
+			options.ThreadCount = threads;
+			Result result;
+			std::string error;
+			ASSERT_TRUE(LoadObjText(obj, result, &error, options)) << error;
+			ExpectSameResult(reference, result);
+		}
+	}
+}
+
+TEST(MeshImporter, ObjReportsBadInput)
+{
+	Result result;
+	std::string error;
+	EXPECT_FALSE(LoadObjText("v 0 0 0\nv 1 0 0\nf 1 2 3\n", result, &error));
+	EXPECT_NE(std::string::npos, error.find("out of range")) << error;
+	EXPECT_FALSE(LoadObjText("v 0 0 0\n", result, &error));
+	EXPECT_NE(std::string::npos, error.find("no faces")) << error;
+	EXPECT_FALSE(MeshImporter::Load(TempPath("MeshImporterTest.missing.obj"), result, &error));
+	EXPECT_FALSE(MeshImporter::Load(TempPath("MeshImporterTest.ply"), result, &error));
+}
+
+TEST(MeshImporter, GlbReadsTrianglePrimitives)
+{
+	std::string bin;
+	// Primitive 0: an unindexed quad, interleaved position and normal.
+	const float quad[6][3] = { { 0, 0, 0 }, { 1, 0, 0 }, { 1, 1, 0 }, { 0, 0, 0 }, { 1, 1, 0 }, { 0, 1, 0 } };
+	for (const float* p : quad)
+		Append<float>(bin, { p[0], p[1], p[2], 0.0f, 0.0f, 1.0f });
+	size_t trianglePositions = bin.size();
+	// Primitive 1: a triangle with 16-bit indices and no normals.
+	Append<float>(bin, { 0, 0, 1, 2, 0, 1, 0, 2, 1 });
+	size_t triangleIndices = bin.size();
+	Append<std::uint16_t>(bin, { 0, 1, 2 });
+
+	std::ostringstream json;
+	json << R"({"asset":{"version":"2.0"},"buffers":[{"byteLength":)" << bin.size() << R"(}],)"
+		<< R"("bufferViews":[)"
+		<< R"({"buffer":0,"byteOffset":0,"byteLength":144,"byteStride":24},)"
+		<< R"({"buffer":0,"byteOffset":)" << trianglePositions << R"(,"byteLength":36},)"
+		<< R"({"buffer":0,"byteOffset":)" << triangleIndices << R"(,"byteLength":6}],)"
+		<< R"("accessors":[)"
+		<< R"({"bufferView":0,"byteOffset":0,"componentType":5126,"count":6,"type":"VEC3"},)"
+		<< R"({"bufferView":0,"byteOffset":12,"componentType":5126,"count":6,"type":"VEC3"},)"
+		<< R"({"bufferView":1,"componentType":5126,"count":3,"type":"VEC3"},)"
+		<< R"({"bufferView":2,"componentType":5123,"count":3,"type":"SCALAR"}],)"
+		<< R"("meshes":[{"name":"shapes","primitives":[)"
+		<< R"({"attributes":{"POSITION":0,"NORMAL":1}},)"
+		<< R"({"attributes":{"POSITION":2},"indices":3},)"
+		<< R"({"attributes":{"POSITION":2},"mode":1}]}]})";
+
+	std::string path = TempPath("MeshImporterTest.glb");
+	WriteFile(path, Glb(json.str(), bin));
+	Result result;
+	std::string error;
+	bool loaded = MeshImporter::Load(path, result, &error);
+
+	std::string truncated = Glb(json.str(), bin);
+	truncated.resize(truncated.size() - 8);
+	WriteFile(path, truncated);
+	Result ignored;
+	EXPECT_FALSE(MeshImporter::Load(path, ignored));
+	std::remove(path.c_str());
+
+	ASSERT_TRUE(loaded) << error;
+	// The line primitive is skipped.
+	ASSERT_EQ(2u, result.Parts.size());
+	EXPECT_EQ("shapes_0", result.Parts[0].Name);
+	EXPECT_EQ(4u, result.Parts[0].VertexCount);
+	EXPECT_EQ(6u, result.Parts[0].IndexCount);
+	EXPECT_EQ("shapes_1", result.Parts[1].Name);
+	EXPECT_EQ(4u, result.Parts[1].BaseVertex);
+	EXPECT_EQ(3u, result.Parts[1].VertexCount);
+	EXPECT_EQ(3u, result.Parts[1].IndexCount);
+	EXPECT_EQ(2.0f, result.Mesh.Vertices[5].Position.x);
+	for (const GeometryGenerator::Vertex& v : result.Mesh.Vertices)
+		EXPECT_NEAR(1.0f, std::fabs(v.Normal.z), 1e-6f);
+}
+
+TEST(MeshImporterBenchmark, DISABLED_LoadObj)
+{
+	std::string path = TempPath("MeshImporterBenchmark.obj");
+	WriteFile(path, GridObj(1000));
+
+	MeshImporter::Options options;
+	Result result;
+	options.ThreadCount = 1;
+	Benchmark::Measure("OBJ 2M triangles, 1 thread", [&]() {
+		MeshImporter::Load(path, options, result);
+	});
+	options.ThreadCount = 0;
+	Benchmark::Measure("OBJ 2M triangles, all threads", [&]() {
+		MeshImporter::Load(path, options, result);
+	});
+	std::remove(path.c_str());
+}
@@ -0,0 +1,165 @@
+#include "MeshOptimizer.h"
+#include "Benchmark.h"
+#include <algorithm>
+#include <array>
+#include <random>
+#include <tuple>
+
+namespace
+{
+	using MeshData = GeometryGenerator::MeshData;
+	using Triangle = std::array<float, 9>;
+
+	// Triangle lists in generator order are already fairly cache friendly;
+	// shuffling them gives the optimizer something to do.
+	void ShuffleTriangles(MeshData& mesh)
+	{
+		size_t triangleCount = mesh.Indices32.size() / 3;
+		std::vector<size_t> order(triangleCount);
+		for (size_t i = 0; i < triangleCount; ++i)
+			order[i] = i;
+		std::shuffle(order.begin(), order.end(), std::mt19937(1));
+
+		std::vector<std::uint32_t> indices;
+		indices.reserve(mesh.Indices32.size());
+		for (size_t t : order)
+			indices.insert(indices.end(), mesh.Indices32.begin() + t * 3, mesh.Indices32.begin() + t * 3 + 3);
+		mesh.Indices32.swap(indices);
+	}
+
+	// The triangles of a mesh by position, each rotated to start at its
+	// smallest corner, so meshes that draw the same triangles in any order
+	// and with any vertex numbering compare equal.
+	std::vector<Triangle> TrianglesOf(const MeshData& mesh)
+	{
+		std::vector<Triangle> triangles;
+		for (size_t t = 0; t < mesh.Indices32.size(); t += 3)
+		{
+			std::array<DirectX::XMFLOAT3, 3> corners;
+			for (size_t k = 0; k < 3; ++k)
+				corners[k] = mesh.Vertices[mesh.Indices32[t + k]].Position;
+
+			auto less = [](const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b) {
+				return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z);
+			};
+			size_t first = std::min_element(corners.begin(), corners.end(), less) - corners.begin();
+
+			Triangle triangle;
+			for (size_t k = 0; k < 3; ++k)
+			{
+				const DirectX::XMFLOAT3& p = corners[(first + k) % 3];
+				triangle[k * 3 + 0] = p.x;
+				triangle[k * 3 + 1] = p.y;
+				triangle[k * 3 + 2] = p.z;
+			}
+			triangles.push_back(triangle);
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	void ExpectOptimized(MeshData mesh, bool optimizeOverdraw)
+	{
+		ShuffleTriangles(mesh);
+		MeshData shuffled = mesh;
+
+		MeshOptimizer::Options options;
+		options.OptimizeOverdraw = optimizeOverdraw;
+		MeshOptimizer::Report report = MeshOptimizer::Optimize(mesh, options);
+
+		EXPECT_LT(report.After.Acmr, report.Before.Acmr);
+		EXPECT_LT(report.After.Acmr, 1.0f);
+		EXPECT_GE(report.After.Atvr, 1.0f);
+		EXPECT_LT(report.After.Atvr, 1.6f);
+		EXPECT_EQ(shuffled.Vertices.size(), mesh.Vertices.size());
+		EXPECT_EQ(TrianglesOf(shuffled), TrianglesOf(mesh));
+
+		MeshOptimizer::CacheStats measured = MeshOptimizer::AnalyzeVertexCache(mesh.Indices32.data(),
+			mesh.Indices32.size(), mesh.Vertices.size(), options.CacheSize);
+		EXPECT_FLOAT_EQ(report.After.Acmr, measured.Acmr);
+		EXPECT_FLOAT_EQ(report.After.Atvr, measured.Atvr);
+	}
+}
+
+TEST(MeshOptimizer, AnalyzeCountsEveryMissOfATriangleSoup)
+{
+	const std::uint32_t indices[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8 };
+	MeshOptimizer::CacheStats stats = MeshOptimizer::AnalyzeVertexCache(indices, 9, 9, 16);
+	EXPECT_FLOAT_EQ(3.0f, stats.Acmr);
+	EXPECT_FLOAT_EQ(1.0f, stats.Atvr);
+}
+
+TEST(MeshOptimizer, AnalyzeReusesSharedVertices)
+{
+	// A quad: the second triangle only misses on vertex 3.
+	const std::uint16_t indices[] = { 0, 1, 2, 2, 1, 3 };
+	MeshOptimizer::CacheStats stats = MeshOptimizer::AnalyzeVertexCache(indices, 6, 4, 16);
+	EXPECT_FLOAT_EQ(2.0f, stats.Acmr);
+	EXPECT_FLOAT_EQ(1.0f, stats.Atvr);
+}
+
+TEST(MeshOptimizer, AnalyzeSimulatesAFifoNotAnLru)
+{
+	// With three entries, the hit on 0 does not refresh it, so 3 evicts it and
+	// the last triangle misses on it again.  An LRU cache would keep 0 and
+	// count 6 misses instead of 7.
+	const std::uint32_t indices[] = { 0, 1, 2, 0, 3, 4, 0, 2, 4 };
+	MeshOptimizer::CacheStats stats = MeshOptimizer::AnalyzeVertexCache(indices, 9, 5, 3);
+	EXPECT_FLOAT_EQ(7.0f / 3.0f, stats.Acmr);
+	EXPECT_FLOAT_EQ(7.0f / 5.0f, stats.Atvr);
+}
+
+TEST(MeshOptimizer, AnalyzeEvictsWhenTheCacheIsSmall)
+{
+	const std::uint32_t indices[] = { 0, 1, 2, 3, 4, 5, 0, 1, 2 };
+	EXPECT_FLOAT_EQ(3.0f, MeshOptimizer::AnalyzeVertexCache(indices, 9, 6, 3).Acmr);
+	EXPECT_FLOAT_EQ(2.0f, MeshOptimizer::AnalyzeVertexCache(indices, 9, 6, 16).Acmr);
+}
+
+TEST(MeshOptimizer, OptimizeKeepsTheTrianglesAndLowersAcmr)
+{
+	GeometryGenerator generator;
+	for (bool overdraw : { false, true })
+	{
+		SCOPED_TRACE(overdraw ? "with overdraw" : "without overdraw");
+		ExpectOptimized(generator.CreateSphere(1.0f, 40, 40), overdraw);
+		ExpectOptimized(generator.CreateGeosphere(1.0f, 5), overdraw);
+		ExpectOptimized(generator.CreateGrid(10.0f, 10.0f, 100, 100), overdraw);
+		ExpectOptimized(generator.CreateCylinder(1.0f, 1.0f, 3.0f, 40, 40), overdraw);
+	}
+}
+
+TEST(MeshOptimizer, OptimizeHandles16BitIndices)
+{
+	GeometryGenerator generator;
+	MeshData mesh = generator.CreateSphere(1.0f, 20, 20);
+	ShuffleTriangles(mesh);
+	std::vector<std::uint16_t> indices(mesh.Indices32.begin(), mesh.Indices32.end());
+
+	MeshOptimizer::Report report = MeshOptimizer::Optimize(mesh.Vertices.data(), mesh.Vertices.size(),
+		sizeof(GeometryGenerator::Vertex), 0, indices.data(), indices.size(), MeshOptimizer::Options());
+	EXPECT_LT(report.After.Acmr, 1.0f);
+
+	mesh.Indices32.assign(indices.begin(), indices.end());
+	MeshOptimizer::CacheStats measured = MeshOptimizer::AnalyzeVertexCache(mesh.Indices32.data(),
+		mesh.Indices32.size(), mesh.Vertices.size(), 16);
+	EXPECT_FLOAT_EQ(report.After.Acmr, measured.Acmr);
+}
+
+TEST(MeshOptimizerBenchmark, DISABLED_Optimize)
+{
+	GeometryGenerator generator;
+	MeshData mesh = generator.CreateGeosphere(1.0f, 6);
+	ShuffleTriangles(mesh);
+
+	MeshOptimizer::Options options;
+	Benchmark::Measure("Geosphere 6 vertex cache", [&]() {
+		MeshData copy = mesh;
+		Benchmark::DoNotOptimize(MeshOptimizer::Optimize(copy, options));
+	});
+	options.OptimizeOverdraw = true;
+	Benchmark::Measure("Geosphere 6 vertex cache + overdraw", [&]() {
+		MeshData copy = mesh;
+		Benchmark::DoNotOptimize(MeshOptimizer::Optimize(copy, options));
+	});
+}
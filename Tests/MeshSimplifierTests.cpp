@@ -0,0 +1,130 @@
+#include "MeshSimplifier.h"
+#include "Benchmark.h"
+#include <algorithm>
+
+namespace
+{
+	using MeshData = GeometryGenerator::MeshData;
+
+	size_t Simplify(const MeshData& mesh, std::vector<std::uint32_t>& result, size_t targetIndexCount,
+		float targetError, float* resultError = nullptr)
+	{
+		result.resize(mesh.Indices32.size());
+		size_t count = MeshSimplifier::Simplify(result.data(), mesh.Indices32.data(), mesh.Indices32.size(),
+			mesh.Vertices.data(), mesh.Vertices.size(), sizeof(GeometryGenerator::Vertex), 0,
+			targetIndexCount, targetError, resultError);
+		result.resize(count);
+		return count;
+	}
+
+	bool References(const std::vector<std::uint32_t>& indices, std::uint32_t v)
+	{
+		return std::find(indices.begin(), indices.end(), v) != indices.end();
+	}
+}
+
+TEST(MeshSimplifier, ReachesTheTargetOnAClosedMesh)
+{
+	GeometryGenerator generator;
+	MeshData mesh = generator.CreateGeosphere(1.0f, 4);
+	size_t target = mesh.Indices32.size() / 4 / 3 * 3;
+
+	std::vector<std::uint32_t> result;
+	float error = 0.0f;
+	size_t count = Simplify(mesh, result, target, 1.0f, &error);
+
+	EXPECT_LE(count, target);
+	EXPECT_GT(count, 0u);
+	EXPECT_EQ(0u, count % 3);
+	EXPECT_GT(error, 0.0f);
+	EXPECT_LT(error, 0.1f);
+	for (std::uint32_t v : result)
+		EXPECT_LT(v, mesh.Vertices.size());
+	for (size_t t = 0; t < count; t += 3)
+	{
+		EXPECT_NE(result[t + 0], result[t + 1]);
+		EXPECT_NE(result[t + 1], result[t + 2]);
+		EXPECT_NE(result[t + 2], result[t + 0]);
+	}
+}
+
+TEST(MeshSimplifier, StopsAtTheErrorLimit)
+{
+	GeometryGenerator generator;
+	MeshData mesh = generator.CreateGeosphere(1.0f, 4);
+
+	std::vector<std::uint32_t> result;
+	float error = 0.0f;
+	size_t count = Simplify(mesh, result, 0, 0.001f, &error);
+
+	EXPECT_LT(count, mesh.Indices32.size());
+	EXPECT_GT(count, 0u);
+	// The limit is relative to the extent of the mesh, which is 2 here.
+	EXPECT_LE(error, 0.002f);
+}
+
+TEST(MeshSimplifier, KeepsTheCornersOfAnOpenGrid)
+{
+	GeometryGenerator generator;
+	const std::uint32_t m = 20;
+	const std::uint32_t n = 20;
+	MeshData mesh = generator.CreateGrid(10.0f, 10.0f, m, n);
+
+	std::vector<std::uint32_t> result;
+	Simplify(mesh, result, 6, 1.0f);
+	EXPECT_LT(result.size(), mesh.Indices32.size() / 2);
+
+	// Border vertices are locked, so a flat grid can only lose its interior.
+	EXPECT_TRUE(References(result, 0));
+	EXPECT_TRUE(References(result, n - 1));
+	EXPECT_TRUE(References(result, (m - 1) * n));
+	EXPECT_TRUE(References(result, m * n - 1));
+	for (std::uint32_t v : result)
+	{
+		std::uint32_t row = v / n;
+		std::uint32_t column = v % n;
+		EXPECT_TRUE(row == 0 || row == m - 1 || column == 0 || column == n - 1) << "interior vertex " << v;
+	}
+}
+
+TEST(MeshSimplifier, LodChainShrinksLevelByLevel)
+{
+	GeometryGenerator generator;
+	MeshData mesh = generator.CreateSphere(1.0f, 64, 64);
+
+	MeshSimplifier::Options options;
+	options.LevelCount = 4;
+	std::vector<std::uint32_t> lodIndices(7, 0);
+	std::vector<MeshSimplifier::Level> levels = MeshSimplifier::BuildLodChain(mesh, options, lodIndices);
+
+	ASSERT_EQ(3u, levels.size());
+	size_t previousCount = mesh.Indices32.size();
+	float previousError = 0.0f;
+	std::uint32_t start = 0;
+	for (const MeshSimplifier::Level& level : levels)
+	{
+		EXPECT_EQ(start, level.StartIndex);
+		EXPECT_LE(level.IndexCount, previousCount * options.TriangleRatio + 3);
+		EXPECT_GE(level.Error, previousError);
+		start += level.IndexCount;
+		previousCount = level.IndexCount;
+		previousError = level.Error;
+	}
+	// Levels are appended after what was already there.
+	EXPECT_EQ(7u + start, lodIndices.size());
+}
+
+TEST(MeshSimplifierBenchmark, DISABLED_Simplify)
+{
+	GeometryGenerator generator;
+	MeshData mesh = generator.CreateGeosphere(1.0f, 6);
+	std::vector<std::uint32_t> result;
+
+	Benchmark::Measure("Geosphere 6 to 10%", [&]() {
+		Benchmark::DoNotOptimize(Simplify(mesh, result, mesh.Indices32.size() / 10, 1.0f));
+	});
+	Benchmark::Measure("Geosphere 6 LOD chain of 4", [&]() {
+		std::vector<std::uint32_t> lodIndices;
+		Benchmark::DoNotOptimize(MeshSimplifier::BuildLodChain(mesh, MeshSimplifier::Options(), lodIndices));
+	});
+}
@@ -0,0 +1,244 @@
+#include "MeshletBuilder.h"
+#include <gtest/gtest.h>
+#include <DirectXCollision.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	using MeshData = GeometryGenerator::MeshData;
+	using uint32 = MeshletBuilder::uint32;
+
+	struct Shape
+	{
+		const char* Name;
+		MeshData Mesh;
+	};
+
+	std::vector<Shape> Shapes()
+	{
+		GeometryGenerator generator;
+		std::vector<Shape> shapes;
+		shapes.push_back({ "box", generator.CreateBox(1.5f, 0.5f, 1.5f, 3) });
+		shapes.push_back({ "sphere", generator.CreateSphere(0.5f, 20, 20) });
+		shapes.push_back({ "geosphere", generator.CreateGeosphere(0.5f, 3) });
+		shapes.push_back({ "cylinder", generator.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20) });
+		shapes.push_back({ "grid", generator.CreateGrid(20.0f, 30.0f, 60, 40) });
+		return shapes;
+	}
+
+	XMFLOAT3 Corner(const MeshData& mesh, const MeshletData& meshlets, const Meshlet& meshlet, uint32 triangle,
+		uint32 corner)
+	{
+		uint32 packed = meshlets.PrimitiveIndices[meshlet.TriangleOffset + triangle];
+		uint32 local = (packed >> (8 * corner)) & 0xff;
+		return mesh.Vertices[meshlets.VertexIndices[meshlet.VertexOffset + local]].Position;
+	}
+
+	// The cone test Cull() does, for one meshlet.
+	bool ConeCulls(const MeshletBounds& bounds, FXMVECTOR eye)
+	{
+		if (bounds.ConeCutoff > 1.0f)
+			return false;
+		XMVECTOR toApex = XMVector3Normalize(XMVectorSubtract(XMLoadFloat3(&bounds.ConeApex), eye));
+		return XMVectorGetX(XMVector3Dot(toApex, XMLoadFloat3(&bounds.ConeAxis))) >= bounds.ConeCutoff;
+	}
+
+	MeshletBuilder::CullingView LookAt(FXMVECTOR eye, FXMVECTOR target)
+	{
+		XMMATRIX view = XMMatrixLookAtLH(eye, target, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		XMMATRIX proj = XMMatrixPerspectiveFovLH(0.25f * 3.1415926535f, 1.0f, 1.0f, 100.0f);
+		return MeshletBuilder::MakeCullingView(eye, XMMatrixMultiply(view, proj));
+	}
+}
+
+TEST(MeshletBuilder, EveryTriangleLandsInOneMeshletWithinTheLimits)
+{
+	MeshletBuilder::Options options;
+	for (const Shape& shape : Shapes())
+	{
+		MeshletData meshlets;
+		uint32 count = MeshletBuilder::Build(shape.Mesh, options, meshlets);
+		ASSERT_EQ(count, meshlets.Meshlets.size()) << shape.Name;
+		ASSERT_EQ(count, meshlets.Bounds.size()) << shape.Name;
+
+		// Each triangle of the mesh, as its sorted vertex indices, once.
+		std::vector<std::vector<uint32>> expected;
+		for (size_t i = 0; i < shape.Mesh.Indices32.size(); i += 3)
+		{
+			std::vector<uint32> triangle(shape.Mesh.Indices32.begin() + i, shape.Mesh.Indices32.begin() + i + 3);
+			std::sort(triangle.begin(), triangle.end());
+			expected.push_back(triangle);
+		}
+		std::vector<std::vector<uint32>> actual;
+		for (const Meshlet& meshlet : meshlets.Meshlets)
+		{
+			EXPECT_LE(meshlet.VertexCount, options.MaxVertices) << shape.Name;
+			EXPECT_LE(meshlet.TriangleCount, options.MaxTriangles) << shape.Name;
+			for (uint32 t = 0; t < meshlet.TriangleCount; ++t)
+			{
+				uint32 packed = meshlets.PrimitiveIndices[meshlet.TriangleOffset + t];
+				std::vector<uint32> triangle;
+				for (uint32 k = 0; k < 3; ++k)
+				{
+					uint32 local = (packed >> (8 * k)) & 0xff;
+					ASSERT_LT(local, meshlet.VertexCount) << shape.Name;
+					triangle.push_back(meshlets.VertexIndices[meshlet.VertexOffset + local]);
+				}
+				std::sort(triangle.begin(), triangle.end());
+				actual.push_back(triangle);
+			}
+		}
+		std::sort(expected.begin(), expected.end());
+		std::sort(actual.begin(), actual.end());
+		EXPECT_EQ(expected, actual) << shape.Name;
+	}
+}
+
+TEST(MeshletBuilder, BoundingSpheresContainEveryVertex)
+{
+	for (const Shape& shape : Shapes())
+	{
+		MeshletData meshlets;
+		MeshletBuilder::Build(shape.Mesh, MeshletBuilder::Options(), meshlets);
+		for (size_t m = 0; m < meshlets.Meshlets.size(); ++m)
+		{
+			const Meshlet& meshlet = meshlets.Meshlets[m];
+			const MeshletBounds& bounds = meshlets.Bounds[m];
+			XMVECTOR center = XMLoadFloat3(&bounds.Center);
+			for (uint32 v = 0; v < meshlet.VertexCount; ++v)
+			{
+				const XMFLOAT3& p = shape.Mesh.Vertices[meshlets.VertexIndices[meshlet.VertexOffset + v]].Position;
+				float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&p), center)));
+				ASSERT_LE(distance, bounds.Radius * (1.0f + 1e-5f) + 1e-6f) << shape.Name << " meshlet " << m;
+			}
+		}
+	}
+}
+
+// Wherever the cone rejects a meshlet, the eye has to be behind every one
+// of its triangles.  Eyes are drawn around each shape and close to it,
+// where a cone with its apex at the centre would be wrong.
+TEST(MeshletBuilder, NormalConesAreConservative)
+{
+	std::mt19937 random(5);
+	for (const Shape& shape : Shapes())
+	{
+		MeshletData meshlets;
+		MeshletBuilder::Build(shape.Mesh, MeshletBuilder::Options(), meshlets);
+
+		BoundingBox box;
+		BoundingBox::CreateFromPoints(box, shape.Mesh.Vertices.size(), &shape.Mesh.Vertices[0].Position,
+			sizeof(GeometryGenerator::Vertex));
+		float extent = (std::max)({ box.Extents.x, box.Extents.y, box.Extents.z });
+		std::uniform_real_distribution<float> far(-3.0f * extent, 3.0f * extent);
+		std::uniform_real_distribution<float> near(-0.1f * extent, 0.1f * extent);
+
+		uint32 withCones = 0;
+		uint32 rejections = 0;
+		for (size_t m = 0; m < meshlets.Meshlets.size(); ++m)
+		{
+			const Meshlet& meshlet = meshlets.Meshlets[m];
+			const MeshletBounds& bounds = meshlets.Bounds[m];
+			if (bounds.ConeCutoff > 1.0f)
+				continue;
+			++withCones;
+
+			for (int i = 0; i < 400; ++i)
+			{
+				XMVECTOR eye;
+				if (i % 2 == 0)
+				{
+					XMVECTOR offset = XMVectorSet(far(random), far(random), far(random), 0.0f);
+					eye = XMVectorAdd(XMLoadFloat3(&box.Center), offset);
+				}
+				else
+				{
+					// Just off one of the meshlet's own corners.
+					XMFLOAT3 corner = Corner(shape.Mesh, meshlets, meshlet, i % meshlet.TriangleCount, 0);
+					XMVECTOR offset = XMVectorSet(near(random), near(random), near(random), 0.0f);
+					eye = XMVectorAdd(XMLoadFloat3(&corner), offset);
+				}
+				if (!ConeCulls(bounds, eye))
+					continue;
+				++rejections;
+
+				for (uint32 t = 0; t < meshlet.TriangleCount; ++t)
+				{
+					XMFLOAT3 p0 = Corner(shape.Mesh, meshlets, meshlet, t, 0);
+					XMFLOAT3 p1 = Corner(shape.Mesh, meshlets, meshlet, t, 1);
+					XMFLOAT3 p2 = Corner(shape.Mesh, meshlets, meshlet, t, 2);
+					XMVECTOR a = XMLoadFloat3(&p0);
+					XMVECTOR n = XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&p1), a),
+						XMVectorSubtract(XMLoadFloat3(&p2), a));
+					float side = XMVectorGetX(XMVector3Dot(n, XMVectorSubtract(eye, a)));
+					ASSERT_LE(side, 1e-4f * XMVectorGetX(XMVector3Length(n)) * extent)
+						<< shape.Name << " meshlet " << m << " triangle " << t << " faces an eye its cone rejects";
+				}
+			}
+		}
+		// The test means nothing unless cones exist and reject something.
+		EXPECT_GT(withCones, 0u) << shape.Name;
+		EXPECT_GT(rejections, 0u) << shape.Name;
+	}
+}
+
+// Meshlets submitted and rejected for views around a sphere and from above
+// and below a grid.  The counts are printed, and held to what the geometry
+// allows: from outside, no more than the far half of a sphere faces away.
+TEST(MeshletBuilder, CullingRejectsMeshletsOutsideTheViewAndFacingAway)
+{
+	GeometryGenerator generator;
+	MeshletData meshlets;
+	uint32 count = MeshletBuilder::Build(generator.CreateGeosphere(0.5f, 4), MeshletBuilder::Options(), meshlets);
+
+	MeshletBuilder::CullStats total;
+	const int kViews = 8;
+	for (int i = 0; i < kViews; ++i)
+	{
+		float angle = 2.0f * 3.1415926535f * i / kViews;
+		XMVECTOR eye = XMVectorSet(3.0f * std::cos(angle), 1.0f, 3.0f * std::sin(angle), 1.0f);
+		std::vector<uint32> visible;
+		MeshletBuilder::CullStats stats =
+			MeshletBuilder::Cull(meshlets, 0, count, LookAt(eye, XMVectorZero()), &visible);
+
+		// The whole sphere is in view, so only backfaces go.
+		EXPECT_EQ(0u, stats.FrustumCulled);
+		EXPECT_GT(stats.BackfaceCulled, count / 5);
+		EXPECT_LT(stats.BackfaceCulled, count / 2);
+		EXPECT_EQ(count - stats.BackfaceCulled, visible.size());
+		total.MeshletCount += stats.MeshletCount;
+		total.BackfaceCulled += stats.BackfaceCulled;
+		total.TrianglesVisible += stats.TrianglesVisible;
+		total.TrianglesTotal += stats.TrianglesTotal;
+
+		// Turned around, the sphere is behind the eye.
+		stats = MeshletBuilder::Cull(meshlets, 0, count, LookAt(eye, XMVectorScale(eye, 2.0f)));
+		EXPECT_EQ(count, stats.FrustumCulled);
+		EXPECT_EQ(0u, stats.TrianglesVisible);
+		total.MeshletCount += stats.MeshletCount;
+		total.FrustumCulled += stats.FrustumCulled;
+		total.TrianglesTotal += stats.TrianglesTotal;
+	}
+	std::printf("[ CULLING  ] geosphere, %d views: %u meshlets submitted, %u frustum and %u backface culled, "
+		"%u of %u triangles drawn\n", 2 * kViews, total.MeshletCount, total.FrustumCulled, total.BackfaceCulled,
+		total.TrianglesVisible, total.TrianglesTotal);
+
+	// Every grid triangle faces up, so from below the cones reject them all.
+	MeshletData grid;
+	uint32 gridCount =
+		MeshletBuilder::Build(generator.CreateGrid(20.0f, 30.0f, 60, 40), MeshletBuilder::Options(), grid);
+	MeshletBuilder::CullStats below = MeshletBuilder::Cull(grid, 0, gridCount,
+		LookAt(XMVectorSet(0.0f, -5.0f, -20.0f, 1.0f), XMVectorZero()));
+	MeshletBuilder::CullStats above = MeshletBuilder::Cull(grid, 0, gridCount,
+		LookAt(XMVectorSet(0.0f, 5.0f, -20.0f, 1.0f), XMVectorZero()));
+	EXPECT_EQ(gridCount, below.FrustumCulled + below.BackfaceCulled);
+	EXPECT_EQ(0u, above.BackfaceCulled);
+	EXPECT_LT(above.FrustumCulled, gridCount);
+	std::printf("[ CULLING  ] grid, 2 views: %u meshlets submitted, %u culled from below and %u from above\n",
+		2 * gridCount, below.FrustumCulled + below.BackfaceCulled, above.FrustumCulled + above.BackfaceCulled);
+}
@@ -0,0 +1,233 @@
+#include "MipChain.h"
+#include "Benchmark.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+namespace
+{
+	using uint32 = MipChain::uint32;
+
+	const MipChain::Format kFormats[] = { MipChain::Format::RGBA8, MipChain::Format::RGBA16F, MipChain::Format::R32F };
+
+	float HalfToFloat(std::uint16_t half)
+	{
+		int exponent = (half >> 10) & 31;
+		int mantissa = half & 1023;
+		float value = exponent == 0 ? std::ldexp(float(mantissa), -24) : std::ldexp(float(mantissa | 1024), exponent - 25);
+		return (half & 0x8000) != 0 ? -value : value;
+	}
+
+	// Only for zero and normal values a half holds exactly.
+	std::uint16_t FloatToHalf(float value)
+	{
+		if (value == 0.0f)
+			return 0;
+		std::uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		std::uint32_t exponent = ((bits >> 23) & 255) - 127 + 15;
+		return static_cast<std::uint16_t>(((bits >> 16) & 0x8000) | (exponent << 10) | ((bits >> 13) & 1023));
+	}
+
+	uint32 ChannelCount(MipChain::Format format)
+	{
+		return format == MipChain::Format::R32F ? 1 : 4;
+	}
+
+	float GetTexel(MipChain::Format format, const MipChain::Level& level, uint32 x, uint32 y, uint32 channel)
+	{
+		const std::uint8_t* row = level.Data + size_t(level.RowPitch) * y;
+		switch (format)
+		{
+		case MipChain::Format::RGBA8:
+			return row[x * 4 + channel] / 255.0f;
+		case MipChain::Format::RGBA16F:
+			return HalfToFloat(reinterpret_cast<const std::uint16_t*>(row)[x * 4 + channel]);
+		case MipChain::Format::R32F:
+			return reinterpret_cast<const float*>(row)[x];
+		}
+		return 0.0f;
+	}
+
+	// value is a multiple of 1/256 in [0, 1), which every format holds
+	// exactly but RGBA8, which rounds it to the nearest 1/255.
+	void SetTexel(MipChain::Format format, const MipChain::Level& level, uint32 x, uint32 y, uint32 channel, float value)
+	{
+		std::uint8_t* row = level.Data + size_t(level.RowPitch) * y;
+		switch (format)
+		{
+		case MipChain::Format::RGBA8:
+			row[x * 4 + channel] = static_cast<std::uint8_t>(value * 255.0f + 0.5f);
+			break;
+		case MipChain::Format::RGBA16F:
+			reinterpret_cast<std::uint16_t*>(row)[x * 4 + channel] = FloatToHalf(value);
+			break;
+		case MipChain::Format::R32F:
+			reinterpret_cast<float*>(row)[x] = value;
+			break;
+		}
+	}
+
+	void FillRandom(MipChain& mips, std::mt19937& random)
+	{
+		MipChain::Level top = mips.GetLevel(0);
+		for (uint32 y = 0; y < top.Height; ++y)
+		{
+			for (uint32 x = 0; x < top.Width; ++x)
+			{
+				for (uint32 c = 0; c < ChannelCount(mips.PixelFormat()); ++c)
+					SetTexel(mips.PixelFormat(), top, x, y, c, (random() % 256) / 256.0f);
+			}
+		}
+	}
+
+	const char* FormatName(MipChain::Format format)
+	{
+		switch (format)
+		{
+		case MipChain::Format::RGBA8:
+			return "RGBA8";
+		case MipChain::Format::RGBA16F:
+			return "RGBA16F";
+		case MipChain::Format::R32F:
+			return "R32F";
+		}
+		return "";
+	}
+}
+
+TEST(MipChain, LevelsHalveDownToOnePixel)
+{
+	EXPECT_EQ(1u, MipChain::FullMipCount(1, 1));
+	EXPECT_EQ(7u, MipChain::FullMipCount(37, 64));
+	EXPECT_EQ(14u, MipChain::FullMipCount(8192, 3));
+
+	MipChain mips(MipChain::Format::RGBA16F, 37, 10);
+	ASSERT_EQ(6u, mips.MipLevels());
+	const uint32 widths[] = { 37, 18, 9, 4, 2, 1 };
+	const uint32 heights[] = { 10, 5, 2, 1, 1, 1 };
+	for (uint32 mip = 0; mip < mips.MipLevels(); ++mip)
+	{
+		MipChain::Level level = mips.GetLevel(mip);
+		EXPECT_EQ(widths[mip], level.Width);
+		EXPECT_EQ(heights[mip], level.Height);
+		EXPECT_EQ(widths[mip] * 8, level.RowPitch);
+		EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(level.Data) % 16);
+	}
+
+	// More levels than the chain has are clamped to it.
+	EXPECT_EQ(3u, MipChain(MipChain::Format::R32F, 8, 8, 3).MipLevels());
+	EXPECT_EQ(4u, MipChain(MipChain::Format::R32F, 8, 8, 10).MipLevels());
+}
+
+TEST(MipChain, BoxAveragesEachTwoByTwoBlock)
+{
+	std::mt19937 random(7);
+	const uint32 sizes[][2] = { { 37, 21 }, { 64, 64 }, { 1, 9 } };
+	for (MipChain::Format format : kFormats)
+	{
+		for (const uint32* size : sizes)
+		{
+			MipChain mips(format, size[0], size[1]);
+			FillRandom(mips, random);
+			mips.Generate(MipChain::Filter::Box, 3);
+
+			for (uint32 mip = 1; mip < mips.MipLevels(); ++mip)
+			{
+				MipChain::Level src = mips.GetLevel(mip - 1);
+				MipChain::Level dst = mips.GetLevel(mip);
+				for (uint32 y = 0; y < dst.Height; ++y)
+				{
+					for (uint32 x = 0; x < dst.Width; ++x)
+					{
+						// A level one texel across or down repeats that texel.
+						uint32 x0 = (std::min)(2 * x, src.Width - 1);
+						uint32 x1 = (std::min)(2 * x + 1, src.Width - 1);
+						uint32 y0 = (std::min)(2 * y, src.Height - 1);
+						uint32 y1 = (std::min)(2 * y + 1, src.Height - 1);
+						for (uint32 c = 0; c < ChannelCount(format); ++c)
+						{
+							float expected = (GetTexel(format, src, x0, y0, c) + GetTexel(format, src, x1, y0, c) +
+								GetTexel(format, src, x0, y1, c) + GetTexel(format, src, x1, y1, c)) / 4.0f;
+							float tolerance = format == MipChain::Format::RGBA8 ? 0.51f / 255.0f :
+								format == MipChain::Format::RGBA16F ? (std::max)(expected * 1e-3f, 1e-6f) : 1e-6f;
+							ASSERT_NEAR(expected, GetTexel(format, dst, x, y, c), tolerance)
+								<< FormatName(format) << " " << size[0] << "x" << size[1] << " mip " << mip
+								<< " texel " << x << "," << y << " channel " << c;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+TEST(MipChain, KaiserKeepsAConstantImageConstant)
+{
+	for (MipChain::Format format : kFormats)
+	{
+		MipChain mips(format, 37, 21);
+		MipChain::Level top = mips.GetLevel(0);
+		for (uint32 y = 0; y < top.Height; ++y)
+		{
+			for (uint32 x = 0; x < top.Width; ++x)
+			{
+				for (uint32 c = 0; c < ChannelCount(format); ++c)
+					SetTexel(format, top, x, y, c, 0.75f);
+			}
+		}
+		mips.Generate(MipChain::Filter::Kaiser, 2);
+
+		float expected = GetTexel(format, top, 0, 0, 0);
+		for (uint32 mip = 1; mip < mips.MipLevels(); ++mip)
+		{
+			MipChain::Level level = mips.GetLevel(mip);
+			for (uint32 y = 0; y < level.Height; ++y)
+			{
+				for (uint32 x = 0; x < level.Width; ++x)
+				{
+					for (uint32 c = 0; c < ChannelCount(format); ++c)
+						ASSERT_NEAR(expected, GetTexel(format, level, x, y, c), 1e-3f) << FormatName(format) << " mip " << mip;
+				}
+			}
+		}
+	}
+}
+
+TEST(MipChain, ThreadCountDoesNotChangeTheResult)
+{
+	std::mt19937 random(11);
+	MipChain single(MipChain::Format::RGBA8, 129, 67);
+	FillRandom(single, random);
+	MipChain threaded = single;
+	single.Generate(MipChain::Filter::Kaiser, 1);
+	threaded.Generate(MipChain::Filter::Kaiser, 5);
+
+	for (uint32 mip = 1; mip < single.MipLevels(); ++mip)
+	{
+		MipChain::Level a = single.GetLevel(mip);
+		MipChain::Level b = threaded.GetLevel(mip);
+		EXPECT_EQ(0, std::memcmp(a.Data, b.Data, size_t(a.RowPitch) * a.Height)) << "mip " << mip;
+	}
+}
+
+TEST(MipChainBenchmark, DISABLED_Generate4Kand8K)
+{
+	std::mt19937 random(3);
+	for (uint32 size : { 4096u, 8192u })
+	{
+		for (MipChain::Format format : kFormats)
+		{
+			MipChain mips(format, size, size);
+			FillRandom(mips, random);
+			char label[64];
+			std::snprintf(label, sizeof(label), "%u^2 %s Box", size, FormatName(format));
+			Benchmark::Measure(label, [&]() { mips.Generate(MipChain::Filter::Box); });
+			std::snprintf(label, sizeof(label), "%u^2 %s Kaiser", size, FormatName(format));
+			Benchmark::Measure(label, [&]() { mips.Generate(MipChain::Filter::Kaiser); });
+		}
+	}
+}
@@ -0,0 +1,157 @@
+#include "NameRegistry.h"
+#include "Benchmark.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <stdexcept>
+
+namespace
+{
+	struct Submesh
+	{
+		std::uint32_t IndexCount = 0;
+		std::uint32_t StartIndexLocation = 0;
+		std::int32_t BaseVertexLocation = 0;
+	};
+
+	using Registry = NameRegistry<int>;
+
+	constexpr NameId kBox("box");
+	constexpr NameId kShapeGeo("shapeGeo");
+}
+
+TEST(NameRegistry, HandlesAreDenseAndStable)
+{
+	Registry values;
+	Registry::Handle box = values.Add("box", 1);
+	Registry::Handle grid = values.Add("grid", 2);
+	EXPECT_EQ(0u, box);
+	EXPECT_EQ(1u, grid);
+	EXPECT_EQ(2u, values.size());
+
+	// Adding again replaces the value and keeps the handle.
+	EXPECT_EQ(box, values.Add("box", 3));
+	EXPECT_EQ(3, values[box]);
+	EXPECT_EQ(2u, values.size());
+
+	EXPECT_EQ(box, values.Find(kBox));
+	EXPECT_EQ(grid, values.Find(std::string("grid")));
+	EXPECT_EQ(Registry::InvalidHandle, values.Find(NameId("sphere")));
+	EXPECT_FALSE(values.Contains("sphere"));
+	EXPECT_EQ("grid", values.Name(grid));
+	EXPECT_EQ(3, values[kBox]);
+}
+
+TEST(NameRegistry, StringIndexingInsertsLikeAMap)
+{
+	Registry values;
+	values["cylinder"] = 7;
+	++values["cylinder"];
+	EXPECT_EQ(1u, values.size());
+	EXPECT_EQ(8, values[NameId("cylinder")]);
+	EXPECT_EQ(0, values[std::string("sphere")]);
+	EXPECT_EQ(2u, values.size());
+}
+
+TEST(NameRegistry, HashCollisionThrows)
+{
+	// Two of the known 32-bit FNV-1a collisions.
+	ASSERT_EQ(NameId("costarring").Hash, NameId("liquid").Hash);
+	ASSERT_EQ(NameId("declinate").Hash, NameId("macallums").Hash);
+
+	Registry values;
+	values.Add("costarring", 1);
+	EXPECT_THROW(values.Add("liquid", 2), std::invalid_argument);
+	values["declinate"] = 3;
+	EXPECT_THROW(values["macallums"], std::invalid_argument);
+
+	// Nothing was added for the rejected names.
+	EXPECT_EQ(2u, values.size());
+	EXPECT_EQ(1, values[NameId("costarring")]);
+}
+
+// Building 100k render items that each find their geometry and submesh, then
+// a frame that looks up every item's submesh again, with the string-keyed
+// maps the renderer used before against NameRegistry by NameId and Handle.
+TEST(NameRegistryBenchmark, DISABLED_RenderItemLookups)
+{
+	const int kItemCount = 100000;
+	const char* const kSubmeshNames[] = { "box", "grid", "sphere", "cylinder" };
+
+	struct MapGeometry
+	{
+		std::unordered_map<std::string, Submesh> DrawArgs;
+	};
+	std::unordered_map<std::string, std::unique_ptr<MapGeometry>> mapGeometries;
+	mapGeometries["shapeGeo"] = std::make_unique<MapGeometry>();
+
+	struct RegistryGeometry
+	{
+		NameRegistry<Submesh> DrawArgs;
+	};
+	NameRegistry<std::unique_ptr<RegistryGeometry>> registryGeometries;
+	registryGeometries.Add("shapeGeo", std::make_unique<RegistryGeometry>());
+
+	for (std::uint32_t i = 0; i < 4; ++i)
+	{
+		Submesh submesh;
+		submesh.IndexCount = 36 * (i + 1);
+		submesh.StartIndexLocation = 1000 * i;
+		mapGeometries["shapeGeo"]->DrawArgs[kSubmeshNames[i]] = submesh;
+		registryGeometries[kShapeGeo]->DrawArgs.Add(kSubmeshNames[i], submesh);
+	}
+
+	struct RenderItem
+	{
+		const void* Geo = nullptr;
+		std::string SubmeshName;
+		NameRegistry<Submesh>::Handle SubmeshHandle = 0;
+		Submesh Args;
+	};
+	std::vector<RenderItem> items(kItemCount);
+	// Read at the end, so the frame loops cannot be dropped.
+	std::uint64_t mapIndices = 0;
+	std::uint64_t registryIndices = 0;
+
+	// As before: the geometry and each draw argument by string.
+	Benchmark::Measure("100k builds, unordered_map<string>", [&]()
+	{
+		for (int i = 0; i < kItemCount; ++i)
+		{
+			RenderItem& item = items[i];
+			MapGeometry* geo = mapGeometries["shapeGeo"].get();
+			item.Geo = geo;
+			item.SubmeshName = kSubmeshNames[i % 4];
+			item.Args.IndexCount = geo->DrawArgs[kSubmeshNames[i % 4]].IndexCount;
+			item.Args.StartIndexLocation = geo->DrawArgs[kSubmeshNames[i % 4]].StartIndexLocation;
+			item.Args.BaseVertexLocation = geo->DrawArgs[kSubmeshNames[i % 4]].BaseVertexLocation;
+		}
+	});
+	Benchmark::Measure("100k frame lookups, unordered_map<string>", [&]()
+	{
+		MapGeometry* geo = mapGeometries["shapeGeo"].get();
+		for (const RenderItem& item : items)
+			mapIndices += geo->DrawArgs[item.SubmeshName].IndexCount;
+	});
+
+	// Names resolved to NameIds at compile time, and one lookup a submesh.
+	const NameId submeshIds[] = { NameId("box"), NameId("grid"), NameId("sphere"), NameId("cylinder") };
+	Benchmark::Measure("100k builds, NameRegistry by NameId", [&]()
+	{
+		for (int i = 0; i < kItemCount; ++i)
+		{
+			RenderItem& item = items[i];
+			RegistryGeometry* geo = registryGeometries[kShapeGeo].get();
+			item.Geo = geo;
+			item.SubmeshHandle = geo->DrawArgs.Find(submeshIds[i % 4]);
+			item.Args = geo->DrawArgs[item.SubmeshHandle];
+		}
+	});
+	Benchmark::Measure("100k frame lookups, NameRegistry by Handle", [&]()
+	{
+		const NameRegistry<Submesh>& drawArgs = registryGeometries[kShapeGeo]->DrawArgs;
+		for (const RenderItem& item : items)
+			registryIndices += drawArgs[item.SubmeshHandle].IndexCount;
+	});
+	EXPECT_NE(0u, mapIndices);
+	EXPECT_NE(0u, registryIndices);
+}
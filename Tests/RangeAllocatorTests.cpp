@@ -0,0 +1,112 @@
+#include "RangeAllocator.h"
+#include <gtest/gtest.h>
+
+namespace
+{
+	const RangeAllocator::uint32 kInvalid = RangeAllocator::InvalidOffset;
+}
+
+TEST(RangeAllocator, TakesTheSmallestGapThatFits)
+{
+	RangeAllocator ranges(105);
+	ASSERT_EQ(0u, ranges.Allocate(10));
+	ASSERT_EQ(10u, ranges.Allocate(30));
+	ASSERT_EQ(40u, ranges.Allocate(5));
+	ASSERT_EQ(45u, ranges.Allocate(20));
+	ASSERT_EQ(65u, ranges.Allocate(5));
+	// Gaps of 30 at 10, 20 at 45 and 35 at 70.
+	ranges.Free(10, 30);
+	ranges.Free(45, 20);
+	EXPECT_EQ(3u, ranges.FreeRangeCount());
+
+	// 18 fits all three, and goes to the 20; what is left of it stays free.
+	EXPECT_EQ(45u, ranges.Allocate(18));
+	EXPECT_EQ(63u, ranges.Allocate(2));
+	// 30 is a closer fit for 25 than 35.
+	EXPECT_EQ(10u, ranges.Allocate(25));
+	EXPECT_EQ(70u, ranges.Allocate(35));
+	EXPECT_EQ(kInvalid, ranges.Allocate(6));
+	EXPECT_EQ(35u, ranges.Allocate(5));
+	EXPECT_EQ(0u, ranges.FreeSize());
+	EXPECT_EQ(105u, ranges.UsedSize());
+}
+
+TEST(RangeAllocator, FreeMergesWithBothNeighbours)
+{
+	RangeAllocator ranges(30);
+	ASSERT_EQ(0u, ranges.Allocate(10));
+	ASSERT_EQ(10u, ranges.Allocate(10));
+	ASSERT_EQ(20u, ranges.Allocate(10));
+
+	ranges.Free(0, 10);
+	ranges.Free(20, 10);
+	EXPECT_EQ(2u, ranges.FreeRangeCount());
+	EXPECT_EQ(10u, ranges.LargestFreeRange());
+
+	// Joins the range before it and the one after it into one.
+	ranges.Free(10, 10);
+	EXPECT_EQ(1u, ranges.FreeRangeCount());
+	EXPECT_EQ(30u, ranges.LargestFreeRange());
+	EXPECT_EQ(30u, ranges.FreeSize());
+	EXPECT_EQ(0u, ranges.Allocate(30));
+}
+
+TEST(RangeAllocator, GrowExtendsTheLastFreeRange)
+{
+	RangeAllocator ranges(20);
+	ASSERT_EQ(0u, ranges.Allocate(15));
+	EXPECT_EQ(kInvalid, ranges.Allocate(10));
+
+	// The new space merges with the 5 free at the end.
+	ranges.Grow(40);
+	EXPECT_EQ(40u, ranges.Capacity());
+	EXPECT_EQ(25u, ranges.FreeSize());
+	EXPECT_EQ(1u, ranges.FreeRangeCount());
+	EXPECT_EQ(15u, ranges.Allocate(25));
+
+	// With the end in use, it is a range of its own.
+	ranges.Grow(50);
+	EXPECT_EQ(1u, ranges.FreeRangeCount());
+	EXPECT_EQ(40u, ranges.Allocate(10));
+	ranges.Grow(50);
+	EXPECT_EQ(0u, ranges.FreeRangeCount());
+}
+
+TEST(RangeAllocator, LargestFreeRangeAfterFragmentation)
+{
+	const RangeAllocator::uint32 kCount = 64;
+	RangeAllocator ranges(kCount * 8);
+	for (RangeAllocator::uint32 i = 0; i < kCount; ++i)
+		ASSERT_EQ(i * 8, ranges.Allocate(8));
+
+	// Every other block: half the space is free, but no range is over 8.
+	for (RangeAllocator::uint32 i = 0; i < kCount; i += 2)
+		ranges.Free(i * 8, 8);
+	EXPECT_EQ(kCount * 4, ranges.FreeSize());
+	EXPECT_EQ(size_t(kCount / 2), ranges.FreeRangeCount());
+	EXPECT_EQ(8u, ranges.LargestFreeRange());
+	EXPECT_EQ(kInvalid, ranges.Allocate(9));
+
+	// Freeing blocks 1 and 3 joins 0 to 4.
+	ranges.Free(8, 8);
+	ranges.Free(24, 8);
+	EXPECT_EQ(40u, ranges.LargestFreeRange());
+	EXPECT_EQ(0u, ranges.Allocate(40));
+	EXPECT_EQ(8u, ranges.LargestFreeRange());
+
+	ranges.Reset(16);
+	EXPECT_EQ(16u, ranges.LargestFreeRange());
+	EXPECT_EQ(1u, ranges.FreeRangeCount());
+}
+
+TEST(RangeAllocator, FreeAtTheTopOfTheRange)
+{
+	// A range that ends at a capacity close to 2^32.
+	const RangeAllocator::uint32 kCapacity = 0xfffffff0;
+	RangeAllocator ranges(kCapacity);
+	ASSERT_EQ(0u, ranges.Allocate(kCapacity - 16));
+	EXPECT_EQ(kCapacity - 16, ranges.Allocate(16));
+	ranges.Free(kCapacity - 16, 16);
+	EXPECT_EQ(16u, ranges.FreeSize());
+	EXPECT_EQ(kCapacity - 16, ranges.Allocate(16));
+}
@@ -0,0 +1,124 @@
+#include "RingAllocator.h"
+#include <gtest/gtest.h>
+
+namespace
+{
+	const RingAllocator::uint64 kInvalid = RingAllocator::InvalidOffset;
+}
+
+TEST(RingAllocator, AllocatesInOrderAtTheAlignment)
+{
+	RingAllocator ring(1024);
+	EXPECT_EQ(0u, ring.Allocate(10));
+	EXPECT_EQ(16u, ring.Allocate(4, 16));
+	EXPECT_EQ(20u, ring.Allocate(1));
+	EXPECT_EQ(256u, ring.Allocate(8, 256));
+	EXPECT_EQ(264u, ring.UsedSize());
+	EXPECT_EQ(264u, ring.PendingSize());
+	EXPECT_EQ(0u, ring.SubmissionCount());
+}
+
+TEST(RingAllocator, FullRingWaitsForRetirement)
+{
+	RingAllocator ring(256);
+	EXPECT_EQ(kInvalid, ring.Allocate(257));
+	EXPECT_EQ(0u, ring.Allocate(200));
+	ring.Submit(1);
+	EXPECT_EQ(kInvalid, ring.Allocate(100));
+	EXPECT_EQ(1u, ring.OldestFence());
+
+	// A fence short of the submission frees nothing.
+	ring.Retire(0);
+	EXPECT_EQ(kInvalid, ring.Allocate(100));
+
+	ring.Retire(1);
+	EXPECT_EQ(0u, ring.UsedSize());
+	EXPECT_EQ(0u, ring.OldestFence());
+	EXPECT_EQ(0u, ring.Allocate(100));
+}
+
+TEST(RingAllocator, RetiresSubmissionsInFenceOrder)
+{
+	RingAllocator ring(1000);
+	ring.Allocate(100);
+	ring.Submit(3);
+	ring.Allocate(200);
+	ring.Allocate(50);
+	ring.Submit(5);
+	ring.Allocate(10);
+	ring.Submit(5);
+	EXPECT_EQ(3u, ring.SubmissionCount());
+	EXPECT_EQ(0u, ring.PendingSize());
+
+	ring.Retire(4);
+	EXPECT_EQ(2u, ring.SubmissionCount());
+	EXPECT_EQ(260u, ring.UsedSize());
+	EXPECT_EQ(5u, ring.OldestFence());
+
+	ring.Retire(5);
+	EXPECT_EQ(0u, ring.SubmissionCount());
+	EXPECT_EQ(0u, ring.UsedSize());
+}
+
+TEST(RingAllocator, SubmitWithNothingPendingIsIgnored)
+{
+	RingAllocator ring(64);
+	ring.Submit(1);
+	EXPECT_EQ(0u, ring.SubmissionCount());
+	EXPECT_EQ(0u, ring.OldestFence());
+
+	ring.Allocate(8);
+	ring.Submit(2);
+	ring.Submit(3);
+	EXPECT_EQ(1u, ring.SubmissionCount());
+	EXPECT_EQ(2u, ring.OldestFence());
+}
+
+TEST(RingAllocator, WrapsRatherThanStraddleTheEnd)
+{
+	RingAllocator ring(100);
+	EXPECT_EQ(0u, ring.Allocate(60));
+	ring.Submit(1);
+	EXPECT_EQ(60u, ring.Allocate(30));
+	ring.Submit(2);
+	ring.Retire(1);
+
+	// 90 + 20 would cross the end, so the allocation starts over at 0 and
+	// the 10 bytes skipped count as used.
+	EXPECT_EQ(0u, ring.Allocate(20));
+	EXPECT_EQ(60u, ring.UsedSize());
+	// The space up to the head of submission 2 is still taken.
+	EXPECT_EQ(kInvalid, ring.Allocate(50));
+	EXPECT_EQ(20u, ring.Allocate(40));
+	ring.Submit(3);
+
+	// The skipped bytes belong to the allocation after them, so retiring 2
+	// leaves them taken until 3 retires.
+	ring.Retire(2);
+	EXPECT_EQ(70u, ring.UsedSize());
+	EXPECT_EQ(kInvalid, ring.Allocate(40));
+	EXPECT_EQ(60u, ring.Allocate(30));
+	ring.Submit(4);
+	ring.Retire(3);
+	EXPECT_EQ(30u, ring.UsedSize());
+
+	// With nothing in flight the ring starts over at 0.
+	ring.Retire(4);
+	EXPECT_EQ(0u, ring.UsedSize());
+	EXPECT_EQ(0u, ring.Allocate(100));
+}
+
+TEST(RingAllocator, ResetFreesEverything)
+{
+	RingAllocator ring(128);
+	ring.Allocate(64);
+	ring.Submit(1);
+	ring.Allocate(32);
+
+	ring.Reset(256);
+	EXPECT_EQ(256u, ring.Capacity());
+	EXPECT_EQ(0u, ring.UsedSize());
+	EXPECT_EQ(0u, ring.PendingSize());
+	EXPECT_EQ(0u, ring.SubmissionCount());
+	EXPECT_EQ(0u, ring.Allocate(256));
+}
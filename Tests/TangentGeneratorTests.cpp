@@ -0,0 +1,143 @@
+#include "TangentGenerator.h"
+#include "Benchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	using MeshData = GeometryGenerator::MeshData;
+
+	// A grid with a wavy height field, so no two vertices share a frame.
+	MeshData DisplacedGrid(GeometryGenerator::uint32 size)
+	{
+		GeometryGenerator generator;
+		MeshData mesh = generator.CreateGrid(100.0f, 100.0f, size, size);
+		for (GeometryGenerator::Vertex& v : mesh.Vertices)
+			v.Position.y = std::sin(v.Position.x) * std::cos(v.Position.z);
+		return mesh;
+	}
+
+	void ClearFrames(MeshData& mesh)
+	{
+		for (GeometryGenerator::Vertex& v : mesh.Vertices)
+		{
+			v.Normal = XMFLOAT3(0.0f, 0.0f, 0.0f);
+			v.TangentU = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		}
+	}
+
+	float AngleDegrees(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		XMVECTOR x = XMVector3Normalize(XMLoadFloat3(&a));
+		XMVECTOR y = XMVector3Normalize(XMLoadFloat3(&b));
+		float cosine = XMVectorGetX(XMVector3Dot(x, y));
+		cosine = (std::max)(-1.0f, (std::min)(1.0f, cosine));
+		return std::acos(cosine) * 180.0f / XM_PI;
+	}
+
+	// Mean angle between the generated frames and the generator's analytic
+	// ones.
+	void ExpectAnalyticFrames(MeshData mesh, float maxMeanDegrees)
+	{
+		MeshData reference = mesh;
+		ClearFrames(mesh);
+		TangentGenerator::Generate(mesh);
+
+		float normalDegrees = 0.0f;
+		float tangentDegrees = 0.0f;
+		for (size_t i = 0; i < mesh.Vertices.size(); ++i)
+		{
+			normalDegrees += AngleDegrees(reference.Vertices[i].Normal, mesh.Vertices[i].Normal);
+			tangentDegrees += AngleDegrees(reference.Vertices[i].TangentU, mesh.Vertices[i].TangentU);
+		}
+		EXPECT_LE(normalDegrees / mesh.Vertices.size(), maxMeanDegrees);
+		EXPECT_LE(tangentDegrees / mesh.Vertices.size(), maxMeanDegrees);
+	}
+}
+
+TEST(TangentGenerator, ReproducesTheFlatGridFrame)
+{
+	GeometryGenerator generator;
+	MeshData mesh = generator.CreateGrid(10.0f, 10.0f, 8, 8);
+	ClearFrames(mesh);
+	TangentGenerator::Generate(mesh);
+
+	for (const GeometryGenerator::Vertex& v : mesh.Vertices)
+	{
+		EXPECT_NEAR(0.0f, v.Normal.x, 1e-5f);
+		EXPECT_NEAR(1.0f, v.Normal.y, 1e-5f);
+		EXPECT_NEAR(0.0f, v.Normal.z, 1e-5f);
+		EXPECT_NEAR(1.0f, v.TangentU.x, 1e-5f);
+		EXPECT_NEAR(0.0f, v.TangentU.y, 1e-5f);
+		EXPECT_NEAR(0.0f, v.TangentU.z, 1e-5f);
+	}
+}
+
+TEST(TangentGenerator, ApproximatesTheAnalyticFrames)
+{
+	GeometryGenerator generator;
+	ExpectAnalyticFrames(generator.CreateBox(1.0f, 2.0f, 3.0f, 2), 0.01f);
+	ExpectAnalyticFrames(generator.CreateCylinder(1.0f, 0.5f, 3.0f, 40, 10), 1.0f);
+	// The sphere poles are singular, every pole vertex has its own frame.
+	ExpectAnalyticFrames(generator.CreateSphere(1.0f, 40, 40), 2.0f);
+}
+
+TEST(TangentGenerator, KeepsNormalsWhenAsked)
+{
+	GeometryGenerator generator;
+	MeshData mesh = generator.CreateSphere(1.0f, 20, 20);
+	for (GeometryGenerator::Vertex& v : mesh.Vertices)
+		v.Normal = XMFLOAT3(0.0f, 0.0f, 1.0f);
+	MeshData before = mesh;
+
+	TangentGenerator::Options options;
+	options.ComputeNormals = false;
+	TangentGenerator::Generate(mesh, options);
+
+	for (size_t i = 0; i < mesh.Vertices.size(); ++i)
+	{
+		EXPECT_EQ(0, std::memcmp(&before.Vertices[i].Normal, &mesh.Vertices[i].Normal, sizeof(XMFLOAT3)));
+		// The tangents are projected into the plane of the kept normal.
+		EXPECT_NEAR(0.0f, mesh.Vertices[i].TangentU.z, 1e-5f);
+	}
+}
+
+TEST(TangentGenerator, IsBitIdenticalForAnyThreadCount)
+{
+	MeshData reference = DisplacedGrid(200);
+	TangentGenerator::Options options;
+	options.ThreadCount = 1;
+	TangentGenerator::Generate(reference, options);
+
+	// Thread counts that do not divide the triangle or vertex counts evenly
+	// move every chunk boundary.
+	for (TangentGenerator::uint32 threads : { 2u, 3u, 7u, 16u })
+	{
+		MeshData mesh = DisplacedGrid(200);
+		options.ThreadCount = threads;
+		options.MinTrianglesPerThread = 1;
+		TangentGenerator::Generate(mesh, options);
+
+		ASSERT_EQ(reference.Vertices.size(), mesh.Vertices.size());
+		EXPECT_EQ(0, std::memcmp(reference.Vertices.data(), mesh.Vertices.data(),
+			mesh.Vertices.size() * sizeof(GeometryGenerator::Vertex))) << threads << " threads";
+	}
+}
+
+TEST(TangentGeneratorBenchmark, DISABLED_Generate)
+{
+	MeshData mesh = DisplacedGrid(1000);
+	TangentGenerator::Options options;
+
+	options.ThreadCount = 1;
+	Benchmark::Measure("2M triangles, 1 thread", [&]() {
+		TangentGenerator::Generate(mesh, options);
+	});
+	options.ThreadCount = 0;
+	Benchmark::Measure("2M triangles, all threads", [&]() {
+		TangentGenerator::Generate(mesh, options);
+	});
+}
@@ -0,0 +1,245 @@
+#pragma once
+#include "TextureFile.h"
+#include "TextureFormat.h"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Writes DDS and KTX2 files for the loader tests, so the corpus is made by
+// the tests rather than checked in.  Subresources are random bytes of the
+// size the format and mip call for, in D3D12 order (mip + item *
+// MipLevels); the writers lay them out as each container does.
+namespace TextureCorpus
+{
+	using uint32 = std::uint32_t;
+	using uint64 = std::uint64_t;
+	using Bytes = std::vector<std::uint8_t>;
+
+	struct Texture
+	{
+		DXGI_FORMAT Format;
+		TextureFile::Dimension Type;
+		uint32 Width;
+		uint32 Height;
+		uint32 Depth;
+		// In cubes for a cube map, not faces.
+		uint32 ArraySize;
+		uint32 MipLevels;
+		bool IsCubeMap;
+	};
+
+	// The header fields the rejection tests corrupt.
+	const size_t kDdsHeaderSizeOffset = 4;
+	const size_t kDdsHeightOffset = 12;
+	const size_t kDdsWidthOffset = 16;
+	const size_t kDdsMipCountOffset = 28;
+	const size_t kDdsFourCCOffset = 84;
+	const size_t kDdsCaps2Offset = 112;
+	const size_t kDdsDx10FormatOffset = 128;
+	const size_t kDdsDx10DimensionOffset = 132;
+	// Where the data of a DDS file with a DX10 header starts.
+	const size_t kDdsDx10DataOffset = 148;
+	const size_t kKtx2VkFormatOffset = 12;
+	const size_t kKtx2FaceCountOffset = 36;
+	const size_t kKtx2SupercompressionOffset = 44;
+	// Then per level: byte offset, byte length, uncompressed byte length.
+	const size_t kKtx2LevelIndexOffset = 80;
+
+	// A pre-DX10 DDS pixel format: a FourCC, or masks over BitCount bits.
+	struct LegacyPixelFormat
+	{
+		uint32 Flags;
+		uint32 FourCC;
+		uint32 BitCount;
+		uint32 RMask;
+		uint32 GMask;
+		uint32 BMask;
+		uint32 AMask;
+	};
+
+	const uint32 kDdpfAlphaPixels = 0x1;
+	const uint32 kDdpfFourCC = 0x4;
+	const uint32 kDdpfRgb = 0x40;
+	const uint32 kDdpfLuminance = 0x20000;
+
+	inline uint32 FourCC(char a, char b, char c, char d)
+	{
+		return uint32(std::uint8_t(a)) | (uint32(std::uint8_t(b)) << 8) | (uint32(std::uint8_t(c)) << 16) |
+			(uint32(std::uint8_t(d)) << 24);
+	}
+
+	inline LegacyPixelFormat FourCCFormat(uint32 fourCC)
+	{
+		return { kDdpfFourCC, fourCC, 0, 0, 0, 0, 0 };
+	}
+
+	inline LegacyPixelFormat MaskFormat(uint32 flags, uint32 bitCount, uint32 r, uint32 g, uint32 b, uint32 a)
+	{
+		return { flags, 0, bitCount, r, g, b, a };
+	}
+
+	inline void Put32(Bytes& bytes, uint32 value)
+	{
+		for (int i = 0; i < 4; ++i)
+			bytes.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+	}
+
+	inline void Put64(Bytes& bytes, uint64 value)
+	{
+		Put32(bytes, static_cast<uint32>(value));
+		Put32(bytes, static_cast<uint32>(value >> 32));
+	}
+
+	inline void Set32(Bytes& bytes, size_t offset, uint32 value)
+	{
+		for (int i = 0; i < 4; ++i)
+			bytes[offset + i] = static_cast<std::uint8_t>(value >> (8 * i));
+	}
+
+	inline void Set64(Bytes& bytes, size_t offset, uint64 value)
+	{
+		Set32(bytes, offset, static_cast<uint32>(value));
+		Set32(bytes, offset + 4, static_cast<uint32>(value >> 32));
+	}
+
+	inline uint32 ItemCount(const Texture& texture)
+	{
+		return texture.ArraySize * (texture.IsCubeMap ? 6 : 1);
+	}
+
+	inline std::vector<Bytes> MakeSubresources(const Texture& texture, std::mt19937& random)
+	{
+		const TextureFormatInfo* info = TextureFormat::Find(texture.Format);
+		std::vector<Bytes> subresources(ItemCount(texture) * texture.MipLevels);
+		for (uint32 item = 0; item < ItemCount(texture); ++item)
+		{
+			for (uint32 mip = 0; mip < texture.MipLevels; ++mip)
+			{
+				uint32 width = (std::max)(texture.Width >> mip, 1u);
+				uint32 height = (std::max)(texture.Height >> mip, 1u);
+				uint32 depth = (std::max)(texture.Depth >> mip, 1u);
+				size_t size = size_t((width + info->BlockWidth - 1) / info->BlockWidth) * info->BytesPerBlock *
+					((height + info->BlockHeight - 1) / info->BlockHeight) * depth;
+				Bytes& bytes = subresources[mip + item * texture.MipLevels];
+				bytes.resize(size);
+				for (std::uint8_t& b : bytes)
+					b = static_cast<std::uint8_t>(random());
+			}
+		}
+		return subresources;
+	}
+
+	namespace Detail
+	{
+		inline Bytes WriteDds(const Texture& texture, const std::vector<Bytes>& subresources, bool dx10,
+			const LegacyPixelFormat& legacy)
+		{
+			bool volume = texture.Type == TextureFile::Dimension::Texture3D;
+			Bytes bytes;
+			Put32(bytes, FourCC('D', 'D', 'S', ' '));
+			// Size; caps, height, width, pixel format and mip count flags.
+			Put32(bytes, 124);
+			Put32(bytes, 0x1007 | 0x20000 | (volume ? 0x800000 : 0));
+			Put32(bytes, texture.Height);
+			Put32(bytes, texture.Width);
+			Put32(bytes, 0);
+			Put32(bytes, texture.Depth);
+			Put32(bytes, texture.MipLevels);
+			for (int i = 0; i < 11; ++i)
+				Put32(bytes, 0);
+
+			Put32(bytes, 32);
+			Put32(bytes, dx10 ? kDdpfFourCC : legacy.Flags);
+			Put32(bytes, dx10 ? FourCC('D', 'X', '1', '0') : legacy.FourCC);
+			Put32(bytes, legacy.BitCount);
+			Put32(bytes, legacy.RMask);
+			Put32(bytes, legacy.GMask);
+			Put32(bytes, legacy.BMask);
+			Put32(bytes, legacy.AMask);
+
+			// Caps: texture.  Caps2: all six cube faces, or volume.
+			Put32(bytes, 0x1000);
+			Put32(bytes, dx10 ? 0 : texture.IsCubeMap ? 0xFE00 : volume ? 0x200000 : 0);
+			for (int i = 0; i < 3; ++i)
+				Put32(bytes, 0);
+
+			if (dx10)
+			{
+				uint32 dimension = texture.Type == TextureFile::Dimension::Texture1D ? 2 :
+					texture.Type == TextureFile::Dimension::Texture2D ? 3 : 4;
+				Put32(bytes, texture.Format);
+				Put32(bytes, dimension);
+				Put32(bytes, texture.IsCubeMap ? 0x4 : 0);
+				Put32(bytes, texture.ArraySize);
+				Put32(bytes, 0);
+			}
+
+			for (const Bytes& subresource : subresources)
+				bytes.insert(bytes.end(), subresource.begin(), subresource.end());
+			return bytes;
+		}
+	}
+
+	// A DDS file with a DX10 header.
+	inline Bytes WriteDds(const Texture& texture, const std::vector<Bytes>& subresources)
+	{
+		return Detail::WriteDds(texture, subresources, true, LegacyPixelFormat());
+	}
+
+	// A DDS file with only the legacy header, for single 2D textures, cube
+	// maps and volumes.
+	inline Bytes WriteLegacyDds(const Texture& texture, const std::vector<Bytes>& subresources,
+		const LegacyPixelFormat& pixelFormat)
+	{
+		return Detail::WriteDds(texture, subresources, false, pixelFormat);
+	}
+
+	// A KTX2 file without supercompression, smallest level first as KTX2
+	// writers store them, each level starting at a multiple of 16.
+	inline Bytes WriteKtx2(const Texture& texture, const std::vector<Bytes>& subresources, uint32 vkFormat)
+	{
+		static const std::uint8_t identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+		Bytes bytes(identifier, identifier + sizeof(identifier));
+		Put32(bytes, vkFormat);
+		Put32(bytes, 1);
+		Put32(bytes, texture.Width);
+		Put32(bytes, texture.Type == TextureFile::Dimension::Texture1D ? 0 : texture.Height);
+		Put32(bytes, texture.Type == TextureFile::Dimension::Texture3D ? texture.Depth : 0);
+		Put32(bytes, texture.ArraySize == 1 ? 0 : texture.ArraySize);
+		Put32(bytes, texture.IsCubeMap ? 6 : 1);
+		Put32(bytes, texture.MipLevels);
+		Put32(bytes, 0);
+		// No data format descriptor, key/value data or supercompression data.
+		for (int i = 0; i < 4; ++i)
+			Put32(bytes, 0);
+		Put64(bytes, 0);
+		Put64(bytes, 0);
+
+		size_t levelIndex = bytes.size();
+		bytes.resize(bytes.size() + 24 * texture.MipLevels);
+		for (uint32 mip = texture.MipLevels; mip-- > 0;)
+		{
+			while (bytes.size() % 16 != 0)
+				bytes.push_back(0);
+			size_t offset = bytes.size();
+			for (uint32 item = 0; item < ItemCount(texture); ++item)
+			{
+				const Bytes& subresource = subresources[mip + item * texture.MipLevels];
+				bytes.insert(bytes.end(), subresource.begin(), subresource.end());
+			}
+			Set64(bytes, levelIndex + 24 * mip, offset);
+			Set64(bytes, levelIndex + 24 * mip + 8, bytes.size() - offset);
+			Set64(bytes, levelIndex + 24 * mip + 16, bytes.size() - offset);
+		}
+		return bytes;
+	}
+
+	inline void Save(const std::string& path, const Bytes& bytes)
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(bytes.data()), std::streamsize(bytes.size()));
+	}
+}
@@ -0,0 +1,336 @@
+#include "TextureFile.h"
+#include "TextureFormat.h"
+#include "TextureCorpus.h"
+#include "Benchmark.h"
+#ifndef _WIN32
+// Stands in for windows.h, which d3d12.h expects.
+#include <wsl/winadapter.h>
+#endif
+#include <d3dx12_property_format_table.h>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+using namespace TextureCorpus;
+
+namespace
+{
+	using Dimension = TextureFile::Dimension;
+
+	std::string TempPath(const char* name)
+	{
+		return ::testing::TempDir() + name;
+	}
+
+	// Opens bytes as a file and checks that it describes texture and that
+	// every subresource points at its bytes in the mapping.
+	void ExpectLoads(const char* label, const Bytes& bytes, const Texture& texture, const std::vector<Bytes>& subresources)
+	{
+		SCOPED_TRACE(label);
+		std::string path = TempPath("corpus.tex");
+		Save(path, bytes);
+		TextureFile file;
+		ASSERT_TRUE(file.Open(path)) << file.Error();
+
+		const TextureFile::Description& desc = file.GetDescription();
+		EXPECT_EQ(texture.Format, desc.Format);
+		EXPECT_EQ(texture.Type, desc.Type);
+		EXPECT_EQ(texture.Width, desc.Width);
+		EXPECT_EQ(texture.Height, desc.Height);
+		EXPECT_EQ(texture.Depth, desc.Depth);
+		EXPECT_EQ(ItemCount(texture), desc.ArraySize);
+		EXPECT_EQ(texture.MipLevels, desc.MipLevels);
+		EXPECT_EQ(texture.IsCubeMap, desc.IsCubeMap);
+
+		ASSERT_EQ(subresources.size(), file.SubresourceCount());
+		const TextureFormatInfo* info = TextureFormat::Find(texture.Format);
+		for (uint32 i = 0; i < file.SubresourceCount(); ++i)
+		{
+			const TextureFile::Subresource& subresource = file.GetSubresource(i);
+			uint32 mip = i % texture.MipLevels;
+			uint32 width = (std::max)(texture.Width >> mip, 1u);
+			uint32 depth = (std::max)(texture.Depth >> mip, 1u);
+			EXPECT_EQ(uint64((width + info->BlockWidth - 1) / info->BlockWidth) * info->BytesPerBlock, subresource.RowPitch)
+				<< "subresource " << i;
+			ASSERT_EQ(subresources[i].size(), subresource.SlicePitch * depth) << "subresource " << i;
+			EXPECT_EQ(0, std::memcmp(subresources[i].data(), subresource.Data, subresources[i].size())) << "subresource " << i;
+		}
+	}
+
+	void ExpectRejected(const char* label, const Bytes& bytes, const char* error)
+	{
+		SCOPED_TRACE(label);
+		std::string path = TempPath("corpus.tex");
+		Save(path, bytes);
+		TextureFile file;
+		EXPECT_FALSE(file.Open(path));
+		EXPECT_NE(std::string::npos, file.Error().find(error)) << file.Error();
+		EXPECT_FALSE(file.IsOpen());
+		EXPECT_EQ(0u, file.SubresourceCount());
+	}
+
+	struct CorpusEntry
+	{
+		Texture Desc;
+		uint32 VkFormat;
+	};
+
+	// Block-compressed and uncompressed formats in every shape the loader
+	// takes: mip chains cut short, odd sizes, arrays, cube maps, 1D and 3D.
+	const CorpusEntry kCorpus[] =
+	{
+		{ { DXGI_FORMAT_BC1_UNORM, Dimension::Texture2D, 64, 32, 1, 1, 7, false }, 133 },
+		{ { DXGI_FORMAT_BC3_UNORM, Dimension::Texture2D, 36, 20, 1, 1, 6, false }, 137 },
+		{ { DXGI_FORMAT_BC4_SNORM, Dimension::Texture2D, 13, 7, 1, 1, 2, false }, 140 },
+		{ { DXGI_FORMAT_BC5_SNORM, Dimension::Texture2D, 32, 32, 1, 1, 6, true }, 142 },
+		{ { DXGI_FORMAT_BC6H_UF16, Dimension::Texture2D, 20, 12, 1, 1, 1, false }, 143 },
+		{ { DXGI_FORMAT_BC7_UNORM_SRGB, Dimension::Texture2D, 128, 128, 1, 4, 8, false }, 146 },
+		{ { DXGI_FORMAT_R8G8B8A8_UNORM, Dimension::Texture2D, 37, 19, 1, 1, 6, false }, 37 },
+		{ { DXGI_FORMAT_R16G16B16A16_FLOAT, Dimension::Texture2D, 16, 16, 1, 1, 5, true }, 97 },
+		{ { DXGI_FORMAT_R32_FLOAT, Dimension::Texture3D, 9, 5, 7, 1, 4, false }, 100 },
+		{ { DXGI_FORMAT_R8_UNORM, Dimension::Texture1D, 100, 1, 1, 3, 7, false }, 9 },
+		{ { DXGI_FORMAT_R32G32B32_FLOAT, Dimension::Texture2D, 5, 3, 1, 2, 2, false }, 106 },
+	};
+
+	const Texture kSmallBc1 = { DXGI_FORMAT_BC1_UNORM, Dimension::Texture2D, 32, 32, 1, 1, 6, false };
+	const Texture kSmallBc7Array = { DXGI_FORMAT_BC7_UNORM, Dimension::Texture2D, 64, 64, 1, 2, 7, false };
+}
+
+TEST(TextureFormat, AgreesWithTheD3D12FormatTable)
+{
+	uint32 known = 0;
+	for (UINT i = 0; i < D3D12_PROPERTY_LAYOUT_FORMAT_TABLE::GetNumFormats(); ++i)
+	{
+		DXGI_FORMAT format = D3D12_PROPERTY_LAYOUT_FORMAT_TABLE::GetFormat(i);
+		const TextureFormatInfo* info = TextureFormat::Find(format);
+		if (info == nullptr)
+			continue;
+		++known;
+		SCOPED_TRACE(D3D12_PROPERTY_LAYOUT_FORMAT_TABLE::GetName(format));
+		EXPECT_EQ(D3D12_PROPERTY_LAYOUT_FORMAT_TABLE::GetBitsPerUnit(format), info->BytesPerBlock * 8);
+		EXPECT_EQ(D3D12_PROPERTY_LAYOUT_FORMAT_TABLE::GetWidthAlignment(format), info->BlockWidth);
+		EXPECT_EQ(D3D12_PROPERTY_LAYOUT_FORMAT_TABLE::GetHeightAlignment(format), info->BlockHeight);
+		EXPECT_EQ(D3D12_PROPERTY_LAYOUT_FORMAT_TABLE::IsBlockCompressFormat(format), info->BlockWidth == 4);
+	}
+	EXPECT_GT(known, 50u);
+}
+
+TEST(TextureFile, LoadsTheCorpusFromDdsAndKtx2)
+{
+	std::mt19937 random(3);
+	for (const CorpusEntry& entry : kCorpus)
+	{
+		std::vector<Bytes> subresources = MakeSubresources(entry.Desc, random);
+		char label[64];
+		std::snprintf(label, sizeof(label), "DDS format %d", int(entry.Desc.Format));
+		ExpectLoads(label, WriteDds(entry.Desc, subresources), entry.Desc, subresources);
+		std::snprintf(label, sizeof(label), "KTX2 VkFormat %u", entry.VkFormat);
+		ExpectLoads(label, WriteKtx2(entry.Desc, subresources, entry.VkFormat), entry.Desc, subresources);
+	}
+}
+
+TEST(TextureFile, LoadsLegacyDdsPixelFormats)
+{
+	struct LegacyEntry
+	{
+		const char* Label;
+		DXGI_FORMAT Format;
+		LegacyPixelFormat PixelFormat;
+	};
+	const LegacyEntry entries[] =
+	{
+		{ "DXT1", DXGI_FORMAT_BC1_UNORM, FourCCFormat(FourCC('D', 'X', 'T', '1')) },
+		{ "DXT5", DXGI_FORMAT_BC3_UNORM, FourCCFormat(FourCC('D', 'X', 'T', '5')) },
+		{ "ATI2", DXGI_FORMAT_BC5_UNORM, FourCCFormat(FourCC('A', 'T', 'I', '2')) },
+		{ "D3DFMT_A16B16G16R16F", DXGI_FORMAT_R16G16B16A16_FLOAT, FourCCFormat(113) },
+		{ "BGRA8", DXGI_FORMAT_B8G8R8A8_UNORM,
+			MaskFormat(kDdpfRgb | kDdpfAlphaPixels, 32, 0xFF0000, 0xFF00, 0xFF, 0xFF000000) },
+		{ "RGBA8", DXGI_FORMAT_R8G8B8A8_UNORM,
+			MaskFormat(kDdpfRgb | kDdpfAlphaPixels, 32, 0xFF, 0xFF00, 0xFF0000, 0xFF000000) },
+		{ "565", DXGI_FORMAT_B5G6R5_UNORM, MaskFormat(kDdpfRgb, 16, 0xF800, 0x7E0, 0x1F, 0) },
+		{ "L8", DXGI_FORMAT_R8_UNORM, MaskFormat(kDdpfLuminance, 8, 0xFF, 0, 0, 0) },
+	};
+
+	std::mt19937 random(5);
+	for (const LegacyEntry& entry : entries)
+	{
+		Texture texture = kSmallBc1;
+		texture.Format = entry.Format;
+		std::vector<Bytes> subresources = MakeSubresources(texture, random);
+		ExpectLoads(entry.Label, WriteLegacyDds(texture, subresources, entry.PixelFormat), texture, subresources);
+	}
+
+	Texture cube = { DXGI_FORMAT_BC1_UNORM, Dimension::Texture2D, 16, 16, 1, 1, 5, true };
+	std::vector<Bytes> subresources = MakeSubresources(cube, random);
+	ExpectLoads("cube", WriteLegacyDds(cube, subresources, FourCCFormat(FourCC('D', 'X', 'T', '1'))), cube, subresources);
+
+	Texture volume = { DXGI_FORMAT_B8G8R8A8_UNORM, Dimension::Texture3D, 8, 4, 6, 1, 4, false };
+	subresources = MakeSubresources(volume, random);
+	ExpectLoads("volume", WriteLegacyDds(volume, subresources,
+		MaskFormat(kDdpfRgb | kDdpfAlphaPixels, 32, 0xFF0000, 0xFF00, 0xFF, 0xFF000000)), volume, subresources);
+}
+
+TEST(TextureFile, RejectsBadDdsFiles)
+{
+	std::mt19937 random(7);
+	std::vector<Bytes> subresources = MakeSubresources(kSmallBc1, random);
+	const Bytes dds = WriteDds(kSmallBc1, subresources);
+	const Bytes legacy = WriteLegacyDds(kSmallBc1, subresources, FourCCFormat(FourCC('D', 'X', 'T', '1')));
+
+	ExpectRejected("empty", Bytes(), "empty");
+	ExpectRejected("not a texture", Bytes(200, 7), "not a DDS or KTX2 file");
+
+	Bytes bytes = dds;
+	bytes.pop_back();
+	ExpectRejected("truncated data", bytes, "truncated");
+	bytes = dds;
+	bytes.resize(kDdsDx10FormatOffset + 2);
+	ExpectRejected("truncated DX10 header", bytes, "truncated");
+	bytes = dds;
+	Set32(bytes, kDdsHeaderSizeOffset, 100);
+	ExpectRejected("header size", bytes, "header size");
+	bytes = dds;
+	Set32(bytes, kDdsDx10FormatOffset, DXGI_FORMAT_NV12);
+	ExpectRejected("planar format", bytes, "unsupported format");
+	bytes = dds;
+	Set32(bytes, kDdsDx10DimensionOffset, 9);
+	ExpectRejected("dimension", bytes, "dimension");
+	bytes = dds;
+	Set32(bytes, kDdsMipCountOffset, 7);
+	ExpectRejected("too many mips", bytes, "mip levels");
+	bytes = dds;
+	Set32(bytes, kDdsHeightOffset, 20000);
+	Set32(bytes, kDdsWidthOffset, 20000);
+	ExpectRejected("too large", bytes, "larger than D3D12 allows");
+	bytes = dds;
+	Set32(bytes, kDdsHeightOffset, 0);
+	ExpectRejected("zero size", bytes, "zero size");
+
+	bytes = legacy;
+	Set32(bytes, kDdsFourCCOffset, FourCC('B', 'B', 'B', 'B'));
+	ExpectRejected("unknown FourCC", bytes, "legacy DDS pixel format");
+	bytes = legacy;
+	// Cube map with only +X and -X.
+	Set32(bytes, kDdsCaps2Offset, 0x200 | 0x400 | 0x800);
+	ExpectRejected("partial cube", bytes, "six faces");
+}
+
+TEST(TextureFile, RejectsBadKtx2Files)
+{
+	std::mt19937 random(9);
+	std::vector<Bytes> subresources = MakeSubresources(kSmallBc7Array, random);
+	const Bytes ktx = WriteKtx2(kSmallBc7Array, subresources, 145);
+
+	Bytes bytes = ktx;
+	Set32(bytes, kKtx2SupercompressionOffset, 1);
+	ExpectRejected("supercompressed", bytes, "supercompressed");
+	bytes = ktx;
+	Set32(bytes, kKtx2VkFormatOffset, 1000);
+	ExpectRejected("VkFormat", bytes, "VkFormat");
+	bytes = ktx;
+	Set32(bytes, kKtx2FaceCountOffset, 5);
+	ExpectRejected("face count", bytes, "face count");
+	bytes = ktx;
+	bytes.resize(kKtx2LevelIndexOffset + 20);
+	ExpectRejected("truncated level index", bytes, "truncated");
+	bytes = ktx;
+	bytes.pop_back();
+	ExpectRejected("truncated data", bytes, "outside the file");
+
+	bytes = ktx;
+	Set64(bytes, kKtx2LevelIndexOffset + 24 * 2 + 8, 17);
+	ExpectRejected("level size", bytes, "wrong size");
+	bytes = ktx;
+	Set64(bytes, kKtx2LevelIndexOffset + 24 * 3, bytes.size());
+	ExpectRejected("level past the end", bytes, "outside the file");
+	bytes = ktx;
+	Set64(bytes, kKtx2LevelIndexOffset, 8);
+	ExpectRejected("level in the header", bytes, "outside the file");
+}
+
+// Reading a texture the usual way takes three copies of every byte: the
+// file into memory, each subresource into its own buffer, and then each
+// row into upload memory at the 256 byte row pitch.  From a TextureFile
+// only the last is left.
+TEST(TextureFileBenchmark, DISABLED_LoadFullChains)
+{
+	struct BenchEntry
+	{
+		const char* Name;
+		DXGI_FORMAT Format;
+	};
+	const BenchEntry entries[] = { { "BC7", DXGI_FORMAT_BC7_UNORM }, { "RGBA8", DXGI_FORMAT_R8G8B8A8_UNORM } };
+
+	std::string path = TempPath("bench.dds");
+	std::mt19937 random(11);
+	for (const BenchEntry& entry : entries)
+	{
+		for (uint32 size : { 4096u, 8192u })
+		{
+			Texture texture = { entry.Format, Dimension::Texture2D, size, size, 1, 1, 1, false };
+			for (uint32 s = size; s > 1; s >>= 1)
+				++texture.MipLevels;
+			Save(path, WriteDds(texture, MakeSubresources(texture, random)));
+
+			// Where each subresource is in the file, and where it goes in
+			// upload memory.
+			std::vector<TextureFile::Subresource> layouts;
+			std::vector<size_t> fileOffsets;
+			std::vector<uint64> offsets;
+			std::vector<uint64> rowPitches;
+			uint64 stagingSize = 0;
+			{
+				TextureFile file;
+				ASSERT_TRUE(file.Open(path)) << file.Error();
+				const std::uint8_t* fileStart = static_cast<const std::uint8_t*>(file.GetSubresource(0).Data) - kDdsDx10DataOffset;
+				for (uint32 i = 0; i < file.SubresourceCount(); ++i)
+				{
+					const TextureFile::Subresource& subresource = file.GetSubresource(i);
+					layouts.push_back(subresource);
+					fileOffsets.push_back(static_cast<const std::uint8_t*>(subresource.Data) - fileStart);
+					stagingSize = (stagingSize + 511) & ~uint64(511);
+					offsets.push_back(stagingSize);
+					rowPitches.push_back((subresource.RowPitch + 255) & ~uint64(255));
+					stagingSize += rowPitches.back() * (subresource.SlicePitch / subresource.RowPitch);
+				}
+			}
+			std::vector<std::uint8_t> staging(static_cast<size_t>(stagingSize));
+
+			auto copyRows = [&](size_t index, const std::uint8_t* src)
+			{
+				std::uint8_t* dest = staging.data() + offsets[index];
+				uint64 rowSize = layouts[index].RowPitch;
+				for (uint64 row = 0; row < layouts[index].SlicePitch / rowSize; ++row)
+					std::memcpy(dest + row * rowPitches[index], src + row * rowSize, static_cast<size_t>(rowSize));
+			};
+
+			char label[64];
+			std::snprintf(label, sizeof(label), "%s %u^2 read into vectors", entry.Name, size);
+			Benchmark::Measure(label, [&]()
+			{
+				std::ifstream stream(path, std::ios::binary | std::ios::ate);
+				std::vector<char> contents(static_cast<size_t>(stream.tellg()));
+				stream.seekg(0);
+				stream.read(contents.data(), std::streamsize(contents.size()));
+				std::vector<std::vector<std::uint8_t>> copies(layouts.size());
+				for (size_t i = 0; i < layouts.size(); ++i)
+				{
+					const std::uint8_t* src = reinterpret_cast<const std::uint8_t*>(contents.data()) + fileOffsets[i];
+					copies[i].assign(src, src + layouts[i].SlicePitch);
+					copyRows(i, copies[i].data());
+				}
+			});
+			std::snprintf(label, sizeof(label), "%s %u^2 from the mapping", entry.Name, size);
+			Benchmark::Measure(label, [&]()
+			{
+				TextureFile file;
+				file.Open(path);
+				for (uint32 i = 0; i < file.SubresourceCount(); ++i)
+					copyRows(i, static_cast<const std::uint8_t*>(file.GetSubresource(i).Data));
+			});
+			Benchmark::DoNotOptimize(staging);
+		}
+	}
+	std::remove(path.c_str());
+}
@@ -0,0 +1,219 @@
+#include "TextureUpload.h"
+#include "Benchmark.h"
+#include "TextureCorpus.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+namespace
+{
+	// Source data for every subresource of a footprint, with rows a little
+	// longer than the footprint's so the copies have to use both pitches.
+	struct SourceData
+	{
+		SourceData(const TextureUpload::Footprints& footprints, std::mt19937& random)
+		{
+			size_t count = footprints.Layouts.size();
+			Bytes.resize(count);
+			Subresources.resize(count);
+			for (size_t i = 0; i < count; ++i)
+			{
+				UINT64 rowPitch = footprints.RowSizes[i] + 12;
+				UINT64 slicePitch = rowPitch * footprints.RowCounts[i];
+				Bytes[i].resize(static_cast<size_t>(slicePitch * footprints.Layouts[i].Footprint.Depth));
+				for (BYTE& b : Bytes[i])
+					b = static_cast<BYTE>(random());
+				Subresources[i] = { Bytes[i].data(), LONG_PTR(rowPitch), LONG_PTR(slicePitch) };
+			}
+		}
+
+		std::vector<std::vector<BYTE>> Bytes;
+		std::vector<D3D12_SUBRESOURCE_DATA> Subresources;
+	};
+
+	// Upload memory as CopySubresources gets it: aligned to a cache line.
+	struct StagingMemory
+	{
+		explicit StagingMemory(UINT64 size) :
+			Bytes(static_cast<size_t>(size) + 64)
+		{
+			Data = reinterpret_cast<BYTE*>((reinterpret_cast<std::uintptr_t>(Bytes.data()) + 63) & ~std::uintptr_t(63));
+		}
+
+		std::vector<BYTE> Bytes;
+		BYTE* Data;
+	};
+
+	// What UpdateSubresources does on the CPU: one MemcpySubresource after
+	// another.
+	void CopySerially(BYTE* dest, const TextureUpload::Footprints& footprints, const D3D12_SUBRESOURCE_DATA* src)
+	{
+		for (size_t i = 0; i < footprints.Layouts.size(); ++i)
+		{
+			const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& layout = footprints.Layouts[i];
+			D3D12_MEMCPY_DEST destData = { dest + layout.Offset, layout.Footprint.RowPitch,
+				SIZE_T(layout.Footprint.RowPitch) * footprints.RowCounts[i] };
+			MemcpySubresource(&destData, &src[i], static_cast<SIZE_T>(footprints.RowSizes[i]), footprints.RowCounts[i],
+				layout.Footprint.Depth);
+		}
+	}
+
+	void ExpectSameAsMemcpySubresource(const D3D12_RESOURCE_DESC& desc, UINT threadCount)
+	{
+		UINT count = desc.MipLevels * (desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D ? 1 : desc.DepthOrArraySize);
+		TextureUpload::Footprints footprints;
+		ASSERT_TRUE(TextureUpload::ComputeFootprints(desc, 0, count, 0, footprints));
+		std::mt19937 random(5);
+		SourceData src(footprints, random);
+
+		StagingMemory expected(footprints.TotalBytes);
+		StagingMemory actual(footprints.TotalBytes);
+		CopySerially(expected.Data, footprints, src.Subresources.data());
+		TextureUpload::CopySubresources(actual.Data, footprints, src.Subresources.data(), threadCount);
+		EXPECT_EQ(0, std::memcmp(expected.Data, actual.Data, static_cast<size_t>(footprints.TotalBytes)));
+	}
+}
+
+TEST(TextureUpload, FootprintsPadRowsAndSubresources)
+{
+	TextureUpload::Footprints footprints;
+	D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, 100, 30, 2, 3);
+	ASSERT_TRUE(TextureUpload::ComputeFootprints(desc, 0, 6, 0, footprints));
+	ASSERT_EQ(6u, footprints.Layouts.size());
+
+	EXPECT_EQ(0u, footprints.Layouts[0].Offset);
+	EXPECT_EQ(512u, footprints.Layouts[0].Footprint.RowPitch);
+	EXPECT_EQ(400u, footprints.RowSizes[0]);
+	EXPECT_EQ(30u, footprints.RowCounts[0]);
+
+	EXPECT_EQ(512u * 30, footprints.Layouts[1].Offset);
+	EXPECT_EQ(50u, footprints.Layouts[1].Footprint.Width);
+	EXPECT_EQ(256u, footprints.Layouts[1].Footprint.RowPitch);
+	EXPECT_EQ((512u * 30 + 256 * 15 + 511) & ~511u, footprints.Layouts[2].Offset);
+	EXPECT_EQ(7u, footprints.Layouts[2].Footprint.Height);
+
+	// The second array slice starts over at mip 0.
+	EXPECT_EQ(100u, footprints.Layouts[3].Footprint.Width);
+	EXPECT_EQ(footprints.Layouts[5].Offset + 256 * 6 + 25 * 4, footprints.TotalBytes);
+}
+
+TEST(TextureUpload, FootprintsCountBlocksForCompressedFormats)
+{
+	TextureUpload::Footprints footprints;
+	D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_BC1_UNORM, 70, 70, 1, 7);
+	ASSERT_TRUE(TextureUpload::ComputeFootprints(desc, 0, 7, 1024, footprints));
+
+	// Offsets start at baseOffset; TotalBytes does not count it.
+	EXPECT_EQ(1024u, footprints.Layouts[0].Offset);
+	EXPECT_EQ(72u, footprints.Layouts[0].Footprint.Width);
+	EXPECT_EQ(18u, footprints.RowCounts[0]);
+	EXPECT_EQ(18u * 8, footprints.RowSizes[0]);
+	EXPECT_EQ(footprints.Layouts[6].Offset + 8 - 1024, footprints.TotalBytes);
+
+	// Mips smaller than a block still take a whole one.
+	EXPECT_EQ(4u, footprints.Layouts[6].Footprint.Width);
+	EXPECT_EQ(4u, footprints.Layouts[6].Footprint.Height);
+	EXPECT_EQ(1u, footprints.RowCounts[6]);
+	EXPECT_EQ(8u, footprints.RowSizes[6]);
+}
+
+TEST(TextureUpload, FootprintsOfVolumesHalveTheDepth)
+{
+	TextureUpload::Footprints footprints;
+	D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Tex3D(DXGI_FORMAT_R32_FLOAT, 16, 16, 8, 2);
+	ASSERT_TRUE(TextureUpload::ComputeFootprints(desc, 0, 2, 0, footprints));
+	EXPECT_EQ(8u, footprints.Layouts[0].Footprint.Depth);
+	EXPECT_EQ(4u, footprints.Layouts[1].Footprint.Depth);
+	EXPECT_EQ(256u * 16 * 8, footprints.Layouts[1].Offset);
+}
+
+TEST(TextureUpload, NoFootprintsForBuffersOrUnknownFormats)
+{
+	TextureUpload::Footprints footprints;
+	EXPECT_FALSE(TextureUpload::ComputeFootprints(CD3DX12_RESOURCE_DESC::Buffer(64), 0, 1, 0, footprints));
+	EXPECT_FALSE(TextureUpload::ComputeFootprints(CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_UNKNOWN, 4, 4), 0, 1, 0,
+		footprints));
+}
+
+TEST(TextureUpload, CopySubresourcesMatchesMemcpySubresource)
+{
+	ExpectSameAsMemcpySubresource(CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, 333, 77, 3, 5), 4);
+	ExpectSameAsMemcpySubresource(CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_BC7_UNORM, 130, 66, 1, 6), 3);
+	ExpectSameAsMemcpySubresource(CD3DX12_RESOURCE_DESC::Tex3D(DXGI_FORMAT_R16G16B16A16_FLOAT, 33, 17, 9, 3), 5);
+	ExpectSameAsMemcpySubresource(CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R32_FLOAT, 1, 1, 1, 1), 8);
+}
+
+TEST(TextureUpload, FileSubresourcesCopyStraightIntoStaging)
+{
+	std::mt19937 random(13);
+	const TextureCorpus::Texture textures[] =
+	{
+		{ DXGI_FORMAT_BC7_UNORM, TextureFile::Dimension::Texture2D, 130, 66, 1, 2, 6, false },
+		{ DXGI_FORMAT_R16G16B16A16_FLOAT, TextureFile::Dimension::Texture2D, 16, 16, 1, 1, 5, true },
+		{ DXGI_FORMAT_R32_FLOAT, TextureFile::Dimension::Texture3D, 9, 5, 7, 1, 4, false },
+	};
+	std::string path = ::testing::TempDir() + "upload.dds";
+	for (const TextureCorpus::Texture& texture : textures)
+	{
+		std::vector<TextureCorpus::Bytes> subresources = TextureCorpus::MakeSubresources(texture, random);
+		TextureCorpus::Save(path, TextureCorpus::WriteDds(texture, subresources));
+		TextureFile file;
+		ASSERT_TRUE(file.Open(path)) << file.Error();
+
+		D3D12_RESOURCE_DESC desc = TextureUpload::ResourceDescOf(file);
+		EXPECT_EQ(texture.Format, desc.Format);
+		EXPECT_EQ(texture.Width, desc.Width);
+		EXPECT_EQ(texture.MipLevels, desc.MipLevels);
+		TextureUpload::Footprints footprints;
+		ASSERT_TRUE(TextureUpload::ComputeFootprints(desc, 0, file.SubresourceCount(), 0, footprints));
+
+		std::vector<D3D12_SUBRESOURCE_DATA> src;
+		for (UINT i = 0; i < file.SubresourceCount(); ++i)
+		{
+			const TextureFile::Subresource& subresource = file.GetSubresource(i);
+			src.push_back({ subresource.Data, LONG_PTR(subresource.RowPitch), LONG_PTR(subresource.SlicePitch) });
+		}
+		StagingMemory staging(footprints.TotalBytes);
+		TextureUpload::CopySubresources(staging.Data, footprints, src.data(), 2);
+
+		// Every row lands at its pitch in the footprint.
+		for (UINT i = 0; i < file.SubresourceCount(); ++i)
+		{
+			const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& layout = footprints.Layouts[i];
+			ASSERT_EQ(UINT64(src[i].RowPitch), footprints.RowSizes[i]);
+			for (UINT z = 0; z < layout.Footprint.Depth; ++z)
+			{
+				for (UINT row = 0; row < footprints.RowCounts[i]; ++row)
+				{
+					const BYTE* staged = staging.Data + layout.Offset +
+						UINT64(layout.Footprint.RowPitch) * (row + footprints.RowCounts[i] * z);
+					const BYTE* expected = subresources[i].data() + src[i].SlicePitch * z + src[i].RowPitch * row;
+					ASSERT_EQ(0, std::memcmp(expected, staged, static_cast<size_t>(footprints.RowSizes[i])))
+						<< "subresource " << i << " slice " << z << " row " << row;
+				}
+			}
+		}
+	}
+}
+
+TEST(TextureUploadBenchmark, DISABLED_CopySubresources4Kand8K)
+{
+	for (UINT size : { 4096u, 8192u })
+	{
+		UINT mipLevels = MipChain::FullMipCount(size, size);
+		D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, size, size, 1,
+			static_cast<UINT16>(mipLevels));
+		TextureUpload::Footprints footprints;
+		ASSERT_TRUE(TextureUpload::ComputeFootprints(desc, 0, mipLevels, 0, footprints));
+		std::mt19937 random(9);
+		SourceData src(footprints, random);
+		StagingMemory staging(footprints.TotalBytes);
+
+		char label[64];
+		std::snprintf(label, sizeof(label), "%u^2 RGBA8 MemcpySubresource", size);
+		Benchmark::Measure(label, [&]() { CopySerially(staging.Data, footprints, src.Subresources.data()); });
+		std::snprintf(label, sizeof(label), "%u^2 RGBA8 CopySubresources", size);
+		Benchmark::Measure(label, [&]() { TextureUpload::CopySubresources(staging.Data, footprints, src.Subresources.data()); });
+	}
+}
@@ -0,0 +1,69 @@
+#include "VertexCompression.h"
+#include "MathHelper.h"
+#include <gtest/gtest.h>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	using MeshData = GeometryGenerator::MeshData;
+
+	struct Shape
+	{
+		const char* Name;
+		MeshData Mesh;
+	};
+
+	std::vector<Shape> Shapes()
+	{
+		GeometryGenerator generator;
+		std::vector<Shape> shapes;
+		shapes.push_back({ "box", generator.CreateBox(1.5f, 0.5f, 1.5f, 3) });
+		shapes.push_back({ "sphere", generator.CreateSphere(0.5f, 20, 20) });
+		shapes.push_back({ "geosphere", generator.CreateGeosphere(0.5f, 3) });
+		shapes.push_back({ "cylinder", generator.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20) });
+		shapes.push_back({ "grid", generator.CreateGrid(20.0f, 30.0f, 60, 40) });
+		shapes.push_back({ "quad", generator.CreateQuad(-1.0f, 1.0f, 2.0f, 2.0f, 0.0f) });
+		return shapes;
+	}
+}
+
+TEST(VertexCompression, PackedLayoutsMatchTheStructs)
+{
+	EXPECT_EQ(20u, sizeof(PackedVertex));
+	EXPECT_EQ(12u, sizeof(PackedAttributes));
+
+	UINT packedBytes = 0;
+	for (const D3D12_INPUT_ELEMENT_DESC& element : VertexCompression::PackedVertexLayout())
+	{
+		EXPECT_EQ(packedBytes, element.AlignedByteOffset) << element.SemanticName;
+		packedBytes += element.Format == DXGI_FORMAT_R16G16B16A16_UNORM ? 8 : 4;
+	}
+	EXPECT_EQ(sizeof(PackedVertex), packedBytes);
+}
+
+// Each bound is what the encoding can be expected to lose: half a unorm16
+// step of the bounds on each axis, half a half-float step below 1 for the
+// texture coordinates, and for the octahedral directions what the float
+// acos in MeasureError can resolve, which is coarser than the encoding.
+TEST(VertexCompression, MeasureErrorStaysWithinTheEncodingsPrecision)
+{
+	for (const Shape& shape : Shapes())
+	{
+		const MeshData& mesh = shape.Mesh;
+		BoundingBox bounds = MathHelper::ComputeBoundingBox(&mesh.Vertices[0].Position, mesh.Vertices.size(),
+			sizeof(GeometryGenerator::Vertex));
+		PositionQuantization quantization = VertexCompression::QuantizationFor(bounds);
+		VertexCompression::ErrorStats error =
+			VertexCompression::MeasureError(mesh.Vertices.data(), mesh.Vertices.size(), quantization);
+
+		float halfStep = 0.5f / 65535.0f;
+		float maxPositionError = halfStep * std::sqrt(quantization.Scale.x * quantization.Scale.x +
+			quantization.Scale.y * quantization.Scale.y + quantization.Scale.z * quantization.Scale.z);
+		EXPECT_LE(error.MaxPositionError, maxPositionError * 1.01f + 1e-6f) << shape.Name;
+		EXPECT_LE(error.MaxNormalAngle, 0.05f) << shape.Name;
+		EXPECT_LE(error.MaxTangentAngle, 0.05f) << shape.Name;
+		EXPECT_LE(error.MaxTexCError, 1.0f / 4096.0f) << shape.Name;
+	}
+}